@@ -0,0 +1,290 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+#if defined(__has_include)
+#if __has_include(<memory_resource>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#include <memory_resource>
+#define HYDROGEN_HAS_MEMORY_RESOURCE 1
+#endif
+#endif
+
+namespace hy {
+    /* arena is a bump-pointer (monotonic) allocator for data that dies all
+     * together, e.g. everything parsed from one request. Allocating moves
+     * a pointer through the current chunk; deallocating does nothing but
+     * give back the last block; reset() frees everything at once, in O(1).
+     *
+     * reset() keeps the chunks and fills them again, so an arena reused
+     * request after request stops touching the heap once it has grown to
+     * fit the biggest one. It may also start with a buffer of the caller,
+     * e.g. on the stack. An arena is not thread-safe.
+     *
+     * Containers allocate from an arena through arena_allocator.
+     */
+    class arena {
+    public:
+        static const size_t max_align = std::alignment_of<std::max_align_t>::value;
+
+        /* Chunks are allocated when needed, the first of `chunk_size`
+         * bytes and each next one twice as big, up to max_chunk_size.
+         */
+        explicit arena(size_t chunk_size = 4096)
+            : _head(nullptr), _current(nullptr), _cur(nullptr), _end(nullptr),
+              _chunk_size(chunk_size), _next_size(chunk_size), _chunks(0){}
+
+        /* Allocates from `buffer` first. The arena does not own it. */
+        arena(void* buffer, size_t size, size_t chunk_size = 4096)
+            : arena(chunk_size){
+            char* p = align_up((char*)buffer, max_align);
+            size_t skip = p - (char*)buffer;
+            if (size > skip + header_size){
+                _head = (chunk*)p;
+                _head->next = nullptr;
+                _head->size = size - skip - header_size;
+                _head->owned = false;
+                reset();
+            }
+        }
+
+        ~arena(){
+            release();
+        }
+
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        /* `bytes` bytes aligned to `align`, a power of 2. */
+        void* allocate(size_t bytes, size_t align = max_align){
+            char* p = align_up(_cur, align);
+            if (_cur && p <= _end && bytes <= (size_t)(_end - p)){
+                _cur = p + bytes;
+                return p;
+            }
+            return grow(bytes, align);
+        }
+
+        /* Gives the block back if it is the last one allocated; otherwise
+         * its memory is reclaimed by reset().
+         */
+        void deallocate(void* p, size_t bytes){
+            if ((char*)p + bytes == _cur){
+                _cur = (char*)p;
+            }
+        }
+
+        /* A NUL-terminated copy of the `n` chars at `s`. */
+        char* copy(const char* s, size_t n){
+            char* p = (char*)allocate(n + 1, 1);
+            memcpy(p, s, n);
+            p[n] = '\0';
+            return p;
+        }
+
+        /* Frees everything allocated, keeping the chunks for reuse. */
+        void reset(){
+            _current = _head;
+            _cur = _head ? data(_head) : nullptr;
+            _end = _head ? _cur + _head->size : nullptr;
+        }
+
+        /* Frees everything allocated and returns the chunks to the heap. */
+        void release(){
+            chunk* c = _head;
+            _head = nullptr;
+            while (c){
+                chunk* next = c->next;
+                if (c->owned){
+                    free(c);
+                }
+                else {
+                    /* the caller's buffer comes first */
+                    _head = c;
+                    c->next = nullptr;
+                }
+                c = next;
+            }
+            _chunks = 0;
+            _next_size = _chunk_size;
+            reset();
+        }
+
+        /* Number of chunks allocated from the heap and kept. */
+        size_t chunks() const { return _chunks; }
+
+    private:
+        struct chunk {
+            chunk* next;
+            size_t size;
+            bool owned;
+        };
+
+        static const size_t header_size = (sizeof(chunk) + max_align - 1) & ~(max_align - 1);
+        static const size_t max_chunk_size = 1024 * 1024;
+
+        static char* align_up(char* p, size_t align){
+            return (char*)(((uintptr_t)p + align - 1) & ~(uintptr_t)(align - 1));
+        }
+
+        static char* data(chunk* c){
+            return (char*)c + header_size;
+        }
+
+        void* grow(size_t bytes, size_t align){
+            if (bytes == 0){
+                bytes = 1;
+            }
+            size_t need = bytes + (align > max_align ? align - 1 : 0);
+            if (need < bytes){
+                throw std::bad_alloc();
+            }
+
+            /* refill the chunks kept by reset() before allocating one */
+            chunk* c = _current ? _current->next : _head;
+            while (c && c->size < need){
+                c = c->next;
+            }
+            if (!c){
+                size_t size = need > _next_size ? need : _next_size;
+                if (size > (size_t)-1 - header_size){
+                    throw std::bad_alloc();
+                }
+                c = (chunk*)malloc(header_size + size);
+                if (!c){
+                    throw std::bad_alloc();
+                }
+                c->size = size;
+                c->owned = true;
+                if (_current){
+                    c->next = _current->next;
+                    _current->next = c;
+                }
+                else {
+                    c->next = _head;
+                    _head = c;
+                }
+                ++_chunks;
+                if (_next_size < max_chunk_size){
+                    _next_size *= 2;
+                }
+            }
+
+            _current = c;
+            char* p = align_up(data(c), align);
+            _cur = p + bytes;
+            _end = data(c) + c->size;
+            return p;
+        }
+
+        chunk* _head;
+        chunk* _current;
+        char* _cur;
+        char* _end;
+        size_t _chunk_size;
+        size_t _next_size;
+        size_t _chunks;
+    };
+
+    /* A standard allocator that allocates from an arena, which must
+     * outlive what is allocated. Copies of a container share its arena.
+     */
+    template<typename T>
+    class arena_allocator {
+    public:
+        typedef T value_type;
+        typedef T* pointer;
+        typedef const T* const_pointer;
+        typedef T& reference;
+        typedef const T& const_reference;
+        typedef size_t size_type;
+        typedef ptrdiff_t difference_type;
+
+        template<typename U>
+        struct rebind {
+            typedef arena_allocator<U> other;
+        };
+
+        arena_allocator(arena& a) : _arena(&a){}
+
+        template<typename U>
+        arena_allocator(const arena_allocator<U>& other) : _arena(other.resource()){}
+
+        T* allocate(size_t n){
+            if (n > max_size()){
+                throw std::bad_alloc();
+            }
+            return static_cast<T*>(_arena->allocate(n * sizeof(T), std::alignment_of<T>::value));
+        }
+
+        void deallocate(T* p, size_t n){
+            _arena->deallocate(p, n * sizeof(T));
+        }
+
+        template<typename U, typename... Args>
+        void construct(U* p, Args&&... args){
+            new ((void*)p) U(std::forward<Args>(args)...);
+        }
+
+        template<typename U>
+        void destroy(U* p){
+            p->~U();
+        }
+
+        size_t max_size() const { return (size_t)-1 / sizeof(T); }
+
+        arena* resource() const { return _arena; }
+
+    private:
+        arena* _arena;
+    };
+
+    template<typename T, typename U>
+    inline bool operator== (const arena_allocator<T>& left, const arena_allocator<U>& right){
+        return left.resource() == right.resource();
+    }
+
+    template<typename T, typename U>
+    inline bool operator!= (const arena_allocator<T>& left, const arena_allocator<U>& right){
+        return left.resource() != right.resource();
+    }
+
+    template<typename T>
+    using arena_vector = std::vector<T, arena_allocator<T>>;
+
+    typedef std::basic_string<char, std::char_traits<char>, arena_allocator<char>> arena_string;
+
+#ifdef HYDROGEN_HAS_MEMORY_RESOURCE
+    /* An arena as a std::pmr::memory_resource, for C++17 code that takes
+     * std::pmr containers.
+     */
+    class arena_resource : public std::pmr::memory_resource {
+    public:
+        explicit arena_resource(arena& a) : _arena(&a){}
+
+        arena* resource() const { return _arena; }
+
+    private:
+        void* do_allocate(size_t bytes, size_t align) override {
+            return _arena->allocate(bytes, align);
+        }
+
+        void do_deallocate(void* p, size_t bytes, size_t) override {
+            _arena->deallocate(p, bytes);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            auto r = dynamic_cast<const arena_resource*>(&other);
+            return r && r->_arena == _arena;
+        }
+
+        arena* _arena;
+    };
+#endif
+}
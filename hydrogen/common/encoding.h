@@ -0,0 +1,574 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+#include <hydrogen/common/arena.h>
+#include <hydrogen/common/charconv.h>
+#include <hydrogen/common/simd.h>
+#include <hydrogen/common/string.h>
+
+namespace hy {
+    /*
+     * Base64 (RFC 4648, the standard and the URL-safe alphabets) and hex
+     * encodings of bytes, written to [first, last) ranges of the caller's
+     * or to an arena, with no std::string in between.
+     *
+     * Decoding is strict: the text must be in the alphabet and no more
+     * (no white space), padded as the alphabet requires, and the bits the
+     * last character has beyond the bytes must be zero, so every byte
+     * string has one encoding. Decoding errors tell where in the text
+     * they are, see decode_result.
+     *
+     * Like hy::string's, the kernels have scalar, SSE2 and AVX2 versions
+     * picked at run time. Base64 needs a byte shuffle (pshufb) that SSE2
+     * lacks, so it is scalar below AVX2.
+     */
+    enum class base64_alphabet { standard, url };
+
+    /* The result of decoding text to [first, last): `ptr` is the end of
+     * the bytes written, and `in` where the text stopped being read.
+     *  - conv_errc::none: `in` is the end of the text;
+     *  - conv_errc::invalid: `ptr` is `first`, and `in` the first character
+     *    that is not valid, or the end of the text if it is cut short;
+     *  - conv_errc::out_of_range: the bytes do not fit; `ptr` is `last`,
+     *    and `in` the beginning of the text.
+     */
+    struct decode_result {
+        char* ptr;
+        const char* in;
+        conv_errc ec;
+    };
+
+    namespace encoding {
+        inline const char* base64_chars(base64_alphabet alphabet){
+            return alphabet == base64_alphabet::url
+                ? "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"
+                : "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        }
+
+        /* The value of base64 character `c`, or -1. */
+        inline int base64_value(char c, base64_alphabet alphabet){
+            static const signed char standard[128] = {
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+                52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+                -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+                15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+                -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+                41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1
+            };
+            static const signed char url[128] = {
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1,
+                52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+                -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+                15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, 63,
+                -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+                41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1
+            };
+            unsigned char u = (unsigned char)c;
+            return u < 128 ? (alphabet == base64_alphabet::url ? url : standard)[u] : -1;
+        }
+
+        /* The value of hex digit `c`, either case, or -1. */
+        inline int hex_value(char c){
+            static const signed char values[128] = {
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+                -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+            };
+            unsigned char u = (unsigned char)c;
+            return u < 128 ? values[u] : -1;
+        }
+
+        /* The kernels work on whole blocks, advancing `p` and `out` past
+         * those they did; they stop at the first block with an invalid
+         * character, and leave the rest to the caller.
+         */
+        namespace scalar {
+            inline void base64_encode(const char*& p, const char* e, char*& out, base64_alphabet alphabet){
+                const char* chars = base64_chars(alphabet);
+                for (; e - p >= 3; p += 3, out += 4){
+                    const unsigned char* b = (const unsigned char*)p;
+                    uint32_t v = (uint32_t)b[0] << 16 | (uint32_t)b[1] << 8 | b[2];
+                    out[0] = chars[v >> 18];
+                    out[1] = chars[v >> 12 & 63];
+                    out[2] = chars[v >> 6 & 63];
+                    out[3] = chars[v & 63];
+                }
+            }
+
+            inline void base64_decode(const char*& p, const char* e, char*& out, base64_alphabet alphabet){
+                for (; e - p >= 4; p += 4, out += 3){
+                    int a = base64_value(p[0], alphabet), b = base64_value(p[1], alphabet);
+                    int c = base64_value(p[2], alphabet), d = base64_value(p[3], alphabet);
+                    if ((a | b | c | d) < 0){
+                        return;
+                    }
+                    uint32_t v = (uint32_t)a << 18 | (uint32_t)b << 12 | (uint32_t)c << 6 | (uint32_t)d;
+                    out[0] = (char)(v >> 16);
+                    out[1] = (char)(v >> 8);
+                    out[2] = (char)v;
+                }
+            }
+
+            inline void hex_encode(const char*& p, const char* e, char*& out, bool upper){
+                const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+                for (; p != e; ++p, out += 2){
+                    unsigned char b = (unsigned char)*p;
+                    out[0] = digits[b >> 4];
+                    out[1] = digits[b & 15];
+                }
+            }
+
+            inline void hex_decode(const char*& p, const char* e, char*& out){
+                for (; e - p >= 2; p += 2, ++out){
+                    int hi = hex_value(p[0]), lo = hex_value(p[1]);
+                    if ((hi | lo) < 0){
+                        return;
+                    }
+                    *out = (char)(hi << 4 | lo);
+                }
+            }
+        }
+
+#ifdef HYDROGEN_SIMD_X86
+        namespace sse2 {
+            /* nibbles 0-15 to their hex digits */
+            inline __m128i hex_digits(__m128i n, char letters){
+                __m128i d = _mm_add_epi8(n, _mm_set1_epi8('0'));
+                return _mm_add_epi8(d, _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8(letters)));
+            }
+
+            /* hex digits to their nibbles; `valid` loses the bytes that are not */
+            inline __m128i hex_nibbles(__m128i x, __m128i& valid){
+                using simd::sse2::in_range;
+                __m128i digit = in_range(x, '0', '9');
+                __m128i folded = _mm_or_si128(x, _mm_set1_epi8(0x20));
+                __m128i letter = in_range(folded, 'a', 'f');
+                valid = _mm_and_si128(valid, _mm_or_si128(digit, letter));
+                return _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(x, _mm_set1_epi8('0'))),
+                                    _mm_and_si128(letter, _mm_sub_epi8(folded, _mm_set1_epi8('a' - 10))));
+            }
+
+            /* the two nibbles of each 16-bit lane, first one high, as a byte */
+            inline __m128i hex_join(__m128i n){
+                return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(n, _mm_set1_epi16(0xff)), 4), _mm_srli_epi16(n, 8));
+            }
+
+            inline void hex_encode(const char*& p, const char* e, char*& out, bool upper){
+                const char letters = upper ? 'A' - '0' - 10 : 'a' - '0' - 10;
+                const __m128i low = _mm_set1_epi8(0x0f);
+                for (; e - p >= 16; p += 16, out += 32){
+                    __m128i x = _mm_loadu_si128((const __m128i*)p);
+                    __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), low);
+                    __m128i lo = _mm_and_si128(x, low);
+                    _mm_storeu_si128((__m128i*)out, hex_digits(_mm_unpacklo_epi8(hi, lo), letters));
+                    _mm_storeu_si128((__m128i*)(out + 16), hex_digits(_mm_unpackhi_epi8(hi, lo), letters));
+                }
+                scalar::hex_encode(p, e, out, upper);
+            }
+
+            inline void hex_decode(const char*& p, const char* e, char*& out){
+                for (; e - p >= 32; p += 32, out += 16){
+                    __m128i valid = _mm_set1_epi8(-1);
+                    __m128i a = hex_nibbles(_mm_loadu_si128((const __m128i*)p), valid);
+                    __m128i b = hex_nibbles(_mm_loadu_si128((const __m128i*)(p + 16)), valid);
+                    if (_mm_movemask_epi8(valid) != 0xffff){
+                        break;
+                    }
+                    _mm_storeu_si128((__m128i*)out, _mm_packus_epi16(hex_join(a), hex_join(b)));
+                }
+                scalar::hex_decode(p, e, out);
+            }
+        }
+
+        namespace avx2 {
+            HYDROGEN_TARGET_AVX2
+            inline __m256i hex_digits(__m256i n, char letters){
+                __m256i d = _mm256_add_epi8(n, _mm256_set1_epi8('0'));
+                return _mm256_add_epi8(d, _mm256_and_si256(_mm256_cmpgt_epi8(n, _mm256_set1_epi8(9)), _mm256_set1_epi8(letters)));
+            }
+
+            HYDROGEN_TARGET_AVX2
+            inline __m256i hex_nibbles(__m256i x, __m256i& valid){
+                using simd::avx2::in_range;
+                __m256i digit = in_range(x, '0', '9');
+                __m256i folded = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+                __m256i letter = in_range(folded, 'a', 'f');
+                valid = _mm256_and_si256(valid, _mm256_or_si256(digit, letter));
+                return _mm256_or_si256(_mm256_and_si256(digit, _mm256_sub_epi8(x, _mm256_set1_epi8('0'))),
+                                       _mm256_and_si256(letter, _mm256_sub_epi8(folded, _mm256_set1_epi8('a' - 10))));
+            }
+
+            HYDROGEN_TARGET_AVX2
+            inline __m256i hex_join(__m256i n){
+                return _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(n, _mm256_set1_epi16(0xff)), 4), _mm256_srli_epi16(n, 8));
+            }
+
+            HYDROGEN_TARGET_AVX2
+            inline void hex_encode(const char*& p, const char* e, char*& out, bool upper){
+                const char letters = upper ? 'A' - '0' - 10 : 'a' - '0' - 10;
+                const __m256i low = _mm256_set1_epi8(0x0f);
+                for (; e - p >= 32; p += 32, out += 64){
+                    __m256i x = _mm256_loadu_si256((const __m256i*)p);
+                    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), low);
+                    __m256i lo = _mm256_and_si256(x, low);
+                    /* unpacking works within 128-bit lanes: put them back in order */
+                    __m256i a = hex_digits(_mm256_unpacklo_epi8(hi, lo), letters);
+                    __m256i b = hex_digits(_mm256_unpackhi_epi8(hi, lo), letters);
+                    _mm256_storeu_si256((__m256i*)out, _mm256_permute2x128_si256(a, b, 0x20));
+                    _mm256_storeu_si256((__m256i*)(out + 32), _mm256_permute2x128_si256(a, b, 0x31));
+                }
+                sse2::hex_encode(p, e, out, upper);
+            }
+
+            HYDROGEN_TARGET_AVX2
+            inline void hex_decode(const char*& p, const char* e, char*& out){
+                for (; e - p >= 64; p += 64, out += 32){
+                    __m256i valid = _mm256_set1_epi8(-1);
+                    __m256i a = hex_nibbles(_mm256_loadu_si256((const __m256i*)p), valid);
+                    __m256i b = hex_nibbles(_mm256_loadu_si256((const __m256i*)(p + 32)), valid);
+                    if ((unsigned)_mm256_movemask_epi8(valid) != 0xffffffff){
+                        break;
+                    }
+                    __m256i packed = _mm256_packus_epi16(hex_join(a), hex_join(b));
+                    _mm256_storeu_si256((__m256i*)out, _mm256_permute4x64_epi64(packed, 0xd8));
+                }
+                sse2::hex_decode(p, e, out);
+            }
+
+            /* 24 bytes to 32 characters a step (Muła's method): spread each
+             * 3 bytes over 4, cut them into 6-bit values with multiplies,
+             * and add to each the offset of its range in the alphabet.
+             */
+            HYDROGEN_TARGET_AVX2
+            inline void base64_encode(const char*& p, const char* e, char*& out, base64_alphabet alphabet){
+                const __m256i spread = _mm256_setr_epi8(
+                    1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                    1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+                /* offsets of A-Z, a-z, 0-9 (x10), and the last two characters */
+                const char c62 = alphabet == base64_alphabet::url ? '-' - 62 : '+' - 62;
+                const char c63 = alphabet == base64_alphabet::url ? '_' - 63 : '/' - 63;
+                const __m256i offsets = _mm256_setr_epi8(
+                    'A', 'a' - 26, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, c62, c63, 0, 0,
+                    'A', 'a' - 26, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, c62, c63, 0, 0);
+                const char* s = p;
+                char* d = out;
+                for (; e - s >= 28; s += 24, d += 32){
+                    __m128i lo = _mm_loadu_si128((const __m128i*)s);
+                    __m128i hi = _mm_loadu_si128((const __m128i*)(s + 12));
+                    __m256i in = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), spread);
+                    __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+                    __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+                    __m256i v = _mm256_or_si256(t0, t1);
+                    /* 0 for A-Z, 1 for a-z, 2-11 for digits, 12 and 13 */
+                    __m256i range = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+                    range = _mm256_sub_epi8(range, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(25)));
+                    _mm256_storeu_si256((__m256i*)d, _mm256_add_epi8(v, _mm256_shuffle_epi8(offsets, range)));
+                }
+                p = s;
+                out = d;
+                scalar::base64_encode(p, e, out, alphabet);
+            }
+
+            /* 32 characters to 24 bytes a step: validate and map them to
+             * 6-bit values with range compares, then pack each 4 into 3
+             * with multiply-adds and shuffles.
+             */
+            HYDROGEN_TARGET_AVX2
+            inline void base64_decode(const char*& p, const char* e, char*& out, base64_alphabet alphabet){
+                using simd::avx2::in_range;
+                const char c62 = alphabet == base64_alphabet::url ? '-' : '+';
+                const char c63 = alphabet == base64_alphabet::url ? '_' : '/';
+                const __m256i pack = _mm256_setr_epi8(
+                    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+                /* locals: the stores could alias the references */
+                const char* s = p;
+                char* d = out;
+                for (; e - s >= 32; s += 32, d += 24){
+                    __m256i x = _mm256_loadu_si256((const __m256i*)s);
+                    __m256i upper = in_range(x, 'A', 'Z');
+                    __m256i lower = in_range(x, 'a', 'z');
+                    __m256i digit = in_range(x, '0', '9');
+                    __m256i is62 = _mm256_cmpeq_epi8(x, _mm256_set1_epi8(c62));
+                    __m256i is63 = _mm256_cmpeq_epi8(x, _mm256_set1_epi8(c63));
+                    __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, _mm256_or_si256(is62, is63)));
+                    if ((unsigned)_mm256_movemask_epi8(valid) != 0xffffffff){
+                        break;
+                    }
+                    __m256i shift = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-'A')), _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a'))),
+                        _mm256_or_si256(_mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')),
+                                        _mm256_or_si256(_mm256_and_si256(is62, _mm256_set1_epi8((char)(62 - c62))),
+                                                        _mm256_and_si256(is63, _mm256_set1_epi8((char)(63 - c63))))));
+                    __m256i v = _mm256_add_epi8(x, shift);
+                    /* aaaaaa bbbbbb -> 12 bits, then two of those -> 24 */
+                    v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+                    v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+                    v = _mm256_shuffle_epi8(v, pack);
+                    v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+                    _mm_storeu_si128((__m128i*)d, _mm256_castsi256_si128(v));
+                    _mm_storel_epi64((__m128i*)(d + 16), _mm256_extracti128_si256(v, 1));
+                }
+                p = s;
+                out = d;
+                scalar::base64_decode(p, e, out, alphabet);
+            }
+        }
+#endif
+
+        inline void base64_encode(const char*& p, const char* e, char*& out, base64_alphabet alphabet){
+#ifdef HYDROGEN_SIMD_X86
+            if (simd::active() == simd::isa::avx2){
+                return avx2::base64_encode(p, e, out, alphabet);
+            }
+#endif
+            scalar::base64_encode(p, e, out, alphabet);
+        }
+
+        inline void base64_decode(const char*& p, const char* e, char*& out, base64_alphabet alphabet){
+#ifdef HYDROGEN_SIMD_X86
+            if (simd::active() == simd::isa::avx2){
+                return avx2::base64_decode(p, e, out, alphabet);
+            }
+#endif
+            scalar::base64_decode(p, e, out, alphabet);
+        }
+
+        inline void hex_encode(const char*& p, const char* e, char*& out, bool upper){
+#ifdef HYDROGEN_SIMD_X86
+            switch (simd::active()){
+            case simd::isa::avx2: return avx2::hex_encode(p, e, out, upper);
+            case simd::isa::sse2: return sse2::hex_encode(p, e, out, upper);
+            default: break;
+            }
+#endif
+            scalar::hex_encode(p, e, out, upper);
+        }
+
+        inline void hex_decode(const char*& p, const char* e, char*& out){
+#ifdef HYDROGEN_SIMD_X86
+            switch (simd::active()){
+            case simd::isa::avx2: return avx2::hex_decode(p, e, out);
+            case simd::isa::sse2: return sse2::hex_decode(p, e, out);
+            default: break;
+            }
+#endif
+            scalar::hex_decode(p, e, out);
+        }
+    }
+
+    /* Length of the base64 text of `n` bytes. */
+    inline size_t base64_encoded_length(size_t n, bool pad = true){
+        return pad ? (n + 2) / 3 * 4 : n / 3 * 4 + (n % 3 ? n % 3 + 1 : 0);
+    }
+
+    /* At most how many bytes `n` characters of base64 text decode to. */
+    inline size_t base64_decoded_length(size_t n){
+        return n / 4 * 3 + (n % 4 > 1 ? n % 4 - 1 : 0);
+    }
+
+    /* Writes the base64 text of `bytes` to [first, last), padded with '='
+     * to a multiple of 4 characters if `pad`. Returns the end of the text,
+     * or `last` and conv_errc::out_of_range if it does not fit.
+     */
+    inline to_chars_result base64_encode(char* first, char* last, const string& bytes,
+                                         base64_alphabet alphabet = base64_alphabet::standard, bool pad = true){
+        to_chars_result r = { last, conv_errc::out_of_range };
+        if (base64_encoded_length(bytes.length(), pad) > (size_t)(last - first)){
+            return r;
+        }
+        const char* p = bytes.begin();
+        const char* e = bytes.end();
+        char* out = first;
+        encoding::base64_encode(p, e, out, alphabet);
+
+        /* 1 or 2 bytes left: 2 or 3 characters */
+        if (p != e){
+            const char* chars = encoding::base64_chars(alphabet);
+            uint32_t v = (uint32_t)(unsigned char)p[0] << 16;
+            if (e - p == 2){
+                v |= (uint32_t)(unsigned char)p[1] << 8;
+            }
+            *out++ = chars[v >> 18];
+            *out++ = chars[v >> 12 & 63];
+            if (e - p == 2){
+                *out++ = chars[v >> 6 & 63];
+            }
+            else if (pad){
+                *out++ = '=';
+            }
+            if (pad){
+                *out++ = '=';
+            }
+        }
+        r.ptr = out;
+        r.ec = conv_errc::none;
+        return r;
+    }
+
+    /* The base64 text of `bytes`, allocated from `a` and NUL-terminated. */
+    inline string base64_encode(arena& a, const string& bytes,
+                                base64_alphabet alphabet = base64_alphabet::standard, bool pad = true){
+        size_t n = base64_encoded_length(bytes.length(), pad);
+        char* text = (char*)a.allocate(n + 1, 1);
+        base64_encode(text, text + n, bytes, alphabet, pad);
+        text[n] = '\0';
+        return string(text, n);
+    }
+
+    /* Writes the bytes of base64 `text` to [first, last). The standard
+     * alphabet must be padded; the URL-safe one may be, as its users (JWT
+     * and the like) mostly do not. A character whose bits beyond the
+     * last byte are not zero is not valid. On errors, [first, last) may
+     * have been written to.
+     */
+    inline decode_result base64_decode(char* first, char* last, const string& text,
+                                       base64_alphabet alphabet = base64_alphabet::standard){
+        decode_result invalid = { first, text.end(), conv_errc::invalid };
+        const char* p = text.begin();
+        const char* e = text.end();
+        size_t padding = 0;
+        if (p != e && e[-1] == '='){
+            padding = e - p > 1 && e[-2] == '=' ? 2 : 1;
+        }
+        if ((padding || alphabet == base64_alphabet::standard) && text.length() % 4){
+            return invalid;
+        }
+        e -= padding;
+        size_t rest = (e - p) % 4;
+        if (rest == 1){
+            return invalid;
+        }
+        size_t n = (e - p) / 4 * 3 + (rest ? rest - 1 : 0);
+        if (n > (size_t)(last - first)){
+            decode_result r = { last, text.begin(), conv_errc::out_of_range };
+            return r;
+        }
+
+        char* out = first;
+        encoding::base64_decode(p, e - rest, out, alphabet);
+        if (p != e - rest){
+            /* the kernels stop at the block of the character */
+            while (encoding::base64_value(*p, alphabet) >= 0){
+                ++p;
+            }
+            invalid.in = p;
+            return invalid;
+        }
+        if (rest){
+            int a = encoding::base64_value(p[0], alphabet);
+            int b = encoding::base64_value(p[1], alphabet);
+            int c = rest == 3 ? encoding::base64_value(p[2], alphabet) : 0;
+            if ((a | b | c) < 0){
+                invalid.in = a < 0 ? p : b < 0 ? p + 1 : p + 2;
+                return invalid;
+            }
+            /* the bits past the last byte must be 0 */
+            if (rest == 2 ? b & 15 : c & 3){
+                invalid.in = p + rest - 1;
+                return invalid;
+            }
+            *out++ = (char)(a << 2 | b >> 4);
+            if (rest == 3){
+                *out++ = (char)(b << 4 | c >> 2);
+            }
+        }
+        decode_result r = { out, text.end(), conv_errc::none };
+        return r;
+    }
+
+    /* Decodes base64 `text` into memory of `a`: `bytes` gets the result,
+     * NUL-terminated, if it returns conv_errc::none.
+     */
+    inline conv_errc base64_decode(arena& a, const string& text, string& bytes,
+                                   base64_alphabet alphabet = base64_alphabet::standard){
+        size_t n = base64_decoded_length(text.length());
+        char* out = (char*)a.allocate(n + 1, 1);
+        decode_result r = base64_decode(out, out + n, text, alphabet);
+        if (r.ec != conv_errc::none){
+            a.deallocate(out, n + 1);
+            return r.ec;
+        }
+        *r.ptr = '\0';
+        bytes = string(out, r.ptr);
+        return conv_errc::none;
+    }
+
+    /* Writes the hex digits of `bytes`, two per byte, to [first, last).
+     * Returns the end of the text, or `last` and conv_errc::out_of_range
+     * if it does not fit.
+     */
+    inline to_chars_result hex_encode(char* first, char* last, const string& bytes, bool upper = false){
+        to_chars_result r = { last, conv_errc::out_of_range };
+        if (bytes.length() > (size_t)(last - first) / 2){
+            return r;
+        }
+        const char* p = bytes.begin();
+        r.ptr = first;
+        encoding::hex_encode(p, bytes.end(), r.ptr, upper);
+        r.ec = conv_errc::none;
+        return r;
+    }
+
+    /* The hex digits of `bytes`, allocated from `a` and NUL-terminated. */
+    inline string hex_encode(arena& a, const string& bytes, bool upper = false){
+        size_t n = bytes.length() * 2;
+        char* text = (char*)a.allocate(n + 1, 1);
+        hex_encode(text, text + n, bytes, upper);
+        text[n] = '\0';
+        return string(text, n);
+    }
+
+    /* Writes the bytes of hex `text`, of either case, to [first, last).
+     * On errors, [first, last) may have been written to.
+     */
+    inline decode_result hex_decode(char* first, char* last, const string& text){
+        decode_result r = { first, text.end(), conv_errc::invalid };
+        if (text.length() % 2){
+            return r;
+        }
+        if (text.length() / 2 > (size_t)(last - first)){
+            r.ptr = last;
+            r.in = text.begin();
+            r.ec = conv_errc::out_of_range;
+            return r;
+        }
+        const char* p = text.begin();
+        char* out = first;
+        encoding::hex_decode(p, text.end(), out);
+        if (p != text.end()){
+            while (encoding::hex_value(*p) >= 0){
+                ++p;
+            }
+            r.in = p;
+            return r;
+        }
+        r.ptr = out;
+        r.ec = conv_errc::none;
+        return r;
+    }
+
+    /* Decodes hex `text` into memory of `a`, as base64_decode() does. */
+    inline conv_errc hex_decode(arena& a, const string& text, string& bytes){
+        size_t n = text.length() / 2;
+        char* out = (char*)a.allocate(n + 1, 1);
+        decode_result r = hex_decode(out, out + n, text);
+        if (r.ec != conv_errc::none){
+            a.deallocate(out, n + 1);
+            return r.ec;
+        }
+        *r.ptr = '\0';
+        bytes = string(out, r.ptr);
+        return conv_errc::none;
+    }
+}
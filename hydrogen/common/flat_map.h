@@ -0,0 +1,459 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <iterator>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+
+#include <hydrogen/common/hash.h>
+#include <hydrogen/common/simd.h>
+#include <hydrogen/common/string.h>
+
+namespace hy {
+    /* Control bytes of flat_map: one per slot, telling an empty, erased or
+     * full slot, and for a full one 7 bits of its key's hash. A group of 16
+     * is compared against a hash at once, so that most lookups look at one
+     * key only: the one they are after.
+     */
+    namespace swiss {
+        static const int8_t empty = -128;
+        static const int8_t deleted = -2;
+        static const size_t group_size = 16;
+
+        /* Bit i set for each slot i of the group whose control byte is `c`. */
+        inline unsigned match(const int8_t* group, int8_t c){
+#ifdef HYDROGEN_SIMD_X86
+            __m128i g = _mm_loadu_si128((const __m128i*)group);
+            return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(c)));
+#else
+            unsigned m = 0;
+            for (size_t i = 0; i < group_size; ++i){
+                m |= (unsigned)(group[i] == c) << i;
+            }
+            return m;
+#endif
+        }
+
+        /* Bit i set for each empty or erased slot i of the group. */
+        inline unsigned match_free(const int8_t* group){
+#ifdef HYDROGEN_SIMD_X86
+            return (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+            unsigned m = 0;
+            for (size_t i = 0; i < group_size; ++i){
+                m |= (unsigned)(group[i] < 0) << i;
+            }
+            return m;
+#endif
+        }
+    }
+
+    /*
+     * flat_map is an unordered map stored in one flat array of slots with
+     * open addressing, in the manner of Abseil's Swiss tables: a lookup
+     * hashes once, probes groups of 16 control bytes with one SIMD compare
+     * each, and compares keys only on a 7-bit hash match.
+     *
+     * Lookups (find, count, at, erase) take any type that Hash and Eq
+     * accept alongside K, so a map keyed by std::string can be searched
+     * with hy::string slices without allocating; see string_map. The
+     * hash of such a type must equal the hash of the equal key.
+     *
+     * Unlike std::unordered_map, inserting may move the elements: it
+     * invalidates iterators, pointers and references into the map.
+     * Erasing invalidates only those to the erased element.
+     */
+    template<typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+    class flat_map {
+    public:
+        typedef K key_type;
+        typedef V mapped_type;
+        typedef std::pair<const K, V> value_type;
+
+        template<typename T>
+        class basic_iterator {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef typename std::remove_const<T>::type value_type;
+            typedef ptrdiff_t difference_type;
+            typedef T* pointer;
+            typedef T& reference;
+
+            basic_iterator() : _ctrl(nullptr), _end(nullptr), _slot(nullptr){}
+            basic_iterator(const int8_t* ctrl, const int8_t* end, T* slot)
+                : _ctrl(ctrl), _end(end), _slot(slot){
+                skip();
+            }
+
+            /* iterator to const_iterator */
+            template<typename U>
+            basic_iterator(const basic_iterator<U>& it)
+                : _ctrl(it._ctrl), _end(it._end), _slot(it._slot){}
+
+            T& operator*() const { return *_slot; }
+            T* operator->() const { return _slot; }
+
+            basic_iterator& operator++(){
+                ++_ctrl;
+                ++_slot;
+                skip();
+                return *this;
+            }
+
+            basic_iterator operator++(int){
+                basic_iterator it = *this;
+                ++*this;
+                return it;
+            }
+
+            template<typename U>
+            bool operator==(const basic_iterator<U>& it) const { return _slot == it._slot; }
+            template<typename U>
+            bool operator!=(const basic_iterator<U>& it) const { return _slot != it._slot; }
+
+        private:
+            template<typename> friend class basic_iterator;
+            friend class flat_map;
+
+            void skip(){
+                while (_ctrl != _end && *_ctrl < 0){
+                    ++_ctrl;
+                    ++_slot;
+                }
+            }
+
+            const int8_t* _ctrl;
+            const int8_t* _end;
+            T* _slot;
+        };
+
+        typedef basic_iterator<value_type> iterator;
+        typedef basic_iterator<const value_type> const_iterator;
+
+    public:
+        flat_map()
+            : _ctrl(nullptr), _slots(nullptr), _capacity(0), _size(0), _growth_left(0){}
+
+        explicit flat_map(size_t count)
+            : flat_map(){
+            reserve(count);
+        }
+
+        flat_map(const flat_map& m)
+            : flat_map(){
+            reserve(m.size());
+            for (auto& v : m){
+                emplace(v.first, v.second);
+            }
+        }
+
+        flat_map(flat_map&& m)
+            : flat_map(){
+            swap(m);
+        }
+
+        ~flat_map(){
+            release();
+        }
+
+        flat_map& operator=(const flat_map& m){
+            if (this != &m){
+                flat_map copy(m);
+                swap(copy);
+            }
+            return *this;
+        }
+
+        flat_map& operator=(flat_map&& m){
+            if (this != &m){
+                release();
+                swap(m);
+            }
+            return *this;
+        }
+
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        size_t capacity() const { return _capacity; }
+
+        iterator begin() { return iterator(_ctrl, _ctrl + _capacity, _slots); }
+        iterator end() { return iterator(_ctrl + _capacity, _ctrl + _capacity, _slots + _capacity); }
+        const_iterator begin() const { return const_iterator(_ctrl, _ctrl + _capacity, _slots); }
+        const_iterator end() const { return const_iterator(_ctrl + _capacity, _ctrl + _capacity, _slots + _capacity); }
+
+        template<typename Q>
+        iterator find(const Q& key){
+            size_t i = find_index(key, hash_of(key));
+            return i == npos ? end() : at_index(i);
+        }
+
+        template<typename Q>
+        const_iterator find(const Q& key) const {
+            size_t i = find_index(key, hash_of(key));
+            return i == npos ? end() : const_iterator(const_cast<flat_map*>(this)->at_index(i));
+        }
+
+        template<typename Q>
+        size_t count(const Q& key) const {
+            return find_index(key, hash_of(key)) == npos ? 0 : 1;
+        }
+
+        /* The value of `key`; throws std::out_of_range if there is none. */
+        template<typename Q>
+        V& at(const Q& key){
+            size_t i = find_index(key, hash_of(key));
+            if (i == npos){
+                throw std::out_of_range("hy::flat_map::at() key not found");
+            }
+            return _slots[i].second;
+        }
+
+        template<typename Q>
+        const V& at(const Q& key) const {
+            return const_cast<flat_map*>(this)->at(key);
+        }
+
+        V& operator[](const K& key){
+            return emplace(key).first->second;
+        }
+
+        V& operator[](K&& key){
+            return emplace(std::move(key)).first->second;
+        }
+
+        /* Inserts `key` with a value made of `args` unless the key is
+         * there already; returns the element and whether it is new.
+         */
+        template<typename Q, typename... Args>
+        std::pair<iterator, bool> emplace(Q&& key, Args&&... args){
+            uint64_t h = hash_of(key);
+            size_t i = find_index(key, h);
+            if (i != npos){
+                return std::make_pair(at_index(i), false);
+            }
+            i = prepare_insert(h);
+            new (_slots + i) value_type(std::piecewise_construct,
+                                        std::forward_as_tuple(std::forward<Q>(key)),
+                                        std::forward_as_tuple(std::forward<Args>(args)...));
+            if (_ctrl[i] == swiss::empty){
+                --_growth_left;
+            }
+            _ctrl[i] = h2(h);
+            ++_size;
+            return std::make_pair(at_index(i), true);
+        }
+
+        std::pair<iterator, bool> insert(const value_type& v){
+            return emplace(v.first, v.second);
+        }
+
+        template<typename Q>
+        size_t erase(const Q& key){
+            size_t i = find_index(key, hash_of(key));
+            if (i == npos){
+                return 0;
+            }
+            erase_index(i);
+            return 1;
+        }
+
+        /* Erases the element at `it` and returns the one after it. */
+        iterator erase(const_iterator it){
+            size_t i = it._slot - _slots;
+            erase_index(i);
+            return iterator(_ctrl + i + 1, _ctrl + _capacity, _slots + i + 1);
+        }
+
+        iterator erase(iterator it){
+            return erase(const_iterator(it));
+        }
+
+        void clear(){
+            destroy_all();
+            if (_capacity){
+                memset(_ctrl, swiss::empty, _capacity);
+            }
+            _size = 0;
+            _growth_left = max_load(_capacity);
+        }
+
+        /* Makes room for `count` elements in all without growing. */
+        void reserve(size_t count){
+            size_t capacity = swiss::group_size;
+            while (max_load(capacity) < count){
+                capacity *= 2;
+            }
+            if (capacity > _capacity){
+                rehash(capacity);
+            }
+        }
+
+        void swap(flat_map& m){
+            std::swap(_ctrl, m._ctrl);
+            std::swap(_slots, m._slots);
+            std::swap(_capacity, m._capacity);
+            std::swap(_size, m._size);
+            std::swap(_growth_left, m._growth_left);
+            std::swap(_hash, m._hash);
+            std::swap(_eq, m._eq);
+        }
+
+    private:
+        static const size_t npos = (size_t)-1;
+
+        /* 7/8 of the slots, leaving some empty in every probe sequence */
+        static size_t max_load(size_t capacity){
+            return capacity - capacity / 8;
+        }
+
+        template<typename Q>
+        uint64_t hash_of(const Q& key) const {
+            return hash_mix((uint64_t)_hash(key));
+        }
+
+        static int8_t h2(uint64_t h){
+            return (int8_t)(h & 0x7f);
+        }
+
+        iterator at_index(size_t i){
+            return iterator(_ctrl + i, _ctrl + _capacity, _slots + i);
+        }
+
+        /* Groups are probed at triangular offsets from the one the hash
+         * picks, which visits all of them; a group with an empty slot ends
+         * the sequence, as no key was ever pushed past it.
+         */
+        template<typename Q>
+        size_t find_index(const Q& key, uint64_t h) const {
+            if (!_capacity){
+                return npos;
+            }
+            const size_t mask = _capacity / swiss::group_size - 1;
+            size_t g = (size_t)(h >> 7) & mask;
+            for (size_t step = 1; ; ++step){
+                const int8_t* group = _ctrl + g * swiss::group_size;
+                for (unsigned m = swiss::match(group, h2(h)); m; m &= m - 1){
+                    size_t i = g * swiss::group_size + simd::_lowest_bit(m);
+                    if (_eq(_slots[i].first, key)){
+                        return i;
+                    }
+                }
+                if (swiss::match(group, swiss::empty)){
+                    return npos;
+                }
+                g = (g + step) & mask;
+            }
+        }
+
+        /* The first empty or erased slot of the probe sequence of `h`. */
+        size_t find_free(uint64_t h) const {
+            const size_t mask = _capacity / swiss::group_size - 1;
+            size_t g = (size_t)(h >> 7) & mask;
+            for (size_t step = 1; ; ++step){
+                unsigned m = swiss::match_free(_ctrl + g * swiss::group_size);
+                if (m){
+                    return g * swiss::group_size + simd::_lowest_bit(m);
+                }
+                g = (g + step) & mask;
+            }
+        }
+
+        /* A free slot for a new key of hash `h`, growing first if taking
+         * an empty slot would pass the maximum load.
+         */
+        size_t prepare_insert(uint64_t h){
+            if (_capacity){
+                size_t i = find_free(h);
+                if (_growth_left || _ctrl[i] == swiss::deleted){
+                    return i;
+                }
+            }
+            /* mostly erased slots: the same capacity cleans them up */
+            size_t capacity = _capacity == 0 ? swiss::group_size
+                            : _size < max_load(_capacity) / 2 ? _capacity : _capacity * 2;
+            rehash(capacity);
+            return find_free(h);
+        }
+
+        void erase_index(size_t i){
+            _slots[i].~value_type();
+            --_size;
+            /* a group that has an empty slot was never probed past, so the
+             * slot can be empty too; otherwise, keep the probe going past it
+             */
+            if (swiss::match(_ctrl + (i & ~(swiss::group_size - 1)), swiss::empty)){
+                _ctrl[i] = swiss::empty;
+                ++_growth_left;
+            }
+            else {
+                _ctrl[i] = swiss::deleted;
+            }
+        }
+
+        void rehash(size_t capacity){
+            int8_t* ctrl = new int8_t[capacity];
+            value_type* slots = static_cast<value_type*>(::operator new(capacity * sizeof(value_type)));
+            memset(ctrl, swiss::empty, capacity);
+
+            int8_t* old_ctrl = _ctrl;
+            value_type* old_slots = _slots;
+            size_t old_capacity = _capacity;
+            _ctrl = ctrl;
+            _slots = slots;
+            _capacity = capacity;
+            _growth_left = max_load(capacity) - _size;
+
+            for (size_t i = 0; i < old_capacity; ++i){
+                if (old_ctrl[i] >= 0){
+                    value_type& v = old_slots[i];
+                    uint64_t h = hash_of(v.first);
+                    size_t j = find_free(h);
+                    new (slots + j) value_type(std::move(const_cast<K&>(v.first)), std::move(v.second));
+                    v.~value_type();
+                    ctrl[j] = h2(h);
+                }
+            }
+            delete[] old_ctrl;
+            ::operator delete(old_slots);
+        }
+
+        void destroy_all(){
+            for (size_t i = 0; i < _capacity; ++i){
+                if (_ctrl[i] >= 0){
+                    _slots[i].~value_type();
+                }
+            }
+        }
+
+        void release(){
+            destroy_all();
+            delete[] _ctrl;
+            ::operator delete(_slots);
+            _ctrl = nullptr;
+            _slots = nullptr;
+            _capacity = 0;
+            _size = 0;
+            _growth_left = 0;
+        }
+
+        int8_t* _ctrl;
+        value_type* _slots;
+        /* Number of slots: 0, or a power of 2 of at least one group */
+        size_t _capacity;
+        size_t _size;
+        /* Empty slots that can still be taken before growing */
+        size_t _growth_left;
+        Hash _hash;
+        Eq _eq;
+    };
+
+    /* A flat_map keyed by std::string that can be searched with string and
+     * const char* keys without allocating.
+     */
+    template<typename V>
+    using string_map = flat_map<std::string, V, string_hash, string_equal>;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace hy {
+    /*
+     * A wyhash-class hash of bytes: 64-bit multiply-and-fold mixing,
+     * reading 16 bytes a step (48 for long inputs), with all of the short
+     * inputs (< 16 bytes, the common key) handled in two multiplies and no
+     * loop. It is fast and of good quality, but not meant to resist
+     * attackers choosing keys.
+     */
+    namespace wyhash {
+        static const uint64_t secret[4] = {
+            0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+        };
+
+        /* a * b as 128 bits, low half to a and high half to b */
+        inline void mum(uint64_t& a, uint64_t& b){
+#if defined(__SIZEOF_INT128__)
+            unsigned __int128 r = (unsigned __int128)a * b;
+            a = (uint64_t)r;
+            b = (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+            a = _umul128(a, b, &b);
+#else
+            uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+            uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+            uint64_t t = rl + (rm0 << 32);
+            uint64_t c = t < rl;
+            uint64_t lo = t + (rm1 << 32);
+            c += lo < t;
+            a = lo;
+            b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+        }
+
+        inline uint64_t mix(uint64_t a, uint64_t b){
+            mum(a, b);
+            return a ^ b;
+        }
+
+        inline uint64_t r8(const uint8_t* p){
+            uint64_t v;
+            memcpy(&v, p, 8);
+            return v;
+        }
+
+        inline uint64_t r4(const uint8_t* p){
+            uint32_t v;
+            memcpy(&v, p, 4);
+            return v;
+        }
+
+        /* 1 to 3 bytes: the first, the middle and the last */
+        inline uint64_t r3(const uint8_t* p, size_t k){
+            return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+        }
+    }
+
+    /* Hashes the `len` bytes at `data`. */
+    inline uint64_t hash_bytes(const void* data, size_t len, uint64_t seed = 0){
+        using namespace wyhash;
+        const uint8_t* p = (const uint8_t*)data;
+        seed ^= mix(seed ^ secret[0], secret[1]);
+        uint64_t a, b;
+        if (len <= 16){
+            if (len >= 4){
+                a = (r4(p) << 32) | r4(p + ((len >> 3) << 2));
+                b = (r4(p + len - 4) << 32) | r4(p + len - 4 - ((len >> 3) << 2));
+            }
+            else if (len > 0){
+                a = r3(p, len);
+                b = 0;
+            }
+            else {
+                a = b = 0;
+            }
+        }
+        else {
+            size_t i = len;
+            if (i > 48){
+                uint64_t see1 = seed, see2 = seed;
+                do {
+                    seed = mix(r8(p) ^ secret[1], r8(p + 8) ^ seed);
+                    see1 = mix(r8(p + 16) ^ secret[2], r8(p + 24) ^ see1);
+                    see2 = mix(r8(p + 32) ^ secret[3], r8(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= see1 ^ see2;
+            }
+            while (i > 16){
+                seed = mix(r8(p) ^ secret[1], r8(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            /* the last 16 bytes, overlapping what came before */
+            a = r8(p + i - 16);
+            b = r8(p + i - 8);
+        }
+        a ^= secret[1];
+        b ^= seed;
+        mum(a, b);
+        return mix(a ^ secret[0] ^ len, b ^ secret[1]);
+    }
+
+    /* Spreads the entropy of `v` over all of its bits, e.g. to turn an
+     * identity hash (std::hash of an integer) into one fit for a table
+     * that indexes with some bits and tags with others.
+     */
+    inline uint64_t hash_mix(uint64_t v){
+        return wyhash::mix(v ^ wyhash::secret[0], wyhash::secret[1]);
+    }
+}
@@ -0,0 +1,272 @@
+#pragma once
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <hydrogen/common/hash.h>
+#include <hydrogen/common/simd.h>
+#include <hydrogen/common/string.h>
+
+namespace hy {
+    /* intern_table gives each distinct string a small integer ID, 0, 1, 2...
+     * in the order they are first seen, and keeps one canonical copy of it.
+     * Parsers intern the tokens they see once; from then on two tokens are
+     * equal if and only if their IDs are, and an ID indexes plain arrays.
+     *
+     * find() and name() are lock-free and may run on any number of threads
+     * while another interns: a lookup hashes once, probes an array of
+     * (hash tag, ID) words published with release stores, and compares the
+     * bytes of the one candidate whose tag matches. intern() of a string
+     * already there takes the same path; only adding a string takes a lock.
+     *
+     * Nothing is ever removed. The copies live as long as the table, at
+     * stable addresses, so name() can be kept. Tables the index outgrows
+     * are kept too, for readers that may still be probing them; together
+     * they are smaller than the last one.
+     */
+    class intern_table {
+    public:
+        /* The ID of no string. */
+        static const uint32_t npos = (uint32_t)-1;
+
+        intern_table()
+            : _index(nullptr), _size(0), _chunk(nullptr), _chunk_left(0){
+            for (auto& s : _segments){
+                s.store(nullptr, std::memory_order_relaxed);
+            }
+            publish(new index(min_capacity));
+        }
+
+        /* Makes room for `count` strings without growing. */
+        explicit intern_table(size_t count)
+            : intern_table(){
+            reserve(count);
+        }
+
+        ~intern_table(){
+            delete _index.load(std::memory_order_relaxed);
+            for (auto t : _retired){
+                delete t;
+            }
+            for (auto& s : _segments){
+                delete[] s.load(std::memory_order_relaxed);
+            }
+            for (auto c : _chunks){
+                free(c);
+            }
+        }
+
+        intern_table(const intern_table&) = delete;
+        intern_table& operator=(const intern_table&) = delete;
+
+        /* Number of strings interned. */
+        size_t size() const { return _size.load(std::memory_order_acquire); }
+
+        /* The ID of `s`, or npos if it was never interned. Lock-free. */
+        uint32_t find(const string& s) const {
+            return find(s, hash_bytes(s.buffer(), s.length()));
+        }
+
+        /* The ID of `s`, interning it first if it is new. */
+        uint32_t intern(const string& s){
+            uint64_t h = hash_bytes(s.buffer(), s.length());
+            uint32_t id = find(s, h);
+            if (id != npos){
+                return id;
+            }
+            std::lock_guard<std::mutex> lock(_write_lock);
+            return add(s, h);
+        }
+
+        /* Interns all of [first, last) under one lock, e.g. the names a
+         * parser is known to see, before it starts. The elements may be
+         * strings, std::strings or const char*.
+         */
+        template<typename It>
+        void seed(It first, It last){
+            std::lock_guard<std::mutex> lock(_write_lock);
+            for (; first != last; ++first){
+                string s = string_equal::view(*first);
+                add(s, hash_bytes(s.buffer(), s.length()));
+            }
+        }
+
+        void reserve(size_t count){
+            std::lock_guard<std::mutex> lock(_write_lock);
+            size_t capacity = _index.load(std::memory_order_relaxed)->mask + 1;
+            if (count * 2 > capacity){
+                while (count * 2 > capacity){
+                    capacity *= 2;
+                }
+                rehash(capacity);
+            }
+        }
+
+        /* The canonical copy of the string of `id`, NUL-terminated too.
+         * Lock-free; `id` must have been returned by this table.
+         */
+        string name(uint32_t id) const {
+            const entry& e = at(id);
+            return string(e.data, e.length);
+        }
+
+    private:
+        struct entry {
+            const char* data;
+            size_t length;
+            uint64_t hash;
+        };
+
+        /* Open addressing with linear probing, at most half full. A slot
+         * is 0 or (hash tag << 32 | ID + 1).
+         */
+        struct index {
+            explicit index(size_t capacity)
+                : mask(capacity - 1), slots(new std::atomic<uint64_t>[capacity]){
+                for (size_t i = 0; i < capacity; ++i){
+                    slots[i].store(0, std::memory_order_relaxed);
+                }
+            }
+            ~index(){ delete[] slots; }
+
+            size_t mask;
+            std::atomic<uint64_t>* slots;
+        };
+
+        static const size_t min_capacity = 64;
+        static const size_t chunk_size = 64 * 1024;
+        /* Segment k holds the entries of IDs [base * (2^k - 1), base * (2^(k+1) - 1)) */
+        static const size_t segment_base = 1024;
+        static const size_t segment_count = 23;
+
+        static uint32_t tag_of(uint64_t h){
+            return (uint32_t)(h >> 32);
+        }
+
+        uint32_t find(const string& s, uint64_t h) const {
+            const index* t = _index.load(std::memory_order_acquire);
+            const uint32_t tag = tag_of(h);
+            for (size_t i = (size_t)h & t->mask; ; i = (i + 1) & t->mask){
+                uint64_t slot = t->slots[i].load(std::memory_order_acquire);
+                if (!slot){
+                    return npos;
+                }
+                if ((uint32_t)(slot >> 32) == tag){
+                    uint32_t id = (uint32_t)slot - 1;
+                    const entry& e = at(id);
+                    if (e.length == s.length() && !memcmp(e.data, s.buffer(), e.length)){
+                        return id;
+                    }
+                }
+            }
+        }
+
+        const entry& at(uint32_t id) const {
+            size_t k = simd::_highest_bit((unsigned)(id / segment_base + 1));
+            size_t offset = id - segment_base * ((size_t(1) << k) - 1);
+            return _segments[k].load(std::memory_order_acquire)[offset];
+        }
+
+        /* With _write_lock held. */
+        uint32_t add(const string& s, uint64_t h){
+            uint32_t id = find(s, h);
+            if (id != npos){
+                return id;
+            }
+            id = (uint32_t)_size.load(std::memory_order_relaxed);
+            index* t = _index.load(std::memory_order_relaxed);
+            if (((size_t)id + 1) * 2 > t->mask + 1){
+                rehash((t->mask + 1) * 2);
+                t = _index.load(std::memory_order_relaxed);
+            }
+
+            /* the entry first, then the slot that leads readers to it */
+            size_t k = simd::_highest_bit((unsigned)(id / segment_base + 1));
+            entry* segment = _segments[k].load(std::memory_order_relaxed);
+            if (!segment){
+                segment = new entry[segment_base << k];
+                _segments[k].store(segment, std::memory_order_release);
+            }
+            entry& e = segment[id - segment_base * ((size_t(1) << k) - 1)];
+            e.data = copy(s);
+            e.length = s.length();
+            e.hash = h;
+
+            insert(t, h, id);
+            _size.store(id + 1, std::memory_order_release);
+            return id;
+        }
+
+        static void insert(index* t, uint64_t h, uint32_t id){
+            size_t i = (size_t)h & t->mask;
+            while (t->slots[i].load(std::memory_order_relaxed)){
+                i = (i + 1) & t->mask;
+            }
+            t->slots[i].store((uint64_t)tag_of(h) << 32 | (id + 1), std::memory_order_release);
+        }
+
+        /* Builds a bigger index aside and swaps it in; readers still on
+         * the old one find what it had, which is all there was.
+         */
+        void rehash(size_t capacity){
+            index* t = new index(capacity);
+            size_t count = _size.load(std::memory_order_relaxed);
+            for (uint32_t id = 0; id < count; ++id){
+                insert(t, at(id).hash, id);
+            }
+            publish(t);
+        }
+
+        void publish(index* t){
+            index* old = _index.load(std::memory_order_relaxed);
+            _index.store(t, std::memory_order_release);
+            if (old){
+                _retired.push_back(old);
+            }
+        }
+
+        /* Copies `s` to the chunk being filled, NUL-terminated. */
+        const char* copy(const string& s){
+            size_t need = s.length() + 1;
+            if (need > _chunk_left){
+                size_t size = need > chunk_size / 4 ? need : chunk_size;
+                char* c = (char*)malloc(size);
+                if (!c){
+                    throw std::bad_alloc();
+                }
+                _chunks.push_back(c);
+                /* a big string gets a chunk of its own; keep filling the last */
+                if (size == chunk_size){
+                    _chunk = c;
+                    _chunk_left = size;
+                }
+                else {
+                    memcpy(c, s.buffer(), s.length());
+                    c[s.length()] = '\0';
+                    return c;
+                }
+            }
+            char* p = _chunk;
+            memcpy(p, s.buffer(), s.length());
+            p[s.length()] = '\0';
+            _chunk += need;
+            _chunk_left -= need;
+            return p;
+        }
+
+        std::atomic<index*> _index;
+        std::atomic<size_t> _size;
+        std::atomic<entry*> _segments[segment_count];
+
+        /* Writers only, under _write_lock */
+        std::mutex _write_lock;
+        std::vector<index*> _retired;
+        std::vector<char*> _chunks;
+        char* _chunk;
+        size_t _chunk_left;
+    };
+}
@@ -0,0 +1,415 @@
+#pragma once
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <new>
+#include <utility>
+#include <string>
+#include <system_error>
+
+#ifdef WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <hydrogen/common/simd.h>
+#include <hydrogen/common/string.h>
+
+namespace hy {
+    /* mapped_file maps a whole file read-only into memory and shows it as
+     * one hy::string: content() and whatever is cut from it (lines(),
+     * split_view(), ...) refer to the pages of the file, so a file of any
+     * size is parsed without reading it into buffers or copying a line.
+     * The views are valid as long as the mapping.
+     *
+     * The options are hints to the kernel, ignored where not supported:
+     * sequential (the default) reads ahead aggressively and drops pages
+     * soon after they were read; willneed starts reading the whole file in
+     * the background; huge_pages asks for transparent huge pages, fewer TLB
+     * misses on big files where the file system can provide them. Windows
+     * only takes sequential.
+     *
+     * Pipes, sockets and some special files cannot be mapped: try_open()
+     * fails for them and file_reader reads them instead. The errors are
+     * errno values, or GetLastError() values on Windows.
+     */
+    class mapped_file {
+    public:
+        enum options {
+            normal = 0,
+            sequential = 1,
+            willneed = 2,
+            huge_pages = 4
+        };
+
+        mapped_file() : _data(nullptr), _size(0){}
+
+        /* Maps the file at `path`; throws std::system_error on failure. */
+        explicit mapped_file(const char* path, unsigned opts = sequential)
+            : mapped_file(){
+            int error = try_open(path, opts);
+            if (error){
+                throw std::system_error(error, std::system_category(), std::string("hy::mapped_file: ") + path);
+            }
+        }
+
+        ~mapped_file(){ close(); }
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        mapped_file(mapped_file&& f) : mapped_file(){
+            swap(f);
+        }
+
+        mapped_file& operator=(mapped_file&& f){
+            close();
+            swap(f);
+            return *this;
+        }
+
+        /* Maps the file at `path`, unmapping the one mapped before.
+         * Returns 0 on success, or the error.
+         */
+        int try_open(const char* path, unsigned opts = sequential){
+            close();
+#ifdef WIN32
+            HANDLE file = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                OPEN_EXISTING, (opts & sequential) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE){
+                return (int)::GetLastError();
+            }
+            LARGE_INTEGER size;
+            if (!::GetFileSizeEx(file, &size)){
+                int error = (int)::GetLastError();
+                ::CloseHandle(file);
+                return error;
+            }
+            if ((unsigned long long)size.QuadPart > (size_t)-1){
+                ::CloseHandle(file);
+                return ERROR_NOT_ENOUGH_MEMORY;
+            }
+            if (size.QuadPart == 0){
+                /* nothing to map */
+                ::CloseHandle(file);
+                return 0;
+            }
+            HANDLE section = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            int error = section ? 0 : (int)::GetLastError();
+            ::CloseHandle(file);
+            if (!section){
+                return error;
+            }
+            void* p = ::MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+            error = p ? 0 : (int)::GetLastError();
+            /* the view keeps the section alive */
+            ::CloseHandle(section);
+            if (!p){
+                return error;
+            }
+            _data = (const char*)p;
+            _size = (size_t)size.QuadPart;
+            return 0;
+#else
+            int fd;
+            do {
+                fd = ::open(path, O_RDONLY | O_CLOEXEC);
+            } while (fd < 0 && errno == EINTR);
+            if (fd < 0){
+                return errno;
+            }
+            struct stat st;
+            if (::fstat(fd, &st)){
+                int error = errno;
+                ::close(fd);
+                return error;
+            }
+            if (!S_ISREG(st.st_mode)){
+                /* a pipe or a device: its size says nothing, read it instead */
+                ::close(fd);
+                return ENODEV;
+            }
+            if ((unsigned long long)st.st_size > (size_t)-1){
+                ::close(fd);
+                return ENOMEM;
+            }
+            if (st.st_size == 0){
+                ::close(fd);
+                return 0;
+            }
+            size_t size = (size_t)st.st_size;
+            void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            int error = p == MAP_FAILED ? errno : 0;
+            /* the mapping keeps the file open */
+            ::close(fd);
+            if (p == MAP_FAILED){
+                return error;
+            }
+            if (opts & sequential){
+                ::madvise(p, size, MADV_SEQUENTIAL);
+            }
+            if (opts & willneed){
+                ::madvise(p, size, MADV_WILLNEED);
+            }
+#ifdef MADV_HUGEPAGE
+            if (opts & huge_pages){
+                ::madvise(p, size, MADV_HUGEPAGE);
+            }
+#endif
+            _data = (const char*)p;
+            _size = size;
+            return 0;
+#endif
+        }
+
+        /* Unmaps the file; views of it must not be used any more. */
+        void close(){
+            if (_data){
+#ifdef WIN32
+                ::UnmapViewOfFile(_data);
+#else
+                ::munmap((void*)_data, _size);
+#endif
+            }
+            _data = nullptr;
+            _size = 0;
+        }
+
+        /* Whether a non-empty file is mapped. */
+        bool is_open() const { return _data != nullptr; }
+
+        const char* data() const { return _data; }
+        size_t size() const { return _size; }
+
+        /* The whole file; empty if nothing is mapped. */
+        string content() const { return _data ? string(_data, _size) : string(); }
+
+        void swap(mapped_file& f){
+            std::swap(_data, f._data);
+            std::swap(_size, f._size);
+        }
+
+    private:
+        const char* _data;
+        size_t _size;
+    };
+
+    /* file_reader reads a file front to back in large blocks (1MB by
+     * default), for the files mapped_file cannot map. read() hands out one
+     * block at a time, cut after its last '\n' so that it holds whole lines
+     * only; the partial line at its end is kept for the next block, and a
+     * line longer than a block grows the buffer. The block is valid until
+     * the next read().
+     *
+     * Regular files are read with pread at increasing offsets; pipes and
+     * other streams, which have no offsets, with plain reads. Errors throw
+     * std::system_error.
+     */
+    class file_reader {
+    public:
+        static const size_t default_block_size = 1024 * 1024;
+
+        explicit file_reader(size_t block_size = default_block_size)
+            : _buf(nullptr), _capacity(block_size ? block_size : 1),
+              _pending(0), _length(0), _offset(0), _eof(false), _stream(false){
+#ifdef WIN32
+            _file = INVALID_HANDLE_VALUE;
+#else
+            _fd = -1;
+#endif
+        }
+
+        /* Opens the file at `path`; throws std::system_error on failure. */
+        explicit file_reader(const char* path, size_t block_size = default_block_size)
+            : file_reader(block_size){
+            int error = try_open(path);
+            if (error){
+                throw std::system_error(error, std::system_category(), std::string("hy::file_reader: ") + path);
+            }
+        }
+
+        ~file_reader(){
+            close();
+            ::free(_buf);
+        }
+
+        file_reader(const file_reader&) = delete;
+        file_reader& operator=(const file_reader&) = delete;
+
+        /* Opens the file at `path`, closing the one open before.
+         * Returns 0 on success, or the error.
+         */
+        int try_open(const char* path){
+            close();
+#ifdef WIN32
+            _file = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (_file == INVALID_HANDLE_VALUE){
+                return (int)::GetLastError();
+            }
+            _stream = ::GetFileType(_file) != FILE_TYPE_DISK;
+#else
+            do {
+                _fd = ::open(path, O_RDONLY | O_CLOEXEC);
+            } while (_fd < 0 && errno == EINTR);
+            if (_fd < 0){
+                return errno;
+            }
+            struct stat st;
+            _stream = ::fstat(_fd, &st) || !S_ISREG(st.st_mode);
+#if defined(POSIX_FADV_SEQUENTIAL)
+            if (!_stream){
+                ::posix_fadvise(_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            }
+#endif
+#endif
+            return 0;
+        }
+
+        void close(){
+#ifdef WIN32
+            if (_file != INVALID_HANDLE_VALUE){
+                ::CloseHandle(_file);
+                _file = INVALID_HANDLE_VALUE;
+            }
+#else
+            if (_fd >= 0){
+                ::close(_fd);
+                _fd = -1;
+            }
+#endif
+            _pending = 0;
+            _length = 0;
+            _offset = 0;
+            _eof = false;
+        }
+
+        bool is_open() const {
+#ifdef WIN32
+            return _file != INVALID_HANDLE_VALUE;
+#else
+            return _fd >= 0;
+#endif
+        }
+
+        /* The next block of whole lines, each with its '\n' but for the
+         * last line of a file that does not end with one. Returns false at
+         * the end of the file.
+         */
+        bool read(string& block){
+            if (!_buf){
+                _buf = (char*)::malloc(_capacity);
+                if (!_buf){
+                    throw std::bad_alloc();
+                }
+            }
+            /* drop the block handed out last, keep the partial line after it */
+            memmove(_buf, _buf + _length - _pending, _pending);
+            _length = _pending;
+            _pending = 0;
+
+            size_t scanned = 0;
+            while (!_eof){
+                if (_length == _capacity){
+                    grow();
+                }
+                size_t n = fill(_buf + _length, _capacity - _length);
+                if (n == 0){
+                    _eof = true;
+                    break;
+                }
+                _length += n;
+                const char* nl = simd::rfind(_buf + scanned, _buf + _length, '\n');
+                if (nl != _buf + _length){
+                    _pending = _buf + _length - (nl + 1);
+                    block = string(_buf, nl + 1);
+                    return true;
+                }
+                scanned = _length;
+            }
+            if (_length == 0){
+                return false;
+            }
+            block = string(_buf, _length);
+            return true;
+        }
+
+        /* Bytes read from the file so far. */
+        unsigned long long offset() const { return _offset; }
+
+    private:
+        void grow(){
+            size_t capacity = _capacity * 2;
+            char* buf = (char*)::realloc(_buf, capacity);
+            if (!buf){
+                throw std::bad_alloc();
+            }
+            _buf = buf;
+            _capacity = capacity;
+        }
+
+        /* Reads up to `n` bytes to `p`; 0 at the end of the file. */
+        size_t fill(char* p, size_t n){
+#ifdef WIN32
+            DWORD count = n > 0x40000000 ? 0x40000000 : (DWORD)n;
+            DWORD got = 0;
+            BOOL ok;
+            if (_stream){
+                ok = ::ReadFile(_file, p, count, &got, nullptr);
+            }
+            else {
+                OVERLAPPED at;
+                memset(&at, 0, sizeof(at));
+                at.Offset = (DWORD)_offset;
+                at.OffsetHigh = (DWORD)(_offset >> 32);
+                ok = ::ReadFile(_file, p, count, &got, &at);
+            }
+            if (!ok){
+                DWORD error = ::GetLastError();
+                if (error == ERROR_HANDLE_EOF || error == ERROR_BROKEN_PIPE){
+                    return 0;
+                }
+                throw std::system_error((int)error, std::system_category(), "hy::file_reader::read()");
+            }
+            _offset += got;
+            return got;
+#else
+            ssize_t got;
+            do {
+                got = _stream ? ::read(_fd, p, n) : ::pread(_fd, p, n, (off_t)_offset);
+            } while (got < 0 && errno == EINTR);
+            if (got < 0){
+                throw std::system_error(errno, std::system_category(), "hy::file_reader::read()");
+            }
+            _offset += (size_t)got;
+            return (size_t)got;
+#endif
+        }
+
+        char* _buf;
+        size_t _capacity;
+        /* bytes after the block handed out last */
+        size_t _pending;
+        /* bytes in _buf */
+        size_t _length;
+        unsigned long long _offset;
+        bool _eof;
+        bool _stream;
+#ifdef WIN32
+        HANDLE _file;
+#else
+        int _fd;
+#endif
+    };
+}
@@ -0,0 +1,253 @@
+#pragma once
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <utility>
+#include <new>
+#include <stdexcept>
+
+#ifdef WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+#include <hydrogen/common/stdext.h>
+
+namespace hy {
+    /* mirrored_queue_buffer is a byte queue_buffer whose storage is a ring
+     * mapped twice, back to back, in virtual memory: byte i and byte
+     * i + capacity() are the same byte. Whatever is queued is therefore one
+     * contiguous run at front(), and all the free room one contiguous run at
+     * tail(), wherever the ring wraps.
+     *
+     * It keeps the queue_buffer API so that it can replace one as is, but
+     * trim() has nothing left to do: the queue never needs moving to make
+     * room, however large the pending partial message.
+     *
+     * The capacity is rounded up to the page size (the allocation
+     * granularity, 64KB, on Windows). The storage is a memfd on Linux, an
+     * unlinked POSIX shared memory object on other systems and a pagefile
+     * section on Windows. Failing to map it throws std::bad_alloc.
+     */
+    class mirrored_queue_buffer {
+    public:
+        mirrored_queue_buffer()
+            : _buf(nullptr), _size(0), _front(0), _tail(0){}
+        explicit mirrored_queue_buffer(size_t size)
+            : mirrored_queue_buffer(){
+            resize(size);
+        }
+        ~mirrored_queue_buffer(){ release(); }
+
+        mirrored_queue_buffer(const mirrored_queue_buffer&) = delete;
+        mirrored_queue_buffer& operator=(mirrored_queue_buffer&) = delete;
+
+        mirrored_queue_buffer(mirrored_queue_buffer&& q): mirrored_queue_buffer(){
+            swap(q);
+        }
+
+        mirrored_queue_buffer& operator=(mirrored_queue_buffer&& q) {
+            release();
+            swap(q);
+            return *this;
+        }
+
+        /* Resize the capacity of the buffer.
+         * Existing contents in the buffer will be dropped.
+         */
+        void resize(size_t size){
+            unmap(_buf, _size);
+            _buf = nullptr;
+            _size = 0;
+            if (size){
+                size = round_up(size);
+                _buf = map(size);
+                _size = size;
+            }
+            _front = 0;
+            _tail = 0;
+        }
+
+        void release(){ resize(0); }
+
+        bool   empty() const { return _front == _tail; }
+        size_t capacity() const { return _size; }
+        size_t length() const { return _tail - _front; }
+        size_t free() const { return _size - length(); }
+
+        char* front() { return _buf + _front; }
+        char* tail() { return _buf + _tail; }
+
+        /* Nothing to move: kept for queue_buffer compatibility. */
+        void trim(){}
+
+        /* Copy count elements from queue front to dst.
+         * Returns number of elements actually copied.
+         */
+        size_t copy(char* dst, size_t count){
+            if (count > length()){
+                count = length();
+            }
+            memcpy(dst, front(), count);
+            return count;
+        }
+
+        /* Pop count elements from queue. */
+        void pop(size_t count){
+            if (count > length()){
+                throw std::out_of_range("hy::mirrored_queue_buffer::pop() out of range.");
+            }
+            _front += count;
+            if (_front >= _size){
+                /* keep front() in the first mapping */
+                _front -= _size;
+                _tail -= _size;
+            }
+        }
+
+        /* Push count elements to queue. */
+        void push(size_t count){
+            if (count > free()){
+                throw std::out_of_range("hy::mirrored_queue_buffer::push() out of range.");
+            }
+            _tail += count;
+        }
+
+        void swap(mirrored_queue_buffer& buf){
+            std::swap(_buf, buf._buf);
+            std::swap(_size, buf._size);
+            std::swap(_front, buf._front);
+            std::swap(_tail, buf._tail);
+        }
+
+    private:
+        static size_t round_up(size_t size){
+#ifdef WIN32
+            SYSTEM_INFO info;
+            ::GetSystemInfo(&info);
+            size_t unit = info.dwAllocationGranularity;
+#else
+            size_t unit = (size_t)::sysconf(_SC_PAGESIZE);
+#endif
+            return (size + unit - 1) / unit * unit;
+        }
+
+        /* Maps `size` bytes of fresh storage at [p, p + size) and again at
+         * [p + size, p + 2 * size), and returns p.
+         */
+        static char* map(size_t size){
+#ifdef WIN32
+            HANDLE section = ::CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                (DWORD)((unsigned long long)size >> 32), (DWORD)size, nullptr);
+            if (!section){
+                throw std::bad_alloc();
+            }
+            char* result = nullptr;
+            /* find a free range, then map into it; another thread may take
+             * the range in between, so retry a few times
+             */
+            for (int tries = 0; tries < 16 && !result; ++tries){
+                void* hole = ::VirtualAlloc(nullptr, size * 2, MEM_RESERVE, PAGE_NOACCESS);
+                if (!hole){
+                    break;
+                }
+                ::VirtualFree(hole, 0, MEM_RELEASE);
+                void* first = ::MapViewOfFileEx(section, FILE_MAP_ALL_ACCESS, 0, 0, size, hole);
+                void* second = first ? ::MapViewOfFileEx(section, FILE_MAP_ALL_ACCESS, 0, 0, size,
+                                                         (char*)hole + size) : nullptr;
+                if (second){
+                    result = (char*)first;
+                }
+                else if (first){
+                    ::UnmapViewOfFile(first);
+                }
+            }
+            /* the views keep the section alive */
+            ::CloseHandle(section);
+            if (!result){
+                throw std::bad_alloc();
+            }
+            return result;
+#else
+            int fd = open_storage();
+            if (fd < 0){
+                throw std::bad_alloc();
+            }
+            if (::ftruncate(fd, (off_t)size)){
+                ::close(fd);
+                throw std::bad_alloc();
+            }
+            /* reserve both halves, then map the storage over each */
+            void* p = ::mmap(nullptr, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED){
+                ::close(fd);
+                throw std::bad_alloc();
+            }
+            char* base = (char*)p;
+            bool mapped =
+                ::mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED &&
+                ::mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+            /* the mappings keep the storage alive */
+            ::close(fd);
+            if (!mapped){
+                ::munmap(base, size * 2);
+                throw std::bad_alloc();
+            }
+            return base;
+#endif
+        }
+
+        static void unmap(char* p, size_t size){
+            if (!p){
+                return;
+            }
+#ifdef WIN32
+            ::UnmapViewOfFile(p + size);
+            ::UnmapViewOfFile(p);
+#else
+            ::munmap(p, size * 2);
+#endif
+        }
+
+#ifndef WIN32
+        /* An anonymous file: no name remains once it is open. */
+        static int open_storage(){
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+            return ::memfd_create("hy::mirrored_queue_buffer", MFD_CLOEXEC);
+#else
+            char name[64];
+            for (int tries = 0; tries < 16; ++tries){
+                snprintf(name, sizeof(name), "/hy-mirror-%ld-%d-%p",
+                         (long)::getpid(), tries, (void*)name);
+                int fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+                if (fd >= 0){
+                    ::shm_unlink(name);
+                    return fd;
+                }
+            }
+            return -1;
+#endif
+        }
+#endif
+
+        /* Start of the first of the two mappings */
+        char* _buf;
+        /* Capacity of queue, the size of one mapping */
+        size_t _size;
+        /* Offset to queue front, always < _size */
+        size_t _front;
+        /* Offset to queue tail, < 2 * _size */
+        size_t _tail;
+    };
+}
+
+IMPLEMENT_STD_SWAP(hy::mirrored_queue_buffer)
@@ -0,0 +1,181 @@
+#pragma once
+#include <cstdlib>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <utility>
+
+namespace hy {
+    /* mpmc_queue is a bounded multi-producer/multi-consumer queue after
+     * Dmitry Vyukov's design.
+     *
+     * Every slot carries a sequence number that says whose turn it is: a
+     * producer may fill slot i when its sequence is i, a consumer may empty
+     * it when it is i + 1. A thread claims a position with one CAS on the
+     * shared index and then works on its slot alone, so producers and
+     * consumers only contend on their own index, and never on a lock.
+     *
+     * Slots and both indices sit on cache lines of their own.
+     *
+     * try_push() and try_pop() fail right away on a full (empty) queue;
+     * push() and pop() wait for room (an element), spinning briefly and
+     * then yielding the CPU. T must be default-constructible and movable.
+     */
+    template<typename T>
+    class mpmc_queue {
+    public:
+        /* `capacity` is rounded up to a power of 2, at least 2. */
+        explicit mpmc_queue(size_t capacity)
+            : _cells(nullptr), _mask(0), _push_pos(0), _pop_pos(0){
+            size_t n = 2;
+            while (n < capacity){
+                n <<= 1;
+            }
+            _cells = new cell[n];
+            _mask = n - 1;
+            for (size_t i = 0; i < n; ++i){
+                _cells[i].seq.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        ~mpmc_queue(){ delete[] _cells; }
+
+        mpmc_queue(const mpmc_queue&) = delete;
+        mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+        size_t capacity() const { return _mask + 1; }
+
+        /* A snapshot, exact only while no other thread is using the queue. */
+        size_t size() const {
+            size_t pushed = _push_pos.load(std::memory_order_relaxed);
+            size_t popped = _pop_pos.load(std::memory_order_relaxed);
+            return pushed > popped ? pushed - popped : 0;
+        }
+
+        template<typename U>
+        bool try_push(U&& value){
+            size_t pos = _push_pos.load(std::memory_order_relaxed);
+            for (;;){
+                cell& c = _cells[pos & _mask];
+                size_t seq = c.seq.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                if (diff == 0){
+                    if (_push_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                        c.value = std::forward<U>(value);
+                        c.seq.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0){
+                    /* the slot still holds the element of the previous lap */
+                    return false;
+                }
+                else {
+                    pos = _push_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool try_pop(T& value){
+            size_t pos = _pop_pos.load(std::memory_order_relaxed);
+            for (;;){
+                cell& c = _cells[pos & _mask];
+                size_t seq = c.seq.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+                if (diff == 0){
+                    if (_pop_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                        value = std::move(c.value);
+                        c.seq.store(pos + _mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0){
+                    return false;
+                }
+                else {
+                    pos = _pop_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /* Pops up to `max` consecutive elements into `out` with a single
+         * claim. Returns the number popped, 0 if the queue is empty.
+         */
+        size_t try_pop_bulk(T* out, size_t max){
+            size_t pos = _pop_pos.load(std::memory_order_relaxed);
+            for (;;){
+                /* count the filled slots from pos on */
+                size_t n = 0;
+                while (n < max){
+                    size_t seq = _cells[(pos + n) & _mask].seq.load(std::memory_order_acquire);
+                    if (seq != pos + n + 1){
+                        break;
+                    }
+                    ++n;
+                }
+                if (n == 0){
+                    size_t seq = _cells[pos & _mask].seq.load(std::memory_order_relaxed);
+                    if ((intptr_t)seq - (intptr_t)(pos + 1) < 0){
+                        return 0;
+                    }
+                    /* another consumer took it: start over */
+                    pos = _pop_pos.load(std::memory_order_relaxed);
+                    continue;
+                }
+                if (_pop_pos.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)){
+                    for (size_t i = 0; i < n; ++i){
+                        cell& c = _cells[(pos + i) & _mask];
+                        out[i] = std::move(c.value);
+                        c.seq.store(pos + i + _mask + 1, std::memory_order_release);
+                    }
+                    return n;
+                }
+            }
+        }
+
+        template<typename U>
+        void push(U&& value){
+            for (unsigned spins = 0; !try_push(std::forward<U>(value)); ++spins){
+                backoff(spins);
+            }
+        }
+
+        void pop(T& value){
+            for (unsigned spins = 0; !try_pop(value); ++spins){
+                backoff(spins);
+            }
+        }
+
+        /* Waits for at least one element, then pops up to `max`. */
+        size_t pop_bulk(T* out, size_t max){
+            size_t n;
+            for (unsigned spins = 0; (n = try_pop_bulk(out, max)) == 0; ++spins){
+                backoff(spins);
+            }
+            return n;
+        }
+
+    private:
+        static const size_t cache_line = 64;
+
+        struct cell {
+            std::atomic<size_t> seq;
+            T value;
+            char pad[cache_line - (sizeof(std::atomic<size_t>) + sizeof(T)) % cache_line];
+        };
+
+        static void backoff(unsigned spins){
+            if (spins >= 16){
+                std::this_thread::yield();
+            }
+        }
+
+        cell* _cells;
+        size_t _mask;
+        char _pad0[cache_line];
+        std::atomic<size_t> _push_pos;
+        char _pad1[cache_line - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> _pop_pos;
+        char _pad2[cache_line - sizeof(std::atomic<size_t>)];
+    };
+}
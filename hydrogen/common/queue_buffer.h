@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdlib>
+#include <cstring>
 #include <utility>
 #include <cassert>
 #include <stdexcept>
@@ -75,7 +76,7 @@ namespace hy {
             if (count > length()){
                 count = length();
             }
-            memcpy(_buf, front(), length());
+            memcpy(dst, front(), count * sizeof(T));
             return count;
         }
 
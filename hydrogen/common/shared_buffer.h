@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <new>
+#include <utility>
+#include <cassert>
+
+#include <hydrogen/common/stdext.h>
+
+namespace hy {
+    /* shared_buffer is an immutable, reference-counted byte buffer.
+     *
+     * The counter and the bytes live in one heap block. Copying a shared_buffer
+     * only bumps the counter, so one encoded message can be queued on any
+     * number of connections without copying its bytes. The counter is atomic:
+     * copies may be released on different threads.
+     *
+     * The bytes are written once, when the buffer is built, and never change
+     * afterwards.
+     */
+    class shared_buffer {
+    public:
+        shared_buffer() : _rep(nullptr){}
+
+        /* Copies `size` bytes from `data` into a new buffer. */
+        shared_buffer(const char* data, size_t size) : _rep(make(size)){
+            memcpy(_rep->data(), data, size);
+        }
+
+        /* Builds a buffer of `size` bytes in place: `fill(char* p)` writes the
+         * bytes (e.g. encodes the message) directly into the shared block.
+         */
+        template<typename Fill>
+        static shared_buffer build(size_t size, Fill fill){
+            shared_buffer b;
+            b._rep = make(size);
+            fill(b._rep->data());
+            return b;
+        }
+
+        shared_buffer(const shared_buffer& b) : _rep(b._rep){
+            if (_rep){
+                _rep->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        shared_buffer(shared_buffer&& b) : _rep(b._rep){
+            b._rep = nullptr;
+        }
+
+        shared_buffer& operator=(shared_buffer b){
+            swap(b);
+            return *this;
+        }
+
+        ~shared_buffer(){ release(); }
+
+        void swap(shared_buffer& b){
+            std::swap(_rep, b._rep);
+        }
+
+        /* Drops this reference; the block is freed with the last one. */
+        void release(){
+            if (_rep && _rep->refs.fetch_sub(1, std::memory_order_acq_rel) == 1){
+                _rep->~rep();
+                free(_rep);
+            }
+            _rep = nullptr;
+        }
+
+        const char* data() const { return _rep ? _rep->data() : nullptr; }
+        size_t size() const { return _rep ? _rep->size : 0; }
+        bool empty() const { return size() == 0; }
+
+        /* Number of shared_buffers referring to the same block. */
+        long use_count() const {
+            return _rep ? _rep->refs.load(std::memory_order_relaxed) : 0;
+        }
+
+    private:
+        struct rep {
+            rep(size_t n) : refs(1), size(n){}
+
+            char* data() { return reinterpret_cast<char*>(this + 1); }
+
+            std::atomic<long> refs;
+            size_t size;
+        };
+
+        static rep* make(size_t size){
+            void* p = malloc(sizeof(rep) + size);
+            if (!p){
+                throw std::bad_alloc();
+            }
+            return new (p) rep(size);
+        }
+
+        rep* _rep;
+    };
+}
+
+IMPLEMENT_STD_SWAP(hy::shared_buffer)
@@ -0,0 +1,791 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HYDROGEN_SIMD_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+/* Functions using AVX2 are compiled for it whatever the target of the
+ * build, and only called once the CPU is known to have it.
+ */
+#if defined(HYDROGEN_SIMD_X86) && defined(__GNUC__)
+#define HYDROGEN_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define HYDROGEN_TARGET_AVX2
+#endif
+
+namespace hy {
+    /*
+     * simd holds the vectorized byte-scanning kernels behind hy::string:
+     * find, search, ASCII classification, case folding.
+     *
+     * Each kernel has a scalar version, an SSE2 version (the x86-64
+     * baseline) and an AVX2 version, selected at run time by the CPU; the
+     * scalar versions serve other architectures. Kernels take [begin, end)
+     * ranges, never read outside of them, and return `end` for "not found".
+     */
+    namespace simd {
+        enum class isa { none, sse2, avx2 };
+
+        /* The best instruction set of this CPU. */
+        inline isa detect(){
+#if !defined(HYDROGEN_SIMD_X86)
+            return isa::none;
+#elif defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7){
+                return isa::sse2;
+            }
+            __cpuid(info, 1);
+            /* OSXSAVE and AVX, and the OS saves the YMM registers */
+            bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28))
+                    && (_xgetbv(0) & 6) == 6;
+            __cpuidex(info, 7, 0);
+            return avx && (info[1] & (1 << 5)) ? isa::avx2 : isa::sse2;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? isa::avx2 : isa::sse2;
+#endif
+        }
+
+        inline isa& _active(){
+            static isa a = detect();
+            return a;
+        }
+
+        /* The instruction set the kernels use. */
+        inline isa active(){ return _active(); }
+
+        /* Restricts the kernels to `level`, or to the best the CPU has if
+         * that is less; returns the level in use. For tests and benchmarks.
+         */
+        inline isa use(isa level){
+            isa best = detect();
+            _active() = level < best ? level : best;
+            return _active();
+        }
+
+        inline unsigned _lowest_bit(unsigned m){
+#ifdef _MSC_VER
+            unsigned long i;
+            _BitScanForward(&i, m);
+            return i;
+#else
+            return __builtin_ctz(m);
+#endif
+        }
+
+        inline unsigned _highest_bit(unsigned m){
+#ifdef _MSC_VER
+            unsigned long i;
+            _BitScanReverse(&i, m);
+            return i;
+#else
+            return 31 - __builtin_clz(m);
+#endif
+        }
+
+        inline unsigned _lowest_bit64(unsigned long long m){
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long i;
+            _BitScanForward64(&i, m);
+            return i;
+#elif defined(_MSC_VER)
+            return (unsigned)m ? _lowest_bit((unsigned)m) : 32 + _lowest_bit((unsigned)(m >> 32));
+#else
+            return __builtin_ctzll(m);
+#endif
+        }
+
+        /* Two-way string matching (Crochemore-Perrin): linear time and
+         * constant space whatever the needle. `nl` >= 1.
+         */
+        inline const char* two_way_search(const char* h, const char* he, const char* needle, size_t nl){
+            const unsigned char* n = (const unsigned char*)needle;
+            size_t ip, jp, k, p, ms, p0, mem, mem0;
+
+            /* maximal suffix for < */
+            ip = (size_t)-1; jp = 0; k = p = 1;
+            while (jp + k < nl){
+                if (n[ip + k] == n[jp + k]){
+                    if (k == p){
+                        jp += p;
+                        k = 1;
+                    }
+                    else {
+                        ++k;
+                    }
+                }
+                else if (n[ip + k] > n[jp + k]){
+                    jp += k;
+                    k = 1;
+                    p = jp - ip;
+                }
+                else {
+                    ip = jp++;
+                    k = p = 1;
+                }
+            }
+            ms = ip;
+            p0 = p;
+
+            /* and for >: the critical factorization is the later one */
+            ip = (size_t)-1; jp = 0; k = p = 1;
+            while (jp + k < nl){
+                if (n[ip + k] == n[jp + k]){
+                    if (k == p){
+                        jp += p;
+                        k = 1;
+                    }
+                    else {
+                        ++k;
+                    }
+                }
+                else if (n[ip + k] < n[jp + k]){
+                    jp += k;
+                    k = 1;
+                    p = jp - ip;
+                }
+                else {
+                    ip = jp++;
+                    k = p = 1;
+                }
+            }
+            if (ip + 1 > ms + 1){
+                ms = ip;
+            }
+            else {
+                p = p0;
+            }
+
+            /* a periodic needle remembers how much of it already matched */
+            if (memcmp(n, n + p, ms + 1)){
+                mem0 = 0;
+                p = (ms > nl - ms - 1 ? ms : nl - ms - 1) + 1;
+            }
+            else {
+                mem0 = nl - p;
+            }
+            mem = 0;
+
+            const unsigned char* s = (const unsigned char*)h;
+            const unsigned char* end = (const unsigned char*)he;
+            while ((size_t)(end - s) >= nl){
+                /* right half, left to right */
+                for (k = (ms + 1 > mem ? ms + 1 : mem); k < nl && n[k] == s[k]; ++k);
+                if (k < nl){
+                    s += k - ms;
+                    mem = 0;
+                    continue;
+                }
+                /* left half, right to left */
+                for (k = ms + 1; k > mem && n[k - 1] == s[k - 1]; --k);
+                if (k <= mem){
+                    return (const char*)s;
+                }
+                s += p;
+                mem = mem0;
+            }
+            return he;
+        }
+
+        namespace scalar {
+            inline unsigned long long match64(const char* b, const char* e, char c){
+                unsigned long long m = 0;
+                for (size_t i = 0; b + i != e; ++i){
+                    m |= (unsigned long long)(b[i] == c) << i;
+                }
+                return m;
+            }
+
+            inline const char* find(const char* b, const char* e, char c){
+                for (; b != e; ++b){
+                    if (*b == c){
+                        return b;
+                    }
+                }
+                return e;
+            }
+
+            inline const char* rfind(const char* b, const char* e, char c){
+                for (auto p = e; p != b;){
+                    if (*--p == c){
+                        return p;
+                    }
+                }
+                return e;
+            }
+
+            /* The candidates at [p, stop) of `search`, one at a time. */
+            inline const char* search_tail(const char* p, const char* stop, const char* he,
+                                           const char* n, size_t nl){
+                for (; p < stop; ++p){
+                    if (p[0] == n[0] && p[nl - 1] == n[nl - 1] && !memcmp(p + 1, n + 1, nl - 2)){
+                        return p;
+                    }
+                }
+                return he;
+            }
+
+            /* ASCII classes of the "C" locale, without its table lookups or
+             * its undefined behavior on negative chars.
+             */
+            inline bool is_space(char c){
+                unsigned char u = (unsigned char)c;
+                return u == ' ' || (unsigned)(u - '\t') <= '\r' - '\t';
+            }
+
+            inline bool is_digit(char c){
+                return (unsigned)((unsigned char)c - '0') <= 9;
+            }
+
+            inline bool is_control(char c){
+                unsigned char u = (unsigned char)c;
+                return u < 0x20 || u == 0x7f;
+            }
+
+            /* tchar of RFC 7230: letters, digits and !#$%&'*+-.^_`|~ */
+            inline bool is_token(char c){
+                static const unsigned long long tchars[2] = { 0x03ff6cfa00000000ull, 0x57ffffffc7fffffeull };
+                unsigned char u = (unsigned char)c;
+                return u < 0x80 && (tchars[u >> 6] >> (u & 63) & 1);
+            }
+
+            inline char to_lower(char c){
+                return (unsigned)((unsigned char)c - 'A') <= 'Z' - 'A' ? (char)(c | 0x20) : c;
+            }
+
+            /* The first byte of [b, e) that is (`hit`) or is not in Class. */
+            template<typename Class>
+            inline const char* scan(const char* b, const char* e, bool hit){
+                for (; b != e; ++b){
+                    if (Class::test(*b) == hit){
+                        return b;
+                    }
+                }
+                return e;
+            }
+
+            /* The last byte of [b, e) that is (`hit`) or is not in Class. */
+            template<typename Class>
+            inline const char* rscan(const char* b, const char* e, bool hit){
+                for (auto p = e; p != b;){
+                    if (Class::test(*--p) == hit){
+                        return p;
+                    }
+                }
+                return e;
+            }
+
+            inline bool equals_ignore_case(const char* a, const char* b, size_t n){
+                for (size_t i = 0; i < n; ++i){
+                    if (a[i] != b[i] && to_lower(a[i]) != to_lower(b[i])){
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            inline char* to_lower(const char* b, const char* e, char* out){
+                for (; b != e; ++b){
+                    *out++ = to_lower(*b);
+                }
+                return out;
+            }
+        }
+
+        /* A false candidate costs a memcmp: past this many (plus one per 16
+         * bytes scanned), search gives up filtering for two-way.
+         */
+        static const size_t search_misses = 16;
+
+#ifdef HYDROGEN_SIMD_X86
+        namespace sse2 {
+            inline unsigned long long match64(const char* b, const char* e, char c){
+                if (e - b < 64){
+                    return scalar::match64(b, e, c);
+                }
+                const __m128i v = _mm_set1_epi8(c);
+                unsigned long long m = 0;
+                for (int i = 0; i < 4; ++i){
+                    __m128i x = _mm_loadu_si128((const __m128i*)(b + 16 * i));
+                    m |= (unsigned long long)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, v)) << (16 * i);
+                }
+                return m;
+            }
+
+            inline const char* find(const char* b, const char* e, char c){
+                const __m128i v = _mm_set1_epi8(c);
+                for (; e - b >= 16; b += 16){
+                    __m128i x = _mm_loadu_si128((const __m128i*)b);
+                    unsigned m = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, v));
+                    if (m){
+                        return b + _lowest_bit(m);
+                    }
+                }
+                return scalar::find(b, e, c);
+            }
+
+            inline const char* rfind(const char* b, const char* e, char c){
+                const __m128i v = _mm_set1_epi8(c);
+                const char* p = e;
+                for (; p - b >= 16; p -= 16){
+                    __m128i x = _mm_loadu_si128((const __m128i*)(p - 16));
+                    unsigned m = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, v));
+                    if (m){
+                        return p - 16 + _highest_bit(m);
+                    }
+                }
+                const char* r = scalar::rfind(b, p, c);
+                return r == p ? e : r;
+            }
+
+            /* Candidates must match the first and the last byte of the
+             * needle; only those get compared in full. `nl` >= 2.
+             */
+            inline const char* search(const char* h, const char* he, const char* n, size_t nl){
+                const __m128i first = _mm_set1_epi8(n[0]);
+                const __m128i last = _mm_set1_epi8(n[nl - 1]);
+                const char* stop = he - nl + 1;
+                const char* p = h;
+                size_t misses = 0;
+                for (; stop - p >= 16; p += 16){
+                    __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), first);
+                    __m128i z = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + nl - 1)), last);
+                    unsigned m = (unsigned)_mm_movemask_epi8(_mm_and_si128(a, z));
+                    while (m){
+                        const char* c = p + _lowest_bit(m);
+                        if (!memcmp(c + 1, n + 1, nl - 2)){
+                            return c;
+                        }
+                        if (++misses > search_misses + (size_t)(p - h) / 16){
+                            return two_way_search(c + 1, he, n, nl);
+                        }
+                        m &= m - 1;
+                    }
+                }
+                return scalar::search_tail(p, stop, he, n, nl);
+            }
+
+            /* 0xff for the bytes of `x` in [lo, hi], as unsigned */
+            inline __m128i in_range(__m128i x, char lo, char hi){
+                __m128i d = _mm_sub_epi8(x, _mm_set1_epi8(lo));
+                return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8((char)(hi - lo))), d);
+            }
+
+            /* ASCII letters lowercased */
+            inline __m128i fold(__m128i x){
+                return _mm_or_si128(x, _mm_and_si128(in_range(x, 'A', 'Z'), _mm_set1_epi8(0x20)));
+            }
+
+            template<typename Class>
+            inline const char* scan(const char* b, const char* e, bool hit){
+                const unsigned flip = hit ? 0 : 0xffff;
+                for (; e - b >= 16; b += 16){
+                    __m128i x = _mm_loadu_si128((const __m128i*)b);
+                    unsigned m = (unsigned)_mm_movemask_epi8(Class::match(x)) ^ flip;
+                    if (m){
+                        return b + _lowest_bit(m);
+                    }
+                }
+                return scalar::scan<Class>(b, e, hit);
+            }
+
+            template<typename Class>
+            inline const char* rscan(const char* b, const char* e, bool hit){
+                const unsigned flip = hit ? 0 : 0xffff;
+                const char* p = e;
+                for (; p - b >= 16; p -= 16){
+                    __m128i x = _mm_loadu_si128((const __m128i*)(p - 16));
+                    unsigned m = (unsigned)_mm_movemask_epi8(Class::match(x)) ^ flip;
+                    if (m){
+                        return p - 16 + _highest_bit(m);
+                    }
+                }
+                const char* r = scalar::rscan<Class>(b, p, hit);
+                return r == p ? e : r;
+            }
+
+            inline bool equals_ignore_case(const char* a, const char* b, size_t n){
+                for (; n >= 16; a += 16, b += 16, n -= 16){
+                    __m128i x = fold(_mm_loadu_si128((const __m128i*)a));
+                    __m128i y = fold(_mm_loadu_si128((const __m128i*)b));
+                    if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xffff){
+                        return false;
+                    }
+                }
+                return scalar::equals_ignore_case(a, b, n);
+            }
+
+            inline char* to_lower(const char* b, const char* e, char* out){
+                for (; e - b >= 16; b += 16, out += 16){
+                    _mm_storeu_si128((__m128i*)out, fold(_mm_loadu_si128((const __m128i*)b)));
+                }
+                return scalar::to_lower(b, e, out);
+            }
+        }
+
+        namespace avx2 {
+            HYDROGEN_TARGET_AVX2
+            inline unsigned long long match64(const char* b, const char* e, char c){
+                if (e - b < 64){
+                    return scalar::match64(b, e, c);
+                }
+                const __m256i v = _mm256_set1_epi8(c);
+                unsigned lo = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)b), v));
+                unsigned hi = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(b + 32)), v));
+                return (unsigned long long)hi << 32 | lo;
+            }
+
+            HYDROGEN_TARGET_AVX2
+            inline const char* find(const char* b, const char* e, char c){
+                const __m256i v = _mm256_set1_epi8(c);
+                for (; e - b >= 32; b += 32){
+                    __m256i x = _mm256_loadu_si256((const __m256i*)b);
+                    unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, v));
+                    if (m){
+                        return b + _lowest_bit(m);
+                    }
+                }
+                return sse2::find(b, e, c);
+            }
+
+            HYDROGEN_TARGET_AVX2
+            inline const char* rfind(const char* b, const char* e, char c){
+                const __m256i v = _mm256_set1_epi8(c);
+                const char* p = e;
+                for (; p - b >= 32; p -= 32){
+                    __m256i x = _mm256_loadu_si256((const __m256i*)(p - 32));
+                    unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, v));
+                    if (m){
+                        return p - 32 + _highest_bit(m);
+                    }
+                }
+                const char* r = sse2::rfind(b, p, c);
+                return r == p ? e : r;
+            }
+
+            HYDROGEN_TARGET_AVX2
+            inline const char* search(const char* h, const char* he, const char* n, size_t nl){
+                const __m256i first = _mm256_set1_epi8(n[0]);
+                const __m256i last = _mm256_set1_epi8(n[nl - 1]);
+                const char* stop = he - nl + 1;
+                const char* p = h;
+                size_t misses = 0;
+                for (; stop - p >= 32; p += 32){
+                    __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), first);
+                    __m256i z = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + nl - 1)), last);
+                    unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(a, z));
+                    while (m){
+                        const char* c = p + _lowest_bit(m);
+                        if (!memcmp(c + 1, n + 1, nl - 2)){
+                            return c;
+                        }
+                        if (++misses > search_misses + (size_t)(p - h) / 16){
+                            return two_way_search(c + 1, he, n, nl);
+                        }
+                        m &= m - 1;
+                    }
+                }
+                return scalar::search_tail(p, stop, he, n, nl);
+            }
+
+            HYDROGEN_TARGET_AVX2
+            inline __m256i in_range(__m256i x, char lo, char hi){
+                __m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8(lo));
+                return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8((char)(hi - lo))), d);
+            }
+
+            HYDROGEN_TARGET_AVX2
+            inline __m256i fold(__m256i x){
+                return _mm256_or_si256(x, _mm256_and_si256(in_range(x, 'A', 'Z'), _mm256_set1_epi8(0x20)));
+            }
+
+            template<typename Class>
+            HYDROGEN_TARGET_AVX2
+            inline const char* scan(const char* b, const char* e, bool hit){
+                const unsigned flip = hit ? 0 : 0xffffffff;
+                for (; e - b >= 32; b += 32){
+                    __m256i x = _mm256_loadu_si256((const __m256i*)b);
+                    unsigned m = (unsigned)_mm256_movemask_epi8(Class::match(x)) ^ flip;
+                    if (m){
+                        return b + _lowest_bit(m);
+                    }
+                }
+                return sse2::scan<Class>(b, e, hit);
+            }
+
+            template<typename Class>
+            HYDROGEN_TARGET_AVX2
+            inline const char* rscan(const char* b, const char* e, bool hit){
+                const unsigned flip = hit ? 0 : 0xffffffff;
+                const char* p = e;
+                for (; p - b >= 32; p -= 32){
+                    __m256i x = _mm256_loadu_si256((const __m256i*)(p - 32));
+                    unsigned m = (unsigned)_mm256_movemask_epi8(Class::match(x)) ^ flip;
+                    if (m){
+                        return p - 32 + _highest_bit(m);
+                    }
+                }
+                const char* r = sse2::rscan<Class>(b, p, hit);
+                return r == p ? e : r;
+            }
+
+            HYDROGEN_TARGET_AVX2
+            inline bool equals_ignore_case(const char* a, const char* b, size_t n){
+                for (; n >= 32; a += 32, b += 32, n -= 32){
+                    __m256i x = fold(_mm256_loadu_si256((const __m256i*)a));
+                    __m256i y = fold(_mm256_loadu_si256((const __m256i*)b));
+                    if ((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != 0xffffffff){
+                        return false;
+                    }
+                }
+                return sse2::equals_ignore_case(a, b, n);
+            }
+
+            HYDROGEN_TARGET_AVX2
+            inline char* to_lower(const char* b, const char* e, char* out){
+                for (; e - b >= 32; b += 32, out += 32){
+                    _mm256_storeu_si256((__m256i*)out, fold(_mm256_loadu_si256((const __m256i*)b)));
+                }
+                return sse2::to_lower(b, e, out);
+            }
+        }
+#endif
+
+        /* Character classes of the scans: a byte test, and the same test
+         * on a vector of bytes, 0xff where it holds.
+         */
+        struct space_class {
+            static bool test(char c){ return scalar::is_space(c); }
+#ifdef HYDROGEN_SIMD_X86
+            static __m128i match(__m128i x){
+                return _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), sse2::in_range(x, '\t', '\r'));
+            }
+            HYDROGEN_TARGET_AVX2
+            static __m256i match(__m256i x){
+                return _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')), avx2::in_range(x, '\t', '\r'));
+            }
+#endif
+        };
+
+        struct digit_class {
+            static bool test(char c){ return scalar::is_digit(c); }
+#ifdef HYDROGEN_SIMD_X86
+            static __m128i match(__m128i x){ return sse2::in_range(x, '0', '9'); }
+            HYDROGEN_TARGET_AVX2
+            static __m256i match(__m256i x){ return avx2::in_range(x, '0', '9'); }
+#endif
+        };
+
+        struct control_class {
+            static bool test(char c){ return scalar::is_control(c); }
+#ifdef HYDROGEN_SIMD_X86
+            static __m128i match(__m128i x){
+                return _mm_or_si128(sse2::in_range(x, 0, 0x1f), _mm_cmpeq_epi8(x, _mm_set1_epi8(0x7f)));
+            }
+            HYDROGEN_TARGET_AVX2
+            static __m256i match(__m256i x){
+                return _mm256_or_si256(avx2::in_range(x, 0, 0x1f), _mm256_cmpeq_epi8(x, _mm256_set1_epi8(0x7f)));
+            }
+#endif
+        };
+
+        /* Letters and digits, the runs #$%&' *+ -. ^_` and ! | ~ */
+        struct token_class {
+            static bool test(char c){ return scalar::is_token(c); }
+#ifdef HYDROGEN_SIMD_X86
+            static __m128i match(__m128i x){
+                using sse2::in_range;
+                __m128i r = _mm_or_si128(in_range(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z'), in_range(x, '0', '9'));
+                r = _mm_or_si128(r, _mm_or_si128(in_range(x, '#', '\''), in_range(x, '*', '+')));
+                r = _mm_or_si128(r, _mm_or_si128(in_range(x, '-', '.'), in_range(x, '^', '`')));
+                r = _mm_or_si128(r, _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('!')), _mm_cmpeq_epi8(x, _mm_set1_epi8('|'))));
+                return _mm_or_si128(r, _mm_cmpeq_epi8(x, _mm_set1_epi8('~')));
+            }
+            /* AVX2 can look a byte up in a table: bit h of lo[l] is set
+             * if byte 0xhl is a token character, and hi[h] is that bit.
+             */
+            HYDROGEN_TARGET_AVX2
+            static __m256i match(__m256i x){
+                const __m256i lo = _mm256_setr_epi8(
+                    (char)0xe8, (char)0xfc, (char)0xf8, (char)0xfc, (char)0xfc, (char)0xfc, (char)0xfc, (char)0xfc,
+                    (char)0xf8, (char)0xf8, (char)0xf4, 0x54, (char)0xd0, 0x54, (char)0xf4, 0x70,
+                    (char)0xe8, (char)0xfc, (char)0xf8, (char)0xfc, (char)0xfc, (char)0xfc, (char)0xfc, (char)0xfc,
+                    (char)0xf8, (char)0xf8, (char)0xf4, 0x54, (char)0xd0, 0x54, (char)0xf4, 0x70);
+                const __m256i hi = _mm256_setr_epi8(
+                    1, 2, 4, 8, 16, 32, 64, (char)0x80, 0, 0, 0, 0, 0, 0, 0, 0,
+                    1, 2, 4, 8, 16, 32, 64, (char)0x80, 0, 0, 0, 0, 0, 0, 0, 0);
+                const __m256i nibble = _mm256_set1_epi8(0x0f);
+                __m256i l = _mm256_shuffle_epi8(lo, _mm256_and_si256(x, nibble));
+                __m256i h = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+                __m256i miss = _mm256_cmpeq_epi8(_mm256_and_si256(l, h), _mm256_setzero_si256());
+                return _mm256_andnot_si256(miss, _mm256_set1_epi8(-1));
+            }
+#endif
+        };
+
+        /* The positions of `c` in the first 64 bytes of [b, e) as a mask:
+         * bit i is set if b[i] == c. Scanning a block at a time serves
+         * callers that stop at every match, e.g. at each of many short lines.
+         */
+        inline unsigned long long match64(const char* b, const char* e, char c){
+#ifdef HYDROGEN_SIMD_X86
+            switch (active()){
+            case isa::avx2: return avx2::match64(b, e, c);
+            case isa::sse2: return sse2::match64(b, e, c);
+            default: break;
+            }
+#endif
+            if (e - b > 64){
+                e = b + 64;
+            }
+            return scalar::match64(b, e, c);
+        }
+
+        /* The first `c` in [b, e). */
+        inline const char* find(const char* b, const char* e, char c){
+#ifdef HYDROGEN_SIMD_X86
+            switch (active()){
+            case isa::avx2: return avx2::find(b, e, c);
+            case isa::sse2: return sse2::find(b, e, c);
+            default: break;
+            }
+#endif
+            return scalar::find(b, e, c);
+        }
+
+        /* The last `c` in [b, e). */
+        inline const char* rfind(const char* b, const char* e, char c){
+#ifdef HYDROGEN_SIMD_X86
+            switch (active()){
+            case isa::avx2: return avx2::rfind(b, e, c);
+            case isa::sse2: return sse2::rfind(b, e, c);
+            default: break;
+            }
+#endif
+            return scalar::rfind(b, e, c);
+        }
+
+        /* The first occurrence of [n, ne) in [h, he), as std::search: an
+         * empty needle is found at `h`.
+         */
+        inline const char* search(const char* h, const char* he, const char* n, const char* ne){
+            size_t nl = ne - n;
+            if (nl == 0){
+                return h;
+            }
+            if ((size_t)(he - h) < nl){
+                return he;
+            }
+            if (nl == 1){
+                return find(h, he, *n);
+            }
+#ifdef HYDROGEN_SIMD_X86
+            switch (active()){
+            case isa::avx2: return avx2::search(h, he, n, nl);
+            case isa::sse2: return sse2::search(h, he, n, nl);
+            default: break;
+            }
+#endif
+            return two_way_search(h, he, n, nl);
+        }
+
+        template<typename Class>
+        inline const char* _scan(const char* b, const char* e, bool hit){
+#ifdef HYDROGEN_SIMD_X86
+            switch (active()){
+            case isa::avx2: return avx2::scan<Class>(b, e, hit);
+            case isa::sse2: return sse2::scan<Class>(b, e, hit);
+            default: break;
+            }
+#endif
+            return scalar::scan<Class>(b, e, hit);
+        }
+
+        template<typename Class>
+        inline const char* _rscan(const char* b, const char* e, bool hit){
+#ifdef HYDROGEN_SIMD_X86
+            switch (active()){
+            case isa::avx2: return avx2::rscan<Class>(b, e, hit);
+            case isa::sse2: return sse2::rscan<Class>(b, e, hit);
+            default: break;
+            }
+#endif
+            return scalar::rscan<Class>(b, e, hit);
+        }
+
+        /* The first byte of [b, e) that is not white space (" \t\n\v\f\r"). */
+        inline const char* skip_space(const char* b, const char* e){
+            /* mostly there is none, or one */
+            if (b == e || !scalar::is_space(*b)){
+                return b;
+            }
+            if (++b == e || !scalar::is_space(*b)){
+                return b;
+            }
+            return _scan<space_class>(b + 1, e, false);
+        }
+
+        /* The end of [b, e) without its trailing white space. */
+        inline const char* rskip_space(const char* b, const char* e){
+            if (b == e || !scalar::is_space(e[-1])){
+                return e;
+            }
+            const char* p = _rscan<space_class>(b, e - 1, false);
+            return p == e - 1 ? b : p + 1;
+        }
+
+        /* The first byte of [b, e) that is not a decimal digit. */
+        inline const char* skip_digits(const char* b, const char* e){
+            return _scan<digit_class>(b, e, false);
+        }
+
+        /* The first byte of [b, e) that is not a token character of
+         * RFC 7230, those of methods and header names.
+         */
+        inline const char* skip_token(const char* b, const char* e){
+            return _scan<token_class>(b, e, false);
+        }
+
+        /* The first control character (0x00-0x1f, 0x7f) in [b, e). */
+        inline const char* find_control(const char* b, const char* e){
+            return _scan<control_class>(b, e, true);
+        }
+
+        /* Whether the `n` bytes at `a` and `b` are equal but for the case
+         * of ASCII letters.
+         */
+        inline bool equals_ignore_case(const char* a, const char* b, size_t n){
+#ifdef HYDROGEN_SIMD_X86
+            switch (active()){
+            case isa::avx2: return avx2::equals_ignore_case(a, b, n);
+            case isa::sse2: return sse2::equals_ignore_case(a, b, n);
+            default: break;
+            }
+#endif
+            return scalar::equals_ignore_case(a, b, n);
+        }
+
+        /* Writes [b, e) to `out` with ASCII letters lowercased; returns the
+         * end of the output. `out` may be `b`.
+         */
+        inline char* to_lower(const char* b, const char* e, char* out){
+#ifdef HYDROGEN_SIMD_X86
+            switch (active()){
+            case isa::avx2: return avx2::to_lower(b, e, out);
+            case isa::sse2: return sse2::to_lower(b, e, out);
+            default: break;
+            }
+#endif
+            return scalar::to_lower(b, e, out);
+        }
+    }
+}
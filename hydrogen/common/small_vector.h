@@ -0,0 +1,203 @@
+#pragma once
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <initializer_list>
+
+namespace hy {
+    /* small_vector is a vector that stores up to N elements inside itself
+     * and only allocates from the heap when it grows past them. For
+     * collections that are usually small, e.g. the fields of a split line,
+     * it saves an allocation per use.
+     *
+     * It has the usual subset of std::vector's interface. Iterators and
+     * references are invalidated by growth, and by moving a small_vector
+     * whose elements are stored inline.
+     */
+    template<typename T, size_t N>
+    class small_vector {
+        static_assert(N > 0, "small_vector needs room for at least one element");
+
+    public:
+        typedef T value_type;
+        typedef T& reference;
+        typedef const T& const_reference;
+        typedef T* iterator;
+        typedef const T* const_iterator;
+        typedef size_t size_type;
+
+        small_vector()
+            : _data(inline_data()), _size(0), _capacity(N){}
+
+        template<typename It>
+        small_vector(It first, It last)
+            : small_vector(){
+            assign(first, last);
+        }
+
+        small_vector(std::initializer_list<T> values)
+            : small_vector(){
+            assign(values.begin(), values.end());
+        }
+
+        small_vector(const small_vector& v)
+            : small_vector(){
+            assign(v.begin(), v.end());
+        }
+
+        small_vector(small_vector&& v)
+            : small_vector(){
+            take(v);
+        }
+
+        ~small_vector(){
+            clear();
+            if (!is_inline()){
+                free(_data);
+            }
+        }
+
+        small_vector& operator=(const small_vector& v){
+            if (this != &v){
+                assign(v.begin(), v.end());
+            }
+            return *this;
+        }
+
+        small_vector& operator=(small_vector&& v){
+            if (this != &v){
+                clear();
+                take(v);
+            }
+            return *this;
+        }
+
+        template<typename It>
+        void assign(It first, It last){
+            clear();
+            for (; first != last; ++first){
+                push_back(*first);
+            }
+        }
+
+        void push_back(const T& value){
+            if (_size == _capacity){
+                /* `value` may live in this vector */
+                T copy(value);
+                grow(_capacity * 2);
+                new (_data + _size) T(std::move(copy));
+            }
+            else {
+                new (_data + _size) T(value);
+            }
+            ++_size;
+        }
+
+        void push_back(T&& value){
+            emplace_back(std::move(value));
+        }
+
+        template<typename... Args>
+        T& emplace_back(Args&&... args){
+            if (_size == _capacity){
+                T value(std::forward<Args>(args)...);
+                grow(_capacity * 2);
+                new (_data + _size) T(std::move(value));
+            }
+            else {
+                new (_data + _size) T(std::forward<Args>(args)...);
+            }
+            return _data[_size++];
+        }
+
+        void pop_back(){
+            _data[--_size].~T();
+        }
+
+        void clear(){
+            while (_size){
+                pop_back();
+            }
+        }
+
+        void reserve(size_t capacity){
+            if (capacity > _capacity){
+                grow(capacity);
+            }
+        }
+
+        size_t size() const { return _size; }
+        size_t capacity() const { return _capacity; }
+        bool empty() const { return _size == 0; }
+
+        /* Whether the elements are stored inside the object. */
+        bool is_inline() const { return _data == inline_data(); }
+
+        T* data() { return _data; }
+        const T* data() const { return _data; }
+
+        iterator begin() { return _data; }
+        iterator end() { return _data + _size; }
+        const_iterator begin() const { return _data; }
+        const_iterator end() const { return _data + _size; }
+
+        T& operator[](size_t i) { return _data[i]; }
+        const T& operator[](size_t i) const { return _data[i]; }
+
+        T& front() { return _data[0]; }
+        const T& front() const { return _data[0]; }
+        T& back() { return _data[_size - 1]; }
+        const T& back() const { return _data[_size - 1]; }
+
+    private:
+        T* inline_data() { return reinterpret_cast<T*>(&_inline); }
+        const T* inline_data() const { return reinterpret_cast<const T*>(&_inline); }
+
+        void grow(size_t capacity){
+            if (capacity < 4){
+                capacity = 4;
+            }
+            T* data = static_cast<T*>(malloc(capacity * sizeof(T)));
+            if (!data){
+                throw std::bad_alloc();
+            }
+            for (size_t i = 0; i < _size; ++i){
+                new (data + i) T(std::move(_data[i]));
+                _data[i].~T();
+            }
+            if (!is_inline()){
+                free(_data);
+            }
+            _data = data;
+            _capacity = capacity;
+        }
+
+        /* Moves the elements of `v` here; this vector must be empty. */
+        void take(small_vector& v){
+            if (!v.is_inline()){
+                if (!is_inline()){
+                    free(_data);
+                }
+                _data = v._data;
+                _size = v._size;
+                _capacity = v._capacity;
+                v._data = v.inline_data();
+                v._size = 0;
+                v._capacity = N;
+                return;
+            }
+            reserve(v._size);
+            for (size_t i = 0; i < v._size; ++i){
+                new (_data + i) T(std::move(v._data[i]));
+            }
+            _size = v._size;
+            v.clear();
+        }
+
+        T* _data;
+        size_t _size;
+        size_t _capacity;
+        typename std::aligned_storage<sizeof(T) * N, std::alignment_of<T>::value>::type _inline;
+    };
+}
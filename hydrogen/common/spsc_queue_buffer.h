@@ -0,0 +1,165 @@
+#pragma once
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <utility>
+#include <stdexcept>
+
+namespace hy {
+    /* spsc_queue_buffer is the single-producer/single-consumer counterpart of
+     * queue_buffer: one thread writes elements in place at tail() and
+     * commits them with push(), another thread reads them in place at
+     * front() and releases them with pop(), without locks.
+     *
+     * The buffer is a ring whose capacity is a power of 2. writable() and
+     * readable() give the contiguous room at tail() and elements at front();
+     * at the end of the ring they stop short, and the rest follows at the
+     * beginning after the next push() or pop(). write() and read() copy
+     * across the wrap.
+     *
+     * push() and pop() publish a whole batch with one store. Each side keeps
+     * a copy of the other side's index and only reads the shared one when
+     * the copy says the ring is full (or empty), so in the steady state the
+     * two threads don't touch each other's cache lines. writable() and
+     * readable() may therefore report less than is available; the rest
+     * shows up once that is used.
+     *
+     * Element SHOULD be of POD types.
+     */
+    template<typename T>
+    class spsc_queue_buffer {
+    public:
+        /* `capacity` is rounded up to a power of 2. */
+        explicit spsc_queue_buffer(size_t capacity)
+            : _buf(nullptr), _mask(0), _tail(0), _cached_front(0), _front(0), _cached_tail(0){
+            size_t n = 1;
+            while (n < capacity){
+                n <<= 1;
+            }
+            _buf = new T[n];
+            _mask = n - 1;
+        }
+
+        ~spsc_queue_buffer(){ delete[] _buf; }
+
+        spsc_queue_buffer(const spsc_queue_buffer&) = delete;
+        spsc_queue_buffer& operator=(const spsc_queue_buffer&) = delete;
+
+        size_t capacity() const { return _mask + 1; }
+
+        /* Either thread; a snapshot. */
+        size_t length() const {
+            return _tail.load(std::memory_order_acquire) - _front.load(std::memory_order_acquire);
+        }
+        bool empty() const { return length() == 0; }
+
+        /* Producer side */
+
+        T* tail() { return _buf + (_tail.load(std::memory_order_relaxed) & _mask); }
+
+        /* Contiguous free elements at tail(). */
+        size_t writable(){
+            size_t t = _tail.load(std::memory_order_relaxed);
+            size_t room = capacity() - (t - _cached_front);
+            if (room == 0){
+                _cached_front = _front.load(std::memory_order_acquire);
+                room = capacity() - (t - _cached_front);
+            }
+            return contiguous(t, room);
+        }
+
+        /* Commits count elements written at tail(). */
+        void push(size_t count){
+            if (count > writable()){
+                throw std::out_of_range("hy::spsc_queue_buffer::push() out of range.");
+            }
+            _tail.store(_tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+        }
+
+        /* Copies up to count elements from src and commits them.
+         * Returns number of elements actually copied.
+         */
+        size_t write(const T* src, size_t count){
+            size_t done = 0;
+            while (done < count){
+                size_t n = writable();
+                if (n == 0){
+                    break;
+                }
+                if (n > count - done){
+                    n = count - done;
+                }
+                memcpy(tail(), src + done, n * sizeof(T));
+                push(n);
+                done += n;
+            }
+            return done;
+        }
+
+        /* Consumer side */
+
+        T* front() { return _buf + (_front.load(std::memory_order_relaxed) & _mask); }
+
+        /* Contiguous elements at front(). */
+        size_t readable(){
+            size_t f = _front.load(std::memory_order_relaxed);
+            size_t count = _cached_tail - f;
+            if (count == 0){
+                _cached_tail = _tail.load(std::memory_order_acquire);
+                count = _cached_tail - f;
+            }
+            return contiguous(f, count);
+        }
+
+        /* Releases count elements read at front(). */
+        void pop(size_t count){
+            if (count > readable()){
+                throw std::out_of_range("hy::spsc_queue_buffer::pop() out of range.");
+            }
+            _front.store(_front.load(std::memory_order_relaxed) + count, std::memory_order_release);
+        }
+
+        /* Copies up to count elements to dst and pops them.
+         * Returns number of elements actually copied.
+         */
+        size_t read(T* dst, size_t count){
+            size_t done = 0;
+            while (done < count){
+                size_t n = readable();
+                if (n == 0){
+                    break;
+                }
+                if (n > count - done){
+                    n = count - done;
+                }
+                memcpy(dst + done, front(), n * sizeof(T));
+                pop(n);
+                done += n;
+            }
+            return done;
+        }
+
+    private:
+        /* `n` elements from index `i`, cut at the end of the ring */
+        size_t contiguous(size_t i, size_t n) const {
+            size_t end = capacity() - (i & _mask);
+            return n < end ? n : end;
+        }
+
+        static const size_t cache_line = 64;
+
+        T* _buf;
+        size_t _mask;
+        char _pad0[cache_line];
+
+        /* written by the producer */
+        std::atomic<size_t> _tail;
+        size_t _cached_front;
+        char _pad1[cache_line - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+        /* written by the consumer */
+        std::atomic<size_t> _front;
+        size_t _cached_tail;
+        char _pad2[cache_line - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+    };
+}
@@ -2,6 +2,10 @@
 #include <cstring>
 #include <cstdarg>
 #include <string>
+#include <stdexcept>
+#include <type_traits>
+
+#include <hydrogen/common/charconv.h>
 
 /* Helps to implements specialized std::swap<> method
  */
@@ -17,19 +21,33 @@ namespace hy {
         return memset(dst, 0, count);
     }
 
+    /* std::string, or a string of chars with another allocator, e.g. an
+     * arena_string: the format functions write to either.
+     */
+    template<typename A>
+    using char_string = std::basic_string<char, std::char_traits<char>, A>;
+
     /* Composes a string using the given format and argument list. */
-    inline std::string& format_v(std::string& result, const char* fmtstr, va_list args){
-        int count = vsnprintf("", 1, fmtstr, args);
-        result.assign(count, '\0');
-        vsnprintf(&(result[0]), count, fmtstr, args);
+    template<typename A>
+    inline char_string<A>& format_v(char_string<A>& result, const char* fmtstr, va_list args){
+        va_list again;
+        va_copy(again, args);
+        int count = vsnprintf(nullptr, 0, fmtstr, args);
+        result.assign(count > 0 ? count + 1 : 1, '\0');
+        vsnprintf(&(result[0]), result.size(), fmtstr, again);
+        va_end(again);
+        result.resize(count > 0 ? count : 0);
         return result;
     }
 
     /* Composes a string using the given format and args. */
-    inline std::string& format(std::string& result, const char* fmtstr, ...){
+    template<typename A>
+    inline char_string<A>& format(char_string<A>& result, const char* fmtstr, ...){
         va_list args;
         va_start(args, fmtstr);
-        return format_v(result, fmtstr, args);
+        format_v(result, fmtstr, args);
+        va_end(args);
+        return result;
     }
 
     inline std::string format_v(const char* fmtstr, va_list args){
@@ -40,6 +58,74 @@ namespace hy {
     inline std::string format(const char* fmtstr, ...){
         va_list args;
         va_start(args, fmtstr);
-        return std::move(format_v(fmtstr, args));
+        std::string result;
+        format_v(result, fmtstr, args);
+        va_end(args);
+        return result;
+    }
+
+    /* Appends `value` as text to `out`, for format_to(). Numbers are
+     * written by to_chars(); other headers add overloads for their types.
+     */
+    template<typename A>
+    inline void format_append(char_string<A>& out, const char* value){ out.append(value); }
+    template<typename A, typename B>
+    inline void format_append(char_string<A>& out, const char_string<B>& value){ out.append(value.data(), value.size()); }
+    template<typename A>
+    inline void format_append(char_string<A>& out, char value){ out.push_back(value); }
+    template<typename A>
+    inline void format_append(char_string<A>& out, bool value){ out.append(value ? "true" : "false"); }
+
+    template<typename A, typename T>
+    inline typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value
+                                   && !std::is_same<T, char>::value>::type
+    format_append(char_string<A>& out, T value){
+        char buf[32];
+        out.append(buf, to_chars(buf, buf + sizeof(buf), value).ptr);
+    }
+
+    /* Appends the text of `fmt` up to its next "{}" to `out`, and returns
+     * the rest of it, or nullptr if there is no "{}" left. "{{" and "}}"
+     * stand for "{" and "}".
+     */
+    template<typename A>
+    inline const char* _format_literal(char_string<A>& out, const char* fmt){
+        const char* run = fmt;
+        for (const char* p = fmt; *p; ++p){
+            if ((p[0] == '{' && p[1] == '{') || (p[0] == '}' && p[1] == '}')){
+                out.append(run, p + 1);
+                run = ++p + 1;
+            }
+            else if (p[0] == '{' && p[1] == '}'){
+                out.append(run, p);
+                return p + 2;
+            }
+        }
+        out.append(run);
+        return nullptr;
+    }
+
+    template<typename A>
+    inline char_string<A>& format_to(char_string<A>& out, const char* fmt){
+        if (_format_literal(out, fmt)){
+            throw std::invalid_argument("hy::format_to() missing argument");
+        }
+        return out;
+    }
+
+    /* Appends `fmt` to `out` with each "{}" replaced by the next argument,
+     * written by format_append(). Unlike format() it checks its arguments'
+     * types at compile time and their count at run time (throwing
+     * std::invalid_argument), and it reuses the capacity `out` already
+     * has: clear a buffer and format into it again.
+     */
+    template<typename A, typename T, typename... Args>
+    inline char_string<A>& format_to(char_string<A>& out, const char* fmt, const T& value, const Args&... args){
+        fmt = _format_literal(out, fmt);
+        if (!fmt){
+            throw std::invalid_argument("hy::format_to() too many arguments");
+        }
+        format_append(out, value);
+        return format_to(out, fmt, args...);
     }
 }
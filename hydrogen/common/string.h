@@ -6,12 +6,77 @@
 #include <vector>
 #include <array>
 #include <algorithm>
+#include <stdexcept>
+#include <functional>
+
+#include <hydrogen/common/arena.h>
+#include <hydrogen/common/charconv.h>
+#include <hydrogen/common/hash.h>
+#include <hydrogen/common/simd.h>
+#include <hydrogen/common/small_vector.h>
+#include <hydrogen/common/stdext.h>
 
 namespace hy {
     class string;
     typedef std::vector<string> strings;
+    typedef arena_vector<string> arena_strings;
     typedef std::pair<string, string> keyval;
 
+    /* Separators of string::split_view: a character, a string, or any
+     * character of a set.
+     */
+    struct char_delimiter {
+        char_delimiter() : ch(0){}
+        explicit char_delimiter(char ch) : ch(ch){}
+
+        const char* find(const char* b, const char* e) const { return simd::find(b, e, ch); }
+        size_t length() const { return 1; }
+
+        char ch;
+    };
+
+    struct string_delimiter {
+        string_delimiter() : b(nullptr), e(nullptr){}
+        string_delimiter(const char* b, const char* e) : b(b), e(e){}
+
+        const char* find(const char* h, const char* he) const { return simd::search(h, he, b, e); }
+        size_t length() const { return e - b; }
+
+        const char* b;
+        const char* e;
+    };
+
+    struct any_delimiter {
+        any_delimiter(){
+            memset(set, 0, sizeof(set));
+        }
+        any_delimiter(const char* b, const char* e){
+            memset(set, 0, sizeof(set));
+            for (; b != e; ++b){
+                unsigned char c = (unsigned char)*b;
+                set[c >> 3] |= (unsigned char)(1 << (c & 7));
+            }
+        }
+
+        const char* find(const char* b, const char* e) const {
+            for (; b != e; ++b){
+                unsigned char c = (unsigned char)*b;
+                if (set[c >> 3] & (1 << (c & 7))){
+                    return b;
+                }
+            }
+            return e;
+        }
+        size_t length() const { return 1; }
+
+        /* a bit per character */
+        unsigned char set[32];
+    };
+
+    template<typename Delimiter>
+    class split_range;
+    class line_range;
+
     /* hy::string is a lightweight C-style string wrapper.
      * The contents held by hy::string is immutable.
      */
@@ -52,13 +117,13 @@ namespace hy {
 
         /* Remove leading spaces. */
         string& ltrim() {
-            while (_str < _end && isspace(*_str)) { ++_str; }
+            _str = simd::skip_space(_str, _end);
             return *this;
         }
 
         /* Remove trailing spaces. */
         string& rtrim() {
-            while (_end > _str && isspace(_end[-1])) { --_end; }
+            _end = simd::rskip_space(_str, _end);
             return *this;
         }
 
@@ -120,32 +185,23 @@ namespace hy {
          * If ch is not found in string, npos is returned.
          */
         size_t find(char ch) const {
-            for (auto p = _str; p != _end; ++p){
-                if (*p == ch){
-                    return p - _str;
-                }
-            }
-            return npos;
+            auto p = simd::find(_str, _end, ch);
+            return p == _end ? npos : p - _str;
         }
         
         /* Find the position of the last occurrence of ch in the string.
          * If ch is not found in string, npos is returned.
          */
         size_t rfind(char ch) const {
-            auto rend = _str - 1;
-            for (auto p = _end - 1; p != rend; --p){
-                if (*p == ch){
-                    return p - _str;
-                }
-            }
-            return npos;
+            auto p = simd::rfind(_str, _end, ch);
+            return p == _end ? npos : p - _str;
         }
 
         /* Search string for the first occurrence of str.
          * If str is not found in string, npos is returned.
          */
         size_t search(const string& str) const {
-            auto p = std::search(_str, _end, str._str, str._end);
+            auto p = simd::search(_str, _end, str._str, str._end);
             return p == _end ? npos : p - _str;
         }
 
@@ -159,17 +215,14 @@ namespace hy {
 
         /* Compare this string to str. */
         int compare(const char* str) const {
-            int diff = memcmp(_str, str, length());
-            return diff ? diff : -str[length()];
+            return compare(str, strlen(str));
         }
 
         /* Compare this string to str[0:count]. */
         int compare(const char* str, size_t count) const {
-            if (count > length()){
-                count = length();
-            }
-            int diff = memcmp(_str, str, count);
-            return diff ? diff : (int)_str[count] - str[count];
+            size_t n = count < length() ? count : length();
+            int diff = memcmp(_str, str, n);
+            return diff ? diff : length() < count ? -1 : length() > count ? 1 : 0;
         }
 
         /* Compare this string to str. */
@@ -178,10 +231,7 @@ namespace hy {
         }
 
         bool starts_with(const char* str) const {
-            const char* p = str;
-            const char* q = _str;
-            while (*p && *p == *q && ++p && ++q);
-            return 0 == *p;
+            return starts_with(string(str));
         }
 
         bool starts_with(const string& str) const {
@@ -209,6 +259,56 @@ namespace hy {
                 && 0 == memcmp(_str, str._str, length());
         }
 
+        /* Whether this string equals str but for the case of ASCII letters,
+         * as header names do.
+         */
+        bool equals_ignore_case(const char* str) const {
+            return equals_ignore_case(string(str));
+        }
+
+        bool equals_ignore_case(const string& str) const {
+            return length() == str.length()
+                && simd::equals_ignore_case(_str, str._str, length());
+        }
+
+        bool starts_with_ignore_case(const char* str) const {
+            return starts_with_ignore_case(string(str));
+        }
+
+        bool starts_with_ignore_case(const string& str) const {
+            return length() >= str.length()
+                && simd::equals_ignore_case(_str, str._str, str.length());
+        }
+
+        /* Whether the string is not empty and all decimal digits. */
+        bool is_digits() const {
+            return !empty() && simd::skip_digits(_str, _end) == _end;
+        }
+
+        /* Whether the string is a token of RFC 7230, like methods and
+         * header names: not empty, and all letters, digits or !#$%&'*+-.^_`|~
+         */
+        bool is_token() const {
+            return !empty() && simd::skip_token(_str, _end) == _end;
+        }
+
+        /* Position of the first control character (0x00-0x1f, 0x7f), which
+         * header values must not have but for tabs, or npos.
+         */
+        size_t find_control() const {
+            const char* p = simd::find_control(_str, _end);
+            return p == _end ? npos : p - _str;
+        }
+
+        /* Copy the whole string to `dst` with ASCII letters lowercased, and
+         * returns `dst`. Like copy(), `dst` must have room for the
+         * terminating null character too.
+         */
+        char* to_lower(char* dst) const {
+            *simd::to_lower(_str, _end, dst) = 0;
+            return dst;
+        }
+
         /* Copy the whole string to `dst` and returns `dst`.
          * This method assumes that size of `dst` is sufficient to store the 
          * whole string including the terminating null character.
@@ -239,40 +339,40 @@ namespace hy {
         }
 
         /* Splits the string into up to (`splits`+1) parts with `ch` as the separator.
-         * The split result will be appended to `parts`.
+         * The split result will be appended to `parts`, which may allocate
+         * from an arena (arena_strings).
          * Returns `parts`.
          */
-        strings& split(strings& parts, char ch, size_t splits = -1) const {
+        template<typename A>
+        std::vector<string, A>& split(std::vector<string, A>& parts, char ch, size_t splits = -1) const {
             auto a = _str, b = a;
-            while (b < _end){
-                if (*b == ch){
-                    parts.push_back(string(a, b));
-                    a = b + 1;
-                    if (--splits == 0){
-                        b = _end;
-                        break;
-                    }
+            while ((b = simd::find(a, _end, ch)) != _end){
+                parts.push_back(string(a, b));
+                a = b + 1;
+                if (--splits == 0){
+                    break;
                 }
-                ++b;
             }
 
-            if (a != b){
-                parts.push_back(string(a, b));
+            if (a != _end){
+                parts.push_back(string(a, _end));
             }
             return parts;
         }
 
         /* Splits the string into up to (`splits`+1) parts with `s` as the separator.
-         * The split result will be appended to `parts`.
+         * The split result will be appended to `parts`, which may allocate
+         * from an arena (arena_strings).
          * Returns `parts`.
          */
-        strings& split(strings& parts, const string& s, size_t splits = -1) const {
+        template<typename A>
+        std::vector<string, A>& split(std::vector<string, A>& parts, const string& s, size_t splits = -1) const {
             _check_separator(s);
 
             auto a = _str, b = a;
             const size_t step = s.length();
             while (b < _end){
-                b = std::search(a, _end, s._str, s._end);
+                b = simd::search(a, _end, s._str, s._end);
                 if (b != _end){
                     parts.push_back(string(a, b));
                     b += step;
@@ -289,6 +389,22 @@ namespace hy {
             return parts;
         }
 
+        /* Splits the string into up to (`splits`+1) parts with `ch` as the separator.
+         * The split result will be appended to `parts`, which only allocates
+         * beyond N parts.
+         * Returns `parts`.
+         */
+        template<size_t N>
+        small_vector<string, N>& split(small_vector<string, N>& parts, char ch, size_t splits = -1) const;
+
+        /* Splits the string into up to (`splits`+1) parts with `s` as the separator.
+         * The split result will be appended to `parts`, which only allocates
+         * beyond N parts.
+         * Returns `parts`.
+         */
+        template<size_t N>
+        small_vector<string, N>& split(small_vector<string, N>& parts, const string& s, size_t splits = -1) const;
+
         /* Splits the string into up to (`splits`+1) parts with `ch` as the separator. */
         strings split(char ch, size_t splits = -1) const {
             std::vector<string> parts;
@@ -301,6 +417,45 @@ namespace hy {
             return std::move(split(parts, s, splits));
         }
 
+        /* Splits the string into up to (`splits`+1) parts with `ch` as the
+         * separator, allocated from `a`: freed all at once by a.reset().
+         */
+        arena_strings split(arena& a, char ch, size_t splits = -1) const {
+            arena_strings parts(a);
+            return std::move(split(parts, ch, splits));
+        }
+
+        /* Splits the string into up to (`splits`+1) parts with `s` as the
+         * separator, allocated from `a`: freed all at once by a.reset().
+         */
+        arena_strings split(arena& a, const string& s, size_t splits = -1) const {
+            arena_strings parts(a);
+            return std::move(split(parts, s, splits));
+        }
+
+        /* Splits the string lazily into up to (`splits`+1) parts with `ch` as
+         * the separator: iterating the returned range yields the parts of
+         * split(ch, splits) one at a time, without allocating. The parts
+         * refer to this string's characters.
+         */
+        split_range<char_delimiter> split_view(char ch, size_t splits = -1) const;
+
+        /* Splits the string lazily into up to (`splits`+1) parts with `s` as
+         * the separator, like split(s, splits). `s` must outlive the range.
+         */
+        split_range<string_delimiter> split_view(const string& s, size_t splits = -1) const;
+
+        /* Splits the string lazily into up to (`splits`+1) parts at any of
+         * the characters in `chars`.
+         */
+        split_range<any_delimiter> split_view_any(const string& chars, size_t splits = -1) const;
+
+        /* The lines of the string, split at '\n' like split_view('\n') but
+         * scanning 64 bytes at a time, which pays off on many short lines,
+         * e.g. a log file. A line keeps a '\r' before its '\n'.
+         */
+        line_range lines() const;
+
         /* Splits the string into N (requires N > 0) parts with `ch` as the separator.
          * The split result will be assigned to `parts`.
          * Returns `parts`.
@@ -309,18 +464,19 @@ namespace hy {
         std::array<string, N>& split_n(char ch, std::array<string, N>& parts) const {
             auto a = _str, b = a;
             size_t n = 0;
-            for (; b < _end; ++b){
-                if (*b == ch){
-                    if (N == ++n){
-                        b = _end;
-                    }
-                    parts[n-1]._assign(a, b);
-                    a = b + 1;
+            while ((b = simd::find(a, _end, ch)) != _end){
+                if (N == ++n){
+                    /* the last part takes the rest */
+                    parts[n-1]._assign(a, _end);
+                    a = _end;
+                    break;
                 }
+                parts[n-1]._assign(a, b);
+                a = b + 1;
             }
 
-            if (a != b){
-                parts[n]._assign(a, b);
+            if (a != _end){
+                parts[n]._assign(a, _end);
                 ++n;
             }
             for (; n < N; ++n){
@@ -341,7 +497,7 @@ namespace hy {
             size_t n = 0;
             const size_t step = s.length();
             while (b < _end){
-                b = std::search(a, _end, s._str, s._end);
+                b = simd::search(a, _end, s._str, s._end);
                 if (b != _end){
                     if (N == ++n){
                         b = _end;
@@ -380,10 +536,7 @@ namespace hy {
          * Returns `kv`.
          */
         keyval& split_kv(char ch, keyval& kv) const {
-            auto p = _str;
-            while (p < _end && *p != ch){
-                ++p;
-            }
+            auto p = simd::find(_str, _end, ch);
             kv.first._assign_checked(_str, p);
             kv.second._assign_checked(p + 1, _end);
             return kv;
@@ -395,7 +548,7 @@ namespace hy {
         keyval& split_kv(const string& s, keyval& kv) const {
             _check_separator(s);
 
-            auto p = std::search(_str, _end, s._str, s._end);
+            auto p = simd::search(_str, _end, s._str, s._end);
             kv.first._assign_checked(_str, p);
             kv.second._assign_checked(p + s.length(), _end);
             return kv;
@@ -413,40 +566,60 @@ namespace hy {
             return split_kv(s, kv);
         }
 
-        /* Gets the integer value represented by the string. */
+        /* Gets the integer value represented by the string: as atoi(), the
+         * leading number after any white space, 0 if there is none, and
+         * clamped to the range of int.
+         */
         int to_int() const {
-            if (*_end < '0' || *_end > '9'){
-                return atoi(_str);
-            }
-
-            char d[36];
-            d[34] = d[35] = '\0';
-            size_t len = length() > 34 ? 34 : length();
-            return atoi(ncopy(d, len));
+            return _to_number<int>();
         }
 
-        /* Gets the double value represented by the string. */
+        /* Gets the double value represented by the string: the leading
+         * decimal number after any white space, inf or nan, 0 if there is
+         * none. Unlike atof(), hexadecimal numbers are not read: "0x10"
+         * gives 0.
+         */
         double to_double() const {
-            if (*_end < '0' || *_end > '9'){
-                return atof(_str);
-            }
-
-            char d[36];
-            d[34] = d[35] = '\0';
-            size_t len = length() > 34 ? 34 : length();
-            return atof(ncopy(d, len));
+            return _to_number<double>();
         }
 
-        /* Gets the long long value represented by the string. */
+        /* Gets the long long value represented by the string, as atoll(). */
         long long to_longlong() const {
-            if (*_end < '0' || *_end > '9'){
-                return atoll(_str);
+            return _to_number<long long>();
+        }
+
+        /* Parses the whole string as a number of type T, an integer type
+         * or float or double, with hy::from_chars (no white space, no '+').
+         * Returns conv_errc::none and sets `value` on success.
+         */
+        template<typename T>
+        conv_errc parse(T& value) const {
+            T v;
+            from_chars_result r = from_chars(_str, _end, v);
+            if (r.ec == conv_errc::none && r.ptr != _end){
+                return conv_errc::invalid;
+            }
+            if (r.ec == conv_errc::none){
+                value = v;
             }
+            return r.ec;
+        }
 
-            char d[36];
-            d[34] = d[35] = '\0';
-            size_t len = length() > 34 ? 34 : length();
-            return atoll(ncopy(d, len));
+        /* Parses the whole string as a number of type T. Throws
+         * std::invalid_argument if it is not one, and std::out_of_range
+         * if T cannot hold it.
+         */
+        template<typename T>
+        T parse() const {
+            T value = T();
+            switch (parse(value)){
+            case conv_errc::invalid:
+                throw std::invalid_argument("hy::string::parse() not a number");
+            case conv_errc::out_of_range:
+                throw std::out_of_range("hy::string::parse() out of range");
+            default:
+                return value;
+            }
         }
 
         /* Random access without checking. */
@@ -458,6 +631,23 @@ namespace hy {
         }
 
     private:        
+        template<typename T>
+        T _to_number() const {
+            const char* p = _str;
+            for (; p != _end && (*p == ' ' || (*p >= '\t' && *p <= '\r')); ++p);
+            if (p != _end && *p == '+'){
+                /* a sign after the '+' is not a number: "+-5" is 0 */
+                if (++p != _end && *p == '-'){
+                    return T();
+                }
+            }
+            T value = T();
+            if (from_chars(p, _end, value).ec == conv_errc::out_of_range && std::is_integral<T>::value){
+                value = *p == '-' ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max();
+            }
+            return value;
+        }
+
         pointer _offset(int n) const {
             if (n >= 0){
                 return _str + n < _end ? _str + n : _end;
@@ -491,6 +681,226 @@ namespace hy {
         pointer _end;
     };
 
+    /* The parts of a string split at a Delimiter, found one at a time as the
+     * range is iterated. See string::split_view.
+     */
+    template<typename Delimiter>
+    class split_range {
+    public:
+        class iterator {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef string value_type;
+            typedef ptrdiff_t difference_type;
+            typedef const string* pointer;
+            typedef const string& reference;
+
+            /* The end of any range. */
+            iterator()
+                : _next(nullptr), _end(nullptr), _splits(0),
+                  _rest(false), _done(true){}
+
+            iterator(const Delimiter& d, const char* b, const char* e, size_t splits)
+                : _delim(d), _next(b), _end(e), _splits(splits), _rest(false), _done(false){
+                advance();
+            }
+
+            const string& operator*() const { return _part; }
+            const string* operator->() const { return &_part; }
+
+            iterator& operator++(){
+                advance();
+                return *this;
+            }
+
+            iterator operator++(int){
+                iterator it(*this);
+                advance();
+                return it;
+            }
+
+            bool operator==(const iterator& it) const {
+                if (_done || it._done){
+                    return _done == it._done;
+                }
+                return _part.begin() == it._part.begin() && _next == it._next;
+            }
+
+            bool operator!=(const iterator& it) const { return !(*this == it); }
+
+        private:
+            /* Same rules as string::split: a trailing empty part is dropped,
+             * and once `splits` separators are found the rest is one part.
+             */
+            void advance(){
+                if (!_next){
+                    _done = true;
+                    return;
+                }
+                const char* a = _next;
+                const char* b = _rest ? _end : _delim.find(a, _end);
+                if (b == _end){
+                    _next = nullptr;
+                    if (a == _end){
+                        _done = true;
+                        return;
+                    }
+                    _part = string(a, _end);
+                    return;
+                }
+                _part = string(a, b);
+                _next = b + _delim.length();
+                _rest = --_splits == 0;
+            }
+
+            Delimiter _delim;
+            string _part;
+            /* start of the next part, nullptr after the last one */
+            const char* _next;
+            const char* _end;
+            size_t _splits;
+            bool _rest;
+            bool _done;
+        };
+
+        typedef iterator const_iterator;
+
+        split_range(const Delimiter& d, const string& s, size_t splits)
+            : _delim(d), _str(s), _splits(splits){}
+
+        iterator begin() const { return iterator(_delim, _str.begin(), _str.end(), _splits); }
+        iterator end() const { return iterator(); }
+
+        /* Whether there are no parts at all. */
+        bool empty() const { return begin() == end(); }
+
+    private:
+        Delimiter _delim;
+        string _str;
+        size_t _splits;
+    };
+
+    /* The lines of a string, found as the range is iterated. See
+     * string::lines.
+     */
+    class line_range {
+    public:
+        class iterator {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef string value_type;
+            typedef ptrdiff_t difference_type;
+            typedef const string* pointer;
+            typedef const string& reference;
+
+            /* The end of any range. */
+            iterator()
+                : _next(nullptr), _end(nullptr), _block(nullptr), _mask(0){}
+
+            iterator(const char* b, const char* e)
+                : _next(b), _end(e), _block(b), _mask(b != e ? simd::match64(b, e, '\n') : 0){
+                advance();
+            }
+
+            const string& operator*() const { return _line; }
+            const string* operator->() const { return &_line; }
+
+            iterator& operator++(){
+                advance();
+                return *this;
+            }
+
+            iterator operator++(int){
+                iterator it(*this);
+                advance();
+                return it;
+            }
+
+            bool operator==(const iterator& it) const {
+                return _next == it._next && (!_next || _line.begin() == it._line.begin());
+            }
+
+            bool operator!=(const iterator& it) const { return !(*this == it); }
+
+        private:
+            /* As split_view('\n'): a trailing empty line is dropped. */
+            void advance(){
+                if (_next == _end){
+                    _next = nullptr;
+                    return;
+                }
+                while (!_mask){
+                    if (_end - _block <= 64){
+                        _line = string(_next, _end);
+                        _next = _end;
+                        return;
+                    }
+                    _block += 64;
+                    _mask = simd::match64(_block, _end, '\n');
+                }
+                const char* nl = _block + simd::_lowest_bit64(_mask);
+                _mask &= _mask - 1;
+                _line = string(_next, nl);
+                _next = nl + 1;
+            }
+
+            string _line;
+            /* start of the next line, nullptr past the last one */
+            const char* _next;
+            const char* _end;
+            /* the newlines not yet reached in the 64 bytes at _block */
+            const char* _block;
+            unsigned long long _mask;
+        };
+
+        typedef iterator const_iterator;
+
+        explicit line_range(const string& s) : _str(s){}
+
+        iterator begin() const { return iterator(_str.begin(), _str.end()); }
+        iterator end() const { return iterator(); }
+
+        /* Whether there are no lines at all. */
+        bool empty() const { return _str.empty(); }
+
+    private:
+        string _str;
+    };
+
+    inline line_range string::lines() const {
+        return line_range(*this);
+    }
+
+    inline split_range<char_delimiter> string::split_view(char ch, size_t splits) const {
+        return split_range<char_delimiter>(char_delimiter(ch), *this, splits);
+    }
+
+    inline split_range<string_delimiter> string::split_view(const string& s, size_t splits) const {
+        _check_separator(s);
+        return split_range<string_delimiter>(string_delimiter(s.begin(), s.end()), *this, splits);
+    }
+
+    inline split_range<any_delimiter> string::split_view_any(const string& chars, size_t splits) const {
+        _check_separator(chars);
+        return split_range<any_delimiter>(any_delimiter(chars.begin(), chars.end()), *this, splits);
+    }
+
+    template<size_t N>
+    inline small_vector<string, N>& string::split(small_vector<string, N>& parts, char ch, size_t splits) const {
+        for (auto& part : split_view(ch, splits)){
+            parts.push_back(part);
+        }
+        return parts;
+    }
+
+    template<size_t N>
+    inline small_vector<string, N>& string::split(small_vector<string, N>& parts, const string& s, size_t splits) const {
+        for (auto& part : split_view(s, splits)){
+            parts.push_back(part);
+        }
+        return parts;
+    }
+
     inline bool operator== (const string& left, const string& right){
         return left.equals(right);
     }
@@ -532,4 +942,40 @@ namespace hy {
         out.write(str.buffer(), str.length());
         return out;
     }
+
+    /* Lets format_to() print strings. */
+    template<typename A>
+    inline void format_append(char_string<A>& out, const string& str){
+        out.append(str.buffer(), str.length());
+    }
+
+    /* Hash and equality of strings by their characters, whatever holds
+     * them: a table keyed by std::string can be searched with a string or
+     * a const char* without building a std::string. See flat_map.
+     */
+    struct string_hash {
+        size_t operator()(const string& s) const { return (size_t)hash_bytes(s.buffer(), s.length()); }
+        size_t operator()(const std::string& s) const { return (size_t)hash_bytes(s.data(), s.size()); }
+        size_t operator()(const char* s) const { return (size_t)hash_bytes(s, strlen(s)); }
+    };
+
+    struct string_equal {
+        template<typename A, typename B>
+        bool operator()(const A& a, const B& b) const {
+            return view(a).equals(view(b));
+        }
+
+        static string view(const string& s) { return s; }
+        static string view(const std::string& s) { return string(s.data(), s.size()); }
+        static string view(const char* s) { return string(s); }
+    };
+}
+
+namespace std {
+    template<>
+    struct hash<hy::string> {
+        size_t operator()(const hy::string& s) const {
+            return (size_t)hy::hash_bytes(s.buffer(), s.length());
+        }
+    };
 }
@@ -0,0 +1,465 @@
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <utility>
+
+#ifdef WIN32
+/* no winsock.h to clash with hydrogen/nio's WinSock2.h, no min/max macros */
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace hy {
+    /* work_stealing_deque is a Chase-Lev deque of pointers.
+     *
+     * The owning thread push()es and pop()s at the bottom, in LIFO order;
+     * any other thread may steal() from the top, in FIFO order. Only the
+     * last element is contended, so the owner runs without atomic
+     * read-modify-writes most of the time.
+     *
+     * The ring grows when full. Replaced rings are kept until the deque is
+     * destroyed, as a thief may still be reading from one.
+     */
+    template<typename T>
+    class work_stealing_deque {
+    public:
+        explicit work_stealing_deque(size_t capacity = 256)
+            : _top(0), _bottom(0){
+            size_t n = 2;
+            while (n < capacity){
+                n <<= 1;
+            }
+            _ring.store(new ring(n), std::memory_order_relaxed);
+        }
+
+        ~work_stealing_deque(){
+            delete _ring.load(std::memory_order_relaxed);
+            for (auto r : _retired){
+                delete r;
+            }
+        }
+
+        work_stealing_deque(const work_stealing_deque&) = delete;
+        work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+        /* Owner only. */
+        void push(T* item){
+            int64_t b = _bottom.load(std::memory_order_relaxed);
+            int64_t t = _top.load(std::memory_order_acquire);
+            ring* r = _ring.load(std::memory_order_relaxed);
+            if (b - t >= (int64_t)r->size()){
+                r = grow(r, t, b);
+            }
+            r->put(b, item);
+            std::atomic_thread_fence(std::memory_order_release);
+            _bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        /* Owner only. Takes the most recently pushed item, nullptr if empty. */
+        T* pop(){
+            int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+            ring* r = _ring.load(std::memory_order_relaxed);
+            _bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = _top.load(std::memory_order_relaxed);
+
+            if (t > b){
+                _bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            T* item = r->get(b);
+            if (t == b){
+                /* the last item: race the thieves for it */
+                if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                  std::memory_order_relaxed)){
+                    item = nullptr;
+                }
+                _bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        /* Any thread. Takes the oldest item; nullptr if the deque is empty
+         * or another thread won the race for it.
+         */
+        T* steal(){
+            int64_t t = _top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = _bottom.load(std::memory_order_acquire);
+            if (t >= b){
+                return nullptr;
+            }
+            ring* r = _ring.load(std::memory_order_acquire);
+            T* item = r->get(t);
+            if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)){
+                return nullptr;
+            }
+            return item;
+        }
+
+        /* A snapshot: exact for the owner, a hint for other threads. */
+        size_t size() const {
+            int64_t b = _bottom.load(std::memory_order_relaxed);
+            int64_t t = _top.load(std::memory_order_relaxed);
+            return b > t ? (size_t)(b - t) : 0;
+        }
+
+        bool empty() const { return size() == 0; }
+
+    private:
+        class ring {
+        public:
+            explicit ring(size_t n) : _mask(n - 1), _items(new std::atomic<T*>[n]){}
+            ~ring(){ delete[] _items; }
+
+            size_t size() const { return _mask + 1; }
+
+            /* release/acquire on the slot itself publishes what the item
+             * points to (free on x86, and visible to race detectors)
+             */
+            T* get(int64_t i) const {
+                return _items[i & _mask].load(std::memory_order_acquire);
+            }
+            void put(int64_t i, T* item){
+                _items[i & _mask].store(item, std::memory_order_release);
+            }
+
+        private:
+            size_t _mask;
+            std::atomic<T*>* _items;
+        };
+
+        ring* grow(ring* r, int64_t t, int64_t b){
+            ring* bigger = new ring(r->size() * 2);
+            for (int64_t i = t; i < b; ++i){
+                bigger->put(i, r->get(i));
+            }
+            _retired.push_back(r);
+            _ring.store(bigger, std::memory_order_release);
+            return bigger;
+        }
+
+        /* thieves and the owner write different ends: keep them apart */
+        std::atomic<int64_t> _top;
+        char _pad[64 - sizeof(std::atomic<int64_t>)];
+        std::atomic<int64_t> _bottom;
+        std::atomic<ring*> _ring;
+        std::vector<ring*> _retired;
+    };
+
+    /* thread_pool is a work-stealing executor.
+     *
+     * Each worker owns a work_stealing_deque. Tasks submitted from a worker
+     * go to its own deque and run in LIFO order, which keeps a task tree on
+     * one core while it fits; tasks submitted from other threads go to a
+     * shared injection queue. A worker out of tasks tries the injection
+     * queue, then steals from the other workers, and parks on a condition
+     * variable once it has found nothing for a while. Submitters only touch
+     * the condition variable when some worker is parked.
+     *
+     * Tasks may block, e.g. serve a socket_stream to the end, but a blocked
+     * task holds its worker: size the pool for the number of concurrently
+     * blocked handlers. As the compute pool of a reactor, submit the work
+     * from the loop and hand results back with reactor::post().
+     *
+     * A task that throws does not stop its worker: the first exception
+     * thrown since the last wait_idle() is kept and rethrown by the next
+     * one, the others are dropped. The destructor runs the tasks already
+     * submitted, then joins, dropping any exception kept.
+     */
+    class thread_pool {
+    public:
+        typedef std::function<void()> task;
+
+        /* `threads` 0 means one per hardware thread. With `pin`, worker i
+         * runs on CPU i modulo the CPU count (Linux and Windows).
+         */
+        explicit thread_pool(size_t threads = 0, bool pin = false)
+            : _pending(0), _sleeping(0), _stopping(false), _wakes(0){
+            if (threads == 0){
+                threads = std::thread::hardware_concurrency();
+                if (threads == 0){
+                    threads = 1;
+                }
+            }
+            for (size_t i = 0; i < threads; ++i){
+                _workers.push_back(new worker);
+            }
+            for (size_t i = 0; i < threads; ++i){
+                _workers[i]->thread = std::thread(&thread_pool::run, this, i);
+                if (pin){
+                    pin_thread(_workers[i]->thread, i);
+                }
+            }
+        }
+
+        ~thread_pool(){
+            {
+                std::lock_guard<std::mutex> lock(_park_lock);
+                _stopping = true;
+                ++_wakes;
+            }
+            _park_cv.notify_all();
+            for (auto w : _workers){
+                w->thread.join();
+            }
+            for (auto w : _workers){
+                delete w;
+            }
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        /* Queues `t` to run on a worker. Thread-safe. */
+        void submit(task t){
+            task* p = new task(std::move(t));
+            _pending.fetch_add(1, std::memory_order_relaxed);
+
+            worker* self = current();
+            if (self && self->pool == this){
+                self->tasks.push(p);
+            }
+            else {
+                std::lock_guard<std::mutex> lock(_inject_lock);
+                _injected.push_back(p);
+            }
+
+            /* pairs with the fence in park(): either we see the sleeper or
+             * it sees the task
+             */
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_sleeping.load(std::memory_order_relaxed)){
+                {
+                    std::lock_guard<std::mutex> lock(_park_lock);
+                    ++_wakes;
+                }
+                _park_cv.notify_one();
+            }
+        }
+
+        /* Blocks until every submitted task, including the ones they
+         * submit, has run, then rethrows the first exception a task threw
+         * since the last call, if any. Must not be called from a worker.
+         */
+        void wait_idle(){
+            std::unique_lock<std::mutex> lock(_idle_lock);
+            _idle_cv.wait(lock, [this]{
+                return _pending.load(std::memory_order_acquire) == 0;
+            });
+            if (_error){
+                std::exception_ptr e;
+                std::swap(e, _error);
+                lock.unlock();
+                std::rethrow_exception(e);
+            }
+        }
+
+        size_t size() const { return _workers.size(); }
+
+        /* Submitted tasks that haven't finished yet. */
+        size_t pending() const { return _pending.load(std::memory_order_relaxed); }
+
+        /* Index of the calling worker in its pool, -1 off the pool threads. */
+        static int current_worker(){
+            worker* w = current();
+            return w ? (int)w->index : -1;
+        }
+
+    private:
+        /* failed rounds over all queues before a worker parks */
+        static const int spin_rounds = 64;
+
+        struct worker {
+            worker() : pool(nullptr), index(0), seed(0){}
+
+            work_stealing_deque<task> tasks;
+            std::thread thread;
+            thread_pool* pool;
+            size_t index;
+            uint32_t seed;
+        };
+
+        static worker*& current(){
+#if defined(_MSC_VER) && _MSC_VER < 1900
+            /* VS2013 has no thread_local */
+            static __declspec(thread) worker* w = nullptr;
+#else
+            static thread_local worker* w = nullptr;
+#endif
+            return w;
+        }
+
+        void run(size_t index){
+            worker* self = _workers[index];
+            self->pool = this;
+            self->index = index;
+            self->seed = (uint32_t)index * 2654435761u + 1;
+            current() = self;
+
+            int idle = 0;
+            for (;;){
+                task* t = find(self);
+                if (t){
+                    idle = 0;
+                    execute(t);
+                    continue;
+                }
+                if (++idle < spin_rounds){
+                    std::this_thread::yield();
+                    continue;
+                }
+                idle = 0;
+                if (!park()){
+                    break;
+                }
+            }
+            current() = nullptr;
+        }
+
+        task* find(worker* self){
+            task* t = self->tasks.pop();
+            if (t){
+                return t;
+            }
+            t = take_injected();
+            if (t){
+                return t;
+            }
+
+            /* start at a random victim so thieves spread out */
+            size_t n = _workers.size();
+            self->seed ^= self->seed << 13;
+            self->seed ^= self->seed >> 17;
+            self->seed ^= self->seed << 5;
+            size_t start = self->seed % n;
+            for (size_t i = 0; i < n; ++i){
+                worker* victim = _workers[(start + i) % n];
+                if (victim != self){
+                    t = victim->tasks.steal();
+                    if (t){
+                        return t;
+                    }
+                }
+            }
+            return nullptr;
+        }
+
+        task* take_injected(){
+            std::lock_guard<std::mutex> lock(_inject_lock);
+            if (_injected.empty()){
+                return nullptr;
+            }
+            task* t = _injected.front();
+            _injected.pop_front();
+            return t;
+        }
+
+        bool has_work(){
+            {
+                std::lock_guard<std::mutex> lock(_inject_lock);
+                if (!_injected.empty()){
+                    return true;
+                }
+            }
+            for (auto w : _workers){
+                if (!w->tasks.empty()){
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /* Sleeps until a task is submitted. Returns false when the pool
+         * stops and no work is left.
+         */
+        bool park(){
+            std::unique_lock<std::mutex> lock(_park_lock);
+            uint64_t wakes = _wakes;
+            _sleeping.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            lock.unlock();
+
+            bool work = has_work();
+            lock.lock();
+            if (!work){
+                if (_stopping){
+                    _sleeping.fetch_sub(1, std::memory_order_relaxed);
+                    return false;
+                }
+                _park_cv.wait(lock, [&]{ return _wakes != wakes; });
+            }
+            _sleeping.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        void execute(task* t){
+            try {
+                (*t)();
+            }
+            catch (...){
+                std::lock_guard<std::mutex> lock(_idle_lock);
+                if (!_error){
+                    _error = std::current_exception();
+                }
+            }
+            delete t;
+            if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1){
+                std::lock_guard<std::mutex> lock(_idle_lock);
+                _idle_cv.notify_all();
+            }
+        }
+
+        static void pin_thread(std::thread& t, size_t index){
+            size_t cpus = std::thread::hardware_concurrency();
+            if (cpus == 0){
+                return;
+            }
+#ifdef WIN32
+            ::SetThreadAffinityMask(t.native_handle(), (DWORD_PTR)1 << (index % cpus));
+#elif defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(index % cpus, &set);
+            ::pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+#else
+            (void)t;
+            (void)index;
+#endif
+        }
+
+        std::vector<worker*> _workers;
+        std::atomic<size_t> _pending;
+
+        std::mutex _inject_lock;
+        std::deque<task*> _injected;
+
+        std::mutex _park_lock;
+        std::condition_variable _park_cv;
+        std::atomic<int> _sleeping;
+        bool _stopping;
+        /* bumped under _park_lock by every wake-up */
+        uint64_t _wakes;
+
+        std::mutex _idle_lock;
+        std::condition_variable _idle_cv;
+        /* first exception thrown by a task, under _idle_lock */
+        std::exception_ptr _error;
+    };
+}
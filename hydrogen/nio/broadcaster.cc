@@ -0,0 +1,45 @@
+#include <algorithm>
+#include <hydrogen/nio/broadcaster.h>
+
+using namespace hy;
+
+broadcaster::broadcaster() : _published(0), _delivered(0), _dropped(0){}
+
+void broadcaster::subscribe(connection* c){
+    if (std::find(_subscribers.begin(), _subscribers.end(), c) == _subscribers.end()){
+        _subscribers.push_back(c);
+    }
+}
+
+void broadcaster::unsubscribe(connection* c){
+    auto it = std::find(_subscribers.begin(), _subscribers.end(), c);
+    if (it != _subscribers.end()){
+        *it = _subscribers.back();
+        _subscribers.pop_back();
+    }
+}
+
+size_t broadcaster::publish(const shared_buffer& b){
+    ++_published;
+    size_t accepted = 0;
+    size_t i = 0;
+    while (i < _subscribers.size()){
+        connection* c = _subscribers[i];
+        if (!c->is_open()){
+            unsubscribe(c);
+            continue;
+        }
+        if (c->send(b)){
+            ++accepted;
+        }
+        else {
+            ++_dropped;
+        }
+        /* a close handler run by send() may have unsubscribed c */
+        if (i < _subscribers.size() && _subscribers[i] == c){
+            ++i;
+        }
+    }
+    _delivered += accepted;
+    return accepted;
+}
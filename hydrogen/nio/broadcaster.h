@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+
+#include <hydrogen/common/shared_buffer.h>
+#include <hydrogen/nio/connection.h>
+
+namespace hy {
+    /*
+     * broadcaster fans a message out to a set of subscribed connections.
+     *
+     * A message is encoded once into a shared_buffer and publish() queues a
+     * reference to it on every subscriber, so the bytes are shared by all the
+     * outbound queues and freed after the last subscriber has written them.
+     * Each subscriber applies its own backpressure: a slow one drops messages
+     * or is disconnected according to its overflow policy, without holding
+     * up the others.
+     *
+     * The broadcaster doesn't own its subscribers. Closed connections are
+     * forgotten on the next publish(). A connection must be unsubscribed
+     * before it is destroyed; its close handler may do that, even while
+     * publish() is running.
+     */
+    class broadcaster {
+    public:
+        broadcaster();
+
+        broadcaster(const broadcaster&) = delete;
+        broadcaster& operator=(const broadcaster&) = delete;
+
+        void subscribe(connection* c);
+        void unsubscribe(connection* c);
+
+        size_t subscribers() const { return _subscribers.size(); }
+
+        /* Queues `b` on every open subscriber and returns the number of
+         * subscribers that accepted it.
+         */
+        size_t publish(const shared_buffer& b);
+
+        /* Totals over the life of the broadcaster: messages published, and
+         * messages accepted and refused by subscribers.
+         */
+        size_t published() const { return _published; }
+        size_t delivered() const { return _delivered; }
+        size_t dropped() const { return _dropped; }
+
+    private:
+        std::vector<connection*> _subscribers;
+        size_t _published;
+        size_t _delivered;
+        size_t _dropped;
+    };
+}
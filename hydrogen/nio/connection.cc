@@ -0,0 +1,241 @@
+#include <hydrogen/nio/connection.h>
+
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
+
+using namespace hy;
+
+/* Flushes the queue until it is empty or the socket fails. */
+class connection::flush_op : public reactor_op {
+public:
+    flush_op(reactor& r, connection* c) : _reactor(r), _conn(c){}
+
+    /* The connection is gone (closed): complete without calling back. */
+    void detach(){ _conn = nullptr; }
+
+    bool perform() override {
+        while (_conn && _conn->_count){
+            auto n = _conn->gather_write();
+            if (n){
+                if (_conn->_paused && _conn->_queued <= _conn->_low){
+                    /* let on_flushed() resume the producers */
+                    return true;
+                }
+                continue;
+            }
+            if (n.error() == socket_error::interrupted){
+                continue;
+            }
+            if (socket_error::transient(n.error())){
+                return false;
+            }
+            _error = n.error();
+            return true;
+        }
+        return true;
+    }
+
+    void complete() override {
+        connection* conn = _conn;
+        int error = _error;
+        _reactor.free_op(this);
+        if (conn){
+            conn->on_flushed(error);
+        }
+    }
+
+private:
+    reactor& _reactor;
+    connection* _conn;
+};
+
+std::atomic<size_t> connection::_total_queued(0);
+
+connection::connection(reactor& r, stream_socket&& s, size_t max_queued, overflow_policy policy)
+    : _reactor(r), _socket(std::move(s)), _max_queued(max_queued), _policy(policy),
+      _queue(16), _head(0), _count(0), _offset(0), _queued(0),
+      _high(default_high_watermark), _low(default_low_watermark), _paused(false),
+      _sent(0), _dropped(0), _flushing(nullptr){}
+
+connection::~connection(){
+    _on_close = nullptr;
+    close();
+}
+
+bool connection::send(const shared_buffer& b){
+    if (!is_open()){
+        return false;
+    }
+
+    /* an empty queue always takes the message, however large */
+    if (_count && _queued + b.size() > _max_queued){
+        switch (_policy){
+        case drop_newest:
+            ++_dropped;
+            return false;
+
+        case drop_oldest: {
+            /* a partly written front message has to go out whole */
+            size_t first = _offset ? 1 : 0;
+            while (_count > first && _queued + b.size() > _max_queued){
+                unqueue(at(first).size());
+                if (first){
+                    /* move the front over the victim, then pop the front */
+                    at(1) = std::move(at(0));
+                }
+                pop();
+                ++_dropped;
+            }
+            break;
+        }
+
+        case disconnect:
+            ++_dropped;
+            close(socket_error::no_buffer_space);
+            return false;
+        }
+    }
+
+    push(b);
+    if (!_flushing){
+        start_flush();
+    }
+    if (!_paused && _queued >= _high && is_open()){
+        _paused = true;
+        if (_on_pause){
+            _on_pause();
+        }
+    }
+    return true;
+}
+
+void connection::set_watermarks(size_t high, size_t low){
+    _high = high;
+    _low = low < high ? low : high;
+}
+
+void connection::close(int error){
+    if (!is_open()){
+        return;
+    }
+
+    if (_flushing){
+        _flushing->detach();
+        _flushing = nullptr;
+    }
+    _reactor.remove(_socket.native_handle());
+    _socket.close();
+
+    while (_count){
+        pop();
+    }
+    _offset = 0;
+    unqueue(_queued);
+    _paused = false;
+
+    /* the handler may destroy this connection: don't touch it afterwards */
+    std::function<void(int)> handler(std::move(_on_close));
+    _on_close = nullptr;
+    if (handler){
+        handler(error);
+    }
+}
+
+void connection::push(const shared_buffer& b){
+    if (_count == _queue.size()){
+        /* grow the ring, moving the messages to the front */
+        std::vector<shared_buffer> q(_queue.size() * 2);
+        for (size_t i = 0; i < _count; ++i){
+            q[i] = std::move(at(i));
+        }
+        _queue.swap(q);
+        _head = 0;
+    }
+    at(_count++) = b;
+    _queued += b.size();
+    _total_queued.fetch_add(b.size(), std::memory_order_relaxed);
+}
+
+void connection::pop(){
+    at(0).release();
+    _head = (_head + 1) & (_queue.size() - 1);
+    --_count;
+}
+
+void connection::unqueue(size_t n){
+    _queued -= n;
+    _total_queued.fetch_sub(n, std::memory_order_relaxed);
+}
+
+void connection::start_flush(){
+    _flushing = _reactor.make_op<flush_op>(_reactor, this);
+    _reactor.start(_socket.native_handle(), reactor::write_queue, _flushing);
+}
+
+void connection::on_flushed(int error){
+    _flushing = nullptr;
+    if (error){
+        close(error);
+        return;
+    }
+    if (_paused && _queued <= _low){
+        _paused = false;
+        if (_on_resume){
+            _on_resume();
+        }
+    }
+    if (is_open() && _count && !_flushing){
+        /* queued after the last write, or still above the low watermark */
+        start_flush();
+    }
+}
+
+io_result<size_t> connection::gather_write(){
+    static const size_t max_buffers = 64;
+    size_t count = _count < max_buffers ? _count : max_buffers;
+
+#ifdef WIN32
+    WSABUF bufs[max_buffers];
+    for (size_t i = 0; i < count; ++i){
+        size_t skip = i ? 0 : _offset;
+        bufs[i].buf = const_cast<char*>(at(i).data()) + skip;
+        bufs[i].len = (ULONG)(at(i).size() - skip);
+    }
+    DWORD sent = 0;
+    if (::WSASend(_socket.native_handle(), bufs, (DWORD)count, &sent, 0, nullptr, nullptr) != 0){
+        return io_result<size_t>::failure(socket_error::last());
+    }
+    size_t n = sent;
+#else
+    iovec bufs[max_buffers];
+    for (size_t i = 0; i < count; ++i){
+        size_t skip = i ? 0 : _offset;
+        bufs[i].iov_base = const_cast<char*>(at(i).data()) + skip;
+        bufs[i].iov_len = at(i).size() - skip;
+    }
+    msghdr msg = msghdr();
+    msg.msg_iov = bufs;
+    msg.msg_iovlen = count;
+    int flags = 0;
+#ifdef MSG_NOSIGNAL
+    flags |= MSG_NOSIGNAL;
+#endif
+    ssize_t wr = ::sendmsg(_socket.native_handle(), &msg, flags);
+    if (wr < 0){
+        return io_result<size_t>::failure(socket_error::last());
+    }
+    size_t n = (size_t)wr;
+#endif
+
+    _sent += n;
+    unqueue(n);
+    size_t left = n;
+    while (_count && left >= at(0).size() - _offset){
+        left -= at(0).size() - _offset;
+        _offset = 0;
+        pop();
+    }
+    _offset += left;
+    return n;
+}
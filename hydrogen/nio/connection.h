@@ -0,0 +1,150 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <functional>
+
+#include <hydrogen/common/shared_buffer.h>
+#include <hydrogen/nio/stream_socket.h>
+#include <hydrogen/nio/reactor.h>
+
+namespace hy {
+    /*
+     * connection owns a stream_socket on a reactor and an outbound queue of
+     * shared_buffers.
+     *
+     * send() queues a reference to the buffer, never its bytes, and the queue
+     * is flushed in the background with one gathering write (writev) per
+     * wake-up. The sender is never blocked by a slow peer: once more than
+     * `max_queued` bytes are waiting, the overflow policy decides what happens
+     * to further messages.
+     *
+     * Producers that can slow down should rather watch the watermarks: when
+     * the queue reaches the high watermark the pause handler runs, and once
+     * it has drained to the low watermark the resume handler runs. A proxy,
+     * for instance, stops reading the inbound side while paused, which leaves
+     * the slow peer's backpressure to TCP instead of to this process' memory.
+     */
+    class connection {
+    public:
+        enum overflow_policy {
+            /* refuse the new message */
+            drop_newest,
+            /* discard the oldest messages that haven't started to go out */
+            drop_oldest,
+            /* close the connection */
+            disconnect
+        };
+
+        static const size_t default_high_watermark = 64 << 10;
+        static const size_t default_low_watermark = 16 << 10;
+
+        connection(reactor& r, stream_socket&& s, size_t max_queued = 1 << 20,
+                   overflow_policy policy = disconnect);
+
+        /* Closes the connection; queued messages are discarded. */
+        ~connection();
+
+        connection(const connection&) = delete;
+        connection& operator=(const connection&) = delete;
+
+        /* Queues `b` for sending. Returns false if the message was dropped
+         * or the connection is closed.
+         */
+        bool send(const shared_buffer& b);
+
+        /* Closes the socket and discards the queue. `error` is passed to the
+         * close handler, 0 for a local close.
+         */
+        void close(int error = 0);
+
+        /* Called once when the connection closes, with the socket_error code
+         * that closed it: 0 for a local close(), no_buffer_space for a
+         * disconnect by policy. The handler may delete the connection. It is
+         * not called when the connection is destroyed.
+         */
+        void on_close(std::function<void(int)> handler){
+            _on_close = std::move(handler);
+        }
+
+        /* Sets the queued bytes at which producers are paused (`high`) and
+         * resumed (`low`), low <= high.
+         */
+        void set_watermarks(size_t high, size_t low);
+        size_t high_watermark() const { return _high; }
+        size_t low_watermark() const { return _low; }
+
+        /* Called when the queue reaches the high watermark, and when it has
+         * drained to the low watermark after that. A closed connection is
+         * never resumed. The handlers may send() or close(), but must not
+         * destroy the connection.
+         */
+        void on_pause(std::function<void()> handler){
+            _on_pause = std::move(handler);
+        }
+        void on_resume(std::function<void()> handler){
+            _on_resume = std::move(handler);
+        }
+
+        /* Whether the queue has reached the high watermark and hasn't
+         * drained to the low watermark yet.
+         */
+        bool paused() const { return _paused; }
+
+        bool is_open() const { return !_socket.bad(); }
+
+        /* Bytes queued but not yet written. */
+        size_t queued_bytes() const { return _queued; }
+        size_t queued_messages() const { return _count; }
+
+        /* Totals over the life of the connection. */
+        size_t bytes_sent() const { return _sent; }
+        size_t dropped() const { return _dropped; }
+
+        /* Bytes queued on all connections of the process. */
+        static size_t total_queued_bytes() {
+            return _total_queued.load(std::memory_order_relaxed);
+        }
+
+        overflow_policy policy() const { return _policy; }
+        stream_socket& socket() { return _socket; }
+
+    private:
+        class flush_op;
+        friend class flush_op;
+
+        shared_buffer& at(size_t i) { return _queue[(_head + i) & (_queue.size() - 1)]; }
+        void push(const shared_buffer& b);
+        void pop();
+        void unqueue(size_t n);
+        void start_flush();
+        void on_flushed(int error);
+
+        /* One gathering write of the queue; would_block if it can't. */
+        io_result<size_t> gather_write();
+
+        reactor& _reactor;
+        stream_socket _socket;
+        size_t _max_queued;
+        overflow_policy _policy;
+
+        /* a ring of queued buffers; its size is a power of 2 */
+        std::vector<shared_buffer> _queue;
+        size_t _head;
+        size_t _count;
+        /* bytes of the front buffer already written */
+        size_t _offset;
+        size_t _queued;
+        size_t _high;
+        size_t _low;
+        bool _paused;
+
+        size_t _sent;
+        size_t _dropped;
+        flush_op* _flushing;
+        std::function<void(int)> _on_close;
+        std::function<void()> _on_pause;
+        std::function<void()> _on_resume;
+
+        static std::atomic<size_t> _total_queued;
+    };
+}
@@ -1,3 +1,4 @@
+#include <cstring>
 #include <hydrogen/nio/protocols.h>
 #include <hydrogen/nio/exceptions.h>
 
@@ -8,3 +9,18 @@ int hy::socket_error::last(){
     return errno;
 #endif // _WIN32
 }
+
+std::string hy::socket_error::message(int error){
+    if (error == host_not_found){
+        return "host not found";
+    }
+#ifdef _WIN32
+    char buf[256] = { 0 };
+    int code = error + WSABASEERR;
+    ::FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+                     nullptr, code, 0, buf, sizeof(buf), nullptr);
+    return buf[0] ? std::string(buf) : "socket error " + std::to_string(code);
+#else
+    return strerror(error);
+#endif // _WIN32
+}
@@ -3,6 +3,7 @@
 #include <cstdarg>
 #include <cassert>
 #include <cerrno>
+#include <string>
 
 #include <hydrogen/common/stdext.h>
 
@@ -17,10 +18,49 @@ namespace hy {
         static const int not_socket = ENOTSOCK;
         static const int out_of_memory = ENOMEM;
         static const int operation_no_supported = EOPNOTSUPP;
+        static const int invalid_argument = EINVAL;
+#ifdef _WIN32
+        /* WSAExxx - WSABASEERR, see last() */
+        static const int interrupted = 4;
+        static const int would_block = 35;
+        static const int in_progress = 36;
+        static const int connection_aborted = 53;
         static const int connection_reset = 54;
+        static const int broken_pipe = 58;
+        static const int timed_out = 60;
+        static const int connection_refused = 61;
+        static const int not_connected = 57;
+        static const int operation_aborted = 103;
+        static const int no_buffer_space = 55;
+#else
+        static const int interrupted = EINTR;
+        static const int would_block = EWOULDBLOCK;
+        static const int in_progress = EINPROGRESS;
+        static const int connection_aborted = ECONNABORTED;
+        static const int connection_reset = ECONNRESET;
+        static const int broken_pipe = EPIPE;
+        static const int timed_out = ETIMEDOUT;
+        static const int connection_refused = ECONNREFUSED;
+        static const int not_connected = ENOTCONN;
+        static const int operation_aborted = ECANCELED;
+        static const int no_buffer_space = ENOBUFS;
+#endif
+        /* Host name lookup failed, not an errno value */
+        static const int host_not_found = -1;
 
         /* Get last error */
         static int last();
+
+        /* Test whether the error is transient, i.e. the operation may be
+         * retried (would_block, interrupted or in_progress).
+         */
+        static bool transient(int error){
+            return error == would_block || error == interrupted
+                || error == in_progress || error == EAGAIN;
+        }
+
+        /* Describes the error code. */
+        static std::string message(int error);
     };
 
     /* Base exception */
@@ -45,10 +85,102 @@ namespace hy {
     /* IO related exception */
     class io_exception : public exception {
     public:
-        io_exception(const char* message = nullptr) : exception(message){}
-        io_exception(const std::string& message) : exception(message){}
-        io_exception(std::string&& message) : exception(std::move(message)){}
-        io_exception(io_exception&& ex) : exception(std::move(ex)){}
+        io_exception(const char* message = nullptr) : exception(message), _error(0){}
+        io_exception(const std::string& message) : exception(message), _error(0){}
+        io_exception(std::string&& message) : exception(std::move(message)), _error(0){}
+        io_exception(io_exception&& ex) : exception(std::move(ex)), _error(ex._error){}
+
+        /* Constructs an exception for socket_error code `error`. The message is
+         * `what` followed by the description of the error.
+         */
+        io_exception(const char* what, int error)
+            : exception(std::string(what) + ": " + socket_error::message(error)), _error(error){}
+
+        /* The socket_error code, or 0 if the exception carries no code. */
+        int error() const { return _error; }
+
+    private:
+        int _error;
+    };
+
+    /* io_result<T> holds either a value of T or a socket_error code.
+     *
+     * It is returned by the non-throwing try_xxx() counterparts of the IO
+     * methods. Ordinary failures such as connection_reset or would_block are
+     * then reported without constructing and unwinding an io_exception.
+     *
+     * T must be default constructible and movable.
+     */
+    template<typename T>
+    class io_result {
+    public:
+        io_result(const T& value) : _value(value), _error(0){}
+        io_result(T&& value) : _value(std::move(value)), _error(0){}
+        io_result(io_result&& r) : _value(std::move(r._value)), _error(r._error){}
+
+        io_result& operator=(io_result&& r){
+            _value = std::move(r._value);
+            _error = r._error;
+            return *this;
+        }
+
+        /* Makes a failed result with socket_error code `error` (non-zero). */
+        static io_result failure(int error){
+            assert(error != 0);
+            io_result r;
+            r._error = error;
+            return r;
+        }
+
+        bool ok() const { return _error == 0; }
+        explicit operator bool() const { return ok(); }
+
+        /* The socket_error code, 0 on success. */
+        int error() const { return _error; }
+
+        /* The value. The result MUST be ok. */
+        T& value() { assert(ok()); return _value; }
+        const T& value() const { assert(ok()); return _value; }
+
+        /* The value, or an io_exception describing `what` failed. */
+        T& get(const char* what = "socket error"){
+            if (!ok()){
+                throw io_exception(what, _error);
+            }
+            return _value;
+        }
+
+    private:
+        io_result() : _error(0){}
+
+        T   _value;
+        int _error;
+    };
+
+    template<>
+    class io_result<void> {
+    public:
+        io_result() : _error(0){}
+
+        static io_result failure(int error){
+            assert(error != 0);
+            io_result r;
+            r._error = error;
+            return r;
+        }
+
+        bool ok() const { return _error == 0; }
+        explicit operator bool() const { return ok(); }
+        int error() const { return _error; }
+
+        void get(const char* what = "socket error") const {
+            if (!ok()){
+                throw io_exception(what, _error);
+            }
+        }
+
+    private:
+        int _error;
     };
 
 }
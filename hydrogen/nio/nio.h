@@ -2,3 +2,8 @@
 
 #include <hydrogen/nio/socket_stream.h>
 #include <hydrogen/nio/socket_acceptor.h>
+#include <hydrogen/nio/socket_handoff.h>
+#include <hydrogen/nio/reactor.h>
+#include <hydrogen/nio/relay.h>
+#include <hydrogen/nio/connection.h>
+#include <hydrogen/nio/broadcaster.h>
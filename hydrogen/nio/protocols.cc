@@ -25,31 +25,49 @@ endpoint::endpoint(){
 }
 
 endpoint::endpoint(const char* host, int port){
-    _setendpoint(host, port);
+    int error = _setendpoint(host, port);
+    if (error){
+        throw io_exception("failed to resolve host", error);
+    }
 }
 
 endpoint::endpoint(const char* uname){
+    *this = parse(uname).get("Bad address string");
+}
+
+io_result<endpoint> endpoint::resolve(const char* host, int port){
+    endpoint ep;
+    int error = ep._setendpoint(host, port);
+    if (error){
+        return io_result<endpoint>::failure(error);
+    }
+    return ep;
+}
+
+io_result<endpoint> endpoint::parse(const char* uname){
     auto part = string(uname).trim().split_n<2>(':');
     if (part[0].empty() || part[0].length() > 127 || part[1].empty()){
-        throw io_exception("Bad address string.");
+        return io_result<endpoint>::failure(socket_error::invalid_argument);
     }
 
     char host[128];
-    _setendpoint(part[0].copy(host), part[1].to_int());
+    return resolve(part[0].copy(host), part[1].to_int());
 }
 
 std::string endpoint::name() const {
-    char buf[128];
-    struct {
-        unsigned char b1, b2, b3, b4;
-    } addr;
-    memcpy(&addr, &(_addr.sin_addr), sizeof(addr));
-    sprintf(buf, "%d.%d.%d.%d:%d", addr.b1, addr.b2, addr.b3, addr.b4,
-            (int)ntohs(_addr.sin_port));
-    return buf;
+    /* "255.255.255.255:65535" */
+    char buf[32];
+    char* p = buf;
+    const unsigned char* addr = reinterpret_cast<const unsigned char*>(&(_addr.sin_addr));
+    for (int i = 0; i < 4; ++i){
+        p = to_chars(p, buf + sizeof(buf), addr[i]).ptr;
+        *p++ = i < 3 ? '.' : ':';
+    }
+    p = to_chars(p, buf + sizeof(buf), ntohs(_addr.sin_port)).ptr;
+    return std::string(buf, p);
 }
 
-void hy::endpoint::_setendpoint(const char* host, int port){
+int hy::endpoint::_setendpoint(const char* host, int port){
     memset(&_addr, 0, sizeof(_addr));
 
     hostent* ent = gethostbyname(host);
@@ -57,8 +75,7 @@ void hy::endpoint::_setendpoint(const char* host, int port){
         _addr.sin_family = AF_INET;
         _addr.sin_addr.s_addr = *reinterpret_cast<u_long*>(ent->h_addr_list[0]);
         _addr.sin_port = htons(port);
+        return 0;
     }
-    else {
-        throw io_exception("Host not found");
-    }
+    return socket_error::host_not_found;
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdlib>
 #include <hydrogen/nio/exceptions.h>
+#include <hydrogen/nio/socket_options.h>
 #include <hydrogen/common/stdext.h>
 
 #ifdef WIN32
@@ -15,6 +16,7 @@
 #include <arpa/inet.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <fcntl.h>
 #define closesocket close
 #endif
 
@@ -25,6 +27,13 @@ namespace hy{
         endpoint(const char* host, int port);
         explicit endpoint(const char* name);
 
+        /* Non-throwing counterparts of endpoint(host, port) and endpoint(name).
+         * They fail with socket_error::host_not_found if the host can't be
+         * resolved, or socket_error::invalid_argument for a malformed name.
+         */
+        static io_result<endpoint> resolve(const char* host, int port);
+        static io_result<endpoint> parse(const char* name);
+
         /* Test whether the endpoint is invalid */
         bool bad() const {
             return _addr.sin_port == 0;
@@ -48,7 +57,7 @@ namespace hy{
         }
 
     private:
-        void _setendpoint(const char* host, int port);
+        int _setendpoint(const char* host, int port);
 
         sockaddr_in _addr;
     };
@@ -71,8 +80,8 @@ namespace hy{
 
         static void close(int fd) {
             if (fd != badfd) {
-                shutdown(fd, 2);
-                closesocket(fd);
+                ::shutdown(fd, 2);
+                ::closesocket(fd);
             }
         }
     };
@@ -112,11 +121,60 @@ namespace hy{
          * Throws an io_exception if the creation fails.
          */
         static socket_base new_socket() {
+            return std::move(try_new_socket().get("failed to create a socket"));
+        }
+
+        /* Creates a new socket, non-throwing version. */
+        static io_result<socket_base> try_new_socket() {
             socket_base sock;
             if ((sock._fd = proto::create()) == proto::badfd){
-                throw io_exception("failed to create a socket");
+                return io_result<socket_base>::failure(socket_error::last());
+            }
+            return io_result<socket_base>(std::move(sock));
+        }
+
+        /* Creates a new socket with the `r` options of a profile. The socket
+         * is closed again if any option fails.
+         */
+        static socket_base new_socket(const socket_options& opts,
+                                      socket_options::role r = socket_options::client) {
+            return std::move(try_new_socket(opts, r).get("failed to create a socket"));
+        }
+
+        static io_result<socket_base> try_new_socket(const socket_options& opts,
+                                                     socket_options::role r = socket_options::client) {
+            auto sock = try_new_socket();
+            if (sock){
+                auto applied = opts.apply(sock.value()._fd, r);
+                if (!applied){
+                    return io_result<socket_base>::failure(applied.error());
+                }
+            }
+            return sock;
+        }
+
+        /* Switches the socket between blocking and non-blocking mode.
+         * In non-blocking mode, IO methods that would wait fail with
+         * socket_error::would_block instead.
+         */
+        void set_nonblocking(bool on = true) {
+            try_set_nonblocking(on).get("failed to set non-blocking mode");
+        }
+
+        io_result<void> try_set_nonblocking(bool on = true) {
+#ifdef WIN32
+            u_long mode = on ? 1 : 0;
+            if (::ioctlsocket(_fd, FIONBIO, &mode)){
+                return io_result<void>::failure(socket_error::last());
             }
-            return std::move(sock);
+#else
+            int flags = ::fcntl(_fd, F_GETFL, 0);
+            if (flags < 0
+                || ::fcntl(_fd, F_SETFL, on ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK))){
+                return io_result<void>::failure(socket_error::last());
+            }
+#endif
+            return io_result<void>();
         }
 
         /* Test whether the underlying file descriptor is bad.
@@ -129,6 +187,14 @@ namespace hy{
         /* Close the socket. */
         void close() {
             proto::close(_fd);
+            _fd = proto::badfd;
+        }
+
+        /* Gives up ownership of the file descriptor without closing it. */
+        int release() {
+            int fd = _fd;
+            _fd = proto::badfd;
+            return fd;
         }
 
         void swap(socket_base& another) {
@@ -0,0 +1,542 @@
+#include <chrono>
+#include <hydrogen/nio/reactor.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+using namespace hy;
+
+#ifdef __linux__
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46
+#endif
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#endif
+
+handler_allocator::handler_allocator(){
+    for (int i = 0; i < classes; ++i){
+        _free[i] = nullptr;
+    }
+}
+
+handler_allocator::~handler_allocator(){
+    for (int i = 0; i < classes; ++i){
+        while (_free[i]){
+            block* b = _free[i];
+            _free[i] = b->next;
+            ::operator delete(b);
+        }
+    }
+}
+
+int handler_allocator::size_class(size_t size){
+    int c = 0;
+    for (size_t block_size = min_block; block_size < size; block_size <<= 1){
+        ++c;
+    }
+    return c;
+}
+
+void* handler_allocator::allocate(size_t size){
+    int c = size_class(size);
+    if (c >= classes){
+        return ::operator new(size);
+    }
+    if (_free[c]){
+        block* b = _free[c];
+        _free[c] = b->next;
+        return b;
+    }
+    return ::operator new(min_block << c);
+}
+
+void handler_allocator::deallocate(void* p, size_t size){
+    int c = size_class(size);
+    if (c >= classes){
+        ::operator delete(p);
+        return;
+    }
+    block* b = static_cast<block*>(p);
+    b->next = _free[c];
+    _free[c] = b;
+}
+
+task_queue::task_queue() : _head(new node), _tail(_head){}
+
+task_queue::~task_queue(){
+    std::function<void()> task;
+    while (pop(task)){
+    }
+    delete _head;
+}
+
+void task_queue::push(std::function<void()>&& task){
+    node* n = new node;
+    n->task = std::move(task);
+    node* prev = _tail.exchange(n, std::memory_order_acq_rel);
+    /* until this store, the consumer can't see n or anything pushed after */
+    prev->next.store(n, std::memory_order_release);
+}
+
+bool task_queue::pop(std::function<void()>& task){
+    node* next = _head->next.load(std::memory_order_acquire);
+    if (!next){
+        return false;
+    }
+    /* next becomes the new head once its task is taken */
+    task = std::move(next->task);
+    delete _head;
+    _head = next;
+    return true;
+}
+
+class reactor::loop_scope {
+public:
+    loop_scope(reactor& r)
+        : _reactor(r), _prev(r._loop_thread.exchange(std::this_thread::get_id())){}
+
+    ~loop_scope(){ _reactor._loop_thread.store(_prev); }
+
+private:
+    reactor& _reactor;
+    std::thread::id _prev;
+};
+
+reactor::reactor()
+    : _outstanding(0), _stopped(false), _wait_mode(block), _spin_us(0),
+      _spin_budget(0), _busy_poll_us(0), _posted(0), _wake_pending(false){
+#ifdef HYDROGEN_REACTOR_EPOLL
+    _epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    if (_epoll < 0){
+        throw io_exception("failed to create epoll instance", socket_error::last());
+    }
+    _events.resize(128);
+#endif
+    open_wakeup();
+}
+
+reactor::~reactor(){
+    /* pending operations are destroyed without invoking their handlers */
+    for (auto& e : _descriptors){
+        for (int q = 0; q < 2; ++q){
+            _ready.splice(e.second->ops[q]);
+        }
+        delete e.second;
+    }
+    while (reactor_op* op = _ready.pop()){
+        free_op(op);
+    }
+    for (auto d : _spare){
+        delete d;
+    }
+#ifdef HYDROGEN_REACTOR_EPOLL
+    ::close(_epoll);
+#endif
+    ::closesocket(_wake[0]);
+    if (_wake[1] != _wake[0]){
+        ::closesocket(_wake[1]);
+    }
+}
+
+void reactor::open_wakeup(){
+#if defined(__linux__)
+    _wake[0] = _wake[1] = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_wake[0] < 0){
+        throw io_exception("failed to create eventfd", socket_error::last());
+    }
+#elif defined(WIN32)
+    /* WSAPoll takes sockets only */
+    int s = (int)::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    sockaddr_in addr = sockaddr_in();
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int len = sizeof(addr);
+    u_long mode = 1;
+    if (s == proto_tcp::badfd
+        || ::bind(s, (sockaddr*)&addr, sizeof(addr))
+        || ::getsockname(s, (sockaddr*)&addr, &len)
+        || ::connect(s, (sockaddr*)&addr, sizeof(addr))
+        || ::ioctlsocket(s, FIONBIO, &mode)){
+        int error = socket_error::last();
+        ::closesocket(s);
+        throw io_exception("failed to create the wake-up socket", error);
+    }
+    _wake[0] = _wake[1] = s;
+#else
+    if (::pipe(_wake)){
+        throw io_exception("failed to create the wake-up pipe", socket_error::last());
+    }
+    for (int i = 0; i < 2; ++i){
+        ::fcntl(_wake[i], F_SETFL, ::fcntl(_wake[i], F_GETFL, 0) | O_NONBLOCK);
+        ::fcntl(_wake[i], F_SETFD, FD_CLOEXEC);
+    }
+#endif
+
+#ifdef HYDROGEN_REACTOR_EPOLL
+    epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    /* no descriptor: see wait() */
+    ev.data.ptr = nullptr;
+    if (::epoll_ctl(_epoll, EPOLL_CTL_ADD, _wake[0], &ev)){
+        int error = socket_error::last();
+        ::close(_wake[0]);
+        ::close(_epoll);
+        throw io_exception("failed to register the wake-up descriptor", error);
+    }
+#endif
+}
+
+void reactor::signal_wakeup(){
+#if defined(__linux__)
+    uint64_t one = 1;
+    ssize_t n = ::write(_wake[1], &one, sizeof(one));
+    (void)n;
+#elif defined(WIN32)
+    ::send(_wake[1], "", 1, 0);
+#else
+    ssize_t n = ::write(_wake[1], "", 1);
+    (void)n;
+#endif
+}
+
+void reactor::drain_wakeup(){
+#if defined(__linux__)
+    uint64_t count;
+    ssize_t n = ::read(_wake[0], &count, sizeof(count));
+    (void)n;
+#elif defined(WIN32)
+    char buf[64];
+    while (::recv(_wake[0], buf, sizeof(buf), 0) > 0){
+    }
+#else
+    char buf[64];
+    while (::read(_wake[0], buf, sizeof(buf)) > 0){
+    }
+#endif
+    /* posts from now on signal again */
+    _wake_pending.store(false, std::memory_order_release);
+}
+
+void reactor::post(std::function<void()> task){
+    /* counted first, so that run() doesn't return while the push is half done */
+    _posted.fetch_add(1, std::memory_order_acq_rel);
+    _tasks.push(std::move(task));
+    if (!_wake_pending.exchange(true, std::memory_order_acq_rel)){
+        signal_wakeup();
+    }
+}
+
+void reactor::run_in_loop(std::function<void()> task){
+    if (in_loop()){
+        task();
+    }
+    else {
+        post(std::move(task));
+    }
+}
+
+size_t reactor::run_tasks(){
+    /* only the tasks queued now: tasks posted by these run on the next round */
+    size_t count = _posted.load(std::memory_order_acquire);
+    size_t n = 0;
+    std::function<void()> task;
+    while (n < count && _tasks.pop(task)){
+        _posted.fetch_sub(1, std::memory_order_acq_rel);
+        ++n;
+        task();
+    }
+    return n;
+}
+
+reactor::descriptor* reactor::get_descriptor(int fd){
+    auto it = _descriptors.find(fd);
+    if (it != _descriptors.end()){
+        return it->second;
+    }
+
+    /* the reactor never waits inside a system call on the descriptor */
+#ifdef WIN32
+    u_long mode = 1;
+    if (::ioctlsocket(fd, FIONBIO, &mode)){
+        return nullptr;
+    }
+#else
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK)){
+        return nullptr;
+    }
+#endif
+
+    descriptor* d;
+    if (_spare.empty()){
+        d = new descriptor;
+    }
+    else {
+        d = _spare.back();
+        _spare.pop_back();
+    }
+    d->fd = fd;
+
+#ifdef __linux__
+    if (_busy_poll_us){
+        int us = (int)_busy_poll_us, prefer = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &us, sizeof(us));
+        ::setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer));
+    }
+#endif
+
+#ifdef HYDROGEN_REACTOR_EPOLL
+    epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    ev.data.ptr = d;
+    if (::epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev)){
+        _spare.push_back(d);
+        return nullptr;
+    }
+#endif
+    _descriptors[fd] = d;
+    return d;
+}
+
+void reactor::start(int fd, int q, reactor_op* op){
+    ++_outstanding;
+    descriptor* d = get_descriptor(fd);
+    if (!d){
+        op->abort(socket_error::last());
+        _ready.push(op);
+        return;
+    }
+
+    /* try it right away unless earlier operations are still waiting */
+    if (d->ops[q].empty() && op->perform()){
+        _ready.push(op);
+        return;
+    }
+    d->ops[q].push(op);
+}
+
+void reactor::perform(descriptor* d, int q){
+    op_queue& ops = d->ops[q];
+    while (!ops.empty() && ops.front()->perform()){
+        _ready.push(ops.pop());
+    }
+}
+
+void reactor::cancel(int fd){
+    auto it = _descriptors.find(fd);
+    if (it == _descriptors.end()){
+        return;
+    }
+    for (int q = 0; q < 2; ++q){
+        op_queue& ops = it->second->ops[q];
+        while (reactor_op* op = ops.pop()){
+            op->abort(socket_error::operation_aborted);
+            _ready.push(op);
+        }
+    }
+}
+
+void reactor::remove(int fd){
+    cancel(fd);
+    auto it = _descriptors.find(fd);
+    if (it == _descriptors.end()){
+        return;
+    }
+#ifdef HYDROGEN_REACTOR_EPOLL
+    ::epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, nullptr);
+#endif
+    it->second->fd = -1;
+    _spare.push_back(it->second);
+    _descriptors.erase(it);
+}
+
+size_t reactor::run_ready(){
+    /* handlers started from here are ready only on the next round, so that
+     * a chain of immediate completions can't starve the backend
+     */
+    op_queue ready;
+    ready.splice(_ready);
+
+    size_t n = 0;
+    while (reactor_op* op = ready.pop()){
+        --_outstanding;
+        ++n;
+        op->complete();
+    }
+    return n + run_tasks();
+}
+
+size_t reactor::wait(int timeout_ms){
+    size_t n = 0;
+#ifdef HYDROGEN_REACTOR_EPOLL
+    int count = ::epoll_wait(_epoll, _events.data(), (int)_events.size(), timeout_ms);
+    for (int i = 0; i < count; ++i){
+        descriptor* d = static_cast<descriptor*>(_events[i].data.ptr);
+        uint32_t ev = _events[i].events;
+        if (!d){
+            drain_wakeup();
+            ++n;
+            continue;
+        }
+        if (ev & (EPOLLIN | EPOLLERR | EPOLLHUP)){
+            perform(d, read_queue);
+        }
+        if (ev & (EPOLLOUT | EPOLLERR | EPOLLHUP)){
+            perform(d, write_queue);
+        }
+        ++n;
+    }
+    if (count == (int)_events.size()){
+        _events.resize(_events.size() * 2);
+    }
+#else
+    _pollfds.clear();
+    _polled.clear();
+    pollfd w;
+    w.fd = _wake[0];
+    w.events = POLLIN;
+    w.revents = 0;
+    _pollfds.push_back(w);
+    _polled.push_back(nullptr);
+    for (auto& e : _descriptors){
+        descriptor* d = e.second;
+        short events = 0;
+        if (!d->ops[read_queue].empty()){
+            events |= POLLIN;
+        }
+        if (!d->ops[write_queue].empty()){
+            events |= POLLOUT;
+        }
+        if (events){
+            pollfd p;
+            p.fd = d->fd;
+            p.events = events;
+            p.revents = 0;
+            _pollfds.push_back(p);
+            _polled.push_back(d);
+        }
+    }
+#ifdef WIN32
+    int count = ::WSAPoll(_pollfds.data(), (ULONG)_pollfds.size(), timeout_ms);
+#else
+    int count = ::poll(_pollfds.data(), _pollfds.size(), timeout_ms);
+#endif
+    for (size_t i = 0; count > 0 && i < _pollfds.size(); ++i){
+        short ev = _pollfds[i].revents;
+        if (!ev){
+            continue;
+        }
+        --count;
+        if (!_polled[i]){
+            drain_wakeup();
+            ++n;
+            continue;
+        }
+        if (ev & (POLLIN | POLLERR | POLLHUP | POLLNVAL)){
+            perform(_polled[i], read_queue);
+        }
+        if (ev & (POLLOUT | POLLERR | POLLHUP | POLLNVAL)){
+            perform(_polled[i], write_queue);
+        }
+        ++n;
+    }
+#endif
+    return n;
+}
+
+void reactor::set_wait_mode(wait_mode m, unsigned spin_us){
+    _wait_mode = m;
+    _spin_us = m == block ? 0 : spin_us;
+    _spin_budget = _spin_us;
+}
+
+bool reactor::set_busy_poll(unsigned us){
+#ifdef __linux__
+    _busy_poll_us = us;
+    return true;
+#else
+    (void)us;
+    return false;
+#endif
+}
+
+size_t reactor::wait_for_io(int timeout_ms){
+    typedef std::chrono::steady_clock clock;
+    size_t n = 0;
+
+    if (!_ready.empty() || timeout_ms == 0
+        || _posted.load(std::memory_order_relaxed)){
+        /* when handlers are ready, still look for IO but don't wait for it */
+        n = wait(0);
+    }
+    else {
+        if (_spin_budget){
+            clock::time_point start = clock::now();
+            clock::time_point end = start + std::chrono::microseconds(_spin_budget);
+            do {
+                n = wait(0);
+            } while (!n && clock::now() < end);
+
+            if (n){
+                ++_wait_stats.spin_hits;
+                _spin_budget = _spin_us;
+                return n;
+            }
+            ++_wait_stats.spin_misses;
+            if (_wait_mode == adaptive){
+                _spin_budget /= 2;
+            }
+            if (timeout_ms > 0){
+                int spent = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                    clock::now() - start).count();
+                timeout_ms = spent < timeout_ms ? timeout_ms - spent : 0;
+            }
+        }
+        ++_wait_stats.sleeps;
+        n = wait(timeout_ms);
+    }
+
+    if (n && _spin_budget < _spin_us){
+        /* traffic again: spin longer next time, starting from an eighth of
+         * the full budget, which outlasts a loopback round trip
+         */
+        unsigned least = _spin_us / 8 ? _spin_us / 8 : 1;
+        _spin_budget = _spin_budget * 2 > least ? _spin_budget * 2 : least;
+        if (_spin_budget > _spin_us){
+            _spin_budget = _spin_us;
+        }
+    }
+    return n;
+}
+
+size_t reactor::run(){
+    loop_scope scope(*this);
+    size_t n = 0;
+    while (!_stopped && pending()){
+        wait_for_io(-1);
+        n += run_ready();
+    }
+    return n;
+}
+
+size_t reactor::run_one(int timeout_ms){
+    loop_scope scope(*this);
+    size_t n = 0;
+    while (!_stopped && pending() && !n){
+        wait_for_io(timeout_ms);
+        n = run_ready();
+        if (timeout_ms >= 0){
+            break;
+        }
+    }
+    return n;
+}
+
+size_t reactor::poll(){
+    loop_scope scope(*this);
+    wait(0);
+    return run_ready();
+}
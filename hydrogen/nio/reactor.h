@@ -0,0 +1,383 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <unordered_map>
+
+#include <hydrogen/nio/protocols.h>
+
+#if defined(__linux__) && !defined(HYDROGEN_REACTOR_POLL)
+#define HYDROGEN_REACTOR_EPOLL 1
+#include <sys/epoll.h>
+#elif !defined(WIN32)
+#include <poll.h>
+#endif
+
+namespace hy {
+    class reactor;
+
+    /* handler_allocator recycles the memory of completed operations.
+     *
+     * Blocks are grouped into a few power-of-two size classes with one free
+     * list each. An operation that completes gives its block back before its
+     * handler runs, so the next operation started from the handler reuses the
+     * same block and steady-state IO doesn't touch the heap at all.
+     */
+    class handler_allocator {
+    public:
+        static const size_t min_block = 64;
+        static const int classes = 5;   /* 64 .. 1024 bytes */
+
+        handler_allocator();
+        ~handler_allocator();
+
+        handler_allocator(const handler_allocator&) = delete;
+        handler_allocator& operator=(const handler_allocator&) = delete;
+
+        void* allocate(size_t size);
+        void deallocate(void* p, size_t size);
+
+    private:
+        static int size_class(size_t size);
+
+        struct block { block* next; };
+        block* _free[classes];
+    };
+
+    /* reactor_op is the base of all asynchronous operations.
+     *
+     * perform() tries to make progress without blocking and returns true once
+     * the operation is finished, successfully or not. complete() invokes the
+     * handler and frees the operation.
+     */
+    class reactor_op {
+    public:
+        reactor_op() : _error(0), _next(nullptr), _size(0){}
+        virtual ~reactor_op(){}
+
+        virtual bool perform() = 0;
+        virtual void complete() = 0;
+
+        /* Finishes the operation with `error` without performing it. */
+        void abort(int error){ _error = error; }
+
+    protected:
+        /* The socket_error code of the operation, 0 on success */
+        int _error;
+
+    private:
+        friend class reactor;
+        friend class op_queue;
+
+        reactor_op* _next;
+        size_t _size;
+    };
+
+    /* Intrusive FIFO of operations. */
+    class op_queue {
+    public:
+        op_queue() : _head(nullptr), _tail(nullptr){}
+
+        bool empty() const { return _head == nullptr; }
+        reactor_op* front() const { return _head; }
+
+        void push(reactor_op* op){
+            op->_next = nullptr;
+            if (_tail){
+                _tail->_next = op;
+            }
+            else {
+                _head = op;
+            }
+            _tail = op;
+        }
+
+        reactor_op* pop(){
+            reactor_op* op = _head;
+            if (op){
+                _head = op->_next;
+                if (!_head){
+                    _tail = nullptr;
+                }
+                op->_next = nullptr;
+            }
+            return op;
+        }
+
+        /* Moves all operations of `q` to the end of this queue. */
+        void splice(op_queue& q){
+            if (q._head){
+                if (_tail){
+                    _tail->_next = q._head;
+                }
+                else {
+                    _head = q._head;
+                }
+                _tail = q._tail;
+                q._head = q._tail = nullptr;
+            }
+        }
+
+    private:
+        reactor_op* _head;
+        reactor_op* _tail;
+    };
+
+    /* Queue of tasks posted to a reactor, with many producer threads and the
+     * reactor's thread as the single consumer.
+     *
+     * It is a linked list whose producers only exchange the tail pointer
+     * (Vyukov's MPSC queue), so push() never blocks and never takes a lock.
+     * pop() may briefly see the queue as empty while a push is half done;
+     * the reactor retries on its next round.
+     */
+    class task_queue {
+    public:
+        task_queue();
+        ~task_queue();
+
+        task_queue(const task_queue&) = delete;
+        task_queue& operator=(const task_queue&) = delete;
+
+        /* Any thread. */
+        void push(std::function<void()>&& task);
+
+        /* Consumer thread only. Returns false if there is nothing to pop. */
+        bool pop(std::function<void()>& task);
+
+    private:
+        struct node {
+            node() : next(nullptr){}
+
+            std::atomic<node*> next;
+            std::function<void()> task;
+        };
+
+        /* the consumer end; its task has been taken already */
+        node* _head;
+        /* the producer end */
+        std::atomic<node*> _tail;
+    };
+
+    /*
+     * reactor runs asynchronous socket operations and invokes their completion
+     * handlers.
+     *
+     * Operations are started with the async_xxx() methods of stream_socket and
+     * socket_acceptor. Each operation is first attempted right away; if it would
+     * block, it waits in a per-descriptor queue until the backend reports the
+     * descriptor ready. Handlers are only ever invoked from run() or poll(),
+     * never from the method that started the operation.
+     *
+     * On Linux the backend is edge-triggered epoll: a descriptor is registered
+     * once, on its first operation, and never modified afterwards. Elsewhere,
+     * or when HYDROGEN_REACTOR_POLL is defined, the backend is poll().
+     *
+     * When no handler is ready, run() and run_one() wait for IO according to
+     * the wait mode: sleep in the backend right away (block, the default), or
+     * first poll it without sleeping for a while (spin), which saves the
+     * wake-up latency of a sleeping thread at the price of a busy core.
+     * adaptive spins too, but backs off towards block while the loop is idle.
+     *
+     * A reactor is not thread-safe; run it from one thread. The exceptions are
+     * post() and run_in_loop(), through which other threads hand work to it. Sockets must not be
+     * closed while they have pending operations: call remove() first, which
+     * completes the pending operations with socket_error::operation_aborted.
+     */
+    class reactor {
+    public:
+        /* descriptor queues */
+        static const int read_queue = 0;
+        static const int write_queue = 1;
+
+        /* how run() and run_one() wait for IO */
+        enum wait_mode {
+            /* sleep in the backend */
+            block,
+            /* poll the backend without sleeping for up to the spin budget,
+             * then sleep
+             */
+            spin,
+            /* spin, halving the budget each time spinning finds nothing and
+             * growing it back while it finds IO
+             */
+            adaptive
+        };
+
+        static const unsigned default_spin_us = 50;
+
+        /* Counters of the waits for IO. */
+        struct wait_stats {
+            wait_stats() : spin_hits(0), spin_misses(0), sleeps(0){}
+
+            /* spins that found IO, spins that ran out of budget */
+            size_t spin_hits;
+            size_t spin_misses;
+            /* waits that slept in the backend */
+            size_t sleeps;
+        };
+
+        reactor();
+        ~reactor();
+
+        reactor(const reactor&) = delete;
+        reactor& operator=(const reactor&) = delete;
+
+        /* Runs until there are no pending operations or stop() is called.
+         * Returns the number of handlers invoked.
+         */
+        size_t run();
+
+        /* Runs until at least one handler is invoked, unless there are no
+         * pending operations or stop() is called. Returns the number of
+         * handlers invoked. With a `timeout_ms` >= 0, waits at most that long
+         * and returns 0 if nothing completed.
+         */
+        size_t run_one(int timeout_ms = -1);
+
+        /* Runs ready handlers without waiting. */
+        size_t poll();
+
+        /* Makes run() return as soon as possible. */
+        void stop() { _stopped = true; }
+        bool stopped() const { return _stopped; }
+        void restart() { _stopped = false; }
+
+        /* Sets the wait mode and its spin budget in microseconds. */
+        void set_wait_mode(wait_mode m, unsigned spin_us = default_spin_us);
+        wait_mode get_wait_mode() const { return _wait_mode; }
+
+        /* The current spin budget; adaptive changes it as it goes. */
+        unsigned spin_budget() const { return _spin_budget; }
+
+        /* Sets SO_BUSY_POLL (`us` microseconds) and SO_PREFER_BUSY_POLL on
+         * the descriptors registered from now on, 0 to stop. The kernel then
+         * polls the device queue in recv() instead of waiting for an
+         * interrupt, and in epoll_wait()/poll() if net.core.busy_poll is set.
+         * Returns false where the options don't exist. Raising SO_BUSY_POLL
+         * above net.core.busy_read needs CAP_NET_ADMIN; sockets that refuse
+         * it are registered anyway.
+         */
+        bool set_busy_poll(unsigned us);
+
+        const wait_stats& get_wait_stats() const { return _wait_stats; }
+
+        /* Queues `task` to run on the reactor's thread, from run(), run_one()
+         * or poll(), and wakes the reactor up if it is waiting for IO. Can be
+         * called from any thread. Wake-ups are coalesced: a burst of posts
+         * costs one wake-up of the reactor.
+         */
+        void post(std::function<void()> task);
+
+        /* Runs `task` right away if called from inside run(), run_one() or
+         * poll() of this reactor, posts it otherwise.
+         */
+        void run_in_loop(std::function<void()> task);
+
+        /* Whether the calling thread is running this reactor. */
+        bool in_loop() const {
+            return _loop_thread.load(std::memory_order_relaxed) == std::this_thread::get_id();
+        }
+
+        /* Number of operations started but not yet completed, and of
+         * posted tasks that haven't run yet.
+         */
+        size_t pending() const {
+            return _outstanding + _posted.load(std::memory_order_acquire);
+        }
+
+        /* Aborts all pending operations on `fd`. */
+        void cancel(int fd);
+
+        /* Aborts all pending operations on `fd` and forgets the descriptor.
+         * Call it before closing a socket that has been used with the reactor.
+         */
+        void remove(int fd);
+
+        /* Constructs an operation in recycled memory. */
+        template<typename Op, typename... Args>
+        Op* make_op(Args&&... args){
+            void* p = _allocator.allocate(sizeof(Op));
+            Op* op = new (p) Op(std::forward<Args>(args)...);
+            op->_size = sizeof(Op);
+            return op;
+        }
+
+        /* Destroys an operation made by make_op(). */
+        void free_op(reactor_op* op){
+            size_t size = op->_size;
+            op->~reactor_op();
+            _allocator.deallocate(op, size);
+        }
+
+        /* Starts `op` on queue `q` of descriptor `fd`. */
+        void start(int fd, int q, reactor_op* op);
+
+        /* Completes `op` from run() without performing it, e.g. because it
+         * failed before it could be started.
+         */
+        void complete(reactor_op* op){
+            ++_outstanding;
+            _ready.push(op);
+        }
+
+    private:
+        struct descriptor {
+            descriptor() : fd(-1){}
+
+            int fd;
+            op_queue ops[2];
+        };
+
+        descriptor* get_descriptor(int fd);
+        void perform(descriptor* d, int q);
+        size_t wait(int timeout_ms);
+        size_t wait_for_io(int timeout_ms);
+        size_t run_ready();
+        size_t run_tasks();
+
+        /* wake-up channel of post() */
+        void open_wakeup();
+        void signal_wakeup();
+        void drain_wakeup();
+
+        /* marks the calling thread as the one running the reactor */
+        class loop_scope;
+
+        handler_allocator _allocator;
+        std::unordered_map<int, descriptor*> _descriptors;
+        std::vector<descriptor*> _spare;
+        op_queue _ready;
+        size_t _outstanding;
+        bool _stopped;
+
+        wait_mode _wait_mode;
+        unsigned _spin_us;
+        unsigned _spin_budget;
+        unsigned _busy_poll_us;
+        wait_stats _wait_stats;
+
+        task_queue _tasks;
+        /* tasks posted but not run yet */
+        std::atomic<size_t> _posted;
+        /* a wake-up has been signalled and not drained yet */
+        std::atomic<bool> _wake_pending;
+        /* read and write ends: one eventfd on Linux, a pipe elsewhere, a UDP
+         * socket connected to itself on Windows
+         */
+        int _wake[2];
+        std::atomic<std::thread::id> _loop_thread;
+
+#ifdef HYDROGEN_REACTOR_EPOLL
+        int _epoll;
+        std::vector<epoll_event> _events;
+#else
+        std::vector<pollfd> _pollfds;
+        std::vector<descriptor*> _polled;
+#endif
+    };
+}
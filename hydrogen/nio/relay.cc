@@ -0,0 +1,210 @@
+#include <hydrogen/nio/relay.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace hy;
+
+#ifdef WIN32
+#define SHUT_WR SD_SEND
+#define SHUT_RDWR SD_BOTH
+#endif
+
+/* One fill (src -> chunk) or drain (chunk -> dst) attempt of a direction. */
+class relay::transfer_op : public reactor_op {
+public:
+    transfer_op(relay& r, direction& d, bool filling)
+        : _relay(r), _dir(d), _filling(filling), _bytes(0){}
+
+    bool perform() override {
+        for (;;){
+            auto n = _filling ? _relay.fill(_dir) : _relay.drain(_dir);
+            if (n){
+                _bytes = n.value();
+                return true;
+            }
+            if (n.error() == socket_error::interrupted){
+                continue;
+            }
+            if (socket_error::transient(n.error())){
+                return false;
+            }
+            _error = n.error();
+            return true;
+        }
+    }
+
+    void complete() override {
+        relay& r = _relay;
+        direction& d = _dir;
+        bool filling = _filling;
+        int error = _error;
+        size_t bytes = _bytes;
+        r._reactor.free_op(this);
+        if (filling){
+            r.on_fill(d, error, bytes);
+        }
+        else {
+            r.on_drain(d, error, bytes);
+        }
+    }
+
+private:
+    relay& _relay;
+    direction& _dir;
+    bool _filling;
+    size_t _bytes;
+};
+
+relay::mode relay::default_mode(){
+#ifdef __linux__
+    return splice;
+#else
+    return copy;
+#endif
+}
+
+relay::relay(reactor& r, stream_socket& a, stream_socket& b, mode m, size_t chunk)
+    : _reactor(r), _mode(m), _chunk(chunk), _error(0), _done(nullptr){
+#ifndef __linux__
+    _mode = copy;
+#endif
+    init(_dirs[0], a, b);
+    init(_dirs[1], b, a);
+}
+
+relay::~relay(){
+#ifdef __linux__
+    for (auto& d : _dirs){
+        if (d.pipe[0] >= 0){
+            ::close(d.pipe[0]);
+            ::close(d.pipe[1]);
+        }
+    }
+#endif
+}
+
+void relay::init(direction& d, stream_socket& src, stream_socket& dst){
+    d.src = &src;
+    d.dst = &dst;
+#ifdef __linux__
+    if (_mode == splice){
+        if (::pipe2(d.pipe, O_NONBLOCK | O_CLOEXEC) == 0){
+            /* a pipe holds 64KB by default; the size is a hint */
+            ::fcntl(d.pipe[1], F_SETPIPE_SZ, (int)_chunk);
+            return;
+        }
+        d.pipe[0] = d.pipe[1] = -1;
+        /* out of descriptors: fall back for both directions */
+        if (&d == &_dirs[1] && _dirs[0].pipe[0] >= 0){
+            ::close(_dirs[0].pipe[0]);
+            ::close(_dirs[0].pipe[1]);
+            _dirs[0].pipe[0] = _dirs[0].pipe[1] = -1;
+            _dirs[0].buf.resize(_chunk);
+        }
+        _mode = copy;
+    }
+#endif
+    d.buf.resize(_chunk);
+}
+
+io_result<size_t> relay::fill(direction& d){
+#ifdef __linux__
+    if (_mode == splice){
+        ssize_t n = ::splice(d.src->native_handle(), nullptr, d.pipe[1], nullptr,
+                             _chunk, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n < 0){
+            return io_result<size_t>::failure(socket_error::last());
+        }
+        if (n == 0){
+            /* splice reports a reset connection as EOF, unlike recv */
+            int error = 0;
+            socklen_t len = sizeof(error);
+            ::getsockopt(d.src->native_handle(), SOL_SOCKET, SO_ERROR, &error, &len);
+            if (error){
+                return io_result<size_t>::failure(error);
+            }
+        }
+        return (size_t)n;
+    }
+#endif
+    return d.src->try_read_some(d.buf.data(), d.buf.size());
+}
+
+io_result<size_t> relay::drain(direction& d){
+#ifdef __linux__
+    if (_mode == splice){
+        ssize_t n = ::splice(d.pipe[0], nullptr, d.dst->native_handle(), nullptr,
+                             d.pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n < 0){
+            return io_result<size_t>::failure(socket_error::last());
+        }
+        return (size_t)n;
+    }
+#endif
+    return d.dst->try_write_some(d.buf.data() + d.offset, d.pending);
+}
+
+void relay::next(direction& d){
+    if (d.pending){
+        _reactor.start(d.dst->native_handle(), reactor::write_queue,
+                       _reactor.make_op<transfer_op>(*this, d, false));
+    }
+    else if (d.eof){
+        /* everything is forwarded: pass the half-close on */
+        ::shutdown(d.dst->native_handle(), SHUT_WR);
+        finish(d, 0);
+    }
+    else {
+        _reactor.start(d.src->native_handle(), reactor::read_queue,
+                       _reactor.make_op<transfer_op>(*this, d, true));
+    }
+}
+
+void relay::on_fill(direction& d, int error, size_t n){
+    if (error){
+        finish(d, error);
+        return;
+    }
+    if (n == 0){
+        d.eof = true;
+    }
+    d.pending = n;
+    d.offset = 0;
+    next(d);
+}
+
+void relay::on_drain(direction& d, int error, size_t n){
+    if (error){
+        finish(d, error);
+        return;
+    }
+    if (n == 0){
+        finish(d, socket_error::broken_pipe);
+        return;
+    }
+    d.pending -= n;
+    d.offset += n;
+    d.bytes += n;
+    next(d);
+}
+
+void relay::finish(direction& d, int error){
+    d.done = true;
+    if (error && !_error){
+        _error = error;
+        /* wake the other direction up, it can't complete either */
+        ::shutdown(_dirs[0].src->native_handle(), SHUT_RDWR);
+        ::shutdown(_dirs[1].src->native_handle(), SHUT_RDWR);
+    }
+    if (_dirs[0].done && _dirs[1].done){
+        if (_error){
+            _done->abort(_error);
+        }
+        reactor_op* done = _done;
+        _done = nullptr;
+        _reactor.complete(done);
+    }
+}
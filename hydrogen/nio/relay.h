@@ -0,0 +1,129 @@
+#pragma once
+#include <vector>
+
+#include <hydrogen/nio/stream_socket.h>
+#include <hydrogen/nio/reactor.h>
+
+namespace hy {
+    /*
+     * relay forwards bytes between two connected stream_sockets in both
+     * directions, e.g. the two legs of an L4 proxy, on a reactor.
+     *
+     * In splice mode (Linux) each direction moves data socket -> pipe -> socket
+     * with splice(2), so payload bytes never enter user space. In copy mode
+     * they go through a user buffer with recv/send, as a read_some/write loop
+     * would.
+     *
+     * Each direction reads at most one chunk ahead: it stops reading while the
+     * previous chunk hasn't been written, so a slow receiver pushes back on
+     * the sender through TCP flow control. When one side shuts down its
+     * sending half, the relay forwards what is left and then shuts down the
+     * sending half towards the other side, while the opposite direction keeps
+     * running (half-close). If either direction fails, both sockets are shut
+     * down so the other direction ends too.
+     *
+     * The relay and both sockets must outlive the relay's pending operations;
+     * the handler passed to start() runs once both directions have ended.
+     */
+    class relay {
+    public:
+        enum mode { copy, splice };
+
+        /* The default chunk size, which is also the pipe size in splice mode */
+        static const size_t default_chunk = 65536;
+
+        relay(reactor& r, stream_socket& a, stream_socket& b,
+              mode m = default_mode(), size_t chunk = default_chunk);
+        ~relay();
+
+        relay(const relay&) = delete;
+        relay& operator=(const relay&) = delete;
+
+        /* splice where available, copy elsewhere. The relay also falls back
+         * to copy mode if it can't create its pipes.
+         */
+        static mode default_mode();
+
+        /* Starts relaying. The handler is called with an io_result<void>
+         * after both directions have ended, with the first error if any.
+         */
+        template<typename Handler>
+        void start(Handler handler);
+
+        /* Bytes forwarded from a to b and from b to a. */
+        size_t a_to_b() const { return _dirs[0].bytes; }
+        size_t b_to_a() const { return _dirs[1].bytes; }
+
+        mode get_mode() const { return _mode; }
+
+    private:
+        struct direction {
+            direction() : src(nullptr), dst(nullptr), pending(0), offset(0),
+                          bytes(0), eof(false), done(false){
+                pipe[0] = pipe[1] = -1;
+            }
+
+            stream_socket* src;
+            stream_socket* dst;
+            /* splice: pipe[0] is read from, pipe[1] written to */
+            int pipe[2];
+            /* copy: the chunk buffer */
+            std::vector<char> buf;
+            /* bytes read from src but not yet written to dst */
+            size_t pending;
+            /* copy: offset of the pending bytes in buf */
+            size_t offset;
+            size_t bytes;
+            bool eof;
+            bool done;
+        };
+
+        class transfer_op;
+        friend class transfer_op;
+
+        void init(direction& d, stream_socket& src, stream_socket& dst);
+        void next(direction& d);
+        void on_fill(direction& d, int error, size_t n);
+        void on_drain(direction& d, int error, size_t n);
+        void finish(direction& d, int error);
+
+        /* one non-blocking attempt to move data; would_block if it can't */
+        io_result<size_t> fill(direction& d);
+        io_result<size_t> drain(direction& d);
+
+        reactor& _reactor;
+        mode _mode;
+        size_t _chunk;
+        direction _dirs[2];
+        int _error;
+        reactor_op* _done;
+    };
+
+    /* Completion of a whole relay. */
+    template<typename Handler>
+    class relay_done_op : public reactor_op {
+    public:
+        relay_done_op(reactor& r, Handler&& h) : _reactor(r), _handler(std::move(h)){}
+
+        bool perform() override { return true; }
+
+        void complete() override {
+            Handler handler(std::move(_handler));
+            io_result<void> result = _error
+                ? io_result<void>::failure(_error) : io_result<void>();
+            _reactor.free_op(this);
+            handler(std::move(result));
+        }
+
+    private:
+        reactor& _reactor;
+        Handler _handler;
+    };
+
+    template<typename Handler>
+    void relay::start(Handler handler){
+        _done = _reactor.make_op<relay_done_op<Handler> >(_reactor, std::move(handler));
+        next(_dirs[0]);
+        next(_dirs[1]);
+    }
+}
@@ -1,5 +1,9 @@
 #include <hydrogen/nio/socket_acceptor.h>
 
+#ifdef __linux__
+#include <linux/filter.h>
+#endif
+
 using namespace hy;
 
 
@@ -9,7 +13,8 @@ socket_acceptor::socket_acceptor(const endpoint& ep, int backlog) {
     listen(ep, backlog);
 }
 
-socket_acceptor::socket_acceptor(socket_acceptor&& a){
+socket_acceptor::socket_acceptor(socket_acceptor&& a)
+    : _name(a._name), _options(a._options){
     swap(a);
 }
 
@@ -18,41 +23,154 @@ socket_acceptor& socket_acceptor::operator=(socket_acceptor&& a){
         assert(bad());
         tcp_socket::swap(a);
         _name = a._name;
+        _options = a._options;
     }
     return *this;
 }
 
+void socket_acceptor::open() {
+    try_open().get("failed to create a socket");
+}
+
+void socket_acceptor::open(const socket_options& opts) {
+    try_open(opts).get("failed to create a socket");
+}
+
+void socket_acceptor::set_reuse_address(bool on) {
+    try_set_reuse_address(on).get("failed to set SO_REUSEADDR");
+}
+
+void socket_acceptor::set_reuse_port(bool on) {
+    try_set_reuse_port(on).get("failed to set SO_REUSEPORT");
+}
+
+void socket_acceptor::attach_cpu_steering(int group_size) {
+    try_attach_cpu_steering(group_size).get("failed to attach the steering program");
+}
+
 void socket_acceptor::bind(const endpoint& ep) {
+    try_bind(ep).get(("bind error " + ep.name()).c_str());
+}
+
+void socket_acceptor::listen(const endpoint& ep, int backlog) {
+    try_listen(ep, backlog).get("socket listen error");
+}
+
+void socket_acceptor::listen(int backlog) {
+    try_listen(backlog).get("socket listen error");
+}
+
+stream_socket socket_acceptor::accept() {
+    return std::move(try_accept().get("socket accept error"));
+}
+
+io_result<void> socket_acceptor::try_open() {
+    if (bad()){
+        auto tmp = tcp_socket::try_new_socket();
+        if (!tmp){
+            return io_result<void>::failure(tmp.error());
+        }
+        tcp_socket::swap(tmp.value());
+    }
+    return io_result<void>();
+}
+
+io_result<void> socket_acceptor::try_open(const socket_options& opts) {
+    assert(bad());
+    auto tmp = tcp_socket::try_new_socket(opts, socket_options::listener);
+    if (!tmp){
+        return io_result<void>::failure(tmp.error());
+    }
+    tcp_socket::swap(tmp.value());
+    _options = opts;
+    return io_result<void>();
+}
+
+io_result<void> socket_acceptor::try_set_reuse_address(bool on) {
+    int value = on ? 1 : 0;
+    if (::setsockopt(native_handle(), SOL_SOCKET, SO_REUSEADDR,
+                     (const char*)&value, sizeof(value))) {
+        return io_result<void>::failure(socket_error::last());
+    }
+    return io_result<void>();
+}
+
+io_result<void> socket_acceptor::try_set_reuse_port(bool on) {
+#ifdef SO_REUSEPORT
+    int value = on ? 1 : 0;
+    if (::setsockopt(native_handle(), SOL_SOCKET, SO_REUSEPORT,
+                     (const char*)&value, sizeof(value))) {
+        return io_result<void>::failure(socket_error::last());
+    }
+    return io_result<void>();
+#else
+    (void)on;
+    return io_result<void>::failure(socket_error::operation_no_supported);
+#endif
+}
+
+io_result<void> socket_acceptor::try_attach_cpu_steering(int group_size) {
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+    if (group_size <= 0){
+        return io_result<void>::failure(socket_error::invalid_argument);
+    }
+    /* A = raw_smp_processor_id() % group_size; return A */
+    sock_filter code[] = {
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU) },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, (uint32_t)group_size },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    sock_fprog prog;
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    if (::setsockopt(native_handle(), SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                     &prog, sizeof(prog))) {
+        return io_result<void>::failure(socket_error::last());
+    }
+    return io_result<void>();
+#else
+    (void)group_size;
+    return io_result<void>::failure(socket_error::operation_no_supported);
+#endif
+}
+
+io_result<void> socket_acceptor::try_bind(const endpoint& ep) {
     auto addr = ep.getaddr();
     if (::bind(native_handle(), (sockaddr*)&addr, sizeof(addr))) {
-        std::string message = "bind error";
-        message += ep.name();
+        return io_result<void>::failure(socket_error::last());
     }
     _name = ep;
+    return io_result<void>();
 }
 
-void socket_acceptor::listen(const endpoint& ep, int backlog) {
-    if (bad()){
-        auto tmp = tcp_socket::new_socket();
-        tcp_socket::swap(tmp);
+io_result<void> socket_acceptor::try_listen(const endpoint& ep, int backlog) {
+    auto r = try_open();
+    if (r){
+        r = try_bind(ep);
     }
-    bind(ep);
-    listen(backlog);
+    return r ? try_listen(backlog) : r;
 }
 
-void socket_acceptor::listen(int backlog) {
+io_result<void> socket_acceptor::try_listen(int backlog) {
     if (::listen(native_handle(), backlog)) {
-        throw io_exception("socket listen error");
+        return io_result<void>::failure(socket_error::last());
     }
+    return io_result<void>();
 }
 
-stream_socket socket_acceptor::accept() {
+io_result<stream_socket> socket_acceptor::try_accept() {
     sockaddr_in addr;
     socklen_t len = sizeof(addr);
     int fd = ::accept(native_handle(), reinterpret_cast<sockaddr*>(&addr), &len);
     if (fd == proto::badfd) {
-        throw io_exception("socket accept error");
+        return io_result<stream_socket>::failure(socket_error::last());
+    }
+    tcp_socket s(fd);
+    if (_options.quick_ack){
+        auto applied = _options.apply(fd, socket_options::accepted);
+        if (!applied){
+            return io_result<stream_socket>::failure(applied.error());
+        }
     }
-    return stream_socket(
-        tcp_socket(fd), stream_socket::readable | stream_socket::writable);
+    return stream_socket(std::move(s), stream_socket::readable | stream_socket::writable);
 }
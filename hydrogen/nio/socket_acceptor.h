@@ -14,12 +14,62 @@ namespace hy {
         socket_acceptor(socket_acceptor&& a);
         socket_acceptor& operator=(socket_acceptor&& a);
 
+        /* Creates the listening socket without binding it, so that options
+         * can be set before listen(). listen(ep) creates it if needed.
+         */
+        void open();
+
+        /* Creates the listening socket with the listener options of `opts`,
+         * see socket_options. Accepted connections get the rest.
+         */
+        void open(const socket_options& opts);
+
+        /* SO_REUSEADDR: rebind while old connections are in TIME_WAIT. */
+        void set_reuse_address(bool on = true);
+
+        /* SO_REUSEPORT: let several acceptors listen on the same endpoint; the
+         * kernel spreads incoming connections over them. Must be set on every
+         * acceptor of the group before it binds. Fails with
+         * socket_error::operation_no_supported where there is no such option.
+         */
+        void set_reuse_port(bool on = true);
+
+        /* Steers each connection of a reuseport group to the acceptor with
+         * index (receiving CPU % group_size), in bind order. Attach it to one
+         * acceptor of the group once all `group_size` acceptors are bound.
+         * Then a worker that is pinned to CPU i and accepts from acceptor i
+         * handles the connections whose packets CPU i processes.
+         * Linux only (SO_ATTACH_REUSEPORT_CBPF). With a single acceptor,
+         * socket_handoff does the same in user space.
+         */
+        void attach_cpu_steering(int group_size);
+
         void bind(const endpoint& ep);
         void listen(int backlog = 5);
         void listen(const endpoint& ep, int backlog = 5);
 
         stream_socket accept();
 
+        /* Non-throwing counterparts of the methods above.
+         * On a non-blocking acceptor, try_accept() fails with
+         * socket_error::would_block when there is no pending connection.
+         */
+        io_result<void> try_open();
+        io_result<void> try_open(const socket_options& opts);
+        io_result<void> try_set_reuse_address(bool on = true);
+        io_result<void> try_set_reuse_port(bool on = true);
+        io_result<void> try_attach_cpu_steering(int group_size);
+        io_result<void> try_bind(const endpoint& ep);
+        io_result<void> try_listen(int backlog = 5);
+        io_result<void> try_listen(const endpoint& ep, int backlog = 5);
+        io_result<stream_socket> try_accept();
+
+        /* Accepts a connection asynchronously, see reactor.
+         * The handler is called with an io_result<stream_socket>.
+         */
+        template<typename Handler>
+        void async_accept(reactor& r, Handler handler);
+
         /* Gets the local name of the acceptor. */
         endpoint getname() const {
             return _name;
@@ -28,5 +78,57 @@ namespace hy {
     private:
         /* The local endpoint that the acceptor binds to. */
         endpoint _name;
+
+        /* The profile given to open() */
+        socket_options _options;
+    };
+
+    /* Asynchronous accept on a socket_acceptor. */
+    template<typename Handler>
+    class accept_op : public reactor_op {
+    public:
+        accept_op(reactor& r, socket_acceptor& a, Handler&& h)
+            : _reactor(r), _acceptor(a), _handler(std::move(h)){}
+
+        bool perform() override {
+            for (;;){
+                auto s = _acceptor.try_accept();
+                if (s){
+                    _socket = std::move(s.value());
+                    return true;
+                }
+                int error = s.error();
+                if (error == socket_error::interrupted
+                    || error == socket_error::connection_aborted){
+                    continue;
+                }
+                if (socket_error::transient(error)){
+                    return false;
+                }
+                _error = error;
+                return true;
+            }
+        }
+
+        void complete() override {
+            Handler handler(std::move(_handler));
+            io_result<stream_socket> result = _error
+                ? io_result<stream_socket>::failure(_error)
+                : io_result<stream_socket>(std::move(_socket));
+            _reactor.free_op(this);
+            handler(std::move(result));
+        }
+
+    private:
+        reactor& _reactor;
+        socket_acceptor& _acceptor;
+        stream_socket _socket;
+        Handler _handler;
     };
+
+    template<typename Handler>
+    void socket_acceptor::async_accept(reactor& r, Handler handler){
+        r.start(native_handle(), reactor::read_queue,
+                r.make_op<accept_op<Handler> >(r, *this, std::move(handler)));
+    }
 }
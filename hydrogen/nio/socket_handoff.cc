@@ -0,0 +1,227 @@
+#include <hydrogen/nio/socket_handoff.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#ifdef WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <cstdio>
+#endif
+
+using namespace hy;
+
+#ifdef __linux__
+static long read_sysfs_number(unsigned cpu, const char* name){
+    char path[96];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/%s", cpu, name);
+    FILE* f = fopen(path, "r");
+    if (!f){
+        return -1;
+    }
+    long value = -1;
+    if (fscanf(f, "%ld", &value) != 1){
+        value = -1;
+    }
+    fclose(f);
+    return value;
+}
+#endif
+
+/* The core and NUMA node of each of `cpus` CPUs, -1 where unknown. */
+static void cpu_topology(unsigned cpus, std::vector<long>& core, std::vector<long>& node){
+    core.assign(cpus, -1);
+    node.assign(cpus, -1);
+#if defined(WIN32)
+    DWORD length = 0;
+    ::GetLogicalProcessorInformation(nullptr, &length);
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if (info.empty() || !::GetLogicalProcessorInformation(info.data(), &length)){
+        return;
+    }
+    for (size_t i = 0; i < info.size(); ++i){
+        for (unsigned c = 0; c < cpus && c < sizeof(ULONG_PTR) * 8; ++c){
+            if (!(info[i].ProcessorMask & ((ULONG_PTR)1 << c))){
+                continue;
+            }
+            if (info[i].Relationship == RelationProcessorCore){
+                core[c] = (long)i;
+            }
+            else if (info[i].Relationship == RelationNumaNode){
+                node[c] = (long)info[i].NumaNode.NodeNumber;
+            }
+        }
+    }
+#elif defined(__linux__)
+    for (unsigned c = 0; c < cpus; ++c){
+        long package = read_sysfs_number(c, "physical_package_id");
+        long id = read_sysfs_number(c, "core_id");
+        if (package >= 0 && id >= 0){
+            core[c] = (package << 16) | id;
+        }
+        /* the CPU's directory links to its node as nodeN */
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", c);
+        DIR* dir = opendir(path);
+        if (!dir){
+            continue;
+        }
+        while (dirent* e = readdir(dir)){
+            long n;
+            if (sscanf(e->d_name, "node%ld", &n) == 1){
+                node[c] = n;
+                break;
+            }
+        }
+        closedir(dir);
+    }
+#endif
+}
+
+socket_handoff::socket_handoff(int workers)
+    : _inboxes(new inbox[workers > 0 ? workers : 1]), _count(workers > 0 ? workers : 1), _next(0){
+    unsigned cpus = std::thread::hardware_concurrency();
+    _by_cpu.resize(cpus);
+    if (cpus == 0){
+        return;
+    }
+    /* worker w runs on CPU w % cpus, see pin_worker() */
+    for (int w = 0; w < _count; ++w){
+        _by_cpu[w % cpus].push_back(w);
+    }
+    if ((unsigned)_count >= cpus){
+        return;
+    }
+    /* the CPUs without a worker: the workers of their core, else of
+     * their node
+     */
+    std::vector<long> core, node;
+    cpu_topology(cpus, core, node);
+    for (unsigned c = _count; c < cpus; ++c){
+        for (int w = 0; w < _count; ++w){
+            if (core[c] >= 0 && core[w] == core[c]){
+                _by_cpu[c].push_back(w);
+            }
+        }
+        for (int w = 0; _by_cpu[c].empty() && w < _count; ++w){
+            if (node[c] >= 0 && node[w] == node[c]){
+                _by_cpu[c].push_back(w);
+            }
+        }
+    }
+}
+
+int socket_handoff::worker_of(stream_socket& s){
+    auto cpu = s.incoming_cpu();
+    int worker = cpu ? worker_of_cpu(cpu.value()) : -1;
+    if (worker >= 0){
+        return worker;
+    }
+    return (int)(_next.fetch_add(1, std::memory_order_relaxed) % (unsigned)_count);
+}
+
+int socket_handoff::worker_of_cpu(int cpu){
+    if (cpu < 0 || (size_t)cpu >= _by_cpu.size() || _by_cpu[cpu].empty()){
+        return -1;
+    }
+    const std::vector<int>& workers = _by_cpu[cpu];
+    if (workers.size() == 1){
+        return workers[0];
+    }
+    return workers[_next.fetch_add(1, std::memory_order_relaxed) % workers.size()];
+}
+
+int socket_handoff::dispatch(stream_socket&& s){
+    int worker = worker_of(s);
+    dispatch(worker, std::move(s));
+    return worker;
+}
+
+void socket_handoff::dispatch(int worker, stream_socket&& s){
+    inbox& in = _inboxes[worker];
+    {
+        std::lock_guard<std::mutex> guard(in.lock);
+        in.sockets.push_back(std::move(s));
+    }
+    if (in.notify){
+        in.notify();
+    }
+}
+
+size_t socket_handoff::take(int worker, std::vector<stream_socket>& out){
+    inbox& in = _inboxes[worker];
+    std::lock_guard<std::mutex> guard(in.lock);
+    size_t n = in.sockets.size();
+    for (auto& s : in.sockets){
+        out.push_back(std::move(s));
+    }
+    in.sockets.clear();
+    return n;
+}
+
+void socket_handoff::on_dispatch(int worker, std::function<void()> notify){
+    _inboxes[worker].notify = std::move(notify);
+}
+
+bool socket_handoff::pin_worker(int worker){
+    unsigned cpus = std::thread::hardware_concurrency();
+    if (cpus == 0 || worker < 0){
+        return false;
+    }
+    unsigned cpu = (unsigned)worker % cpus;
+#if defined(WIN32)
+    return ::SetThreadAffinityMask(::GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+buffer_pool::buffer_pool(size_t buffer_size, size_t buffers_per_chunk)
+    : _size(buffer_size ? buffer_size : 1), _per_chunk(buffers_per_chunk ? buffers_per_chunk : 1){}
+
+buffer_pool::~buffer_pool(){
+    for (auto c : _chunks){
+        ::free(c);
+    }
+}
+
+char* buffer_pool::get(){
+    if (_free.empty()){
+        if (_size > (size_t)-1 / _per_chunk){
+            throw std::bad_alloc();
+        }
+        char* chunk = (char*)::malloc(_size * _per_chunk);
+        if (!chunk){
+            throw std::bad_alloc();
+        }
+        _chunks.push_back(chunk);
+        /* first touch, on this thread */
+        memset(chunk, 0, _size * _per_chunk);
+        for (size_t i = _per_chunk; i-- > 0;){
+            _free.push_back(chunk + i * _size);
+        }
+    }
+    char* b = _free.back();
+    _free.pop_back();
+    return b;
+}
+
+void buffer_pool::put(char* buffer){
+    _free.push_back(buffer);
+}
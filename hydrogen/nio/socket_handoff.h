@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <hydrogen/nio/stream_socket.h>
+
+namespace hy {
+    /*
+     * socket_handoff passes the connections one thread accepts to a set of
+     * workers, worker i running pinned to CPU i modulo the CPU count (see
+     * pin_worker()). dispatch() queues a connection in the inbox of a
+     * worker pinned to the CPU that processed its packets
+     * (stream_socket::incoming_cpu()), so that the kernel's work and the
+     * worker's on the connection share a core and its caches. With fewer
+     * workers than CPUs, a CPU without a worker maps to the workers on its
+     * core, else to those on its NUMA node (read from sysfs on Linux, from
+     * GetLogicalProcessorInformation() on Windows). Connections of unknown
+     * CPU, or of a CPU with no worker near it, go round robin.
+     *
+     * It is the user space counterpart of
+     * socket_acceptor::attach_cpu_steering(), for a single accepting thread
+     * or a kernel without reuseport BPF. A worker empties its inbox with
+     * take(), polling, or when told by the notifier given to on_dispatch(),
+     * e.g. a reactor::post() to the worker's reactor.
+     */
+    class socket_handoff {
+    public:
+        explicit socket_handoff(int workers);
+
+        int workers() const { return _count; }
+
+        /* The worker for `s`: worker_of_cpu(s.incoming_cpu()), or the next
+         * one in round robin where that is -1.
+         */
+        int worker_of(stream_socket& s);
+
+        /* The worker for a connection received on `cpu`: the one pinned to
+         * it, else one on the same core, else on the same NUMA node, taken
+         * in turn where there are several; -1 if there is none.
+         */
+        int worker_of_cpu(int cpu);
+
+        /* Queues `s` for worker_of(s); returns that worker. */
+        int dispatch(stream_socket&& s);
+
+        /* Queues `s` for `worker`. */
+        void dispatch(int worker, stream_socket&& s);
+
+        /* Moves the connections queued for `worker` to the end of `out`,
+         * and returns how many they are.
+         */
+        size_t take(int worker, std::vector<stream_socket>& out);
+
+        /* Calls `notify` on the dispatching thread each time a connection
+         * is queued for `worker`. Set it before dispatching starts.
+         */
+        void on_dispatch(int worker, std::function<void()> notify);
+
+        /* Pins the calling thread to the CPU of `worker`: CPU `worker`
+         * modulo the number of CPUs. Returns false where it cannot.
+         */
+        static bool pin_worker(int worker);
+
+    private:
+        struct inbox {
+            std::mutex lock;
+            std::vector<stream_socket> sockets;
+            std::function<void()> notify;
+            /* keep the locks of two workers off one cache line */
+            char pad[64];
+        };
+
+        std::unique_ptr<inbox[]> _inboxes;
+        int _count;
+        /* the workers for each CPU, see worker_of_cpu() */
+        std::vector<std::vector<int> > _by_cpu;
+        std::atomic<unsigned> _next;
+    };
+
+    /*
+     * buffer_pool recycles the fixed-size IO buffers of one worker. It
+     * allocates them in chunks and writes them once on the calling thread,
+     * so a worker that pins itself before its first get() has its buffers
+     * on its own NUMA node (Linux and Windows place a page where it is
+     * first touched). A pool is not thread-safe: one pool per worker.
+     */
+    class buffer_pool {
+    public:
+        explicit buffer_pool(size_t buffer_size, size_t buffers_per_chunk = 16);
+        ~buffer_pool();
+
+        buffer_pool(const buffer_pool&) = delete;
+        buffer_pool& operator=(const buffer_pool&) = delete;
+
+        /* A buffer of buffer_size() bytes. */
+        char* get();
+
+        /* Gives back a buffer of get(). */
+        void put(char* buffer);
+
+        size_t buffer_size() const { return _size; }
+
+        /* Number of buffers allocated, in use or not. */
+        size_t allocated() const { return _chunks.size() * _per_chunk; }
+
+    private:
+        size_t _size;
+        size_t _per_chunk;
+        std::vector<char*> _chunks;
+        std::vector<char*> _free;
+    };
+}
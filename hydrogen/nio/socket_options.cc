@@ -0,0 +1,62 @@
+#include <hydrogen/nio/socket_options.h>
+#include <hydrogen/nio/protocols.h>
+
+#ifndef WIN32
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+using namespace hy;
+
+static io_result<void> set_option(int fd, int level, int name, int value){
+    if (::setsockopt(fd, level, name, (const char*)&value, sizeof(value))){
+        return io_result<void>::failure(socket_error::last());
+    }
+    return io_result<void>();
+}
+
+#ifdef __linux__
+#define LINUX_OPTION(name) name
+#else
+/* no such option: apply() fails with operation_no_supported */
+#define LINUX_OPTION(name) -1
+#endif
+
+io_result<void> socket_options::apply(int fd, role r) const {
+    struct option {
+        bool wanted;
+        int level;
+        int name;
+        int value;
+    };
+    const option opts[] = {
+        /* inherited by accepted connections: set on clients and listeners */
+        { r != accepted && no_delay, IPPROTO_TCP, TCP_NODELAY, 1 },
+        { r != accepted && send_buffer > 0, SOL_SOCKET, SO_SNDBUF, send_buffer },
+        { r != accepted && receive_buffer > 0, SOL_SOCKET, SO_RCVBUF, receive_buffer },
+        { r != accepted && user_timeout_ms > 0, IPPROTO_TCP,
+          LINUX_OPTION(TCP_USER_TIMEOUT), (int)user_timeout_ms },
+        /* not inherited */
+        { r != listener && quick_ack, IPPROTO_TCP, LINUX_OPTION(TCP_QUICKACK), 1 },
+        /* listeners only */
+        { r == listener && reuse_address, SOL_SOCKET, SO_REUSEADDR, 1 },
+        { r == listener && defer_accept_s > 0, IPPROTO_TCP,
+          LINUX_OPTION(TCP_DEFER_ACCEPT), defer_accept_s },
+        { r == listener && fast_open > 0, IPPROTO_TCP,
+          LINUX_OPTION(TCP_FASTOPEN), fast_open },
+    };
+
+    for (auto& o : opts){
+        if (!o.wanted){
+            continue;
+        }
+        if (o.name < 0){
+            return io_result<void>::failure(socket_error::operation_no_supported);
+        }
+        auto result = set_option(fd, o.level, o.name, o.value);
+        if (!result){
+            return result;
+        }
+    }
+    return io_result<void>();
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <hydrogen/nio/exceptions.h>
+
+namespace hy {
+    /*
+     * socket_options is a profile of TCP socket options, applied as a whole
+     * when a socket is created: if the system refuses any of them, the socket
+     * is closed and the creation fails with that error, so a socket never
+     * runs with half of its profile.
+     *
+     * Fields left at their defaults (false / 0) leave the system default in
+     * place; a default-constructed profile makes a bare socket.
+     *
+     * A listener applies the connection options too: accepted connections
+     * inherit them from it, except TCP_QUICKACK, which socket_acceptor sets
+     * again on each accepted connection.
+     */
+    struct socket_options {
+        socket_options()
+            : no_delay(false), quick_ack(false), send_buffer(0), receive_buffer(0),
+              user_timeout_ms(0), reuse_address(false), defer_accept_s(0),
+              fast_open(0){}
+
+        /* TCP_NODELAY and TCP_QUICKACK: request/response traffic. */
+        static socket_options low_latency(){
+            socket_options o;
+            o.no_delay = true;
+            o.quick_ack = true;
+            return o;
+        }
+
+        /* Connection options */
+
+        /* TCP_NODELAY: send small segments right away (no Nagle). */
+        bool no_delay;
+        /* TCP_QUICKACK: ACK right away instead of delaying. Linux only; the
+         * kernel may leave quick-ack mode again later on.
+         */
+        bool quick_ack;
+        /* SO_SNDBUF, SO_RCVBUF in bytes */
+        int send_buffer;
+        int receive_buffer;
+        /* TCP_USER_TIMEOUT: abort the connection when sent data stays
+         * unacknowledged this long. Linux only.
+         */
+        unsigned user_timeout_ms;
+
+        /* Listener options */
+
+        /* SO_REUSEADDR */
+        bool reuse_address;
+        /* TCP_DEFER_ACCEPT: wake the acceptor only once data has arrived,
+         * waiting at most this many seconds. Linux only.
+         */
+        int defer_accept_s;
+        /* TCP Fast Open. On a listener, the length of the queue of pending
+         * fast-open connections (TCP_FASTOPEN). On a client, any value > 0
+         * makes socket_stream::open(ep, options, data, len) carry the first
+         * request in the SYN (sendto with MSG_FASTOPEN), which saves a round
+         * trip once the client holds a cookie from the server. Linux only;
+         * net.ipv4.tcp_fastopen must enable it on each side (1 client,
+         * 2 server). Without a cookie the kernel falls back to a regular
+         * handshake.
+         */
+        int fast_open;
+
+        enum role { client, listener, accepted };
+
+        /* Applies the options of `r` to `fd`. Fails with the first error, or
+         * socket_error::operation_no_supported for an option the platform
+         * doesn't have.
+         */
+        io_result<void> apply(int fd, role r) const;
+    };
+}
@@ -49,6 +49,35 @@ size_t socket_stream::write_some(const char* buf, size_t bytes) {
     return _socket.write_some(buf, bytes);
 }
 
+io_result<size_t> socket_stream::try_read(char* buf, size_t bytes) {
+    size_t rd = local_read(buf, bytes);
+    if (!bytes) {
+        return rd;
+    }
+
+    auto r = _socket.try_read(buf, bytes);
+    if (!r) {
+        return r;
+    }
+    return rd + r.value();
+}
+
+io_result<size_t> socket_stream::try_read_some(char* buf, size_t bytes) {
+    size_t rd = local_read(buf, bytes);
+    if (!rd && bytes) {
+        return _socket.try_read_some(buf, bytes);
+    }
+    return rd;
+}
+
+io_result<size_t> socket_stream::try_write(const char* buf, size_t bytes) {
+    return _socket.try_write(buf, bytes);
+}
+
+io_result<size_t> socket_stream::try_write_some(const char* buf, size_t bytes) {
+    return _socket.try_write_some(buf, bytes);
+}
+
 size_t socket_stream::local_read(char*& buf, size_t& count){
     size_t rd = 0;
     if (!_buf.empty()){
@@ -61,17 +90,57 @@ size_t socket_stream::local_read(char*& buf, size_t& count){
 }
 
 void socket_stream::open(const endpoint& ep){
+    try_open(ep).get("socket connect error");
+}
+
+void socket_stream::open(const endpoint& ep, const socket_options& opts){
+    try_open(ep, opts).get("socket connect error");
+}
+
+void socket_stream::open(const endpoint& ep, const socket_options& opts,
+                         const char* data, size_t len){
+    try_open(ep, opts, data, len).get("socket connect error");
+}
+
+io_result<void> socket_stream::try_open(const endpoint& ep){
+    return try_open(ep, socket_options());
+}
+
+io_result<void> socket_stream::try_open(const endpoint& ep, const socket_options& opts,
+                                        const char* data, size_t len){
     assert(_socket.bad());
 
-    tcp_socket s = tcp_socket::new_socket();
+    auto s = tcp_socket::try_new_socket(opts);
+    if (!s){
+        return io_result<void>::failure(s.error());
+    }
+
+    stream_socket tmp(std::move(s.value()), 0);
+    auto w = tmp.try_connect_with(ep, data, len, opts.fast_open > 0);
+    if (!w){
+        return io_result<void>::failure(w.error());
+    }
+    _socket = std::move(tmp);
+    return io_result<void>();
+}
+
+io_result<void> socket_stream::try_open(const endpoint& ep, const socket_options& opts){
+    assert(_socket.bad());
+
+    auto s = tcp_socket::try_new_socket(opts);
+    if (!s){
+        return io_result<void>::failure(s.error());
+    }
+
     auto addr = ep.getaddr();
-    if (::connect(s.native_handle(), (sockaddr*)&addr, sizeof(addr))){
-        throw io_exception("socket connect error");
+    if (::connect(s.value().native_handle(), (sockaddr*)&addr, sizeof(addr))){
+        return io_result<void>::failure(socket_error::last());
     }
 
-    auto tmp = stream_socket(std::move(s),
+    auto tmp = stream_socket(std::move(s.value()),
         stream_socket::readable | stream_socket::writable);
     _socket = std::move(tmp);
+    return io_result<void>();
 }
 
 void socket_stream::open(const char* uname){
@@ -3,6 +3,9 @@
 #include <hydrogen/nio/protocols.h>
 #include <hydrogen/nio/stream_socket.h>
 #include <hydrogen/common/queue_buffer.h>
+#ifdef HYDROGEN_SOCKET_STREAM_MIRRORED
+#include <hydrogen/common/mirrored_queue_buffer.h>
+#endif
 
 namespace hy{
     /* socket_stream encapsulates stream_socket and provides std::iostream-like
@@ -29,6 +32,15 @@ namespace hy{
         void open(const endpoint& ep);
         void open(const char* uname);
 
+        /* Opens a new socket_stream on a socket created with `opts`. */
+        void open(const endpoint& ep, const socket_options& opts);
+
+        /* Opens a new socket_stream and sends the first request, `len` bytes
+         * of `data`. With opts.fast_open the request rides in the SYN (TCP
+         * Fast Open), which saves a round trip on short-lived connections.
+         */
+        void open(const endpoint& ep, const socket_options& opts, const char* data, size_t len);
+
         /* Closes the socket_stream. */
         void close(){
             _socket.close();
@@ -46,6 +58,19 @@ namespace hy{
         void write(const char* buf, size_t bytes);
         size_t write_some(const char* buf, size_t bytes);
 
+        /* Non-throwing counterparts of open/read/write, see stream_socket.
+         * try_read() returns fewer than `bytes` only if the peer closed the
+         * connection.
+         */
+        io_result<void> try_open(const endpoint& ep);
+        io_result<void> try_open(const endpoint& ep, const socket_options& opts);
+        io_result<void> try_open(const endpoint& ep, const socket_options& opts,
+                                 const char* data, size_t len);
+        io_result<size_t> try_read(char* buf, size_t bytes);
+        io_result<size_t> try_read_some(char* buf, size_t bytes);
+        io_result<size_t> try_write(const char* buf, size_t bytes);
+        io_result<size_t> try_write_some(const char* buf, size_t bytes);
+
         void getline(char* buf, size_t count, char delim = '\n');
         int  getch();
 
@@ -61,8 +86,15 @@ namespace hy{
         /* The underlying socket */
         stream_socket _socket;
 
-        /* Buffer for socket reading */
+        /* Buffer for socket reading. Builds that define
+         * HYDROGEN_SOCKET_STREAM_MIRRORED (library and users alike) read into
+         * a mirrored_queue_buffer, which never moves unread bytes to make room.
+         */
+#ifdef HYDROGEN_SOCKET_STREAM_MIRRORED
+        hy::mirrored_queue_buffer _buf;
+#else
         hy::queue_buffer<char> _buf;
+#endif
     };
 }
 
@@ -24,6 +24,9 @@ stream_socket& stream_socket::operator=(stream_socket&& s){
 void stream_socket::read(char* buf, size_t len, int flag) {
     while (len) {
         auto r = read_some(buf, len, flag);
+        if (r == 0){
+            throw io_exception("socket read error: connection closed");
+        }
         buf += r;
         len -= r;
     }
@@ -38,33 +41,139 @@ void stream_socket::write(const char* buf, size_t len, int flag){
 }
 
 size_t stream_socket::read_some(char* buf, size_t len, int flag){
-    //if (!can_read()){
-    //    throw io_exception("socket is not readable.", 0);
-    //}
+    return try_read_some(buf, len, flag).get("socket read error");
+}
+
+size_t stream_socket::write_some(const char* buf, size_t len, int flag) {
+    size_t wr = try_write_some(buf, len, flag).get("socket write error");
+    if (wr == 0 && len){
+        throw io_exception("socket write error");
+    }
+    return wr;
+}
+
+io_result<size_t> stream_socket::try_read_some(char* buf, size_t len, int flag){
     int rd = ::recv(native_handle(), buf, len, flag);
     if (rd <= 0){
-        /* socket no longer readable */
-        _rwmask &= ~readable;
-        if (rd < 0){
-            throw io_exception("socket read error");
+        if (rd == 0){
+            /* socket no longer readable */
+            _rwmask &= ~readable;
+            return 0;
         }
+
+        int error = socket_error::last();
+        if (!socket_error::transient(error)){
+            _rwmask &= ~readable;
+        }
+        return io_result<size_t>::failure(error);
     }
     _bytes_in += rd;
-    return rd;
+    return (size_t)rd;
 }
 
-size_t stream_socket::write_some(const char* buf, size_t len, int flag) {
-    //if (!can_write()){
-    //    throw io_exception("socket is not writable.", 0);
-    //}
+io_result<size_t> stream_socket::try_write_some(const char* buf, size_t len, int flag) {
+#ifdef MSG_NOSIGNAL
+    /* report a closed peer as broken_pipe instead of raising SIGPIPE */
+    flag |= MSG_NOSIGNAL;
+#endif
     int wr = ::send(native_handle(), buf, len, flag);
-    if (wr <= 0){
-        /* socket no longer writable */
+    if (wr < 0){
+        int error = socket_error::last();
+        if (!socket_error::transient(error)){
+            /* socket no longer writable */
+            _rwmask &= ~writable;
+        }
+        return io_result<size_t>::failure(error);
+    }
+    if (wr == 0 && len){
         _rwmask &= ~writable;
-        throw io_exception("socket write error");
     }
     _bytes_out += wr;
-    return wr;
+    return (size_t)wr;
+}
+
+io_result<size_t> stream_socket::try_read(char* buf, size_t len, int flag){
+    size_t done = 0;
+    while (done < len){
+        auto r = try_read_some(buf + done, len - done, flag);
+        if (!r){
+            if (r.error() == socket_error::interrupted){
+                continue;
+            }
+            return r;
+        }
+        if (r.value() == 0){
+            break;
+        }
+        done += r.value();
+    }
+    return done;
+}
+
+io_result<size_t> stream_socket::try_write(const char* buf, size_t len, int flag){
+    size_t done = 0;
+    while (done < len){
+        auto w = try_write_some(buf + done, len - done, flag);
+        if (!w){
+            if (w.error() == socket_error::interrupted){
+                continue;
+            }
+            return w;
+        }
+        if (w.value() == 0){
+            return io_result<size_t>::failure(socket_error::broken_pipe);
+        }
+        done += w.value();
+    }
+    return done;
+}
+
+io_result<size_t> stream_socket::try_connect_with(const endpoint& ep, const char* data,
+                                                  size_t len, bool fast_open){
+    auto addr = ep.getaddr();
+    size_t sent = 0;
+    bool connected = false;
+#ifdef MSG_FASTOPEN
+    if (fast_open && len){
+        int wr = ::sendto(native_handle(), data, len, MSG_FASTOPEN | MSG_NOSIGNAL,
+                          (const sockaddr*)&addr, sizeof(addr));
+        if (wr >= 0){
+            sent = (size_t)wr;
+            _bytes_out += sent;
+            connected = true;
+        }
+        else if (socket_error::last() != socket_error::operation_no_supported){
+            return io_result<size_t>::failure(socket_error::last());
+        }
+        /* client Fast Open is off (net.ipv4.tcp_fastopen): connect as usual */
+    }
+#endif
+    if (!connected && ::connect(native_handle(), (const sockaddr*)&addr, sizeof(addr))){
+        return io_result<size_t>::failure(socket_error::last());
+    }
+    (void)fast_open;
+
+    _rwmask = readable | writable;
+    if (sent < len){
+        auto w = try_write(data + sent, len - sent);
+        if (!w){
+            return w;
+        }
+    }
+    return len;
+}
+
+io_result<int> stream_socket::incoming_cpu(){
+#ifdef SO_INCOMING_CPU
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (::getsockopt(native_handle(), SOL_SOCKET, SO_INCOMING_CPU, (char*)&cpu, &len)){
+        return io_result<int>::failure(socket_error::last());
+    }
+    return cpu;
+#else
+    return io_result<int>::failure(socket_error::operation_no_supported);
+#endif
 }
 
 void stream_socket::close(){
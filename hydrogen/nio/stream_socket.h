@@ -1,5 +1,6 @@
 #pragma once
 #include <hydrogen/nio/protocols.h>
+#include <hydrogen/nio/reactor.h>
 
 namespace hy{
     /*
@@ -39,6 +40,63 @@ namespace hy{
          */
         void write(const char* buf, size_t len, int flag = 0);
 
+        /* Non-throwing counterparts of the methods above.
+         * Failures are reported as socket_error codes in the result. A zero-byte
+         * read means the peer closed the connection. On a non-blocking socket
+         * the xxx_some() methods fail with socket_error::would_block when no
+         * progress can be made.
+         */
+        io_result<size_t> try_read_some(char* buf, size_t len, int flag = 0);
+        io_result<size_t> try_write_some(const char* buf, size_t len, int flag = 0);
+
+        /* Reads until `len` bytes are read or the peer closes the connection.
+         * Returns the number of bytes read, which is less than `len` only if
+         * the connection was closed.
+         */
+        io_result<size_t> try_read(char* buf, size_t len, int flag = 0);
+
+        /* Writes `len` bytes, returns `len` on success. */
+        io_result<size_t> try_write(const char* buf, size_t len, int flag = 0);
+
+        /* The CPU that processed the last packet received on the connection
+         * (SO_INCOMING_CPU). Useful to hand a freshly accepted connection to
+         * the worker running on that CPU. Fails with
+         * socket_error::operation_no_supported where the option is missing.
+         */
+        io_result<int> incoming_cpu();
+
+        /* Connects the socket, which must be created but not connected, to
+         * `ep` and writes `data`. With TCP Fast Open (Linux, sendto with
+         * MSG_FASTOPEN) the first bytes travel in the SYN; elsewhere, or
+         * where the kernel has client Fast Open off, this is connect()
+         * followed by try_write(). Returns `len` on success.
+         */
+        io_result<size_t> try_connect_with(const endpoint& ep, const char* data, size_t len,
+                                           bool fast_open = true);
+
+        /* Asynchronous IO, see reactor.
+         * The handler of a read or write is called with an io_result<size_t>:
+         *  - async_read() completes when `len` bytes are read or the peer closes
+         *    the connection, so it reports fewer than `len` bytes only on EOF;
+         *  - async_read_some() completes as soon as some bytes are read;
+         *  - async_write() completes when all `len` bytes are written.
+         * The buffer and the socket must stay valid until the handler runs.
+         */
+        template<typename Handler>
+        void async_read(reactor& r, char* buf, size_t len, Handler handler);
+
+        template<typename Handler>
+        void async_read_some(reactor& r, char* buf, size_t len, Handler handler);
+
+        template<typename Handler>
+        void async_write(reactor& r, const char* buf, size_t len, Handler handler);
+
+        /* Connects to `ep`, creating the socket first if it is bad.
+         * The handler is called with an io_result<void>.
+         */
+        template<typename Handler>
+        void async_connect(reactor& r, const endpoint& ep, Handler handler);
+
         void swap(stream_socket& sock) {
             tcp_socket::swap(sock);
             std::swap(_rwmask, sock._rwmask);
@@ -71,4 +129,170 @@ namespace hy{
     };
 }
 
+namespace hy{
+    /* Asynchronous read/write on a stream_socket. */
+    template<typename Handler>
+    class stream_transfer_op : public reactor_op {
+    public:
+        enum kind { read_all, read_some, write_all };
+
+        stream_transfer_op(reactor& r, stream_socket& s, kind k, char* buf, size_t len, Handler&& h)
+            : _reactor(r), _socket(s), _kind(k), _buf(buf), _len(len), _done(0),
+              _handler(std::move(h)){}
+
+        bool perform() override {
+            while (_done < _len){
+                io_result<size_t> n = _kind == write_all
+                    ? _socket.try_write_some(_buf + _done, _len - _done)
+                    : _socket.try_read_some(_buf + _done, _len - _done);
+                if (!n){
+                    if (n.error() == socket_error::interrupted){
+                        continue;
+                    }
+                    if (socket_error::transient(n.error())){
+                        return false;
+                    }
+                    _error = n.error();
+                    return true;
+                }
+                if (n.value() == 0){
+                    /* EOF for reads, a dead peer for writes */
+                    if (_kind == write_all){
+                        _error = socket_error::broken_pipe;
+                    }
+                    return true;
+                }
+                _done += n.value();
+                if (_kind == read_some){
+                    return true;
+                }
+            }
+            return true;
+        }
+
+        void complete() override {
+            Handler handler(std::move(_handler));
+            io_result<size_t> result = _error
+                ? io_result<size_t>::failure(_error) : io_result<size_t>(_done);
+            /* free the operation first so that the handler can reuse it */
+            _reactor.free_op(this);
+            handler(std::move(result));
+        }
+
+    private:
+        reactor& _reactor;
+        stream_socket& _socket;
+        kind _kind;
+        char* _buf;
+        size_t _len;
+        size_t _done;
+        Handler _handler;
+    };
+
+    /* Asynchronous connect on a stream_socket. */
+    template<typename Handler>
+    class stream_connect_op : public reactor_op {
+    public:
+        stream_connect_op(reactor& r, stream_socket& s, const endpoint& ep, Handler&& h)
+            : _reactor(r), _socket(s), _name(ep), _started(false),
+              _handler(std::move(h)){}
+
+        bool perform() override {
+            int fd = _socket.native_handle();
+            if (!_started){
+                _started = true;
+                auto addr = _name.getaddr();
+                if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0){
+                    return true;
+                }
+                int error = socket_error::last();
+                if (error == socket_error::in_progress || error == socket_error::would_block){
+                    return false;
+                }
+                _error = error;
+                return true;
+            }
+
+            int error = 0;
+            socklen_t len = sizeof(error);
+            if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, (char*)&error, &len)){
+                _error = socket_error::last();
+                return true;
+            }
+            if (error){
+#ifdef WIN32
+                error -= WSABASEERR;
+#endif
+                _error = error;
+                return true;
+            }
+
+            /* a socket may report writable before the handshake is done */
+            sockaddr_in peer;
+            socklen_t peer_len = sizeof(peer);
+            if (::getpeername(fd, (sockaddr*)&peer, &peer_len)){
+                error = socket_error::last();
+                if (error == socket_error::not_connected){
+                    return false;
+                }
+                _error = error;
+            }
+            return true;
+        }
+
+        void complete() override {
+            Handler handler(std::move(_handler));
+            io_result<void> result = _error
+                ? io_result<void>::failure(_error) : io_result<void>();
+            _reactor.free_op(this);
+            handler(std::move(result));
+        }
+
+    private:
+        reactor& _reactor;
+        stream_socket& _socket;
+        endpoint _name;
+        bool _started;
+        Handler _handler;
+    };
+
+    template<typename Handler>
+    void stream_socket::async_read(reactor& r, char* buf, size_t len, Handler handler){
+        typedef stream_transfer_op<Handler> op;
+        r.start(native_handle(), reactor::read_queue,
+                r.make_op<op>(r, *this, op::read_all, buf, len, std::move(handler)));
+    }
+
+    template<typename Handler>
+    void stream_socket::async_read_some(reactor& r, char* buf, size_t len, Handler handler){
+        typedef stream_transfer_op<Handler> op;
+        r.start(native_handle(), reactor::read_queue,
+                r.make_op<op>(r, *this, op::read_some, buf, len, std::move(handler)));
+    }
+
+    template<typename Handler>
+    void stream_socket::async_write(reactor& r, const char* buf, size_t len, Handler handler){
+        typedef stream_transfer_op<Handler> op;
+        r.start(native_handle(), reactor::write_queue,
+                r.make_op<op>(r, *this, op::write_all, const_cast<char*>(buf), len,
+                              std::move(handler)));
+    }
+
+    template<typename Handler>
+    void stream_socket::async_connect(reactor& r, const endpoint& ep, Handler handler){
+        typedef stream_connect_op<Handler> op;
+        op* o = r.make_op<op>(r, *this, ep, std::move(handler));
+        if (bad()){
+            auto s = tcp_socket::try_new_socket();
+            if (!s){
+                o->abort(s.error());
+                r.complete(o);
+                return;
+            }
+            *this = stream_socket(std::move(s.value()), readable | writable);
+        }
+        r.start(native_handle(), reactor::write_queue, o);
+    }
+}
+
 IMPLEMENT_STD_SWAP(hy::stream_socket)
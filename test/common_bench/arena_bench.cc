@@ -0,0 +1,100 @@
+#include <hydrogen/common/arena.h>
+#include <hydrogen/common/stdext.h>
+#include <hydrogen/common/string.h>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "inputs.h"
+using namespace hy;
+
+/* std::allocator that counts its allocations, to compare the heap
+ * allocations of parsing a request with and without an arena.
+ */
+static size_t heap_allocations = 0;
+
+template<typename T>
+struct counting_allocator : std::allocator<T> {
+    template<typename U>
+    struct rebind {
+        typedef counting_allocator<U> other;
+    };
+
+    counting_allocator(){}
+
+    template<typename U>
+    counting_allocator(const counting_allocator<U>&){}
+
+    T* allocate(size_t n){
+        ++heap_allocations;
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+template<typename T, typename U>
+inline bool operator== (const counting_allocator<T>&, const counting_allocator<U>&){ return true; }
+template<typename T, typename U>
+inline bool operator!= (const counting_allocator<T>&, const counting_allocator<U>&){ return false; }
+
+typedef std::vector<string, counting_allocator<string>> counted_strings;
+typedef std::vector<keyval, counting_allocator<keyval>> counted_fields;
+typedef char_string<counting_allocator<char>> counted_string;
+
+/* The HTTP header split of string_tests.cc, over a full request head:
+ * lines, name/value pairs, a copy of the target and a log line.
+ */
+template<typename Strings, typename Fields, typename String>
+static size_t parse_request(const string& req, Strings& lines, Fields& fields, String& target, String& log){
+    req.split(lines, "\r\n");
+    for (size_t i = 1; i < lines.size(); ++i){
+        fields.push_back(lines[i].split_kv(':'));
+    }
+    const string& line = lines[0];
+    auto first = line.split_n<3>(' ');
+    target.assign(first[1].buffer(), first[1].length());
+    format_to(log, "{} {} {} headers", first[0], first[1], fields.size());
+    return lines.size() + target.size() + log.size();
+}
+
+void arena_bench(bench::runner& runner) {
+    const std::string& text = bench::http_request();
+    const string req(text.c_str(), text.length());
+
+    auto heap = [&]{
+        counted_strings lines;
+        counted_fields fields;
+        counted_string target, log;
+        bench::do_not_optimize(parse_request(req, lines, fields, target, log));
+    };
+
+    arena a;
+    auto pooled = [&]{
+        {
+            arena_strings lines(a);
+            arena_vector<keyval> fields(a);
+            arena_string target(a), log(a);
+            bench::do_not_optimize(parse_request(req, lines, fields, target, log));
+        }
+        a.reset();
+    };
+
+    if (runner.enabled("arena/request/allocations")){
+        const int requests = 1000;
+        heap_allocations = 0;
+        for (int i = 0; i < requests; ++i){
+            heap();
+        }
+        double before = (double)heap_allocations / requests;
+        pooled();
+        size_t chunks = a.chunks();
+        for (int i = 0; i < requests; ++i){
+            pooled();
+        }
+        double after = (double)(a.chunks() - chunks) / requests;
+        runner.record("arena/request/allocations", { { "heap_per_request", before }, { "arena_per_request", after },
+                                                     { "arena_chunks", (double)a.chunks() } });
+    }
+
+    runner.run("arena/request/heap", 1, text.length(), heap);
+    runner.run("arena/request/arena", 1, text.length(), pooled);
+}
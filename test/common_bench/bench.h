@@ -0,0 +1,272 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/* A small microbenchmark harness.
+ *
+ * Every benchmark is a callable that performs `ops` operations per call. The
+ * harness warms it up, calibrates the number of calls so that one repetition
+ * runs for about `min_time_ms`, and then times `repetitions` repetitions with
+ * both the steady clock and the time stamp counter. When the kernel allows it,
+ * hardware counters are read through perf_event_open as well.
+ *
+ * Results are printed as one JSON object per line (JSON Lines), so successive
+ * runs can be diffed or loaded by scripts directly.
+ */
+namespace bench {
+    /* Prevents the compiler from optimizing away `value`. */
+    template<typename T>
+    inline void do_not_optimize(const T& value){
+#if defined(__GNUC__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+#endif
+    }
+
+    /* Reads the time stamp counter, or 0 where there is none. */
+    inline uint64_t ticks(){
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    inline uint64_t now_ns(){
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /* Hardware counters (cycles, instructions, branch and cache misses) read as
+     * one perf_event group. available() is false if the kernel refuses.
+     */
+    class perf_counters {
+    public:
+        static const int count = 4;
+
+        explicit perf_counters(bool enable = true) : _leader(-1){
+#if defined(__linux__)
+            if (!enable){
+                return;
+            }
+            const uint64_t configs[count] = {
+                PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+            };
+            for (int i = 0; i < count; ++i){
+                perf_event_attr attr;
+                memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = configs[i];
+                attr.disabled = (i == 0);
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP;
+                int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, _leader, 0);
+                if (fd < 0){
+                    close_all();
+                    return;
+                }
+                _fds.push_back(fd);
+                if (i == 0){
+                    _leader = fd;
+                }
+            }
+#else
+            (void)enable;
+#endif
+        }
+
+        ~perf_counters(){ close_all(); }
+
+        bool available() const { return _leader >= 0; }
+
+        static const char* name(int i){
+            static const char* names[count] = {
+                "cycles", "instructions", "branch_misses", "cache_misses"
+            };
+            return names[i];
+        }
+
+        void start(){
+#if defined(__linux__)
+            if (available()){
+                ioctl(_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                ioctl(_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            }
+#endif
+        }
+
+        /* Stops counting and stores the counter values into `values`. */
+        bool stop(uint64_t (&values)[count]){
+#if defined(__linux__)
+            if (available()){
+                ioctl(_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+                uint64_t buf[count + 1];
+                if (::read(_leader, buf, sizeof(buf)) == (ssize_t)sizeof(buf)){
+                    std::copy(buf + 1, buf + 1 + count, values);
+                    return true;
+                }
+            }
+#endif
+            (void)values;
+            return false;
+        }
+
+    private:
+        perf_counters(const perf_counters&);
+        perf_counters& operator=(const perf_counters&);
+
+        void close_all(){
+#if defined(__linux__)
+            for (size_t i = 0; i < _fds.size(); ++i){
+                ::close(_fds[i]);
+            }
+#endif
+            _fds.clear();
+            _leader = -1;
+        }
+
+        int _leader;
+        std::vector<int> _fds;
+    };
+
+    struct options {
+        options() : warmup_ms(50), min_time_ms(20), repetitions(10), counters(true), out(stdout){}
+
+        unsigned warmup_ms;
+        unsigned min_time_ms;
+        unsigned repetitions;
+        bool counters;
+        /* only run benchmarks whose name contains `filter` */
+        std::string filter;
+        FILE* out;
+    };
+
+    /* runner times benchmarks and prints one JSON line per benchmark. */
+    class runner {
+    public:
+        explicit runner(const options& opt) : _opt(opt), _counters(opt.counters){}
+
+        /* Benchmarks `fn`, which performs `ops` operations over `bytes` bytes of
+         * input per call. `bytes` may be 0 when throughput is meaningless.
+         */
+        template<typename Fn>
+        void run(const char* name, size_t ops, size_t bytes, Fn fn){
+            if (!enabled(name)){
+                return;
+            }
+
+            /* warm up caches, branch predictors and the CPU clock */
+            uint64_t calls = 0;
+            uint64_t begin = now_ns();
+            uint64_t warmup_ns = _opt.warmup_ms * 1000000ull;
+            do {
+                fn();
+                ++calls;
+            } while (now_ns() - begin < warmup_ns);
+
+            /* calibrate the number of calls per repetition */
+            uint64_t per_call = (now_ns() - begin) / calls + 1;
+            uint64_t batch = _opt.min_time_ms * 1000000ull / per_call + 1;
+
+            std::vector<double> ns, cycles;
+            uint64_t totals[perf_counters::count] = { 0 };
+            bool counted = _counters.available();
+            for (unsigned r = 0; r < _opt.repetitions; ++r){
+                uint64_t values[perf_counters::count] = { 0 };
+                _counters.start();
+                uint64_t t0 = now_ns();
+                uint64_t c0 = ticks();
+                for (uint64_t i = 0; i < batch; ++i){
+                    fn();
+                }
+                uint64_t c1 = ticks();
+                uint64_t t1 = now_ns();
+                counted = _counters.stop(values) && counted;
+                for (int k = 0; k < perf_counters::count; ++k){
+                    totals[k] += values[k];
+                }
+
+                double n = (double)batch * ops;
+                ns.push_back((t1 - t0) / n);
+                cycles.push_back((c1 - c0) / n);
+            }
+
+            report(name, batch * ops, bytes, ops, ns, cycles, counted ? totals : nullptr);
+        }
+
+        /* Prints a JSON line of measured `fields`, for benchmarks that take
+         * their own measurements (e.g. latency percentiles).
+         */
+        void record(const char* name, const std::vector<std::pair<const char*, double>>& fields){
+            if (!enabled(name)){
+                return;
+            }
+            FILE* out = _opt.out;
+            fprintf(out, "{\"name\": \"%s\"", name);
+            for (size_t i = 0; i < fields.size(); ++i){
+                fprintf(out, ", \"%s\": %.3f", fields[i].first, fields[i].second);
+            }
+            fprintf(out, "}\n");
+            fflush(out);
+        }
+
+        bool enabled(const char* name) const {
+            return _opt.filter.empty() || strstr(name, _opt.filter.c_str());
+        }
+
+    private:
+        void report(const char* name, uint64_t iterations, size_t bytes, size_t ops,
+                    std::vector<double>& ns, std::vector<double>& cycles,
+                    const uint64_t* totals){
+            std::sort(ns.begin(), ns.end());
+            std::sort(cycles.begin(), cycles.end());
+            double median = ns[ns.size() / 2];
+
+            FILE* out = _opt.out;
+            fprintf(out, "{\"name\": \"%s\", \"iterations\": %llu, \"repetitions\": %u, "
+                         "\"ns_per_op\": %.3f, \"ns_per_op_min\": %.3f, \"ns_per_op_max\": %.3f, "
+                         "\"tsc_per_op\": %.3f",
+                    name, (unsigned long long)iterations, (unsigned)ns.size(),
+                    median, ns.front(), ns.back(), cycles[cycles.size() / 2]);
+            if (bytes){
+                /* bytes per op over ns per op is GB/s */
+                fprintf(out, ", \"gb_per_sec\": %.3f", (double)bytes / ops / median);
+            }
+            if (totals){
+                double n = (double)iterations * ns.size();
+                for (int k = 0; k < perf_counters::count; ++k){
+                    fprintf(out, ", \"%s_per_op\": %.3f", perf_counters::name(k), totals[k] / n);
+                }
+            }
+            fprintf(out, "}\n");
+            fflush(out);
+        }
+
+        options _opt;
+        perf_counters _counters;
+    };
+}
@@ -0,0 +1,64 @@
+#include <hydrogen/common/charconv.h>
+#include <hydrogen/common/stdext.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+using namespace hy;
+
+/* to_chars and format_to against snprintf, on a spread of magnitudes. */
+void charconv_bench(bench::runner& runner) {
+    std::vector<long long> ints;
+    std::vector<double> doubles;
+    unsigned long long seed = 1;
+    for (int i = 0; i < 1024; ++i){
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        ints.push_back((long long)(seed >> (seed & 63)) * (i & 1 ? -1 : 1));
+        /* prices and latencies: a few decimals, and full precision */
+        doubles.push_back(i & 1 ? (double)(seed % 1000000) / 100 : (double)(seed >> 11) / (1ull << 40));
+    }
+    char buf[64];
+
+    runner.run("charconv/to_chars/int64", ints.size(), 0, [&]{
+        for (size_t i = 0; i < ints.size(); ++i){
+            bench::do_not_optimize(to_chars(buf, buf + sizeof(buf), ints[i]).ptr);
+        }
+    });
+
+    runner.run("charconv/snprintf/int64", ints.size(), 0, [&]{
+        for (size_t i = 0; i < ints.size(); ++i){
+            bench::do_not_optimize(snprintf(buf, sizeof(buf), "%lld", ints[i]));
+        }
+    });
+
+    runner.run("charconv/to_chars/double", doubles.size(), 0, [&]{
+        for (size_t i = 0; i < doubles.size(); ++i){
+            bench::do_not_optimize(to_chars(buf, buf + sizeof(buf), doubles[i]).ptr);
+        }
+    });
+
+    /* %.17g round-trips too, but is not shortest */
+    runner.run("charconv/snprintf/double", doubles.size(), 0, [&]{
+        for (size_t i = 0; i < doubles.size(); ++i){
+            bench::do_not_optimize(snprintf(buf, sizeof(buf), "%.17g", doubles[i]));
+        }
+    });
+
+    /* a status line, as a response encoder writes one */
+    std::string out;
+    runner.run("charconv/format_to/status_line", ints.size(), 0, [&]{
+        for (size_t i = 0; i < ints.size(); ++i){
+            out.clear();
+            format_to(out, "id={} price={} qty={}", ints[i], doubles[i], (int)i);
+            bench::do_not_optimize(out.data());
+        }
+    });
+
+    runner.run("charconv/format/status_line", ints.size(), 0, [&]{
+        for (size_t i = 0; i < ints.size(); ++i){
+            format(out, "id=%lld price=%.17g qty=%d", ints[i], doubles[i], (int)i);
+            bench::do_not_optimize(out.data());
+        }
+    });
+}
@@ -0,0 +1,108 @@
+#include <hydrogen/common/encoding.h>
+#include <hydrogen/common/simd.h>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "inputs.h"
+using namespace hy;
+
+/* The usual scalar base64 found in third-party code: a character at a
+ * time, appended to a std::string, with a find() per decoded character.
+ */
+static const std::string chars64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static std::string std_base64_encode(const std::string& in){
+    std::string out;
+    int val = 0, bits = -6;
+    for (unsigned char c : in){
+        val = (val << 8) + c;
+        bits += 8;
+        while (bits >= 0){
+            out.push_back(chars64[(val >> bits) & 0x3f]);
+            bits -= 6;
+        }
+    }
+    if (bits > -6){
+        out.push_back(chars64[((val << 8) >> (bits + 8)) & 0x3f]);
+    }
+    while (out.size() % 4){
+        out.push_back('=');
+    }
+    return out;
+}
+
+static std::string std_base64_decode(const std::string& in){
+    std::string out;
+    int val = 0, bits = -8;
+    for (unsigned char c : in){
+        size_t v = chars64.find(c);
+        if (v == std::string::npos){
+            break;
+        }
+        val = (val << 6) + (int)v;
+        bits += 6;
+        if (bits >= 0){
+            out.push_back(char((val >> bits) & 0xff));
+            bits -= 8;
+        }
+    }
+    return out;
+}
+
+void encoding_bench(bench::runner& runner) {
+    std::string data;
+    unsigned seed = 5;
+    while (data.size() < (1 << 20)){
+        seed = seed * 1103515245 + 12345;
+        data += (char)(seed >> 16);
+    }
+    std::vector<char> text(base64_encoded_length(data.size()) + 1), bytes(data.size() + 1);
+
+    /* encode and decode 64B to 1MB at each instruction set the CPU has;
+     * throughput is of the bytes, not of the text
+     */
+    const simd::isa best = simd::detect();
+    const struct { simd::isa level; const char* name; } levels[] = {
+        { simd::isa::none, "scalar" }, { simd::isa::sse2, "sse2" }, { simd::isa::avx2, "avx2" }
+    };
+    const size_t sizes[] = { 64, 4096, 1 << 20 };
+    for (auto& l : levels){
+        if (simd::use(l.level) != l.level){
+            continue;
+        }
+        for (size_t size : sizes){
+            const string in(data.c_str(), size);
+            char* tb = text.data();
+            char* te = tb + text.size();
+            char* bb = bytes.data();
+            char* be = bb + bytes.size();
+            const string b64(tb, base64_encode(tb, te, in).ptr);
+            std::vector<char> hex(size * 2);
+            hex_encode(hex.data(), hex.data() + hex.size(), in);
+            const string b16(hex.data(), hex.size());
+            std::vector<char> out(size * 2);
+
+            char name[64];
+            snprintf(name, sizeof(name), "encoding/base64_encode/%s/%uB", l.name, (unsigned)size);
+            runner.run(name, 1, size, [&]{ bench::do_not_optimize(base64_encode(out.data(), out.data() + out.size(), in).ptr); });
+            snprintf(name, sizeof(name), "encoding/base64_decode/%s/%uB", l.name, (unsigned)size);
+            runner.run(name, 1, size, [&]{ bench::do_not_optimize(base64_decode(bb, be, b64).ptr); });
+            snprintf(name, sizeof(name), "encoding/hex_encode/%s/%uB", l.name, (unsigned)size);
+            runner.run(name, 1, size, [&]{ bench::do_not_optimize(hex_encode(out.data(), out.data() + out.size(), in).ptr); });
+            snprintf(name, sizeof(name), "encoding/hex_decode/%s/%uB", l.name, (unsigned)size);
+            runner.run(name, 1, size, [&]{ bench::do_not_optimize(hex_decode(bb, be, b16).ptr); });
+        }
+    }
+    simd::use(best);
+
+    for (size_t size : sizes){
+        const std::string in = data.substr(0, size);
+        const std::string b64 = std_base64_encode(in);
+        char name[64];
+        snprintf(name, sizeof(name), "encoding/base64_encode/std_string/%uB", (unsigned)size);
+        runner.run(name, 1, size, [&]{ bench::do_not_optimize(std_base64_encode(in)); });
+        snprintf(name, sizeof(name), "encoding/base64_decode/std_string/%uB", (unsigned)size);
+        runner.run(name, 1, size, [&]{ bench::do_not_optimize(std_base64_decode(b64)); });
+    }
+}
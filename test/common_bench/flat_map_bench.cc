@@ -0,0 +1,109 @@
+#include <hydrogen/common/flat_map.h>
+#include <hydrogen/common/string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bench.h"
+#include "inputs.h"
+using namespace hy;
+
+/* Lookups of hy::string slices in tables keyed by strings: flat_map
+ * against std::unordered_map, which needs a std::string made for each
+ * lookup, or a table keyed by the views themselves.
+ */
+template<typename Map, typename Key>
+static void lookup_bench(bench::runner& runner, const char* name, const Map& map,
+                         const std::vector<string>& keys, Key make_key){
+    runner.run(name, keys.size(), 0, [&]{
+        int sum = 0;
+        for (size_t i = 0; i < keys.size(); ++i){
+            auto it = map.find(make_key(keys[i]));
+            sum += it == map.end() ? 0 : it->second;
+        }
+        bench::do_not_optimize(sum);
+    });
+}
+
+static void string_lookups(bench::runner& runner, const char* what,
+                           const std::vector<std::string>& table, const std::vector<string>& keys){
+    std::unordered_map<std::string, int> by_std;
+    std::unordered_map<string, int> by_view;
+    string_map<int> flat;
+    for (size_t i = 0; i < table.size(); ++i){
+        by_std[table[i]] = (int)i;
+        by_view[string(table[i].c_str(), table[i].size())] = (int)i;
+        flat[table[i]] = (int)i;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "flat_map/find/%s", what);
+    lookup_bench(runner, name, flat, keys, [](const string& s){ return s; });
+    snprintf(name, sizeof(name), "flat_map/std_string_find/%s", what);
+    lookup_bench(runner, name, by_std, keys, [](const string& s){ return s.std_string(); });
+    snprintf(name, sizeof(name), "flat_map/std_view_find/%s", what);
+    lookup_bench(runner, name, by_view, keys, [](const string& s){ return s; });
+}
+
+void flat_map_bench(bench::runner& runner) {
+    /* header names of a request, against a table of known ones */
+    const std::vector<std::string> known = {
+        "Host", "User-Agent", "Accept", "Accept-Language", "Accept-Encoding", "Connection",
+        "Upgrade-Insecure-Requests", "Cache-Control", "Content-Length", "Content-Type",
+        "Authorization", "Referer", "Origin", "If-None-Match", "If-Modified-Since", "Range",
+        "Pragma", "TE", "Via", "X-Forwarded-For", "X-Forwarded-Proto", "X-Request-Id"
+    };
+    const std::string& req = bench::http_request();
+    std::vector<string> names;
+    for (auto& line : string(req.c_str(), req.length()).split("\r\n")){
+        if (line.contains(':')){
+            names.push_back(line.split_kv(':').first);
+        }
+    }
+    string_lookups(runner, "header_name", known, names);
+
+    /* 1000 routes, each looked up from a slice of a path */
+    std::vector<std::string> routes;
+    std::string paths;
+    for (int i = 0; i < 1000; ++i){
+        routes.push_back("/api/v" + std::to_string(i % 3) + "/resource" + std::to_string(i) + "/items");
+        paths += routes.back() + "?id=" + std::to_string(i) + "\n";
+    }
+    std::vector<string> slices;
+    for (auto& line : string(paths.c_str(), paths.size()).split('\n')){
+        slices.push_back(line.split_kv('?').first);
+    }
+    string_lookups(runner, "route_1000", routes, slices);
+
+    /* integer keys: building then probing a table of 100k */
+    std::vector<unsigned long long> ids;
+    unsigned long long seed = 1;
+    for (int i = 0; i < 100000; ++i){
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        ids.push_back(seed >> 20);
+    }
+
+    runner.run("flat_map/build_find/u64_100k", ids.size(), 0, [&]{
+        flat_map<unsigned long long, int> m;
+        for (size_t i = 0; i < ids.size(); ++i){
+            m[ids[i]] = (int)i;
+        }
+        int sum = 0;
+        for (size_t i = 0; i < ids.size(); ++i){
+            sum += m.find(ids[i])->second;
+        }
+        bench::do_not_optimize(sum);
+    });
+
+    runner.run("flat_map/std_build_find/u64_100k", ids.size(), 0, [&]{
+        std::unordered_map<unsigned long long, int> m;
+        for (size_t i = 0; i < ids.size(); ++i){
+            m[ids[i]] = (int)i;
+        }
+        int sum = 0;
+        for (size_t i = 0; i < ids.size(); ++i){
+            sum += m.find(ids[i])->second;
+        }
+        bench::do_not_optimize(sum);
+    });
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <random>
+
+/* Representative inputs shared by the benchmarks. All generators are
+ * deterministic so numbers from different runs are comparable.
+ */
+namespace bench {
+    /* A typical browser request head, ~500 bytes. */
+    inline const std::string& http_request(){
+        static const std::string req =
+            "GET /api/v1/items?id=12345&fields=name,price HTTP/1.1\r\n"
+            "Host: www.example.com\r\n"
+            "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0\r\n"
+            "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+            "Accept-Language: en-US,en;q=0.5\r\n"
+            "Accept-Encoding: gzip, deflate, br\r\n"
+            "Connection: keep-alive\r\n"
+            "Cookie: session=4f2a9c1e7b3d; theme=dark; lang=en\r\n"
+            "Upgrade-Insecure-Requests: 1\r\n"
+            "Cache-Control: max-age=0\r\n"
+            "Content-Length: 348\r\n"
+            "\r\n";
+        return req;
+    }
+
+    /* `rows` CSV rows of 8 mixed integer/decimal/text columns. */
+    inline std::string csv_rows(size_t rows){
+        std::mt19937 rng(42);
+        auto next = [&](unsigned m){ return (unsigned)(rng() % m); };
+        std::string out;
+        char line[160];
+        for (size_t i = 0; i < rows; ++i){
+            snprintf(line, sizeof(line), "%u,%d,%.4f,%u,item-%u,%d,%.2f,%u\n",
+                     (unsigned)i, (int)next(2000000) - 1000000,
+                     next(10000000) / 1000.0, next(100), next(100000),
+                     (int)next(200) - 100, next(100000) / 100.0, (unsigned)rng());
+            out += line;
+        }
+        return out;
+    }
+
+    /* About `bytes` bytes of access-log style lines. */
+    inline std::string log_lines(size_t bytes){
+        static const char* paths[] = {
+            "/", "/index.html", "/api/v1/items", "/static/js/app.min.js",
+            "/images/logo.png", "/api/v1/users/login", "/favicon.ico"
+        };
+        std::mt19937 rng(7);
+        auto next = [&](unsigned m){ return (unsigned)(rng() % m); };
+        std::string out;
+        out.reserve(bytes + 256);
+        char line[256];
+        while (out.size() < bytes){
+            snprintf(line, sizeof(line),
+                     "10.%u.%u.%u - - [19/Oct/2026:12:%02u:%02u +0000] \"GET %s HTTP/1.1\" %u %u \"-\" \"curl/8.4.0\"\n",
+                     next(256), next(256), next(256), next(60), next(60),
+                     paths[next(sizeof(paths) / sizeof(paths[0]))],
+                     next(8) ? 200u : 404u, next(50000));
+            out += line;
+        }
+        return out;
+    }
+}
@@ -0,0 +1,94 @@
+#include <hydrogen/common/intern.h>
+#include <hydrogen/common/string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "inputs.h"
+using namespace hy;
+
+/* Resolving header names of a request to the known one they match: by
+ * comparing against each known name, or by interning them once and
+ * looking up an ID.
+ */
+void intern_bench(bench::runner& runner) {
+    const std::vector<std::string> known = {
+        "Host", "User-Agent", "Accept", "Accept-Language", "Accept-Encoding", "Connection",
+        "Upgrade-Insecure-Requests", "Cache-Control", "Content-Length", "Content-Type",
+        "Authorization", "Referer", "Origin", "If-None-Match", "If-Modified-Since", "Range",
+        "Pragma", "TE", "Via", "X-Forwarded-For", "X-Forwarded-Proto", "X-Request-Id"
+    };
+    const std::string& req = bench::http_request();
+    std::vector<string> names;
+    for (auto& line : string(req.c_str(), req.length()).split("\r\n")){
+        if (line.contains(':')){
+            names.push_back(line.split_kv(':').first);
+        }
+    }
+
+    intern_table table;
+    table.seed(known.begin(), known.end());
+
+    runner.run("intern/match/equals", names.size(), 0, [&]{
+        size_t sum = 0;
+        for (size_t i = 0; i < names.size(); ++i){
+            for (size_t k = 0; k < known.size(); ++k){
+                if (names[i].equals(string(known[k].c_str(), known[k].size()))){
+                    sum += k;
+                    break;
+                }
+            }
+        }
+        bench::do_not_optimize(sum);
+    });
+
+    runner.run("intern/match/find", names.size(), 0, [&]{
+        size_t sum = 0;
+        for (size_t i = 0; i < names.size(); ++i){
+            sum += table.find(names[i]);
+        }
+        bench::do_not_optimize(sum);
+    });
+
+    /* once interned, tokens compare as integers */
+    std::vector<uint32_t> ids;
+    for (size_t i = 0; i < names.size(); ++i){
+        ids.push_back(table.intern(names[i]));
+    }
+    uint32_t content_length = table.find("Content-Length");
+    runner.run("intern/compare/id", ids.size(), 0, [&]{
+        size_t n = 0;
+        for (size_t i = 0; i < ids.size(); ++i){
+            n += ids[i] == content_length;
+        }
+        bench::do_not_optimize(n);
+    });
+
+    runner.run("intern/compare/equals", names.size(), 0, [&]{
+        size_t n = 0;
+        for (size_t i = 0; i < names.size(); ++i){
+            n += names[i].equals("Content-Length");
+        }
+        bench::do_not_optimize(n);
+    });
+
+    /* lookups from 4 threads at once, with no lock to contend on */
+    runner.run("intern/find/4_threads", names.size() * 4 * 1000, 0, [&]{
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t){
+            threads.emplace_back([&]{
+                size_t sum = 0;
+                for (int round = 0; round < 1000; ++round){
+                    for (size_t i = 0; i < names.size(); ++i){
+                        sum += table.find(names[i]);
+                    }
+                }
+                bench::do_not_optimize(sum);
+            });
+        }
+        for (auto& t : threads){
+            t.join();
+        }
+    });
+}
@@ -0,0 +1,65 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "bench.h"
+
+#define BENCH(mod) do { void mod##_bench(bench::runner&);\
+    mod##_bench(runner);\
+  } while (false)
+
+/* common_bench [--filter NAME] [--repetitions N] [--min-time MS] [--warmup MS]
+ *              [--no-counters] [--out FILE]
+ */
+int main(int argc, char* argv[]) {
+    bench::options opt;
+    for (int i = 1; i < argc; ++i){
+        const char* arg = argv[i];
+        const char* val = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!strcmp(arg, "--no-counters")){
+            opt.counters = false;
+            continue;
+        }
+        if (!val){
+            std::cerr << "missing value for " << arg << '\n';
+            return 1;
+        }
+        ++i;
+        if (!strcmp(arg, "--filter")){ opt.filter = val; }
+        else if (!strcmp(arg, "--repetitions")){ opt.repetitions = atoi(val); }
+        else if (!strcmp(arg, "--min-time")){ opt.min_time_ms = atoi(val); }
+        else if (!strcmp(arg, "--warmup")){ opt.warmup_ms = atoi(val); }
+        else if (!strcmp(arg, "--out")){
+            opt.out = fopen(val, "w");
+            if (!opt.out){
+                std::cerr << "failed to open " << val << '\n';
+                return 1;
+            }
+        }
+        else {
+            std::cerr << "unknown option " << arg << '\n';
+            return 1;
+        }
+    }
+    if (opt.repetitions == 0){
+        opt.repetitions = 1;
+    }
+
+    bench::runner runner(opt);
+    BENCH(string);
+    BENCH(charconv);
+    BENCH(flat_map);
+    BENCH(intern);
+    BENCH(arena);
+    BENCH(encoding);
+    BENCH(mapped_file);
+    BENCH(queue_buffer);
+    BENCH(thread_pool);
+    BENCH(mpmc_queue);
+
+    if (opt.out != stdout){
+        fclose(opt.out);
+    }
+    return 0;
+}
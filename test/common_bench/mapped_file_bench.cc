@@ -0,0 +1,88 @@
+#include <hydrogen/common/mapped_file.h>
+#include <hydrogen/common/string.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "bench.h"
+#include "inputs.h"
+using namespace hy;
+
+/* What a log scan does with each line: look at it once. */
+static size_t scan(const string& line){
+    return line.length() + (line.empty() ? 0 : (unsigned char)line[0]);
+}
+
+void mapped_file_bench(bench::runner& runner) {
+    /* in memory: the line iterators alone */
+    const std::string log = bench::log_lines(16 << 20);
+    const string logv(log.c_str(), log.length());
+    const size_t count = logv.split('\n').size();
+
+    runner.run("mapped_file/lines/16mb", count, log.length(), [&]{
+        size_t sum = 0;
+        for (auto& line : logv.lines()){
+            sum += scan(line);
+        }
+        bench::do_not_optimize(sum);
+    });
+
+    runner.run("mapped_file/split_view/16mb", count, log.length(), [&]{
+        size_t sum = 0;
+        for (auto& line : logv.split_view('\n')){
+            sum += scan(line);
+        }
+        bench::do_not_optimize(sum);
+    });
+
+    /* from a file in the page cache: mapped, read in blocks, and the
+     * std::getline baseline that copies each line
+     */
+    const std::string big = bench::log_lines(64 << 20);
+    const size_t big_count = string(big.c_str(), big.length()).split('\n').size();
+    char path[] = "/tmp/hy_mapped_file_bench_XXXXXX";
+#ifdef WIN32
+    FILE* f = fopen(_mktemp(path), "wb");
+#else
+    ::close(::mkstemp(path));
+    FILE* f = fopen(path, "wb");
+#endif
+    if (!f){
+        return;
+    }
+    fwrite(big.data(), 1, big.length(), f);
+    fclose(f);
+
+    runner.run("mapped_file/mapped/64mb", big_count, big.length(), [&]{
+        mapped_file file(path);
+        size_t sum = 0;
+        for (auto& line : file.content().lines()){
+            sum += scan(line);
+        }
+        bench::do_not_optimize(sum);
+    });
+
+    runner.run("mapped_file/file_reader/64mb", big_count, big.length(), [&]{
+        file_reader reader(path);
+        size_t sum = 0;
+        string block;
+        while (reader.read(block)){
+            for (auto& line : block.lines()){
+                sum += scan(line);
+            }
+        }
+        bench::do_not_optimize(sum);
+    });
+
+    runner.run("mapped_file/std_getline/64mb", big_count, big.length(), [&]{
+        std::ifstream in(path, std::ios::binary);
+        size_t sum = 0;
+        std::string line;
+        while (std::getline(in, line)){
+            sum += scan(string(line.c_str(), line.length()));
+        }
+        bench::do_not_optimize(sum);
+    });
+
+    remove(path);
+}
@@ -0,0 +1,91 @@
+#include <hydrogen/common/mpmc_queue.h>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+using namespace hy;
+
+/* The baseline: std::queue under a mutex. */
+class LockedQueue {
+public:
+    void push(uint64_t v){
+        std::lock_guard<std::mutex> lock(_lock);
+        _queue.push(v);
+    }
+
+    bool try_pop(uint64_t& v){
+        std::lock_guard<std::mutex> lock(_lock);
+        if (_queue.empty()){
+            return false;
+        }
+        v = _queue.front();
+        _queue.pop();
+        return true;
+    }
+
+private:
+    std::mutex _lock;
+    std::queue<uint64_t> _queue;
+};
+
+/* `threads` threads each push and pop `pairs` times in turn; one op is one
+ * push/pop pair. Threads are started per call, which the 4096 pairs per
+ * thread amortize.
+ */
+template<typename Queue>
+static void contend(Queue& q, int threads, size_t pairs){
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t){
+        pool.emplace_back([&q, pairs, t]{
+            uint64_t v = 0, sum = 0;
+            for (size_t i = 0; i < pairs; ++i){
+                q.push((uint64_t)t);
+                while (!q.try_pop(v)){
+                    std::this_thread::yield();
+                }
+                sum += v;
+            }
+            bench::do_not_optimize(sum);
+        });
+    }
+    for (auto& t : pool){
+        t.join();
+    }
+}
+
+void mpmc_queue_bench(bench::runner& runner) {
+    const size_t pairs = 4096;
+    const int counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+    for (int threads : counts){
+        char name[64];
+        mpmc_queue<uint64_t> lockfree(1024);
+        snprintf(name, sizeof(name), "mpmc_queue/push_pop/%dT", threads);
+        runner.run(name, pairs * threads, 0, [&]{ contend(lockfree, threads, pairs); });
+
+        LockedQueue locked;
+        snprintf(name, sizeof(name), "locked_queue/push_pop/%dT", threads);
+        runner.run(name, pairs * threads, 0, [&]{ contend(locked, threads, pairs); });
+    }
+
+    /* 16 pushes, drained with one claim or with 16 */
+    mpmc_queue<uint64_t> q(1024);
+    runner.run("mpmc_queue/pop_bulk/16", 16, 0, [&]{
+        for (uint64_t i = 0; i < 16; ++i){
+            q.try_push(i);
+        }
+        uint64_t out[16];
+        bench::do_not_optimize(q.try_pop_bulk(out, 16));
+    });
+    runner.run("mpmc_queue/pop_single/16", 16, 0, [&]{
+        for (uint64_t i = 0; i < 16; ++i){
+            q.try_push(i);
+        }
+        uint64_t v = 0;
+        for (int i = 0; i < 16; ++i){
+            q.try_pop(v);
+        }
+        bench::do_not_optimize(v);
+    });
+}
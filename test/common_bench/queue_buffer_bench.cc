@@ -0,0 +1,124 @@
+#include <hydrogen/common/queue_buffer.h>
+#include <hydrogen/common/spsc_queue_buffer.h>
+#include <hydrogen/common/mirrored_queue_buffer.h>
+#include <thread>
+#include <atomic>
+
+#include "bench.h"
+#include "inputs.h"
+using namespace hy;
+
+void queue_buffer_bench(bench::runner& runner) {
+    /* push/pop bookkeeping alone */
+    queue_buffer<char> q(4096);
+    runner.run("queue_buffer/push_pop/64B", 1, 0, [&]{
+        q.push(64);
+        q.pop(64);
+        q.trim();
+        bench::do_not_optimize(q.front());
+    });
+
+    /* The socket_stream pattern: refill with 1460-byte segments, consume
+     * 100-byte messages, trim when the tail runs out of room.
+     */
+    const std::string log = bench::log_lines(1460);
+    queue_buffer<char> s(16384);
+    runner.run("queue_buffer/refill_consume/1460B", 1, 1460, [&]{
+        if (s.free() < 1460){
+            s.trim();
+        }
+        memcpy(s.tail(), log.data(), 1460);
+        s.push(1460);
+        while (s.length() >= 100){
+            bench::do_not_optimize(*s.front());
+            s.pop(100);
+        }
+    });
+
+    /* trim() with a large pending partial frame: every refill moves it. */
+    queue_buffer<char> t(65536 + 4096);
+    memset(t.tail(), 'x', 65536);
+    t.push(65536);
+    runner.run("queue_buffer/trim/32KB_pending", 1, 32768, [&]{
+        t.pop(t.length() - 32768);
+        t.trim();
+        t.push(t.free() < 32768 ? t.free() : 32768);
+        bench::do_not_optimize(t.front());
+    });
+
+    /* 64KB frames arriving in 1460-byte reads into a 128KB buffer: the
+     * queue_buffer trims whenever the tail runs out of room, moving the
+     * pending partial frame; the mirrored buffer never moves anything.
+     */
+    queue_buffer<char> f(128 << 10);
+    runner.run("queue_buffer/frames/64KB_in_1460B", 1, 1460, [&]{
+        if (f.free() < 1460){
+            f.trim();
+        }
+        memcpy(f.tail(), log.data(), 1460);
+        f.push(1460);
+        if (f.length() >= (64 << 10)){
+            bench::do_not_optimize(*f.front());
+            f.pop(64 << 10);
+        }
+    });
+    mirrored_queue_buffer m(128 << 10);
+    runner.run("mirrored_queue_buffer/frames/64KB_in_1460B", 1, 1460, [&]{
+        memcpy(m.tail(), log.data(), 1460);
+        m.push(1460);
+        if (m.length() >= (64 << 10)){
+            bench::do_not_optimize(*m.front());
+            m.pop(64 << 10);
+        }
+    });
+
+    /* 8-byte messages from this thread to a consumer thread, committed in
+     * batches of up to 64; one op is one message.
+     */
+    const size_t messages = 1 << 16;
+    spsc_queue_buffer<uint64_t> ring(4096);
+    std::atomic<uint64_t> consumed(0);
+    std::atomic<bool> stop(false);
+    std::thread consumer([&]{
+        uint64_t sum = 0;
+        while (!stop.load(std::memory_order_relaxed)){
+            size_t n = ring.readable();
+            if (n == 0){
+                std::this_thread::yield();
+                continue;
+            }
+            const uint64_t* p = ring.front();
+            for (size_t i = 0; i < n; ++i){
+                sum += p[i];
+            }
+            ring.pop(n);
+            consumed.fetch_add(n, std::memory_order_release);
+        }
+        bench::do_not_optimize(sum);
+    });
+    uint64_t produced = 0;
+    runner.run("spsc_queue_buffer/handoff/8B", messages, messages * 8, [&]{
+        size_t left = messages;
+        while (left){
+            size_t n = ring.writable();
+            if (n == 0){
+                std::this_thread::yield();
+                continue;
+            }
+            n = n < 64 ? n : 64;
+            n = n < left ? n : left;
+            uint64_t* p = ring.tail();
+            for (size_t i = 0; i < n; ++i){
+                p[i] = produced + i;
+            }
+            ring.push(n);
+            produced += n;
+            left -= n;
+        }
+        while (consumed.load(std::memory_order_acquire) != produced){
+            std::this_thread::yield();
+        }
+    });
+    stop = true;
+    consumer.join();
+}
@@ -0,0 +1,293 @@
+#include <hydrogen/common/string.h>
+#include <hydrogen/common/simd.h>
+#include <cctype>
+#include <algorithm>
+
+#include "bench.h"
+#include "inputs.h"
+using namespace hy;
+
+void string_bench(bench::runner& runner) {
+    const std::string& req = bench::http_request();
+    const std::string csv = bench::csv_rows(1000);
+    const std::string log = bench::log_lines(1 << 20);
+
+    const strings headers = string(req.c_str(), req.length()).split("\r\n");
+    const strings rows = string(csv.c_str(), csv.length()).split('\n');
+    const strings lines = string(log.c_str(), log.length()).split('\n');
+    const string logv(log.c_str(), log.length());
+
+    std::vector<keyval> fields;
+    for (size_t i = 1; i < headers.size(); ++i){
+        fields.push_back(headers[i].split_kv(':'));
+    }
+
+    strings cells;
+    for (size_t i = 0; i < rows.size(); ++i){
+        rows[i].split(cells, ',');
+    }
+
+    runner.run("string/find/http_header", headers.size(), req.length(), [&]{
+        for (size_t i = 0; i < headers.size(); ++i){
+            bench::do_not_optimize(headers[i].find(':'));
+        }
+    });
+
+    runner.run("string/find/log_1mb_miss", 1, log.length(), [&]{
+        bench::do_not_optimize(logv.find('\x01'));
+    });
+
+    runner.run("string/rfind/log_line", lines.size(), log.length(), [&]{
+        for (size_t i = 0; i < lines.size(); ++i){
+            bench::do_not_optimize(lines[i].rfind('['));
+        }
+    });
+
+    runner.run("string/search/log_1mb_miss", 1, log.length(), [&]{
+        bench::do_not_optimize(logv.search("\"POST /"));
+    });
+
+    runner.run("string/search/http_header", 1, req.length(), [&]{
+        bench::do_not_optimize(string(req.c_str(), req.length()).search("\r\n\r\n"));
+    });
+
+    strings parts;
+    runner.run("string/split/http_header", 1, req.length(), [&]{
+        parts.clear();
+        string(req.c_str(), req.length()).split(parts, "\r\n");
+        bench::do_not_optimize(parts.data());
+    });
+
+    runner.run("string/split/csv_row", rows.size(), csv.length(), [&]{
+        for (size_t i = 0; i < rows.size(); ++i){
+            parts.clear();
+            rows[i].split(parts, ',');
+            bench::do_not_optimize(parts.data());
+        }
+    });
+
+    runner.run("string/split_view/csv_row", rows.size(), csv.length(), [&]{
+        for (size_t i = 0; i < rows.size(); ++i){
+            size_t n = 0;
+            for (auto& cell : rows[i].split_view(',')){
+                n += cell.length();
+            }
+            bench::do_not_optimize(n);
+        }
+    });
+
+    runner.run("string/split_small/csv_row", rows.size(), csv.length(), [&]{
+        small_vector<string, 8> small;
+        for (size_t i = 0; i < rows.size(); ++i){
+            small.clear();
+            rows[i].split(small, ',');
+            bench::do_not_optimize(small.data());
+        }
+    });
+
+    runner.run("string/split_view/http_header", 1, req.length(), [&]{
+        size_t n = 0;
+        for (auto& line : string(req.c_str(), req.length()).split_view("\r\n")){
+            n += line.length();
+        }
+        bench::do_not_optimize(n);
+    });
+
+    runner.run("string/split_n/csv_row", rows.size(), csv.length(), [&]{
+        std::array<string, 8> p;
+        for (size_t i = 0; i < rows.size(); ++i){
+            rows[i].split_n(',', p);
+            bench::do_not_optimize(p);
+        }
+    });
+
+    runner.run("string/split_kv/http_header", headers.size(), req.length(), [&]{
+        keyval kv;
+        for (size_t i = 0; i < headers.size(); ++i){
+            headers[i].split_kv(':', kv);
+            bench::do_not_optimize(kv);
+        }
+    });
+
+    runner.run("string/trim/header_value", fields.size(), 0, [&]{
+        for (size_t i = 0; i < fields.size(); ++i){
+            string v = fields[i].second;
+            bench::do_not_optimize(v.trim());
+        }
+    });
+
+    /* trim() as it was: isspace() a byte at a time */
+    runner.run("string/trim/header_value/isspace", fields.size(), 0, [&]{
+        for (size_t i = 0; i < fields.size(); ++i){
+            string v = fields[i].second;
+            const char* b = v.begin();
+            const char* e = v.end();
+            while (b < e && isspace(*b)) { ++b; }
+            while (e > b && isspace(e[-1])) { --e; }
+            v = string(b, e);
+            bench::do_not_optimize(v);
+        }
+    });
+
+    /* looking a header up by name, as it may come in any case */
+    std::vector<std::string> lowered;
+    for (size_t i = 0; i < fields.size(); ++i){
+        lowered.push_back(std::string(fields[i].first.length() + 1, '\0'));
+        fields[i].first.to_lower(&lowered.back()[0]);
+        lowered.back().pop_back();
+    }
+    runner.run("string/equals_ignore_case/header_name", fields.size(), 0, [&]{
+        size_t n = 0;
+        for (size_t i = 0; i < fields.size(); ++i){
+            n += fields[i].first.equals_ignore_case(string(lowered[i].c_str(), lowered[i].size()));
+        }
+        bench::do_not_optimize(n);
+    });
+
+    runner.run("string/equals_ignore_case/header_name/tolower", fields.size(), 0, [&]{
+        size_t n = 0;
+        for (size_t i = 0; i < fields.size(); ++i){
+            const string& a = fields[i].first;
+            const std::string& b = lowered[i];
+            bool same = a.length() == b.size();
+            for (size_t k = 0; same && k < b.size(); ++k){
+                same = tolower((unsigned char)a[k]) == tolower((unsigned char)b[k]);
+            }
+            n += same;
+        }
+        bench::do_not_optimize(n);
+    });
+
+    runner.run("string/is_token/header_name", fields.size(), 0, [&]{
+        size_t n = 0;
+        for (size_t i = 0; i < fields.size(); ++i){
+            n += fields[i].first.is_token();
+        }
+        bench::do_not_optimize(n);
+    });
+
+    /* find, rfind and search misses over 16B to 1MB of log text, at each
+     * instruction set the CPU has; "none" is the byte-at-a-time loop.
+     */
+    const simd::isa best = simd::detect();
+    const struct { simd::isa level; const char* name; } levels[] = {
+        { simd::isa::none, "scalar" }, { simd::isa::sse2, "sse2" }, { simd::isa::avx2, "avx2" }
+    };
+    const size_t sizes[] = { 16, 64, 256, 4096, 65536, 1 << 20 };
+
+    /* inputs the class scans go through to the end: blanks, token
+     * characters, text without control characters
+     */
+    const std::string blanks(1 << 20, ' ');
+    std::string tokens, text(log), upper(log);
+    while (tokens.size() < (1 << 20)){
+        tokens += "Accept-Encoding-";
+    }
+    std::replace(text.begin(), text.end(), '\n', ' ');
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](char c){ return (char)toupper((unsigned char)c); });
+    std::vector<char> lower(log.size() + 1);
+    for (auto& l : levels){
+        if (simd::use(l.level) != l.level){
+            continue;
+        }
+        for (size_t size : sizes){
+            const string v(log.c_str(), size);
+            char name[64];
+            snprintf(name, sizeof(name), "string/find/%s/%uB", l.name, (unsigned)size);
+            runner.run(name, 1, size, [&]{ bench::do_not_optimize(v.find('\x01')); });
+            snprintf(name, sizeof(name), "string/rfind/%s/%uB", l.name, (unsigned)size);
+            runner.run(name, 1, size, [&]{ bench::do_not_optimize(v.rfind('\x01')); });
+            snprintf(name, sizeof(name), "string/search/%s/%uB", l.name, (unsigned)size);
+            runner.run(name, 1, size, [&]{ bench::do_not_optimize(v.search("\"POST /")); });
+
+            const string b(blanks.c_str(), size), t(tokens.c_str(), size), x(text.c_str(), size), u(upper.c_str(), size);
+            snprintf(name, sizeof(name), "string/trim/%s/%uB", l.name, (unsigned)size);
+            runner.run(name, 1, size, [&]{ string c = b; bench::do_not_optimize(c.trim()); });
+            snprintf(name, sizeof(name), "string/is_token/%s/%uB", l.name, (unsigned)size);
+            runner.run(name, 1, size, [&]{ bench::do_not_optimize(t.is_token()); });
+            snprintf(name, sizeof(name), "string/find_control/%s/%uB", l.name, (unsigned)size);
+            runner.run(name, 1, size, [&]{ bench::do_not_optimize(x.find_control()); });
+            snprintf(name, sizeof(name), "string/equals_ignore_case/%s/%uB", l.name, (unsigned)size);
+            runner.run(name, 1, size, [&]{ bench::do_not_optimize(v.equals_ignore_case(u)); });
+            snprintf(name, sizeof(name), "string/to_lower/%s/%uB", l.name, (unsigned)size);
+            runner.run(name, 1, size, [&]{ bench::do_not_optimize(u.to_lower(lower.data())); });
+        }
+    }
+    /* the standard library's search, for reference */
+    for (size_t size : sizes){
+        const char* b = log.c_str();
+        const char* n = "\"POST /";
+        char name[64];
+        snprintf(name, sizeof(name), "string/search/std/%uB", (unsigned)size);
+        runner.run(name, 1, size, [&]{
+            bench::do_not_optimize(std::search(b, b + size, n, n + 7));
+        });
+    }
+    simd::use(best);
+
+    /* Columns 0, 1 and 7 of each row are integers, columns 2 and 6 decimals. */
+    runner.run("string/to_int/csv", rows.size() * 2, 0, [&]{
+        for (size_t i = 0; i < cells.size(); i += 8){
+            bench::do_not_optimize(cells[i].to_int());
+            bench::do_not_optimize(cells[i + 1].to_int());
+        }
+    });
+
+    runner.run("string/to_longlong/csv", rows.size(), 0, [&]{
+        for (size_t i = 0; i < cells.size(); i += 8){
+            bench::do_not_optimize(cells[i + 7].to_longlong());
+        }
+    });
+
+    runner.run("string/to_double/csv", rows.size() * 2, 0, [&]{
+        for (size_t i = 0; i < cells.size(); i += 8){
+            bench::do_not_optimize(cells[i + 2].to_double());
+            bench::do_not_optimize(cells[i + 6].to_double());
+        }
+    });
+
+    runner.run("string/parse_int/csv", rows.size() * 2, 0, [&]{
+        int v = 0;
+        for (size_t i = 0; i < cells.size(); i += 8){
+            cells[i].parse(v);
+            bench::do_not_optimize(v);
+            cells[i + 1].parse(v);
+            bench::do_not_optimize(v);
+        }
+    });
+
+    runner.run("string/parse_double/csv", rows.size() * 2, 0, [&]{
+        double v = 0;
+        for (size_t i = 0; i < cells.size(); i += 8){
+            cells[i + 2].parse(v);
+            bench::do_not_optimize(v);
+            cells[i + 6].parse(v);
+            bench::do_not_optimize(v);
+        }
+    });
+
+    /* Baselines: the C library on a NUL-terminated copy, as to_int() and
+     * to_double() used to do.
+     */
+    char d[36];
+    auto copy = [&](const string& s) -> const char* {
+        size_t n = s.length() > 34 ? 34 : s.length();
+        memcpy(d, s.buffer(), n);
+        d[n] = '\0';
+        return d;
+    };
+
+    runner.run("string/atoi/csv", rows.size() * 2, 0, [&]{
+        for (size_t i = 0; i < cells.size(); i += 8){
+            bench::do_not_optimize(atoi(copy(cells[i])));
+            bench::do_not_optimize(atoi(copy(cells[i + 1])));
+        }
+    });
+
+    runner.run("string/strtod/csv", rows.size() * 2, 0, [&]{
+        for (size_t i = 0; i < cells.size(); i += 8){
+            bench::do_not_optimize(strtod(copy(cells[i + 2]), nullptr));
+            bench::do_not_optimize(strtod(copy(cells[i + 6]), nullptr));
+        }
+    });
+}
@@ -0,0 +1,141 @@
+#include <hydrogen/common/thread_pool.h>
+
+#include "bench.h"
+using namespace hy;
+
+/* The baseline: one queue under a mutex, workers waiting on a condition
+ * variable. Every submit and every take goes through the same lock.
+ */
+class MutexPool {
+public:
+    explicit MutexPool(size_t threads) : _pending(0), _stopping(false){
+        for (size_t i = 0; i < threads; ++i){
+            _threads.emplace_back([this]{ run(); });
+        }
+    }
+
+    ~MutexPool(){
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _stopping = true;
+        }
+        _cv.notify_all();
+        for (auto& t : _threads){
+            t.join();
+        }
+    }
+
+    void submit(std::function<void()> t){
+        _pending.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _tasks.push_back(std::move(t));
+        }
+        _cv.notify_one();
+    }
+
+    void wait_idle(){
+        std::unique_lock<std::mutex> lock(_idle_lock);
+        _idle_cv.wait(lock, [this]{ return _pending.load() == 0; });
+    }
+
+private:
+    void run(){
+        for (;;){
+            std::function<void()> t;
+            {
+                std::unique_lock<std::mutex> lock(_lock);
+                _cv.wait(lock, [this]{ return _stopping || !_tasks.empty(); });
+                if (_tasks.empty()){
+                    return;
+                }
+                t = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+            t();
+            if (_pending.fetch_sub(1) == 1){
+                std::lock_guard<std::mutex> lock(_idle_lock);
+                _idle_cv.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> _threads;
+    std::deque<std::function<void()>> _tasks;
+    std::mutex _lock;
+    std::condition_variable _cv;
+    std::atomic<size_t> _pending;
+    bool _stopping;
+    std::mutex _idle_lock;
+    std::condition_variable _idle_cv;
+};
+
+template<typename Pool>
+static void spawn_tree(Pool& pool, int depth){
+    if (depth == 0){
+        return;
+    }
+    pool.submit([&pool, depth]{ spawn_tree(pool, depth - 1); });
+    pool.submit([&pool, depth]{ spawn_tree(pool, depth - 1); });
+}
+
+/* Submit-to-start latency of `samples` tasks submitted in bursts of
+ * `burst`, as percentiles in ns.
+ */
+template<typename Pool>
+static void latency(bench::runner& runner, const char* name, Pool& pool,
+                    size_t samples, size_t burst){
+    if (!runner.enabled(name)){
+        return;
+    }
+    std::vector<uint64_t> ns(samples);
+    for (size_t i = 0; i < samples; i += burst){
+        for (size_t k = i; k < i + burst && k < samples; ++k){
+            uint64_t t0 = bench::now_ns();
+            uint64_t* slot = &ns[k];
+            pool.submit([slot, t0]{ *slot = bench::now_ns() - t0; });
+        }
+        pool.wait_idle();
+    }
+    std::sort(ns.begin(), ns.end());
+    auto at = [&](double q){ return (double)ns[(size_t)(q * (samples - 1))]; };
+    runner.record(name, {
+        { "p50_ns", at(0.50) }, { "p99_ns", at(0.99) },
+        { "p999_ns", at(0.999) }, { "max_ns", at(1.0) }
+    });
+}
+
+void thread_pool_bench(bench::runner& runner) {
+    const size_t threads = 4;
+    thread_pool stealing(threads);
+    MutexPool locked(threads);
+
+    /* 1000 empty tasks from a thread outside the pool */
+    runner.run("thread_pool/external_submit/1k", 1000, 0, [&]{
+        for (int i = 0; i < 1000; ++i){
+            stealing.submit([]{});
+        }
+        stealing.wait_idle();
+    });
+    runner.run("mutex_pool/external_submit/1k", 1000, 0, [&]{
+        for (int i = 0; i < 1000; ++i){
+            locked.submit([]{});
+        }
+        locked.wait_idle();
+    });
+
+    /* a binary tree of 4094 tasks, each submitted by its parent task:
+     * the work-stealing pool keeps them on the submitting worker
+     */
+    runner.run("thread_pool/task_tree/4k", 4094, 0, [&]{
+        spawn_tree(stealing, 11);
+        stealing.wait_idle();
+    });
+    runner.run("mutex_pool/task_tree/4k", 4094, 0, [&]{
+        spawn_tree(locked, 11);
+        locked.wait_idle();
+    });
+
+    latency(runner, "thread_pool/latency/burst64", stealing, 64000, 64);
+    latency(runner, "mutex_pool/latency/burst64", locked, 64000, 64);
+}
@@ -0,0 +1,117 @@
+#include <hydrogen/common/arena.h>
+#include <hydrogen/common/stdext.h>
+#include <hydrogen/common/string.h>
+#include <iostream>
+#include <string>
+
+#include "test.h"
+using namespace hy;
+
+static bool aligned(const void* p, size_t align){
+    return ((uintptr_t)p & (align - 1)) == 0;
+}
+
+void arena_tests() {
+    BEGIN_TEST_PACKAGE("common/arena");
+
+    BEGIN_TEST_CASE("allocate/reset");
+    {
+        arena a(256);
+        TEST_CHECK(a.chunks() == 0);
+        char* p = (char*)a.allocate(10, 1);
+        char* q = (char*)a.allocate(10, 1);
+        TEST_CHECK(q == p + 10 && a.chunks() == 1);
+        TEST_CHECK(aligned(a.allocate(8), arena::max_align));
+        TEST_CHECK(aligned(a.allocate(1, 64), 64));
+
+        /* the last block can be given back */
+        char* r = (char*)a.allocate(16, 1);
+        a.deallocate(r, 16);
+        TEST_CHECK(a.allocate(16, 1) == r);
+
+        /* chunks grow, and big blocks get a chunk of their own */
+        bool sane = true;
+        for (int i = 0; i < 100; ++i){
+            char* b = (char*)a.allocate(100, 8);
+            memset(b, i, 100);
+            sane = sane && aligned(b, 8);
+        }
+        char* big = (char*)a.allocate(100000, 16);
+        memset(big, 1, 100000);
+        TEST_CHECK(sane && a.chunks() > 2);
+
+        /* reset() refills the same chunks */
+        size_t chunks = a.chunks();
+        a.reset();
+        TEST_CHECK(a.allocate(10, 1) == p);
+        for (int round = 0; round < 10; ++round){
+            a.reset();
+            for (int i = 0; i < 100; ++i){
+                a.allocate(100, 8);
+            }
+            a.allocate(100000, 16);
+        }
+        TEST_CHECK(a.chunks() == chunks);
+
+        a.release();
+        TEST_CHECK(a.chunks() == 0);
+        TEST_CHECK(strcmp(a.copy("Host", 4), "Host") == 0);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("caller's buffer");
+    {
+        char buf[512];
+        arena a(buf, sizeof(buf), 256);
+        char* p = (char*)a.allocate(100);
+        TEST_CHECK(p >= buf && p + 100 <= buf + sizeof(buf) && a.chunks() == 0);
+        char* q = (char*)a.allocate(1000);
+        TEST_CHECK((q < buf || q >= buf + sizeof(buf)) && a.chunks() == 1);
+        a.reset();
+        TEST_CHECK(a.allocate(100) == p);
+        a.release();
+        TEST_CHECK(a.chunks() == 0 && a.allocate(100) == p);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("containers");
+    {
+        arena a;
+        const string req("GET / HTTP/1.1\r\nHost: google.com\r\nContent-Length: -1\r\n\r\n");
+        size_t chunks = 0;
+        bool same = true;
+        for (int round = 0; round < 100; ++round){
+            a.reset();
+            arena_strings h = req.split(a, "\r\n");
+            same = same && h.size() == 4 && h[3].empty() && h[1].split_kv(':').second.trim() == "google.com";
+
+            arena_strings words(a);
+            h[0].split(words, ' ');
+            same = same && words.size() == 3 && words[2] == "HTTP/1.1";
+
+            arena_string line(a);
+            format_to(line, "{} {} -> {}", words[0], std::string("/index"), 200);
+            same = same && line == "GET /index -> 200";
+            line.clear();
+            format(line, "%s:%d", "x", 1);
+            same = same && line == "x:1";
+
+            arena_vector<int> v(a);
+            for (int i = 0; i < 1000; ++i){
+                v.push_back(i);
+            }
+            arena_vector<int> copy(v);
+            same = same && copy.get_allocator() == v.get_allocator() && copy[999] == 999;
+
+            if (round == 0){
+                chunks = a.chunks();
+            }
+        }
+        TEST_CHECK(same);
+        /* after the first round, nothing more is taken from the heap */
+        TEST_CHECK(a.chunks() == chunks);
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
@@ -0,0 +1,219 @@
+#include <hydrogen/common/charconv.h>
+#include <hydrogen/common/stdext.h>
+#include <hydrogen/common/string.h>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+
+#include "test.h"
+using namespace hy;
+
+/* Checks the parsers against the C library on random numbers and on the
+ * boundaries of each type.
+ */
+void charconv_tests() {
+    BEGIN_TEST_PACKAGE("common/charconv");
+
+    BEGIN_TEST_CASE("from_chars integers");
+    {
+        long long ll = 7;
+        const char* s = "-9223372036854775808";
+        TEST_CHECK(from_chars(s, s + strlen(s), ll).ec == conv_errc::none && ll == LLONG_MIN);
+        s = "-9223372036854775809";
+        TEST_CHECK(from_chars(s, s + strlen(s), ll).ec == conv_errc::out_of_range && ll == LLONG_MIN);
+
+        unsigned long long ull = 0;
+        s = "000000000000000000000018446744073709551615";
+        TEST_CHECK(from_chars(s, s + strlen(s), ull).ec == conv_errc::none && ull == ULLONG_MAX);
+        s = "18446744073709551616";
+        auto r = from_chars(s, s + strlen(s), ull);
+        TEST_CHECK(r.ec == conv_errc::out_of_range && r.ptr == s + 20);
+        s = "-1";
+        TEST_CHECK(from_chars(s, s + 2, ull).ec == conv_errc::invalid);
+
+        /* the end of the range is respected: "12" of "1234" */
+        int i = 0;
+        s = "1234";
+        r = from_chars(s, s + 2, i);
+        TEST_CHECK(r.ec == conv_errc::none && i == 12 && r.ptr == s + 2);
+        s = "12345678x";
+        r = from_chars(s, s + 9, i);
+        TEST_CHECK(i == 12345678 && r.ptr == s + 8);
+
+        signed char c = 0;
+        s = "-128";
+        TEST_CHECK(from_chars(s, s + 4, c).ec == conv_errc::none && c == -128);
+        s = "128";
+        TEST_CHECK(from_chars(s, s + 3, c).ec == conv_errc::out_of_range && c == -128);
+
+        bool same = true;
+        unsigned long long seed = 1;
+        char buf[32];
+        for (int k = 0; k < 100000; ++k){
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            long long v = (long long)(seed >> (seed & 63));
+            int len = snprintf(buf, sizeof(buf), "%lld", v);
+            long long parsed = 0;
+            r = from_chars(buf, buf + len, parsed);
+            same = same && r.ec == conv_errc::none && r.ptr == buf + len && parsed == v;
+        }
+        TEST_CHECK(same);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("from_chars floating point");
+    {
+        /* random bit patterns printed at random precisions */
+        bool same = true;
+        unsigned long long seed = 1;
+        char buf[64];
+        for (int k = 0; k < 200000; ++k){
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            double d;
+            memcpy(&d, &seed, sizeof(d));
+            if (d != d || d - d != 0){
+                continue;
+            }
+            int len = snprintf(buf, sizeof(buf), k & 1 ? "%.*g" : "%.*e", 1 + (int)(seed >> 59), d);
+            double pd = 0;
+            float pf = 0;
+            auto r = from_chars(buf, buf + len, pd);
+            from_chars(buf, buf + len, pf);
+            double sd = strtod(buf, nullptr);
+            float sf = strtof(buf, nullptr);
+            same = same && r.ptr == buf + len && !memcmp(&pd, &sd, sizeof(pd)) && pf == sf;
+        }
+        TEST_CHECK(same);
+
+        const char* cases[] = {
+            "0", "-0", "1", "0.1", "1e23", "8.98846567431158e307", "2.2250738585072011e-308",
+            "4.9e-324", "2.4703282292062327e-324", "9007199254740993", "0.000000000000000000000000000001",
+            "1.00000000000000011102230246251565404236316680908203125",
+            "3.14159265358979323846264338327950288419716939937510582097494459", ".5", "5.", "1e-400"
+        };
+        for (auto s : cases){
+            double v = 0;
+            auto r = from_chars(s, s + strlen(s), v);
+            double expect = strtod(s, nullptr);
+            same = same && r.ec == conv_errc::none && r.ptr == s + strlen(s) && !memcmp(&v, &expect, sizeof(v));
+        }
+        TEST_CHECK(same);
+
+        double v = 0;
+        const char* s = "1e309";
+        TEST_CHECK(from_chars(s, s + 5, v).ec == conv_errc::out_of_range && v == std::numeric_limits<double>::infinity());
+        s = "-Infinity";
+        TEST_CHECK(from_chars(s, s + 9, v).ec == conv_errc::none && v == -std::numeric_limits<double>::infinity());
+        s = "nan";
+        TEST_CHECK(from_chars(s, s + 3, v).ec == conv_errc::none && v != v);
+        s = "1e+x";
+        auto r = from_chars(s, s + 4, v);
+        TEST_CHECK(r.ec == conv_errc::none && v == 1 && r.ptr == s + 1);
+        s = "-.e1";
+        TEST_CHECK(from_chars(s, s + 4, v).ec == conv_errc::invalid);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("to_chars integers");
+    {
+        char buf[32];
+        const long long values[] = { 0, -1, 9, 10, 99, 100, 12345678, LLONG_MIN, LLONG_MAX };
+        const char* texts[] = { "0", "-1", "9", "10", "99", "100", "12345678",
+                                "-9223372036854775808", "9223372036854775807" };
+        bool same = true;
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i){
+            auto r = to_chars(buf, buf + sizeof(buf), values[i]);
+            same = same && r.ec == conv_errc::none && std::string(buf, r.ptr) == texts[i];
+        }
+        TEST_CHECK(same);
+
+        auto r = to_chars(buf, buf + sizeof(buf), ULLONG_MAX);
+        TEST_CHECK(std::string(buf, r.ptr) == "18446744073709551615");
+        r = to_chars(buf, buf + 3, -100);
+        TEST_CHECK(r.ec == conv_errc::out_of_range && r.ptr == buf + 3);
+        r = to_chars(buf, buf + 3, (unsigned char)255);
+        TEST_CHECK(r.ec == conv_errc::none && std::string(buf, r.ptr) == "255");
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("to_chars floating point");
+    {
+        /* shortest: no fewer digits round-trip through the C library */
+        bool same = true;
+        unsigned long long seed = 7;
+        char buf[32], ref[32];
+        for (int k = 0; k < 100000; ++k){
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            double d;
+            memcpy(&d, &seed, sizeof(d));
+            if (d != d || d - d != 0){
+                continue;
+            }
+            auto r = to_chars(buf, buf + sizeof(buf), d);
+            int digits = 1;
+            for (; digits < 17; ++digits){
+                snprintf(ref, sizeof(ref), "%.*e", digits - 1, d);
+                if (strtod(ref, nullptr) == d){
+                    break;
+                }
+            }
+            double back = 0;
+            from_chars(buf, r.ptr, back);
+            /* significant digits written: first to last nonzero one */
+            int count = 0, written = 0;
+            for (const char* p = buf; p != r.ptr && *p != 'e'; ++p){
+                if ((*p >= '1' && *p <= '9') || (*p == '0' && count)){
+                    ++count;
+                }
+                if (*p >= '1' && *p <= '9'){
+                    written = count;
+                }
+            }
+            same = same && back == d && written <= digits;
+        }
+        TEST_CHECK(same);
+
+        const double values[] = { 0.1, 0.3, 1e22, 1e21, 100, 1.5, -2.5e-7, 5e-324, 1.7976931348623157e308,
+                                  12345678901234567.0, 0.001, -0.0 };
+        const char* texts[] = { "0.1", "0.3", "1e+22", "1e+21", "100", "1.5", "-2.5e-07", "5e-324",
+                                "1.7976931348623157e+308", "12345678901234568", "0.001", "-0" };
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i){
+            auto r = to_chars(buf, buf + sizeof(buf), values[i]);
+            same = same && std::string(buf, r.ptr) == texts[i];
+        }
+        TEST_CHECK(same);
+
+        auto r = to_chars(buf, buf + sizeof(buf), 0.1f);
+        TEST_CHECK(std::string(buf, r.ptr) == "0.1");
+        r = to_chars(buf, buf + sizeof(buf), -std::numeric_limits<double>::infinity());
+        TEST_CHECK(std::string(buf, r.ptr) == "-inf");
+        r = to_chars(buf, buf + 3, 1.25);
+        TEST_CHECK(r.ec == conv_errc::out_of_range);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("format_to");
+    {
+        std::string out;
+        format_to(out, "{} {} {}: {}", "GET", std::string("/index"), string("HTTP/1.1"), 200);
+        TEST_CHECK(out == "GET /index HTTP/1.1: 200");
+        out.clear();
+        format_to(out, "{{{}}} {} {} {}", -1.5, true, 'x', (unsigned char)7);
+        TEST_CHECK(out == "{-1.5} true x 7");
+
+        bool thrown = false;
+        try {
+            format_to(out, "{} {}", 1);
+        }
+        catch (std::invalid_argument&){
+            thrown = true;
+        }
+        TEST_CHECK(thrown);
+
+        TEST_CHECK(format("%s=%d", "x", 12345) == "x=12345");
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
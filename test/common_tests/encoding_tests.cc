@@ -0,0 +1,182 @@
+#include <hydrogen/common/encoding.h>
+#include <hydrogen/common/simd.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+using namespace hy;
+
+static std::string encode64(const std::string& s, base64_alphabet alphabet = base64_alphabet::standard, bool pad = true){
+    std::vector<char> buf(base64_encoded_length(s.size(), pad) + 1);
+    auto r = base64_encode(buf.data(), buf.data() + buf.size(), string(s.data(), s.size()), alphabet, pad);
+    return r.ec == conv_errc::none ? std::string(buf.data(), r.ptr) : "<error>";
+}
+
+static std::string decode64(const std::string& s, base64_alphabet alphabet = base64_alphabet::standard){
+    std::vector<char> buf(base64_decoded_length(s.size()) + 1);
+    auto r = base64_decode(buf.data(), buf.data() + buf.size(), string(s.data(), s.size()), alphabet);
+    return r.ec == conv_errc::none ? std::string(buf.data(), r.ptr) : "<error>";
+}
+
+static std::string encode16(const std::string& s, bool upper = false){
+    std::vector<char> buf(s.size() * 2 + 1);
+    auto r = hex_encode(buf.data(), buf.data() + buf.size(), string(s.data(), s.size()), upper);
+    return r.ec == conv_errc::none ? std::string(buf.data(), r.ptr) : "<error>";
+}
+
+static std::string decode16(const std::string& s){
+    std::vector<char> buf(s.size() / 2 + 1);
+    auto r = hex_decode(buf.data(), buf.data() + buf.size(), string(s.data(), s.size()));
+    return r.ec == conv_errc::none ? std::string(buf.data(), r.ptr) : "<error>";
+}
+
+/* Where decoding `s` stops: its length if it is valid. */
+static size_t where64(const std::string& s, base64_alphabet alphabet = base64_alphabet::standard){
+    std::vector<char> buf(base64_decoded_length(s.size()) + 1);
+    string text(s.data(), s.size());
+    return base64_decode(buf.data(), buf.data() + buf.size(), text, alphabet).in - text.begin();
+}
+
+static size_t where16(const std::string& s){
+    std::vector<char> buf(s.size() / 2 + 1);
+    string text(s.data(), s.size());
+    return hex_decode(buf.data(), buf.data() + buf.size(), text).in - text.begin();
+}
+
+/* Checks the kernels at every instruction set of this CPU against the
+ * test vectors of RFC 4648 and against each other, on lengths around
+ * their block sizes.
+ */
+void encoding_tests() {
+    BEGIN_TEST_PACKAGE("common/encoding");
+
+    const simd::isa levels[] = { simd::isa::none, simd::isa::sse2, simd::isa::avx2 };
+    const simd::isa best = simd::detect();
+
+    BEGIN_TEST_CASE("RFC 4648 vectors");
+    {
+        const char* plain[] = { "", "f", "fo", "foo", "foob", "fooba", "foobar" };
+        const char* b64[] = { "", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy" };
+        const char* b16[] = { "", "66", "666f", "666f6f", "666f6f62", "666f6f6261", "666f6f626172" };
+        bool same = true;
+        for (size_t i = 0; i < 7; ++i){
+            same = same && encode64(plain[i]) == b64[i] && decode64(b64[i]) == plain[i];
+            same = same && encode16(plain[i]) == b16[i] && decode16(b16[i]) == plain[i];
+        }
+        TEST_CHECK(same);
+        TEST_CHECK(encode64("foob", base64_alphabet::url, false) == "Zm9vYg");
+        TEST_CHECK(decode64("Zm9vYg", base64_alphabet::url) == "foob" && decode64("Zm9vYg==", base64_alphabet::url) == "foob");
+        TEST_CHECK(encode64("\xfb\xff", base64_alphabet::standard) == "+/8=" && encode64("\xfb\xff", base64_alphabet::url) == "-_8=");
+        TEST_CHECK(encode16("\x01\xab\xff", true) == "01ABFF" && decode16("01aBfF") == "\x01\xab\xff");
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("round trips");
+    {
+        bool same = true;
+        std::string data;
+        unsigned seed = 99;
+        for (int i = 0; i < 600; ++i){
+            seed = seed * 1103515245 + 12345;
+            data += (char)(seed >> 16);
+        }
+        for (auto alphabet : { base64_alphabet::standard, base64_alphabet::url }){
+            std::vector<std::string> reference;
+            for (auto level : levels){
+                simd::use(level);
+                for (size_t len = 0; len <= 200; ++len){
+                    for (size_t off = 0; off < 3; ++off){
+                        std::string s = data.substr(off, len);
+                        std::string t = encode64(s, alphabet);
+                        std::string h = encode16(s);
+                        same = same && decode64(t, alphabet) == s && decode16(h) == s;
+                        if (alphabet == base64_alphabet::url){
+                            std::string u = encode64(s, alphabet, false);
+                            same = same && decode64(u, alphabet) == s && u == t.substr(0, u.size());
+                        }
+                        /* the same text at every level */
+                        if (level == simd::isa::none){
+                            reference.push_back(t + h);
+                        }
+                        else {
+                            same = same && reference[len * 3 + off] == t + h;
+                        }
+                    }
+                }
+            }
+        }
+        simd::use(best);
+        TEST_CHECK(same);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("strict decoding");
+    {
+        bool strict = true;
+        std::string text = encode64(std::string(150, 'x'));
+        std::string hex = encode16(std::string(150, 'x'));
+        for (auto level : levels){
+            simd::use(level);
+            /* one bad character anywhere, in a vector block or not */
+            for (size_t i = 0; i < text.size(); ++i){
+                for (char bad : { '=', '*', ' ', '\n', '-', '\x80', '\0' }){
+                    std::string t = text;
+                    t[i] = bad;
+                    strict = strict && decode64(t) == "<error>";
+                    /* a '=' at the end is padding, and cuts the last bits instead */
+                    strict = strict && (where64(t) == i || (bad == '=' && i + 1 == t.size()));
+                }
+            }
+            for (size_t i = 0; i < hex.size(); ++i){
+                for (char bad : { 'g', 'G', ' ', '/', ':', '@', '`', '\xe6' }){
+                    std::string h = hex;
+                    h[i] = bad;
+                    strict = strict && decode16(h) == "<error>" && where16(h) == i;
+                }
+            }
+        }
+        simd::use(best);
+        TEST_CHECK(strict);
+
+        /* padding, lengths and the bits past the last byte */
+        TEST_CHECK(decode64("Zm9vYg") == "<error>" && decode64("Zm9vYg=") == "<error>");
+        TEST_CHECK(decode64("Zm9vY") == "<error>" && decode64("Zm9vY===") == "<error>");
+        TEST_CHECK(decode64("Zh==") == "<error>" && decode64("Zm9=") == "<error>");
+        TEST_CHECK(decode64("Zm9vYg==Zm9v") == "<error>" && decode64("====") == "<error>");
+        TEST_CHECK(decode64("Zm9v+/8=") != "<error>" && decode64("Zm9v-_8=") == "<error>");
+        TEST_CHECK(decode64("Zm9v+/8=", base64_alphabet::url) == "<error>");
+        TEST_CHECK(decode16("666") == "<error>");
+
+        /* where the text is wrong: a character, or its end */
+        TEST_CHECK(where64("Zm9vYmFy") == 8 && where64("Zm9v*mFy") == 4 && where64("Zm9vYm*y") == 6);
+        TEST_CHECK(where64("Zm9vYg") == 6 && where64("Zh==") == 1 && where64("Zm9=") == 2);
+        TEST_CHECK(where64("Zm9vY", base64_alphabet::url) == 5 && where64("Zm9vYg==Zm9v") == 6);
+        TEST_CHECK(where16("666") == 3 && where16("66x6") == 2 && where16("6666") == 4);
+
+        char buf[4];
+        string foob("Zm9vYg==");
+        auto r = base64_decode(buf, buf + 3, foob);
+        TEST_CHECK(r.ec == conv_errc::out_of_range && r.ptr == buf + 3 && r.in == foob.begin());
+        TEST_CHECK(base64_decode(buf, buf + 4, "Zm9vYg==").ec == conv_errc::none);
+        TEST_CHECK(base64_encode(buf, buf + 3, "f").ec == conv_errc::out_of_range);
+        TEST_CHECK(hex_encode(buf, buf + 3, "fo").ec == conv_errc::out_of_range);
+        TEST_CHECK(hex_decode(buf, buf + 1, "6666").ec == conv_errc::out_of_range);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("arena");
+    {
+        arena a;
+        string t = base64_encode(a, "foobar");
+        TEST_CHECK(t == "Zm9vYmFy" && t.buffer()[t.length()] == '\0');
+        string bytes;
+        TEST_CHECK(base64_decode(a, t, bytes) == conv_errc::none && bytes == "foobar");
+        TEST_CHECK(base64_decode(a, "Zm9vYmF", bytes) == conv_errc::invalid && bytes == "foobar");
+        string h = hex_encode(a, "\x12\x34", true);
+        TEST_CHECK(h == "1234" && hex_decode(a, h, bytes) == conv_errc::none && bytes == "\x12\x34");
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
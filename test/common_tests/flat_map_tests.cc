@@ -0,0 +1,137 @@
+#include <hydrogen/common/flat_map.h>
+#include <hydrogen/common/string.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "test.h"
+using namespace hy;
+
+void flat_map_tests() {
+    BEGIN_TEST_PACKAGE("common/flat_map");
+
+    BEGIN_TEST_CASE("hash");
+    {
+        /* the same bytes hash the same, whatever holds them */
+        std::string s("Content-Length");
+        string v = string("xContent-Lengthx").substr(1, 15);
+        string_hash h;
+        TEST_CHECK(h(s) == h(v) && h(s) == h("Content-Length") && h(s) == std::hash<string>()(v));
+        TEST_CHECK(h(s) != h("Content-Type") && h("") != h("a"));
+
+        /* every length through the 48-byte loop, every byte matters */
+        std::string bytes(200, 'a');
+        bool differ = true;
+        for (size_t len = 1; len <= bytes.size(); ++len){
+            uint64_t a = hash_bytes(bytes.data(), len);
+            bytes[len / 2] = 'b';
+            differ = differ && a != hash_bytes(bytes.data(), len) && a != hash_bytes(bytes.data(), len - 1);
+            bytes[len / 2] = 'a';
+        }
+        TEST_CHECK(differ);
+        TEST_CHECK(hash_bytes("abc", 3, 1) != hash_bytes("abc", 3, 2));
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("insert/find/erase");
+    {
+        flat_map<int, int> m;
+        TEST_CHECK(m.empty() && m.find(1) == m.end() && m.count(1) == 0 && m.capacity() == 0);
+        for (int i = 0; i < 1000; ++i){
+            TEST_CHECK(m.emplace(i, i * 2).second);
+        }
+        TEST_CHECK(m.size() == 1000 && !m.emplace(5, 0).second && m.at(5) == 10);
+        for (int i = 0; i < 1000; i += 2){
+            TEST_CHECK(m.erase(i) == 1);
+        }
+        TEST_CHECK(m.size() == 500 && m.erase(0) == 0 && m.count(1) == 1 && m.count(2) == 0);
+
+        long long sum = 0;
+        for (auto& kv : m){
+            sum += kv.second;
+        }
+        TEST_CHECK(sum == 500000);
+
+        m[7] += 1;
+        m[2000] = 3;
+        TEST_CHECK(m[7] == 15 && m.at(2000) == 3 && m.size() == 501);
+
+        bool thrown = false;
+        try {
+            m.at(-1);
+        }
+        catch (std::out_of_range&){
+            thrown = true;
+        }
+        TEST_CHECK(thrown);
+
+        for (auto it = m.begin(); it != m.end();){
+            it = it->first % 3 ? m.erase(it) : ++it;
+        }
+        bool thirds = true;
+        for (auto& kv : m){
+            thirds = thirds && kv.first % 3 == 0;
+        }
+        TEST_CHECK(thirds && m.size() == 167);
+
+        m.clear();
+        TEST_CHECK(m.empty() && m.begin() == m.end());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("string keys, string lookups");
+    {
+        string_map<int> headers;
+        const char* names[] = { "Host", "Accept", "Content-Type", "Content-Length", "Connection" };
+        for (int i = 0; i < 5; ++i){
+            headers[names[i]] = i;
+        }
+        auto lines = string("Host: a\r\nContent-Length: 5\r\nX-Other: 1").split("\r\n");
+        TEST_CHECK(headers.find(lines[0].split_kv(':').first)->second == 0);
+        TEST_CHECK(headers.at(lines[1].split_kv(':').first) == 3);
+        TEST_CHECK(headers.count(lines[2].split_kv(':').first) == 0);
+        TEST_CHECK(headers.count("Accept") == 1 && headers.erase(string("Accept")) == 1);
+        TEST_CHECK(headers.size() == 4);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("against std::unordered_map");
+    {
+        /* random inserts and erases: tombstones, regrowth and rehashes in place */
+        flat_map<unsigned, std::unique_ptr<int>> m;
+        std::unordered_map<unsigned, int> expect;
+        unsigned seed = 1;
+        bool same = true;
+        for (int k = 0; k < 200000; ++k){
+            seed = seed * 1103515245 + 12345;
+            unsigned key = (seed >> 8) % 3000;
+            if (seed & 1){
+                m.emplace(key, std::unique_ptr<int>(new int(k)));
+                expect.emplace(key, k);
+            }
+            else {
+                same = same && m.erase(key) == expect.erase(key);
+            }
+        }
+        same = same && m.size() == expect.size();
+        for (auto& kv : expect){
+            auto it = m.find(kv.first);
+            same = same && it != m.end() && *it->second == kv.second;
+        }
+        TEST_CHECK(same);
+
+        flat_map<unsigned, std::unique_ptr<int>> moved(std::move(m));
+        TEST_CHECK(m.empty() && moved.size() == expect.size());
+
+        flat_map<std::string, std::string> a;
+        a["x"] = "1";
+        flat_map<std::string, std::string> b(a);
+        b["y"] = "2";
+        a = b;
+        TEST_CHECK(a.size() == 2 && a.at("y") == "2" && b.at("x") == "1");
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
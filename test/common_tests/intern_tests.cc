@@ -0,0 +1,110 @@
+#include <hydrogen/common/intern.h>
+#include <hydrogen/common/string.h>
+#include <iostream>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+using namespace hy;
+
+void intern_tests() {
+    BEGIN_TEST_PACKAGE("common/intern");
+
+    BEGIN_TEST_CASE("intern/find/name");
+    {
+        intern_table t;
+        TEST_CHECK(t.size() == 0 && t.find("Host") == intern_table::npos);
+        uint32_t host = t.intern("Host");
+        uint32_t accept = t.intern("Accept");
+        TEST_CHECK(host == 0 && accept == 1 && t.size() == 2);
+
+        /* slices of other buffers find the same IDs */
+        auto kv = string("Host: example.com").split_kv(':');
+        TEST_CHECK(t.find(kv.first) == host && t.intern(kv.first) == host && t.size() == 2);
+        TEST_CHECK(t.find("host") == intern_table::npos && t.intern("") == 2 && t.find("") == 2);
+
+        /* canonical copies, NUL-terminated */
+        string name = t.name(accept);
+        TEST_CHECK(name == "Accept" && name.buffer()[6] == '\0' && t.name(host).buffer() == t.name(0).buffer());
+
+        std::string big(100000, 'x');
+        uint32_t b = t.intern(string(big.c_str(), big.size()));
+        TEST_CHECK(t.name(b).length() == big.size() && t.name(accept) == "Accept");
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("seed and growth");
+    {
+        std::vector<std::string> names;
+        for (int i = 0; i < 20000; ++i){
+            names.push_back("metric_" + std::to_string(i));
+        }
+        intern_table t(16);
+        t.seed(names.begin(), names.begin() + 10000);
+        for (size_t i = 10000; i < names.size(); ++i){
+            t.intern(string(names[i].c_str(), names[i].size()));
+        }
+        bool same = t.size() == names.size();
+        for (size_t i = 0; i < names.size(); ++i){
+            same = same && t.find(string(names[i].c_str(), names[i].size())) == i;
+            same = same && t.name((uint32_t)i) == string(names[i].c_str(), names[i].size());
+        }
+        TEST_CHECK(same);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("concurrent readers and writers");
+    {
+        /* readers must see each name either missing or with the one ID the
+         * writers agree on, while the index grows under them
+         */
+        std::vector<std::string> names;
+        for (int i = 0; i < 5000; ++i){
+            names.push_back("label-" + std::to_string(i * 7919 % 5000));
+        }
+        intern_table t;
+        std::vector<std::atomic<uint32_t>> ids(names.size());
+        for (auto& id : ids){
+            id.store(intern_table::npos);
+        }
+        std::atomic<bool> bad(false), done(false);
+
+        std::vector<std::thread> threads;
+        for (int w = 0; w < 2; ++w){
+            threads.emplace_back([&, w]{
+                for (size_t i = 0; i < names.size(); ++i){
+                    size_t k = w ? names.size() - 1 - i : i;
+                    uint32_t id = t.intern(string(names[k].c_str(), names[k].size()));
+                    uint32_t expect = intern_table::npos;
+                    if (!ids[k].compare_exchange_strong(expect, id) && expect != id){
+                        bad = true;
+                    }
+                }
+            });
+        }
+        for (int r = 0; r < 2; ++r){
+            threads.emplace_back([&]{
+                while (!done){
+                    for (size_t k = 0; k < names.size(); k += 13){
+                        string s(names[k].c_str(), names[k].size());
+                        uint32_t id = t.find(s);
+                        if (id != intern_table::npos && t.name(id) != s){
+                            bad = true;
+                        }
+                    }
+                }
+            });
+        }
+        threads[0].join();
+        threads[1].join();
+        done = true;
+        threads[2].join();
+        threads[3].join();
+        TEST_CHECK(!bad && t.size() == names.size());
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
@@ -7,6 +7,18 @@
 
 int main(int argc, char* argv[]) {
     TEST(string);
+    TEST(charconv);
+    TEST(simd);
+    TEST(small_vector);
+    TEST(flat_map);
+    TEST(intern);
+    TEST(arena);
+    TEST(encoding);
+    TEST(mapped_file);
+    TEST(thread_pool);
+    TEST(spsc_queue_buffer);
+    TEST(mpmc_queue);
+    TEST(mirrored_queue_buffer);
     return 0;
 }
 
@@ -0,0 +1,142 @@
+#include <hydrogen/common/mapped_file.h>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "test.h"
+using namespace hy;
+
+/* A new temporary file holding `content`. */
+static std::string temp_file(const std::string& content){
+#ifdef WIN32
+    char dir[MAX_PATH], path[MAX_PATH];
+    ::GetTempPathA(MAX_PATH, dir);
+    ::GetTempFileNameA(dir, "hy", 0, path);
+#else
+    char path[] = "/tmp/hy_mapped_file_XXXXXX";
+    ::close(::mkstemp(path));
+#endif
+    FILE* f = fopen(path, "wb");
+    fwrite(content.data(), 1, content.length(), f);
+    fclose(f);
+    return path;
+}
+
+/* Lines of 0 to 300 characters, one longer than 64KB, no final newline */
+static std::string log_text(){
+    std::string text;
+    for (size_t n = 0; n < 2000; ++n){
+        text += std::string(n * 37 % 301, 'a' + n % 26);
+        text += n % 13 ? "\n" : "\r\n";
+    }
+    text += std::string(70000, 'z') + "\n" + "last";
+    return text;
+}
+
+void mapped_file_tests() {
+    BEGIN_TEST_PACKAGE("common/mapped_file");
+
+    const std::string text = log_text();
+    const strings expect = string(text.c_str(), text.length()).split('\n');
+
+    BEGIN_TEST_CASE("map");
+    {
+        std::string path = temp_file(text);
+        for (unsigned opts : { (unsigned)mapped_file::normal, (unsigned)mapped_file::sequential,
+                               (unsigned)(mapped_file::sequential | mapped_file::willneed | mapped_file::huge_pages) }){
+            mapped_file f(path.c_str(), opts);
+            TEST_CHECK(f.is_open() && f.size() == text.length());
+            TEST_CHECK(f.content() == string(text.c_str(), text.length()));
+            strings lines(f.content().lines().begin(), f.content().lines().end());
+            TEST_CHECK(lines == expect);
+        }
+
+        mapped_file first(path.c_str());
+        mapped_file moved(std::move(first));
+        TEST_CHECK(!first.is_open() && moved.content().ends_with("last"));
+        moved.close();
+        TEST_CHECK(!moved.is_open() && moved.content().empty());
+        remove(path.c_str());
+
+        /* an empty file maps to an empty content */
+        path = temp_file("");
+        mapped_file empty;
+        TEST_CHECK(empty.try_open(path.c_str()) == 0 && !empty.is_open() && empty.content().empty());
+        TEST_CHECK(empty.content().lines().empty());
+        remove(path.c_str());
+
+        TEST_CHECK(empty.try_open(path.c_str()) != 0);
+        bool thrown = false;
+        try {
+            mapped_file missing(path.c_str());
+        }
+        catch (std::system_error&){
+            thrown = true;
+        }
+        TEST_CHECK(thrown);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("read blocks");
+    {
+        std::string path = temp_file(text);
+        for (size_t block_size : { (size_t)64, (size_t)4096, file_reader::default_block_size }){
+            file_reader r(path.c_str(), block_size);
+            std::string all;
+            strings lines;
+            bool whole = true;
+            size_t blocks = 0;
+            string block;
+            while (r.read(block)){
+                ++blocks;
+                all.append(block.begin(), block.end());
+                whole = whole && (block.ends_with("\n") || block == "last");
+                for (auto& line : block.lines()){
+                    lines.push_back(line);
+                }
+            }
+            TEST_CHECK(all == text && whole && r.offset() == text.length());
+            TEST_CHECK(blocks > 1 || block_size > text.length());
+            /* the strings point into blocks since overwritten: compare lengths */
+            bool same = lines.size() == expect.size();
+            for (size_t i = 0; same && i < lines.size(); ++i){
+                same = lines[i].length() == expect[i].length();
+            }
+            TEST_CHECK(same);
+            TEST_CHECK(!r.read(block));
+        }
+        remove(path.c_str());
+
+        file_reader r;
+        TEST_CHECK(r.try_open(path.c_str()) != 0 && !r.is_open());
+    }
+    END_TEST_CASE();
+
+#ifndef WIN32
+    BEGIN_TEST_CASE("pipe");
+    {
+        /* a pipe cannot be mapped, but can be read */
+        int fds[2];
+        TEST_ASSERT(::pipe(fds) == 0);
+        const char data[] = "one\ntwo\nthree";
+        TEST_ASSERT(::write(fds[1], data, sizeof(data) - 1) == sizeof(data) - 1);
+        ::close(fds[1]);
+        std::string path = "/dev/fd/" + std::to_string(fds[0]);
+
+        mapped_file f;
+        TEST_CHECK(f.try_open(path.c_str()) != 0);
+
+        file_reader r(path.c_str(), 4);
+        std::string all;
+        string block;
+        while (r.read(block)){
+            all.append(block.begin(), block.end());
+        }
+        TEST_CHECK(all == data);
+        ::close(fds[0]);
+    }
+    END_TEST_CASE();
+#endif
+
+    END_TEST_PACKAGE();
+}
@@ -0,0 +1,86 @@
+#include <hydrogen/common/mirrored_queue_buffer.h>
+#include <hydrogen/common/queue_buffer.h>
+#include <iostream>
+
+#include "test.h"
+using namespace hy;
+
+void mirrored_queue_buffer_tests() {
+    BEGIN_TEST_PACKAGE("common/mirrored_queue_buffer");
+
+    BEGIN_TEST_CASE("mirror");
+    {
+        mirrored_queue_buffer q(100);
+        size_t cap = q.capacity();
+        TEST_ASSERT(cap >= 100 && q.empty() && q.free() == cap);
+
+        /* a write through one mapping shows through the other */
+        q.front()[1] = 'x';
+        TEST_CHECK(q.front()[cap + 1] == 'x');
+        q.front()[cap + 2] = 'y';
+        TEST_CHECK(q.front()[2] == 'y');
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("contiguous across the end");
+    {
+        mirrored_queue_buffer q(1);
+        size_t cap = q.capacity();
+        q.push(cap - 3);
+        q.pop(cap - 3);
+        TEST_CHECK(q.empty() && q.free() == cap);
+
+        /* 10 bytes from 3 before the end: one run at tail() */
+        memcpy(q.tail(), "0123456789", 10);
+        q.push(10);
+        TEST_CHECK(q.length() == 10 && !memcmp(q.front(), "0123456789", 10));
+        q.pop(5);
+        TEST_CHECK(!memcmp(q.front(), "56789", 5) && q.front() < q.tail());
+
+        char out[8] = { 0 };
+        TEST_CHECK(q.copy(out, 8) == 5 && !memcmp(out, "56789", 5));
+
+        bool thrown = false;
+        try {
+            q.push(cap);
+        }
+        catch (std::out_of_range&){
+            thrown = true;
+        }
+        TEST_CHECK(thrown);
+
+        q.push(cap - 5);
+        TEST_CHECK(q.free() == 0);
+        q.pop(cap);
+        TEST_CHECK(q.empty());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("move/resize");
+    {
+        mirrored_queue_buffer a(4096);
+        memcpy(a.tail(), "abc", 3);
+        a.push(3);
+        mirrored_queue_buffer b(std::move(a));
+        TEST_CHECK(a.capacity() == 0 && b.length() == 3 && !memcmp(b.front(), "abc", 3));
+        b.resize(65536);
+        TEST_CHECK(b.capacity() >= 65536 && b.empty());
+        b.release();
+        TEST_CHECK(b.capacity() == 0);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("queue_buffer copy");
+    {
+        queue_buffer<char> q(16);
+        memcpy(q.tail(), "hello world", 11);
+        q.push(11);
+        char out[16] = { 0 };
+        TEST_CHECK(q.copy(out, 5) == 5 && !memcmp(out, "hello", 5));
+        TEST_CHECK(!memcmp(q.front(), "hello world", 11));
+        TEST_CHECK(q.copy(out, 16) == 11 && !memcmp(out, "hello world", 11));
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
@@ -0,0 +1,97 @@
+#include <hydrogen/common/mpmc_queue.h>
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "test.h"
+using namespace hy;
+
+void mpmc_queue_tests() {
+    BEGIN_TEST_PACKAGE("common/mpmc_queue");
+
+    BEGIN_TEST_CASE("try push/pop");
+    {
+        mpmc_queue<int> q(3);
+        TEST_CHECK(q.capacity() == 4 && q.size() == 0);
+        int v = 0;
+        TEST_CHECK(!q.try_pop(v));
+        for (int i = 0; i < 4; ++i){
+            TEST_CHECK(q.try_push(i));
+        }
+        TEST_CHECK(!q.try_push(4) && q.size() == 4);
+        TEST_CHECK(q.try_pop(v) && v == 0);
+        TEST_CHECK(q.try_push(4));
+
+        int out[8];
+        TEST_CHECK(q.try_pop_bulk(out, 8) == 4);
+        TEST_CHECK(out[0] == 1 && out[3] == 4);
+        TEST_CHECK(q.try_pop_bulk(out, 8) == 0);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("move-only values");
+    {
+        mpmc_queue<std::unique_ptr<int>> q(2);
+        TEST_CHECK(q.try_push(std::unique_ptr<int>(new int(7))));
+        std::unique_ptr<int> p;
+        q.pop(p);
+        TEST_CHECK(p && *p == 7);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("producers and consumers");
+    {
+        /* every value arrives exactly once */
+        const int producers = 4, consumers = 4, per_producer = 100000;
+        mpmc_queue<uint32_t> q(64);
+        std::vector<std::atomic<int>> seen(producers * per_producer);
+        for (auto& s : seen){
+            s = 0;
+        }
+        std::atomic<int> left(producers * per_producer);
+
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p){
+            threads.emplace_back([&, p]{
+                for (int i = 0; i < per_producer; ++i){
+                    q.push((uint32_t)(p * per_producer + i));
+                }
+            });
+        }
+        for (int c = 0; c < consumers; ++c){
+            threads.emplace_back([&, c]{
+                uint32_t batch[16];
+                while (left.load() > 0){
+                    size_t n = 0;
+                    if (c % 2){
+                        n = q.try_pop_bulk(batch, 16);
+                    }
+                    else if (q.try_pop(batch[0])){
+                        n = 1;
+                    }
+                    if (n == 0){
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    for (size_t i = 0; i < n; ++i){
+                        seen[batch[i]].fetch_add(1);
+                    }
+                    left.fetch_sub((int)n);
+                }
+            });
+        }
+        for (auto& t : threads){
+            t.join();
+        }
+
+        bool once = true;
+        for (auto& s : seen){
+            once = once && s.load() == 1;
+        }
+        TEST_CHECK(once && q.size() == 0);
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
@@ -0,0 +1,240 @@
+#include <hydrogen/common/simd.h>
+#include <hydrogen/common/string.h>
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "test.h"
+using namespace hy;
+
+/* Checks every kernel at every instruction set of this CPU against the
+ * standard library, on lengths and offsets around the vector widths.
+ */
+void simd_tests() {
+    BEGIN_TEST_PACKAGE("common/simd");
+
+    const simd::isa levels[] = { simd::isa::none, simd::isa::sse2, simd::isa::avx2 };
+    const simd::isa best = simd::detect();
+    std::cout << "best instruction set: " << (int)best << '\n';
+
+    BEGIN_TEST_CASE("find/rfind");
+    {
+        char buf[200];
+        bool same = true;
+        for (auto level : levels){
+            simd::use(level);
+            for (size_t len = 0; len <= 100; ++len){
+                for (size_t off = 0; off < 3; ++off){
+                    const char* b = buf + off;
+                    const char* e = b + len;
+                    memset(buf, 'a', sizeof(buf));
+                    same = same && simd::find(b, e, 'x') == e && simd::rfind(b, e, 'x') == e;
+                    for (size_t at = 0; at < len; at += 7){
+                        memset(buf, 'a', sizeof(buf));
+                        buf[off + at] = 'x';
+                        /* outside of the range: must not be seen */
+                        buf[off + len] = 'x';
+                        if (off){
+                            buf[off - 1] = 'x';
+                        }
+                        same = same && simd::find(b, e, 'x') == b + at;
+                        same = same && simd::rfind(b, e, 'x') == b + at;
+                        buf[off + len - 1] = 'x';
+                        same = same && simd::find(b, e, 'x') == b + at;
+                        same = same && simd::rfind(b, e, 'x') == e - 1;
+                    }
+                }
+            }
+        }
+        simd::use(best);
+        TEST_CHECK(same);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("search");
+    {
+        /* small alphabets make many partial matches */
+        std::vector<std::string> haystacks, needles;
+        unsigned seed = 12345;
+        auto next = [&]{ seed = seed * 1103515245 + 12345; return (seed >> 16) & 0x7fff; };
+        for (int i = 0; i < 200; ++i){
+            std::string h, n;
+            size_t hl = next() % 300, nl = 1 + next() % 12;
+            int alphabet = 2 + next() % 3;
+            for (size_t k = 0; k < hl; ++k){
+                h += (char)('a' + next() % alphabet);
+            }
+            for (size_t k = 0; k < nl; ++k){
+                n += (char)('a' + next() % alphabet);
+            }
+            haystacks.push_back(h);
+            needles.push_back(n);
+        }
+        /* periodic needles and a long run of near misses */
+        haystacks.push_back(std::string(5000, 'a') + "b");
+        needles.push_back(std::string(40, 'a') + "b");
+        haystacks.push_back(std::string(5000, 'a'));
+        needles.push_back("aaab");
+        haystacks.push_back("abababababababababababababababababababac");
+        needles.push_back("ababac");
+        /* every position passes the first/last byte filter: two-way takes over */
+        haystacks.push_back(std::string(5000, 'a'));
+        needles.push_back("aaaabaaaa");
+        haystacks.push_back(std::string(5000, 'a') + "aaaabaaaa" + std::string(100, 'a'));
+        needles.push_back("aaaabaaaa");
+
+        bool same = true;
+        for (auto level : levels){
+            simd::use(level);
+            for (size_t i = 0; i < haystacks.size(); ++i){
+                const std::string& h = haystacks[i];
+                const std::string& n = needles[i];
+                const char* hb = h.data();
+                const char* he = hb + h.size();
+                auto expect = std::search(hb, he, n.data(), n.data() + n.size());
+                same = same && simd::search(hb, he, n.data(), n.data() + n.size()) == expect;
+                same = same && simd::two_way_search(hb, he, n.data(), n.size()) == expect;
+            }
+        }
+        simd::use(best);
+        TEST_CHECK(same);
+
+        const char* t = "text";
+        TEST_CHECK(simd::search(t, t + 4, t, t) == t);
+        TEST_CHECK(simd::search(t, t + 2, t, t + 4) == t + 2);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("classes/case folding");
+    {
+        /* every byte value, at every position of lengths around the widths */
+        auto space = [](unsigned char c){ return c == ' ' || (c >= '\t' && c <= '\r'); };
+        auto digit = [](unsigned char c){ return c >= '0' && c <= '9'; };
+        auto control = [](unsigned char c){ return c < 0x20 || c == 0x7f; };
+        auto token = [](unsigned char c){ return c && c < 0x80 && (isalnum(c) || strchr("!#$%&'*+-.^_`|~", c)); };
+        auto lower = [](unsigned char c){ return (char)(c >= 'A' && c <= 'Z' ? c + 32 : c); };
+
+        bool same = true;
+        char buf[80], out[80];
+        for (auto level : levels){
+            simd::use(level);
+            for (int v = 0; v < 256; ++v){
+                const char c = (char)v;
+                for (size_t len = 1; len <= 70; len += 3){
+                    const char* b = buf + 1;
+                    const char* e = b + len;
+                    size_t at = (v * 7 + len) % len;
+
+                    memset(buf, ' ', sizeof(buf));
+                    buf[1 + at] = c;
+                    const char* first = space((unsigned char)c) ? e : b + at;
+                    same = same && simd::skip_space(b, e) == first;
+                    same = same && simd::rskip_space(b, e) == (first == e ? b : b + at + 1);
+
+                    memset(buf, '7', sizeof(buf));
+                    buf[1 + at] = c;
+                    same = same && simd::skip_digits(b, e) == (digit((unsigned char)c) ? e : b + at);
+                    same = same && simd::find_control(b, e) == (control((unsigned char)c) ? b + at : e);
+
+                    memset(buf, 'k', sizeof(buf));
+                    buf[1 + at] = c;
+                    same = same && simd::skip_token(b, e) == (token((unsigned char)c) ? e : b + at);
+
+                    memset(buf, 'Q', sizeof(buf));
+                    buf[1 + at] = c;
+                    same = same && simd::to_lower(b, e, out) == out + len;
+                    for (size_t i = 0; i < len; ++i){
+                        same = same && out[i] == lower((unsigned char)buf[1 + i]);
+                    }
+                    out[at] = lower((unsigned char)c);
+                    same = same && simd::equals_ignore_case(b, out, len);
+                    out[at] = lower((unsigned char)c) ^ 1;
+                    same = same && !simd::equals_ignore_case(b, out, len);
+                }
+            }
+        }
+        simd::use(best);
+        TEST_CHECK(same);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("match64/lines");
+    {
+        char buf[200];
+        bool same = true;
+        for (auto level : levels){
+            simd::use(level);
+            for (size_t len = 0; len <= 80; ++len){
+                const char* b = buf + 1;
+                memset(buf, 'a', sizeof(buf));
+                for (size_t at = 0; at < len; at += 5){
+                    buf[1 + at] = '\n';
+                }
+                buf[0] = buf[1 + len] = '\n';
+                unsigned long long expect = 0;
+                for (size_t i = 0; i < len && i < 64; ++i){
+                    expect |= (unsigned long long)(b[i] == '\n') << i;
+                }
+                same = same && simd::match64(b, b + len, '\n') == expect;
+            }
+
+            /* lines of every length around the 64-byte blocks */
+            std::string text;
+            for (size_t n = 0; n < 150; ++n){
+                text += std::string(n % 70, 'a' + n % 26);
+                text += n % 11 ? "\n" : "\r\n";
+            }
+            for (size_t cut : { text.length(), text.length() - 1, (size_t)130, (size_t)64, (size_t)1, (size_t)0 }){
+                string v(text.c_str(), cut);
+                strings lines(v.lines().begin(), v.lines().end());
+                same = same && lines == v.split('\n') && v.lines().empty() == lines.empty();
+            }
+        }
+        simd::use(best);
+        TEST_CHECK(same);
+
+        auto lines = string("a\n\nb\r\n").lines();
+        auto it = lines.begin();
+        TEST_CHECK(*it++ == "a" && *it++ == "" && *it++ == "b\r" && it == lines.end());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("string uses the kernels");
+    {
+        std::string s(1000, '.');
+        s[300] = ':';
+        s[700] = ':';
+        s += "\r\n\r\nbody";
+        string v(s.c_str(), s.length());
+        TEST_CHECK(v.find(':') == 300 && v.rfind(':') == 700);
+        TEST_CHECK(v.search("\r\n\r\n") == 1000 && v.contains("body"));
+        TEST_CHECK(v.split(':').size() == 3 && v.split(':')[2].length() == 307);
+        TEST_CHECK(v.split_kv(':').first.length() == 300);
+        TEST_CHECK(v.split_n<2>(':')[1].length() == 707);
+
+        std::string padded = std::string(40, ' ') + "\tvalue \r\n" + std::string(40, '\t');
+        TEST_CHECK(string(padded.c_str()).trim() == "value");
+        TEST_CHECK(string(padded.c_str()).ltrim().length() == 48);
+        TEST_CHECK(string(" \t\r\n").trim().empty() && string().trim().empty());
+
+        string name("Content-Length");
+        TEST_CHECK(name.equals_ignore_case("content-length") && name.equals_ignore_case("CONTENT-LENGTH"));
+        TEST_CHECK(!name.equals_ignore_case("content-lengt") && !name.equals_ignore_case("content_length"));
+        TEST_CHECK(name.starts_with_ignore_case("CONTENT-") && !name.starts_with_ignore_case("content-length:"));
+        TEST_CHECK(name.is_token() && !string("Content Length").is_token() && !string().is_token());
+        TEST_CHECK(string("0123456789").is_digits() && !string("12a").is_digits());
+        TEST_CHECK(string("a\tb").find_control() == 1 && name.find_control() == string::npos);
+        char lower[32];
+        TEST_CHECK(strcmp(name.to_lower(lower), "content-length") == 0);
+
+        /* views are not read past their end */
+        const char* text = "hello world";
+        TEST_CHECK(!string(text, 2).starts_with("hel") && string(text, 3).starts_with("hel"));
+        TEST_CHECK(string(text, 5).compare("hello") == 0 && string(text, 4).compare("hello") < 0);
+        TEST_CHECK(string(text, 5).compare(string(text, 4)) > 0 && string(text, 5) < "hello!");
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
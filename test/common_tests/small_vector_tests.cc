@@ -0,0 +1,66 @@
+#include <hydrogen/common/small_vector.h>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "test.h"
+using namespace hy;
+
+void small_vector_tests() {
+    BEGIN_TEST_PACKAGE("common/small_vector");
+
+    BEGIN_TEST_CASE("inline, then heap");
+    {
+        small_vector<int, 4> v;
+        TEST_CHECK(v.empty() && v.capacity() == 4 && v.is_inline());
+        for (int i = 0; i < 4; ++i){
+            v.push_back(i);
+        }
+        TEST_CHECK(v.size() == 4 && v.is_inline());
+        v.push_back(4);
+        TEST_CHECK(v.size() == 5 && !v.is_inline() && v.capacity() >= 5);
+        int sum = 0;
+        for (int x : v){
+            sum += x;
+        }
+        TEST_CHECK(sum == 10 && v.front() == 0 && v.back() == 4);
+        v.pop_back();
+        v.clear();
+        TEST_CHECK(v.empty());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("copy/move");
+    {
+        small_vector<std::string, 2> a = { "one", "two" };
+        small_vector<std::string, 2> b(a);
+        TEST_CHECK(b.size() == 2 && b[1] == "two" && a[1] == "two");
+
+        /* inline elements move one by one */
+        small_vector<std::string, 2> c(std::move(a));
+        TEST_CHECK(c.size() == 2 && c[0] == "one" && a.empty());
+
+        /* heap storage moves whole */
+        b.push_back("three");
+        const std::string* data = b.data();
+        small_vector<std::string, 2> d;
+        d = std::move(b);
+        TEST_CHECK(d.data() == data && d.size() == 3 && b.empty() && b.is_inline());
+
+        /* pushing an element of the vector itself while it grows */
+        c.push_back(c[0]);
+        TEST_CHECK(c.size() == 3 && c[2] == "one");
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("move-only elements");
+    {
+        small_vector<std::unique_ptr<int>, 1> v;
+        v.emplace_back(new int(1));
+        v.push_back(std::unique_ptr<int>(new int(2)));
+        TEST_CHECK(v.size() == 2 && *v[0] == 1 && *v[1] == 2);
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
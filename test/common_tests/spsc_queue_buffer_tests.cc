@@ -0,0 +1,115 @@
+#include <hydrogen/common/spsc_queue_buffer.h>
+#include <iostream>
+#include <thread>
+#include <cstdint>
+
+#include "test.h"
+using namespace hy;
+
+void spsc_queue_buffer_tests() {
+    BEGIN_TEST_PACKAGE("common/spsc_queue_buffer");
+
+    BEGIN_TEST_CASE("in place");
+    {
+        spsc_queue_buffer<char> q(6);
+        TEST_CHECK(q.capacity() == 8 && q.empty());
+        TEST_CHECK(q.writable() == 8 && q.readable() == 0);
+
+        memcpy(q.tail(), "abcde", 5);
+        q.push(5);
+        TEST_CHECK(q.length() == 5 && q.writable() == 3);
+        TEST_CHECK(q.readable() == 5 && !memcmp(q.front(), "abcde", 5));
+        q.pop(3);
+
+        /* 3 left before the end of the ring, then 3 more at the start */
+        TEST_CHECK(q.writable() == 3);
+        memcpy(q.tail(), "fgh", 3);
+        q.push(3);
+        TEST_CHECK(q.writable() == 3 && q.tail() == q.front() - 3);
+
+        bool thrown = false;
+        try {
+            q.push(4);
+        }
+        catch (std::out_of_range&){
+            thrown = true;
+        }
+        TEST_CHECK(thrown);
+
+        /* the consumer's copy of the tail is only refreshed when it runs dry */
+        TEST_CHECK(q.readable() == 2 && !memcmp(q.front(), "de", 2));
+        q.pop(2);
+        TEST_CHECK(q.readable() == 3 && !memcmp(q.front(), "fgh", 3));
+        q.pop(3);
+        TEST_CHECK(q.empty() && q.readable() == 0);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("write/read across the end");
+    {
+        spsc_queue_buffer<int> q(8);
+        int in[6] = { 1, 2, 3, 4, 5, 6 };
+        int out[8] = { 0 };
+        TEST_CHECK(q.write(in, 6) == 6);
+        TEST_CHECK(q.read(out, 4) == 4);
+        TEST_CHECK(q.write(in, 6) == 6);
+        TEST_CHECK(q.write(in, 6) == 0);
+        TEST_CHECK(q.read(out, 8) == 8);
+        TEST_CHECK(out[0] == 5 && out[1] == 6 && out[2] == 1 && out[7] == 6);
+        TEST_CHECK(q.empty());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("two threads");
+    {
+        /* odd batch sizes so that batches straddle the end of the ring */
+        const uint32_t count = 1 << 22;
+        spsc_queue_buffer<uint32_t> q(1024);
+        uint64_t sum = 0;
+        bool ordered = true;
+        std::thread consumer([&]{
+            uint32_t expect = 0;
+            while (expect < count){
+                size_t n = q.readable();
+                if (n == 0){
+                    std::this_thread::yield();
+                    continue;
+                }
+                const uint32_t* p = q.front();
+                for (size_t i = 0; i < n; ++i){
+                    ordered = ordered && p[i] == expect;
+                    sum += p[i];
+                    ++expect;
+                }
+                q.pop(n);
+            }
+        });
+
+        uint32_t next = 0;
+        while (next < count){
+            size_t n = q.writable();
+            if (n == 0){
+                std::this_thread::yield();
+                continue;
+            }
+            if (n > 37){
+                n = 37;
+            }
+            if (n > count - next){
+                n = count - next;
+            }
+            uint32_t* p = q.tail();
+            for (size_t i = 0; i < n; ++i){
+                p[i] = next++;
+            }
+            q.push(n);
+        }
+        consumer.join();
+        TEST_CHECK(ordered);
+        TEST_CHECK(sum == (uint64_t)count * (count - 1) / 2);
+        TEST_CHECK(q.empty());
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
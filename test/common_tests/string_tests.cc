@@ -85,6 +85,44 @@ void string_tests() {
     }
     END_TEST_CASE();
     
+    BEGIN_TEST_CASE("split_view");
+    {
+        /* the same parts as split(), for every separator and limit */
+        const char* inputs[] = { "", ",", "a", "a,", ",a", "a,,b", "0,20,330,4440,55550,666660,", ",,," };
+        bool same = true;
+        for (auto in : inputs){
+            string s(in);
+            for (size_t splits : { (size_t)-1, (size_t)1, (size_t)2, (size_t)5 }){
+                strings lazy;
+                for (auto& p : s.split_view(',', splits)){
+                    lazy.push_back(p);
+                }
+                same = same && lazy == s.split(',', splits);
+
+                lazy.clear();
+                for (auto& p : s.split_view(string(",,"), splits)){
+                    lazy.push_back(p);
+                }
+                same = same && lazy == s.split(",,", splits);
+
+                small_vector<string, 4> small;
+                s.split(small, ',', splits);
+                same = same && strings(small.begin(), small.end()) == s.split(',', splits);
+            }
+        }
+        TEST_CHECK(same);
+
+        auto words = string("GET /index.html HTTP/1.1\r\n").split_view_any(" \r\n");
+        strings w(words.begin(), words.end());
+        TEST_CHECK(w.size() == 4 && w[0] == "GET" && w[2] == "HTTP/1.1" && w[3].empty());
+        TEST_CHECK(string("").split_view(',').empty());
+        TEST_CHECK(string("a=b=c").split_view_any("=", 1).begin()->length() == 1);
+
+        auto it = string("x;y").split_view(';').begin();
+        TEST_CHECK(*it++ == "x" && *it == "y");
+    }
+    END_TEST_CASE();
+
     BEGIN_TEST_CASE("starts_with/ends_with");
     {
         auto s = string("hello world!");
@@ -127,6 +165,52 @@ void string_tests() {
             TEST_CHECK(strs[i].to_longlong() == values[i]);
         }
     }
+
+    {
+        /* views end where their text does, not at a NUL */
+        string v("12345", 2);
+        TEST_CHECK(v.to_int() == 12 && v.to_double() == 12 && v.to_longlong() == 12);
+        TEST_CHECK(string("99999999999").to_int() == INT_MAX && string("+7").to_int() == 7);
+        std::string digits(100, '1');
+        TEST_CHECK(string(digits.c_str(), digits.length()).to_double() == atof(digits.c_str()));
+
+        /* one sign only, as atoi() */
+        string sign("+-5");
+        TEST_CHECK(sign.to_int() == 0 && sign.to_double() == 0 && sign.to_longlong() == 0);
+        TEST_CHECK(string("+-5").to_int() == atoi("+-5"));
+        /* hexadecimal is not read, by to_double() either */
+        string hex("0x10");
+        TEST_CHECK(hex.to_int() == 0 && hex.to_double() == 0 && hex.to_longlong() == 0);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("parse");
+    {
+        int i = 0;
+        TEST_CHECK(string("-42").parse(i) == conv_errc::none && i == -42);
+        TEST_CHECK(string("42 ").parse(i) == conv_errc::invalid && i == -42);
+        TEST_CHECK(string("").parse(i) == conv_errc::invalid);
+        TEST_CHECK(string("2147483648").parse(i) == conv_errc::out_of_range);
+        TEST_CHECK(string("2147483647").parse<int>() == INT_MAX);
+        TEST_CHECK(string("-1").parse<short>() == -1 && string("65535").parse<unsigned short>() == 65535);
+        TEST_CHECK(string("18446744073709551615").parse<unsigned long long>() == ULLONG_MAX);
+        TEST_CHECK(string("0.1").parse<double>() == 0.1 && string("-2.5e-3").parse<float>() == -2.5e-3f);
+
+        bool invalid = false, range = false;
+        try {
+            string("12x").parse<long>();
+        }
+        catch (std::invalid_argument&){
+            invalid = true;
+        }
+        try {
+            string("-129").parse<signed char>();
+        }
+        catch (std::out_of_range&){
+            range = true;
+        }
+        TEST_CHECK(invalid && range);
+    }
     END_TEST_CASE();
 
     BEGIN_TEST_CASE("find/rfind/search");
@@ -0,0 +1,195 @@
+#include <hydrogen/common/thread_pool.h>
+#include <iostream>
+#include <chrono>
+#include <stdexcept>
+
+#include "test.h"
+using namespace hy;
+
+static void spawn_tree(thread_pool& pool, std::atomic<int>& count, int depth){
+    count.fetch_add(1);
+    if (depth == 0){
+        return;
+    }
+    pool.submit([&pool, &count, depth]{ spawn_tree(pool, count, depth - 1); });
+    pool.submit([&pool, &count, depth]{ spawn_tree(pool, count, depth - 1); });
+}
+
+void thread_pool_tests() {
+    BEGIN_TEST_PACKAGE("common/thread_pool");
+
+    BEGIN_TEST_CASE("deque push/pop/steal");
+    {
+        work_stealing_deque<int> d(2);
+        int items[100];
+        for (int i = 0; i < 100; ++i){
+            items[i] = i;
+            d.push(items + i);
+        }
+        TEST_CHECK(d.size() == 100);
+        /* the owner takes the newest, thieves the oldest */
+        TEST_CHECK(d.pop() == items + 99);
+        TEST_CHECK(d.steal() == items);
+        TEST_CHECK(d.steal() == items + 1);
+
+        size_t left = 0;
+        while (d.pop()){
+            ++left;
+        }
+        TEST_CHECK(left == 97 && d.empty());
+        TEST_CHECK(d.pop() == nullptr && d.steal() == nullptr);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("deque concurrent steal");
+    {
+        /* every item is taken exactly once, by the owner or a thief */
+        const int count = 200000;
+        std::vector<int> items(count);
+        std::vector<std::atomic<int>> taken(count);
+        for (int i = 0; i < count; ++i){
+            items[i] = i;
+            taken[i] = 0;
+        }
+
+        work_stealing_deque<int> d(16);
+        std::atomic<bool> done(false);
+        std::vector<std::thread> thieves;
+        for (int k = 0; k < 3; ++k){
+            thieves.emplace_back([&]{
+                while (!done.load() || !d.empty()){
+                    int* p = d.steal();
+                    if (p){
+                        taken[*p].fetch_add(1);
+                    }
+                    else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (int i = 0; i < count; ++i){
+            d.push(&items[i]);
+            if (i % 3 == 0){
+                int* p = d.pop();
+                if (p){
+                    taken[*p].fetch_add(1);
+                }
+            }
+        }
+        int* p;
+        while ((p = d.pop()) != nullptr){
+            taken[*p].fetch_add(1);
+        }
+        done = true;
+        for (auto& t : thieves){
+            t.join();
+        }
+
+        bool once = true;
+        for (int i = 0; i < count; ++i){
+            once = once && taken[i].load() == 1;
+        }
+        TEST_CHECK(once);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("submit from outside");
+    {
+        thread_pool pool(4);
+        TEST_CHECK(pool.size() == 4);
+        TEST_CHECK(thread_pool::current_worker() == -1);
+
+        std::atomic<int> sum(0);
+        std::atomic<bool> on_worker(true);
+        for (int i = 1; i <= 1000; ++i){
+            pool.submit([&, i]{
+                sum.fetch_add(i);
+                int w = thread_pool::current_worker();
+                if (w < 0 || w >= 4){
+                    on_worker = false;
+                }
+            });
+        }
+        pool.wait_idle();
+        TEST_CHECK(sum.load() == 500500);
+        TEST_CHECK(on_worker.load());
+        TEST_CHECK(pool.pending() == 0);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("nested submit");
+    {
+        thread_pool pool(4, true);
+        std::atomic<int> count(0);
+        pool.submit([&]{ spawn_tree(pool, count, 12); });
+        pool.wait_idle();
+        TEST_CHECK(count.load() == (1 << 13) - 1);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("parked workers wake up");
+    {
+        thread_pool pool(2);
+        std::atomic<int> count(0);
+        for (int round = 0; round < 5; ++round){
+            /* long enough for the workers to park */
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            pool.submit([&]{ count.fetch_add(1); });
+            pool.wait_idle();
+        }
+        TEST_CHECK(count.load() == 5);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("throwing task");
+    {
+        thread_pool pool(2);
+        std::atomic<int> count(0);
+        for (int i = 0; i < 100; ++i){
+            pool.submit([&, i]{
+                count.fetch_add(1);
+                if (i % 10 == 0){
+                    throw std::runtime_error("task failed");
+                }
+            });
+        }
+        /* the workers go on; wait_idle() rethrows one exception, once */
+        bool thrown = false;
+        try {
+            pool.wait_idle();
+        }
+        catch (const std::runtime_error&){
+            thrown = true;
+        }
+        TEST_CHECK(thrown && count.load() == 100 && pool.pending() == 0);
+        pool.submit([&]{ count.fetch_add(1); });
+        pool.wait_idle();
+        TEST_CHECK(count.load() == 101);
+
+        /* the destructor drops what is kept */
+        {
+            thread_pool dropped(1);
+            dropped.submit([]{ throw std::runtime_error("dropped"); });
+        }
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("destructor runs queued tasks");
+    {
+        std::atomic<int> count(0);
+        {
+            thread_pool pool(2);
+            for (int i = 0; i < 100; ++i){
+                pool.submit([&]{
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    count.fetch_add(1);
+                });
+            }
+        }
+        TEST_CHECK(count.load() == 100);
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
@@ -0,0 +1,294 @@
+#include <hydrogen/nio/nio.h>
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+
+#ifndef WIN32
+#include <netinet/tcp.h>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#include <fcntl.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#endif
+
+#include "../common_tests/test.h"
+using namespace hy;
+
+namespace {
+    const int test_port = 7191;
+
+    /* Polls every acceptor until one of them accepts a connection, returns
+     * its index or -1.
+     */
+    int accept_any(socket_acceptor* acceptors, int count, stream_socket& s){
+        for (int round = 0; round < 1000; ++round){
+            for (int i = 0; i < count; ++i){
+                auto r = acceptors[i].try_accept();
+                if (r){
+                    s = std::move(r.value());
+                    return i;
+                }
+            }
+#ifdef WIN32
+            Sleep(1);
+#else
+            usleep(1000);
+#endif
+        }
+        return -1;
+    }
+
+    int get_option(stream_socket& s, int level, int name){
+        int value = 0;
+        socklen_t len = sizeof(value);
+        ::getsockopt(s.native_handle(), level, name, (char*)&value, &len);
+        return value;
+    }
+
+#ifdef __linux__
+    /* Runs `fn` in a child process with a network namespace of its own,
+     * where client Fast Open is off (net.ipv4.tcp_fastopen = 0). Returns
+     * the exit status of fn(), or -1 if the namespace cannot be made, e.g.
+     * without CAP_SYS_ADMIN.
+     */
+    template<typename Fn>
+    int without_client_fast_open(Fn fn){
+        pid_t pid = ::fork();
+        if (pid == 0){
+            if (::unshare(CLONE_NEWNET)){
+                _exit(100);
+            }
+            /* a new namespace starts with its loopback down */
+            ifreq ifr;
+            memset(&ifr, 0, sizeof(ifr));
+            strcpy(ifr.ifr_name, "lo");
+            int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+            ifr.ifr_flags = IFF_UP | IFF_LOOPBACK | IFF_RUNNING;
+            int sysctl = ::open("/proc/sys/net/ipv4/tcp_fastopen", O_WRONLY);
+            if (fd < 0 || ::ioctl(fd, SIOCSIFFLAGS, &ifr) || sysctl < 0 || ::write(sysctl, "0", 1) != 1){
+                _exit(100);
+            }
+            ::close(sysctl);
+            ::close(fd);
+            _exit(fn());
+        }
+        int status = 0;
+        if (pid < 0 || ::waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) == 100){
+            return -1;
+        }
+        return WEXITSTATUS(status);
+    }
+#endif
+}
+
+void acceptor_tests() {
+    BEGIN_TEST_PACKAGE("nio/socket_acceptor");
+
+    endpoint ep = endpoint::localhost(test_port);
+
+    BEGIN_TEST_CASE("reuse address");
+    {
+        TEST_CHECK(ep.name() == "127.0.0.1:" + std::to_string(test_port));
+        TEST_CHECK(endpoint("10.200.3.255:65535").name() == "10.200.3.255:65535");
+
+        /* a second round binds the port while the first round's connection
+         * is still in TIME_WAIT
+         */
+        for (int round = 0; round < 2; ++round){
+            socket_acceptor acceptor;
+            acceptor.open();
+            acceptor.set_reuse_address();
+            TEST_ASSERT(acceptor.try_listen(ep).ok());
+            stream_socket server;
+            socket_stream client(ep);
+            server = acceptor.accept();
+            server.close();
+        }
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("socket options");
+    {
+        socket_options opts = socket_options::low_latency();
+        opts.reuse_address = true;
+        opts.receive_buffer = 1 << 16;
+        socket_acceptor acceptor;
+        acceptor.open(opts);
+        acceptor.listen(ep);
+
+        stream_socket client(tcp_socket::new_socket(opts), 0);
+        TEST_CHECK(get_option(client, IPPROTO_TCP, TCP_NODELAY) != 0);
+        /* Linux reports twice the size it was given */
+        TEST_CHECK(get_option(client, SOL_SOCKET, SO_RCVBUF) >= 1 << 16);
+        TEST_ASSERT(client.try_connect_with(ep, "ping", 4, false).ok());
+
+        /* the accepted connection inherits the listener's options */
+        stream_socket server = acceptor.accept();
+        TEST_CHECK(get_option(server, IPPROTO_TCP, TCP_NODELAY) != 0);
+        char buf[4];
+        TEST_CHECK(server.read_some(buf, 4) == 4 && !memcmp(buf, "ping", 4));
+
+        /* the first option the system refuses is reported */
+        TEST_CHECK(!opts.apply(-1, socket_options::client).ok());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("handoff");
+    {
+        socket_acceptor acceptor;
+        acceptor.open();
+        acceptor.set_reuse_address();
+        acceptor.listen(ep);
+
+        /* each connection lands in the inbox of the worker pinned to its
+         * CPU, where there is one
+         */
+        const int workers = 3;
+        const int cpus = std::max(1, (int)std::thread::hardware_concurrency());
+        socket_handoff handoff(workers);
+        int notified = 0;
+        handoff.on_dispatch(1, [&]{ ++notified; });
+        std::vector<socket_stream> clients(8);
+        std::vector<int> expect(workers);
+        for (auto& c : clients){
+            c.open(ep);
+            stream_socket s = acceptor.accept();
+            auto cpu = s.incoming_cpu();
+            int w = handoff.dispatch(std::move(s));
+            TEST_CHECK(w >= 0 && w < workers && (!cpu || cpu.value() >= workers || w % cpus == cpu.value()));
+            ++expect[w];
+        }
+        /* or in the one chosen */
+        socket_stream extra(ep);
+        handoff.dispatch(1, acceptor.accept());
+        ++expect[1];
+
+        size_t total = 0;
+        for (int w = 0; w < workers; ++w){
+            std::vector<stream_socket> mine;
+            TEST_CHECK(handoff.take(w, mine) == (size_t)expect[w] && mine.size() == (size_t)expect[w]);
+            TEST_CHECK(handoff.take(w, mine) == 0);
+            total += mine.size();
+        }
+        TEST_CHECK(total == clients.size() + 1 && notified == expect[1]);
+
+        /* one worker more than CPUs: CPU 0 has two, taken in turn */
+        socket_handoff more(cpus + 1);
+        int first = more.worker_of_cpu(0);
+        TEST_CHECK(first + more.worker_of_cpu(0) == cpus && (first == 0 || first == cpus));
+        bool own = true;
+        for (int c = 1; c < cpus; ++c){
+            own = own && more.worker_of_cpu(c) == c;
+        }
+        TEST_CHECK(own && more.worker_of_cpu(-1) == -1 && more.worker_of_cpu(cpus) == -1);
+
+        /* buffers are recycled, allocated a chunk at a time */
+        buffer_pool pool(4096, 2);
+        char* a = pool.get();
+        char* b = pool.get();
+        TEST_CHECK(a != b && pool.allocated() == 2 && pool.buffer_size() == 4096);
+        pool.put(a);
+        TEST_CHECK(pool.get() == a && pool.allocated() == 2);
+        pool.get();
+        TEST_CHECK(pool.allocated() == 4);
+        pool.put(b);
+    }
+    END_TEST_CASE();
+
+#ifdef __linux__
+    BEGIN_TEST_CASE("incoming cpu");
+    {
+        socket_acceptor acceptor;
+        acceptor.open();
+        acceptor.set_reuse_address();
+        acceptor.listen(ep);
+        socket_stream client(ep);
+        stream_socket server = acceptor.accept();
+        auto cpu = server.incoming_cpu();
+        TEST_CHECK(cpu.ok() && cpu.value() >= 0);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("cpu steering");
+    {
+        const int group = 2;
+        socket_acceptor acceptors[group];
+        for (int i = 0; i < group; ++i){
+            acceptors[i].open();
+            acceptors[i].set_reuse_address();
+            acceptors[i].set_reuse_port();
+            acceptors[i].listen(ep);
+            acceptors[i].set_nonblocking();
+        }
+        acceptors[0].attach_cpu_steering(group);
+
+        socket_stream client(ep);
+        stream_socket server;
+        int index = accept_any(acceptors, group, server);
+        TEST_ASSERT(index >= 0);
+        auto cpu = server.incoming_cpu();
+        TEST_CHECK(cpu.ok() && cpu.value() % group == index);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("fast open");
+    {
+        socket_options server_opts;
+        server_opts.reuse_address = true;
+        server_opts.fast_open = 16;
+        server_opts.defer_accept_s = 1;
+        socket_acceptor acceptor;
+        acceptor.open(server_opts);
+        acceptor.listen(ep);
+
+        /* the first connection fetches a cookie, the second uses it when
+         * net.ipv4.tcp_fastopen allows; the requests get through either way
+         */
+        socket_options client_opts;
+        client_opts.fast_open = 1;
+        for (int round = 0; round < 2; ++round){
+            socket_stream client;
+            TEST_ASSERT(client.try_open(ep, client_opts, "hello", 5).ok());
+            TEST_CHECK(client.tellp() == 5);
+            stream_socket server = acceptor.accept();
+            char buf[5];
+            TEST_CHECK(server.try_read(buf, 5).ok() && !memcmp(buf, "hello", 5));
+        }
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("fast open off");
+    {
+        /* sendto(MSG_FASTOPEN) fails with EOPNOTSUPP: connect() instead */
+        int status = without_client_fast_open([&]{
+            socket_acceptor acceptor;
+            acceptor.open();
+            acceptor.set_reuse_address();
+            if (!acceptor.try_listen(ep).ok()){
+                return 1;
+            }
+            socket_options client_opts;
+            client_opts.fast_open = 1;
+            socket_stream client;
+            if (!client.try_open(ep, client_opts, "hello", 5).ok() || client.tellp() != 5){
+                return 2;
+            }
+            stream_socket server = acceptor.accept();
+            char buf[5];
+            return server.try_read(buf, 5).ok() && !memcmp(buf, "hello", 5) ? 0 : 3;
+        });
+        if (status < 0){
+            std::cout << "skipped: no network namespace\n";
+        }
+        TEST_CHECK(status <= 0);
+    }
+    END_TEST_CASE();
+#endif
+
+    END_TEST_PACKAGE();
+}
@@ -0,0 +1,384 @@
+#include <hydrogen/nio/nio.h>
+#include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <chrono>
+#include <vector>
+
+#include "../common_tests/test.h"
+using namespace hy;
+
+/* Counts heap allocations so that tests can assert there are none. */
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)){
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+namespace {
+    const int test_port = 7181;
+
+    /* Listens with SO_REUSEADDR so that the tests can be rerun right away. */
+    void listen(socket_acceptor& acceptor, const endpoint& ep){
+        acceptor.open();
+        acceptor.set_reuse_address();
+        acceptor.listen(ep);
+    }
+
+    /* Runs handlers until `done()` holds; an echo session never runs out of
+     * pending operations, so reactor::run() alone wouldn't return.
+     */
+    template<typename Pred>
+    void run_until(reactor& r, Pred done){
+        while (!done() && r.run_one()){
+        }
+    }
+
+    /* Echoes everything read from a connection until the peer closes it. */
+    class EchoSession {
+    public:
+        EchoSession(reactor& r) : _reactor(r){}
+
+        void accept(socket_acceptor& acceptor){
+            acceptor.async_accept(_reactor, [this](io_result<stream_socket> s){
+                if (s){
+                    _socket = std::move(s.value());
+                    read();
+                }
+            });
+        }
+
+        void read(){
+            _socket.async_read_some(_reactor, _buf, sizeof(_buf), [this](io_result<size_t> n){
+                if (n && n.value()){
+                    _socket.async_write(_reactor, _buf, n.value(), [this](io_result<size_t> w){
+                        if (w){
+                            read();
+                        }
+                    });
+                }
+                else {
+                    closed = true;
+                }
+            });
+        }
+
+        bool closed = false;
+
+    private:
+        reactor& _reactor;
+        stream_socket _socket;
+        char _buf[4096];
+    };
+
+    /* Sends a message and waits for its echo, `rounds` times. */
+    class PingClient {
+    public:
+        PingClient(reactor& r, size_t size) : _reactor(r), _size(size){
+            for (size_t i = 0; i < _size; ++i){
+                _out[i] = (char)('a' + i % 26);
+            }
+        }
+
+        void connect(const endpoint& ep){
+            _socket.async_connect(_reactor, ep, [this](io_result<void> r){
+                connected = r.ok();
+            });
+        }
+
+        void ping(size_t rounds){
+            _rounds = rounds;
+            next();
+        }
+
+        void close(){
+            _reactor.remove(_socket.native_handle());
+            _socket.close();
+        }
+
+        bool connected = false;
+        size_t completed = 0;
+        size_t mismatches = 0;
+
+    private:
+        void next(){
+            if (_rounds == 0){
+                return;
+            }
+            --_rounds;
+            _socket.async_write(_reactor, _out, _size, [this](io_result<size_t> w){
+                if (!w){
+                    return;
+                }
+                _socket.async_read(_reactor, _in, _size, [this](io_result<size_t> n){
+                    if (!n || n.value() != _size || memcmp(_in, _out, _size)){
+                        ++mismatches;
+                        return;
+                    }
+                    ++completed;
+                    next();
+                });
+            });
+        }
+
+        reactor& _reactor;
+        stream_socket _socket;
+        size_t _size;
+        size_t _rounds = 0;
+        char _out[512];
+        char _in[512];
+    };
+}
+
+void async_tests() {
+    BEGIN_TEST_PACKAGE("nio/reactor");
+
+    endpoint ep = endpoint::localhost(test_port);
+
+    BEGIN_TEST_CASE("accept/connect");
+    {
+        reactor r;
+        socket_acceptor acceptor;
+        listen(acceptor, ep);
+        bool accepted = false, connected = false;
+        stream_socket server, client;
+        acceptor.async_accept(r, [&](io_result<stream_socket> s){
+            accepted = s.ok();
+            if (s){
+                server = std::move(s.value());
+            }
+        });
+        client.async_connect(r, ep, [&](io_result<void> c){
+            connected = c.ok();
+        });
+        TEST_CHECK(!accepted && !connected);
+        TEST_CHECK(r.run() == 2);
+        TEST_CHECK(accepted && connected && r.pending() == 0);
+        r.remove(acceptor.native_handle());
+        r.remove(client.native_handle());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("connection refused");
+    {
+        reactor r;
+        stream_socket s;
+        int error = 0;
+        s.async_connect(r, endpoint::localhost(test_port + 1), [&](io_result<void> c){
+            error = c.error();
+        });
+        r.run();
+        TEST_CHECK(error == socket_error::connection_refused);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("echo");
+    {
+        reactor r;
+        socket_acceptor acceptor;
+        listen(acceptor, ep);
+        EchoSession session(r);
+        PingClient client(r, 100);
+        session.accept(acceptor);
+        client.connect(ep);
+        run_until(r, [&]{ return client.connected; });
+        TEST_ASSERT(client.connected);
+
+        client.ping(100);
+        run_until(r, [&]{ return client.completed == 100 || client.mismatches; });
+        TEST_CHECK(client.completed == 100 && client.mismatches == 0);
+
+        /* the session sees EOF once the client is gone */
+        client.close();
+        r.run();
+        TEST_CHECK(session.closed && r.pending() == 0);
+        r.remove(acceptor.native_handle());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("zero allocation per round trip");
+    {
+        reactor r;
+        socket_acceptor acceptor;
+        listen(acceptor, ep);
+        EchoSession session(r);
+        PingClient client(r, 512);
+        session.accept(acceptor);
+        client.connect(ep);
+        run_until(r, [&]{ return client.connected; });
+        TEST_ASSERT(client.connected);
+
+        /* warm up descriptor tables and operation free lists */
+        client.ping(100);
+        run_until(r, [&]{ return client.completed == 100 || client.mismatches; });
+
+        size_t before = allocations;
+        client.ping(1000);
+        run_until(r, [&]{ return client.completed == 1100 || client.mismatches; });
+        TEST_CHECK(client.completed == 1100);
+        TEST_CHECK(allocations == before);
+
+        client.close();
+        r.run();
+        r.remove(acceptor.native_handle());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("cancel");
+    {
+        reactor r;
+        socket_acceptor acceptor;
+        listen(acceptor, ep);
+        stream_socket server, client;
+        acceptor.async_accept(r, [&](io_result<stream_socket> s){
+            server = std::move(s.value());
+        });
+        client.async_connect(r, ep, [](io_result<void>){});
+        r.run();
+
+        char buf[16];
+        int error = 0;
+        server.async_read(r, buf, sizeof(buf), [&](io_result<size_t> n){
+            error = n.error();
+        });
+        TEST_CHECK(r.pending() == 1);
+        r.remove(server.native_handle());
+        r.run();
+        TEST_CHECK(error == socket_error::operation_aborted);
+        r.remove(acceptor.native_handle());
+        r.remove(client.native_handle());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("spin");
+    {
+        reactor r;
+        r.set_wait_mode(reactor::spin, 200);
+        r.set_busy_poll(50);
+        socket_acceptor acceptor;
+        listen(acceptor, ep);
+        EchoSession session(r);
+        PingClient client(r, 100);
+        session.accept(acceptor);
+        client.connect(ep);
+        run_until(r, [&]{ return client.connected; });
+        client.ping(100);
+        run_until(r, [&]{ return client.completed == 100 || client.mismatches; });
+        TEST_CHECK(client.completed == 100 && client.mismatches == 0);
+        TEST_CHECK(r.get_wait_stats().spin_hits > 0);
+        TEST_CHECK(r.spin_budget() == 200);
+
+        client.close();
+        r.run();
+        r.remove(acceptor.native_handle());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("adaptive spin backs off when idle");
+    {
+        reactor r;
+        r.set_wait_mode(reactor::adaptive, 1000);
+        socket_acceptor acceptor;
+        listen(acceptor, ep);
+        EchoSession session(r);
+        PingClient client(r, 100);
+        session.accept(acceptor);
+        client.connect(ep);
+        run_until(r, [&]{ return client.connected; });
+
+        /* nothing happens: every spin misses and halves the budget */
+        for (int i = 0; i < 12; ++i){
+            r.run_one(1);
+        }
+        TEST_CHECK(r.spin_budget() == 0);
+        TEST_CHECK(r.get_wait_stats().spin_misses >= 10);
+        size_t sleeps = r.get_wait_stats().sleeps;
+        r.run_one(1);
+        TEST_CHECK(r.get_wait_stats().sleeps == sleeps + 1);
+
+        /* traffic grows the budget back */
+        client.ping(100);
+        run_until(r, [&]{ return client.completed == 100 || client.mismatches; });
+        TEST_CHECK(client.completed == 100);
+        TEST_CHECK(r.spin_budget() > 0);
+
+        client.close();
+        r.run();
+        r.remove(acceptor.native_handle());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("post from other threads");
+    {
+        reactor r;
+        const size_t threads = 4, tasks = 10000;
+        size_t done = 0;
+        bool on_loop = true;
+        std::vector<std::thread> producers;
+        for (size_t t = 0; t < threads; ++t){
+            producers.emplace_back([&]{
+                for (size_t i = 0; i < tasks; ++i){
+                    /* `done` is only touched on the reactor's thread */
+                    r.post([&]{
+                        ++done;
+                        on_loop = on_loop && r.in_loop();
+                    });
+                }
+            });
+        }
+        while (done < threads * tasks){
+            r.run_one(1000);
+        }
+        for (auto& t : producers){
+            t.join();
+        }
+        TEST_CHECK(done == threads * tasks && on_loop);
+        TEST_CHECK(r.pending() == 0 && !r.in_loop());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("run_in_loop");
+    {
+        reactor r;
+        bool outer = false, inner = false, inner_now = false;
+        /* not on the loop: queued until the reactor runs */
+        r.run_in_loop([&]{
+            outer = true;
+            /* on the loop: runs before run_in_loop() returns */
+            r.run_in_loop([&]{ inner = true; });
+            inner_now = inner;
+        });
+        TEST_CHECK(!outer && r.pending() == 1);
+        r.run();
+        TEST_CHECK(outer && inner && inner_now);
+
+        /* a task posted from another thread wakes up a sleeping reactor */
+        bool woken = false;
+        std::thread t([&]{
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            r.post([&]{ woken = true; });
+        });
+        socket_acceptor acceptor;
+        listen(acceptor, ep);
+        acceptor.async_accept(r, [](io_result<stream_socket>){});
+        while (!woken && r.run_one(5000)){
+        }
+        t.join();
+        TEST_CHECK(woken);
+        r.remove(acceptor.native_handle());
+        r.run();
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
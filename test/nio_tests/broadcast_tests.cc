@@ -0,0 +1,191 @@
+#include <hydrogen/nio/nio.h>
+#include <hydrogen/nio/broadcaster.h>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "../common_tests/test.h"
+using namespace hy;
+
+namespace {
+    const int test_port = 7301;
+
+    /* A reactor with `n` connected pairs: the server sides are connections
+     * subscribed to a broadcaster, the client sides are plain sockets.
+     */
+    struct fan_out {
+        fan_out(size_t n, size_t max_queued, connection::overflow_policy policy)
+            : clients(n){
+            socket_acceptor acceptor;
+            acceptor.open();
+            acceptor.set_reuse_address();
+            acceptor.listen(endpoint::localhost(test_port));
+            for (auto& c : clients){
+                stream_socket server;
+                int done = 0;
+                acceptor.async_accept(r, [&](io_result<stream_socket> s){
+                    if (s){
+                        server = std::move(s.value());
+                    }
+                    ++done;
+                });
+                c.async_connect(r, endpoint::localhost(test_port), [&](io_result<void>){
+                    ++done;
+                });
+                while (done < 2 && r.run_one()){
+                }
+                conns.emplace_back(new connection(r, std::move(server), max_queued, policy));
+                hub.subscribe(conns.back().get());
+            }
+        }
+
+        reactor r;
+        std::vector<stream_socket> clients;
+        std::vector<std::unique_ptr<connection> > conns;
+        broadcaster hub;
+    };
+
+    shared_buffer message(size_t size, char seed){
+        return shared_buffer::build(size, [&](char* p){
+            for (size_t i = 0; i < size; ++i){
+                p[i] = (char)(seed + i);
+            }
+        });
+    }
+}
+
+void broadcast_tests() {
+    BEGIN_TEST_PACKAGE("nio/broadcast");
+
+    BEGIN_TEST_CASE("shared_buffer");
+    {
+        shared_buffer a("hello", 5);
+        TEST_CHECK(a.size() == 5 && a.use_count() == 1);
+        shared_buffer b(a);
+        TEST_CHECK(b.data() == a.data() && a.use_count() == 2);
+        shared_buffer c(std::move(b));
+        TEST_CHECK(b.data() == nullptr && c.use_count() == 2);
+        c.release();
+        TEST_CHECK(a.use_count() == 1 && c.empty());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("fan-out");
+    {
+        const size_t subscribers = 4, messages = 100, size = 1000;
+        fan_out f(subscribers, 1 << 20, connection::disconnect);
+        TEST_CHECK(f.hub.subscribers() == subscribers);
+
+        std::vector<shared_buffer> sent;
+        for (size_t i = 0; i < messages; ++i){
+            sent.push_back(message(size, (char)i));
+            TEST_CHECK(f.hub.publish(sent.back()) == subscribers);
+        }
+
+        std::vector<std::vector<char> > received(subscribers, std::vector<char>(messages * size));
+        size_t complete = 0;
+        for (size_t i = 0; i < subscribers; ++i){
+            f.clients[i].async_read(f.r, received[i].data(), received[i].size(),
+                [&](io_result<size_t> n){
+                    if (n && n.value() == messages * size){
+                        ++complete;
+                    }
+                });
+        }
+        while (complete < subscribers && f.r.run_one(1000)){
+        }
+        TEST_CHECK(complete == subscribers);
+
+        bool same = true;
+        for (auto& in : received){
+            for (size_t i = 0; i < messages; ++i){
+                same = same && memcmp(in.data() + i * size, sent[i].data(), size) == 0;
+            }
+        }
+        TEST_CHECK(same);
+        /* every queue has let go of its references */
+        TEST_CHECK(sent[0].use_count() == 1 && sent.back().use_count() == 1);
+        TEST_CHECK(f.hub.delivered() == subscribers * messages && f.hub.dropped() == 0);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("queued, not copied");
+    {
+        /* nobody reads: most of the message stays queued on each connection */
+        fan_out f(3, 64 << 20, connection::disconnect);
+        shared_buffer big = message(32 << 20, 1);
+        TEST_CHECK(f.hub.publish(big) == 3);
+        TEST_CHECK(big.use_count() == 4);
+        for (auto& c : f.conns){
+            TEST_CHECK(c->queued_messages() == 1 && c->queued_bytes() > 0);
+        }
+        f.conns[0]->close();
+        TEST_CHECK(big.use_count() == 3);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("drop newest");
+    {
+        fan_out f(1, 256 << 10, connection::drop_newest);
+        shared_buffer m = message(64 << 10, 2);
+        size_t accepted = 0;
+        for (int i = 0; i < 1024; ++i){
+            accepted += f.hub.publish(m);
+        }
+        connection& c = *f.conns[0];
+        TEST_CHECK(c.is_open());
+        TEST_CHECK(accepted < 1024 && c.dropped() == 1024 - accepted);
+        TEST_CHECK(c.queued_bytes() <= (256 << 10));
+        TEST_CHECK(f.hub.dropped() == c.dropped());
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("drop oldest");
+    {
+        fan_out f(1, 256 << 10, connection::drop_oldest);
+        size_t accepted = 0;
+        for (int i = 0; i < 1024; ++i){
+            accepted += f.hub.publish(message(64 << 10, (char)i));
+        }
+        connection& c = *f.conns[0];
+        TEST_CHECK(c.is_open());
+        TEST_CHECK(accepted == 1024 && c.dropped() > 0);
+        /* a partly written front message may stay on top of the limit */
+        TEST_CHECK(c.queued_bytes() <= (256 << 10) + (64 << 10));
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("disconnect");
+    {
+        fan_out f(2, 256 << 10, connection::disconnect);
+        int closed_with = -1;
+        f.conns[0]->on_close([&](int error){ closed_with = error; });
+
+        /* subscriber 1 keeps up, subscriber 0 never reads */
+        std::vector<char> sink(64 << 10);
+        std::function<void(io_result<size_t>)> drain = [&](io_result<size_t> n){
+            if (n && n.value()){
+                f.clients[1].async_read_some(f.r, sink.data(), sink.size(), drain);
+            }
+        };
+        f.clients[1].async_read_some(f.r, sink.data(), sink.size(), drain);
+
+        shared_buffer m = message(64 << 10, 3);
+        for (int i = 0; i < 1024 && f.conns[0]->is_open(); ++i){
+            f.hub.publish(m);
+            while (f.r.poll()){
+            }
+        }
+        TEST_CHECK(!f.conns[0]->is_open());
+        TEST_CHECK(closed_with == socket_error::no_buffer_space);
+        TEST_CHECK(f.conns[1]->is_open());
+
+        /* the closed subscriber is forgotten */
+        TEST_CHECK(f.hub.publish(m) == 1);
+        TEST_CHECK(f.hub.subscribers() == 1);
+        f.conns[1]->close();
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
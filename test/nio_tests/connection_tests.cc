@@ -0,0 +1,162 @@
+#include <hydrogen/nio/nio.h>
+#include <hydrogen/nio/connection.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "../common_tests/test.h"
+using namespace hy;
+
+namespace {
+    const int test_port = 7401;
+
+    /* Connects `client` to `server` through `acceptor` on the reactor. */
+    void connect_pair(reactor& r, socket_acceptor& acceptor,
+                      stream_socket& client, stream_socket& server){
+        int done = 0;
+        acceptor.async_accept(r, [&](io_result<stream_socket> s){
+            if (s){
+                server = std::move(s.value());
+            }
+            ++done;
+        });
+        client.async_connect(r, endpoint::localhost(test_port), [&](io_result<void>){
+            ++done;
+        });
+        while (done < 2 && r.run_one()){
+        }
+    }
+}
+
+void connection_tests() {
+    BEGIN_TEST_PACKAGE("nio/connection");
+
+    socket_acceptor acceptor;
+    acceptor.open();
+    acceptor.set_reuse_address();
+    acceptor.listen(endpoint::localhost(test_port));
+
+    BEGIN_TEST_CASE("watermarks");
+    {
+        reactor r;
+        stream_socket client, server;
+        connect_pair(r, acceptor, client, server);
+        connection c(r, std::move(server));
+        c.set_watermarks(256 << 10, 64 << 10);
+
+        int pauses = 0, resumes = 0;
+        size_t queued_at_resume = 0;
+        c.on_pause([&]{ ++pauses; });
+        c.on_resume([&]{
+            ++resumes;
+            queued_at_resume = c.queued_bytes();
+        });
+
+        /* nobody reads yet: the queue grows until the producer is paused */
+        shared_buffer m = shared_buffer::build(64 << 10, [](char* p){
+            memset(p, 'x', 64 << 10);
+        });
+        size_t sent = 0;
+        while (!c.paused() && sent < 1024){
+            c.send(m);
+            ++sent;
+            r.poll();
+        }
+        TEST_CHECK(c.paused() && pauses == 1 && resumes == 0);
+        TEST_CHECK(c.queued_bytes() >= c.high_watermark());
+        TEST_CHECK(connection::total_queued_bytes() == c.queued_bytes());
+
+        /* the reader catches up: resumed once at the low watermark */
+        std::vector<char> in(64 << 10);
+        size_t received = 0;
+        std::function<void(io_result<size_t>)> drain = [&](io_result<size_t> n){
+            if (n && n.value()){
+                received += n.value();
+                if (received < sent * m.size()){
+                    client.async_read_some(r, in.data(), in.size(), drain);
+                }
+            }
+        };
+        client.async_read_some(r, in.data(), in.size(), drain);
+        while (received < sent * m.size() && r.run_one(1000)){
+        }
+        TEST_CHECK(received == sent * m.size());
+        TEST_CHECK(!c.paused() && pauses == 1 && resumes == 1);
+        TEST_CHECK(queued_at_resume <= c.low_watermark());
+        TEST_CHECK(c.queued_bytes() == 0 && connection::total_queued_bytes() == 0);
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("proxy stops reading while paused");
+    {
+        /* producer -> [inbound | proxy | out] -> sink */
+        reactor r;
+        stream_socket producer, inbound, sink, outbound;
+        connect_pair(r, acceptor, producer, inbound);
+        connect_pair(r, acceptor, sink, outbound);
+        connection out(r, std::move(outbound));
+        out.set_watermarks(256 << 10, 64 << 10);
+
+        const size_t total = 16 << 20;
+        std::vector<char> data(total), received(total);
+        for (size_t i = 0; i < total; ++i){
+            data[i] = (char)(i * 31);
+        }
+        producer.async_write(r, data.data(), data.size(), [](io_result<size_t>){});
+
+        /* the proxy forwards what it reads, and reads only while not paused */
+        std::vector<char> chunk(64 << 10);
+        bool reading = false;
+        size_t peak = 0;
+        std::function<void()> read_more = [&]{
+            reading = true;
+            inbound.async_read_some(r, chunk.data(), chunk.size(), [&](io_result<size_t> n){
+                reading = false;
+                if (!n || n.value() == 0){
+                    return;
+                }
+                out.send(shared_buffer(chunk.data(), n.value()));
+                peak = std::max(peak, out.queued_bytes());
+                if (!out.paused()){
+                    read_more();
+                }
+            });
+        };
+
+        /* the sink starts reading only after the first pause */
+        bool sink_started = false;
+        size_t got = 0;
+        std::function<void(io_result<size_t>)> on_sink = [&](io_result<size_t> n){
+            if (n && n.value()){
+                got += n.value();
+                if (got < total){
+                    sink.async_read_some(r, received.data() + got, total - got, on_sink);
+                }
+            }
+        };
+        out.on_pause([&]{
+            if (!sink_started){
+                sink_started = true;
+                sink.async_read_some(r, received.data(), total, on_sink);
+            }
+        });
+        out.on_resume([&]{
+            if (!reading){
+                read_more();
+            }
+        });
+
+        read_more();
+        while (got < total && r.run_one(1000)){
+        }
+        TEST_CHECK(sink_started);
+        TEST_CHECK(got == total && received == data);
+        /* the queue stayed within one read of the high watermark */
+        TEST_CHECK(peak < out.high_watermark() + chunk.size());
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
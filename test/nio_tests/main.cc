@@ -0,0 +1,17 @@
+#include <iostream>
+
+#pragma comment(lib, "hydrogen-nio")
+
+#define TEST(mod) do { void mod##_tests();\
+    std::cout << "Running " << #mod << "_tests()...\n";\
+    mod##_tests();\
+  } while (false)
+
+int main(int argc, char* argv[]) {
+    TEST(acceptor);
+    TEST(async);
+    TEST(relay);
+    TEST(broadcast);
+    TEST(connection);
+    return 0;
+}
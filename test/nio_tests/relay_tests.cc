@@ -0,0 +1,156 @@
+#include <hydrogen/nio/nio.h>
+#include <hydrogen/nio/relay.h>
+#include <iostream>
+#include <vector>
+
+#include "../common_tests/test.h"
+using namespace hy;
+
+namespace {
+    const int test_port = 7201;
+
+    /* Connects `client` to `server` through `acceptor` on the reactor. */
+    bool connect_pair(reactor& r, socket_acceptor& acceptor, const endpoint& ep,
+                      stream_socket& client, stream_socket& server){
+        int done = 0;
+        bool ok = true;
+        acceptor.async_accept(r, [&](io_result<stream_socket> s){
+            ok = ok && s.ok();
+            if (s){
+                server = std::move(s.value());
+            }
+            ++done;
+        });
+        client.async_connect(r, ep, [&](io_result<void> c){
+            ok = ok && c.ok();
+            ++done;
+        });
+        while (done < 2 && r.run_one()){
+        }
+        return ok;
+    }
+
+    /* Sends `out` one way through the relay and `back` the other way, then
+     * half-closes each direction, and checks what arrived.
+     */
+    bool round_trip(relay::mode m, size_t size, relay::mode& used, size_t& forwarded){
+        reactor r;
+        socket_acceptor acceptor;
+        acceptor.open();
+        acceptor.set_reuse_address();
+        acceptor.listen(endpoint::localhost(test_port));
+        endpoint ep = endpoint::localhost(test_port);
+
+        /* client -> [front | relay | back] -> server */
+        stream_socket client, front, back, server;
+        if (!connect_pair(r, acceptor, ep, client, front)
+            || !connect_pair(r, acceptor, ep, back, server)){
+            return false;
+        }
+
+        std::vector<char> out(size), in(size), reply(size / 2), reply_in(size / 2);
+        for (size_t i = 0; i < out.size(); ++i){
+            out[i] = (char)(i * 7);
+        }
+        for (size_t i = 0; i < reply.size(); ++i){
+            reply[i] = (char)(i * 13);
+        }
+
+        relay proxy(r, front, back, m);
+        used = proxy.get_mode();
+        bool relayed = false, eof_seen = false, reply_seen = false;
+        proxy.start([&](io_result<void> result){
+            relayed = result.ok();
+        });
+
+        client.async_write(r, out.data(), out.size(), [&](io_result<size_t> w){
+            if (w){
+                ::shutdown(client.native_handle(), 1);
+            }
+        });
+        server.async_read(r, in.data(), in.size(), [&](io_result<size_t> n){
+            if (!n || n.value() != in.size()){
+                return;
+            }
+            /* the client's half-close must come through as EOF ... */
+            static char extra;
+            server.async_read(r, &extra, 1, [&](io_result<size_t> e){
+                eof_seen = e && e.value() == 0;
+                /* ... while the other direction still works */
+                server.async_write(r, reply.data(), reply.size(), [&](io_result<size_t> w){
+                    if (w){
+                        ::shutdown(server.native_handle(), 1);
+                    }
+                });
+            });
+        });
+        client.async_read(r, reply_in.data(), reply_in.size(), [&](io_result<size_t> n){
+            reply_seen = n && n.value() == reply_in.size();
+        });
+
+        r.run();
+        forwarded = proxy.a_to_b() + proxy.b_to_a();
+        return relayed && eof_seen && reply_seen && in == out && reply_in == reply;
+    }
+}
+
+void relay_tests() {
+    BEGIN_TEST_PACKAGE("nio/relay");
+
+    BEGIN_TEST_CASE("copy");
+    {
+        relay::mode used;
+        size_t forwarded = 0;
+        TEST_CHECK(round_trip(relay::copy, 1 << 20, used, forwarded));
+        TEST_CHECK(used == relay::copy);
+        TEST_CHECK(forwarded == (1 << 20) + (1 << 19));
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("splice");
+    {
+        relay::mode used;
+        size_t forwarded = 0;
+        TEST_CHECK(round_trip(relay::splice, 1 << 20, used, forwarded));
+        TEST_CHECK(used == relay::default_mode());
+        TEST_CHECK(forwarded == (1 << 20) + (1 << 19));
+    }
+    END_TEST_CASE();
+
+    BEGIN_TEST_CASE("reset");
+    {
+        reactor r;
+        socket_acceptor acceptor;
+        acceptor.open();
+        acceptor.set_reuse_address();
+        acceptor.listen(endpoint::localhost(test_port));
+        endpoint ep = endpoint::localhost(test_port);
+
+        stream_socket client, front, back, server;
+        TEST_ASSERT(connect_pair(r, acceptor, ep, client, front));
+        TEST_ASSERT(connect_pair(r, acceptor, ep, back, server));
+
+        relay proxy(r, front, back);
+        int error = 0;
+        bool done = false;
+        proxy.start([&](io_result<void> result){
+            error = result.error();
+            done = true;
+        });
+
+        /* an abortive close of one leg ends both directions */
+        linger l;
+        l.l_onoff = 1;
+        l.l_linger = 0;
+        setsockopt(server.native_handle(), SOL_SOCKET, SO_LINGER, (const char*)&l, sizeof(l));
+        server.close();
+        while (!done && r.run_one()){
+        }
+        /* splice may see the reset as a broken pipe */
+        TEST_CHECK(done && (error == socket_error::connection_reset
+                            || error == socket_error::broken_pipe));
+    }
+    END_TEST_CASE();
+
+    END_TEST_PACKAGE();
+}
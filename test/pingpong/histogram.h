@@ -0,0 +1,156 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+/* latency_histogram records latency samples (in nanoseconds) into log-linear
+ * buckets: every power of two is divided into `sub_buckets` linear slots, which
+ * keeps the relative error of any reported percentile below 1/sub_buckets.
+ *
+ * Histograms are cheap to merge, so every benchmark thread keeps its own and
+ * the results are combined after the run.
+ */
+class latency_histogram {
+public:
+    static const int sub_bits = 7;
+    static const int sub_buckets = 1 << sub_bits;
+    static const int octaves = 64 - sub_bits + 1;
+
+    latency_histogram()
+        : _counts(octaves * sub_buckets, 0), _total(0), _sum(0), _min(UINT64_MAX), _max(0){}
+
+    /* Record one sample. */
+    void record(uint64_t value, uint64_t count = 1){
+        _counts[_index(value)] += count;
+        _total += count;
+        _sum += value * count;
+        if (value < _min){ _min = value; }
+        if (value > _max){ _max = value; }
+    }
+
+    /* Record one sample with coordinated-omission correction.
+     * If `value` is larger than the `expected_interval` between two requests,
+     * the requests that would have been issued while the sample was stalled are
+     * back-filled with linearly decreasing latencies, the same way
+     * HdrHistogram's recordValueWithExpectedInterval() does.
+     */
+    void record_corrected(uint64_t value, uint64_t expected_interval){
+        record(value);
+        if (expected_interval == 0 || value <= expected_interval){
+            return;
+        }
+        for (uint64_t missed = value - expected_interval;
+             missed >= expected_interval; missed -= expected_interval){
+            record(missed);
+        }
+    }
+
+    /* A copy of this histogram corrected for coordinated omission after the
+     * fact, for an `expected_interval` only known once all samples are in:
+     * every sample back-fills as with record_corrected(), taken at the upper
+     * bound of its bucket, like HdrHistogram's
+     * copyCorrectedForCoordinatedOmission().
+     */
+    latency_histogram corrected_copy(uint64_t expected_interval) const {
+        latency_histogram h(*this);
+        if (expected_interval == 0){
+            return h;
+        }
+        for (size_t i = 0; i < _counts.size(); ++i){
+            uint64_t value = std::min(_upper_bound(i), _max);
+            if (_counts[i] == 0 || value <= expected_interval){
+                continue;
+            }
+            for (uint64_t missed = value - expected_interval;
+                 missed >= expected_interval; missed -= expected_interval){
+                h.record(missed, _counts[i]);
+            }
+        }
+        return h;
+    }
+
+    void merge(const latency_histogram& h){
+        for (size_t i = 0; i < _counts.size(); ++i){
+            _counts[i] += h._counts[i];
+        }
+        _total += h._total;
+        _sum += h._sum;
+        _min = std::min(_min, h._min);
+        _max = std::max(_max, h._max);
+    }
+
+    void reset(){
+        std::fill(_counts.begin(), _counts.end(), 0);
+        _total = 0;
+        _sum = 0;
+        _min = UINT64_MAX;
+        _max = 0;
+    }
+
+    uint64_t count() const { return _total; }
+    uint64_t min() const { return _total ? _min : 0; }
+    uint64_t max() const { return _max; }
+    double mean() const { return _total ? (double)_sum / _total : 0.0; }
+
+    /* Value at percentile `p` (0 < p <= 100).
+     * The upper bound of the matching bucket is reported, clamped to max().
+     */
+    uint64_t percentile(double p) const {
+        if (_total == 0){
+            return 0;
+        }
+        uint64_t rank = (uint64_t)(p / 100.0 * _total + 0.5);
+        if (rank == 0){ rank = 1; }
+        if (rank > _total){ rank = _total; }
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < _counts.size(); ++i){
+            seen += _counts[i];
+            if (seen >= rank){
+                return std::min(_upper_bound(i), _max);
+            }
+        }
+        return _max;
+    }
+
+private:
+    static size_t _index(uint64_t value){
+        if (value < (uint64_t)sub_buckets){
+            return (size_t)value;
+        }
+        int msb = 63 - _clz(value);
+        int shift = msb - sub_bits;
+        /* bucket (shift + 1) covers [2^msb, 2^(msb+1)) with sub_buckets slots */
+        return (size_t)(shift + 1) * sub_buckets
+            + (size_t)((value >> shift) & (sub_buckets - 1));
+    }
+
+    static uint64_t _upper_bound(size_t index){
+        size_t bucket = index / sub_buckets;
+        uint64_t slot = index % sub_buckets;
+        if (bucket == 0){
+            return slot;
+        }
+        int shift = (int)bucket - 1;
+        return (((uint64_t)sub_buckets + slot + 1) << shift) - 1;
+    }
+
+    static int _clz(uint64_t v){
+#if defined(__GNUC__)
+        return __builtin_clzll(v);
+#else
+        int n = 0;
+        for (uint64_t bit = 1ull << 63; !(v & bit); bit >>= 1){
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    std::vector<uint64_t> _counts;
+    uint64_t _total;
+    uint64_t _sum;
+    uint64_t _min;
+    uint64_t _max;
+};
@@ -1,63 +1,1041 @@
+/* pingpong is the loopback benchmark suite of hydrogen-nio.
+ *
+ * An in-process echo server is started on localhost and a configurable number
+ * of client connections push messages through it. Latencies are collected in
+ * per-thread histograms and reported as throughput plus p50/p99/p999, both
+ * raw and corrected for coordinated omission.
+ *
+ *   pingpong [options]
+ *     --mode closed|open|churn|post
+ *                              closed loop: send the next message as soon as the
+ *                              previous one is echoed back (default);
+ *                              open loop: send at a fixed rate (see --rate);
+ *                              churn: one connection per message, the server
+ *                              resets a fraction of them (see --reset-rate);
+ *                              post: --connections threads hand tasks over to
+ *                              a reactor thread with reactor::post(), measured
+ *                              from post() to the task running
+ *     --connections N          number of client connections (1 - 10000)
+ *     --threads N              client threads (default: min(N, cores))
+ *     --server-threads N       echo server threads (default: min(N, cores))
+ *     --steer MODE             how the server assigns connections to its
+ *                              threads: none (round robin, default), handoff
+ *                              (by SO_INCOMING_CPU) or reuseport (a listener
+ *                              per thread, picked by the receiving CPU)
+ *     --rate R                 total messages per second. Required by open
+ *                              loop; for closed loop it sets the expected
+ *                              interval used by coordinated-omission correction,
+ *                              the mean service time when not given
+ *     --size SPEC              message size: N | fixed:N | uniform:A-B | exp:MEAN
+ *     --window BYTES           max bytes in flight per connection (open loop)
+ *     --relay copy|splice      put a relay thread between the clients and the
+ *                              echo server that forwards with recv/send
+ *                              (copy) or splice(2), and report its CPU use
+ *     --wait MODE              serve from one hy::reactor thread instead of
+ *                              the poll() workers, waiting for IO with the
+ *                              reactor wait mode block, spin or adaptive
+ *     --spin-us US             spin budget of --wait spin|adaptive (default 50)
+ *     --busy-poll US           SO_BUSY_POLL of the reactor's sockets
+ *     --reset-rate P           churn: fraction of connections reset by the
+ *                              server instead of answered (default 0.1)
+ *     --api throw|nothrow      churn: exercise the throwing IO methods or their
+ *                              non-throwing try_xxx() counterparts
+ *     --low-latency            TCP_NODELAY and TCP_QUICKACK on both sides
+ *     --fast-open              churn: TCP Fast Open, the request rides in the
+ *                              SYN (needs net.ipv4.tcp_fastopen = 3)
+ *     --duration SEC           measured run time (default 5)
+ *     --warmup SEC             discarded run time before measuring (default 1)
+ *     --port PORT              loopback port of the echo server (default 7070)
+ *     --verify                 validate echoed payloads
+ *     --check                  run the functional ping/getline checks first
+ *     --json FILE              write results as JSON to FILE ("-" for stdout)
+ */
 #include <iostream>
 #include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <set>
+#include <memory>
+#include <string>
+#include <cstdio>
 
 #include <hydrogen/nio/nio.h>
+#include <hydrogen/common/string.h>
+
+#include "histogram.h"
+#include "report.h"
+
+#ifdef WIN32
+#define poll WSAPoll
+#else
+#include <poll.h>
+#include <sys/resource.h>
+#endif
 
 using namespace hy;
 
 #pragma comment(lib, "hydrogen-nio")
 
+typedef std::chrono::steady_clock bench_clock;
+
+static uint64_t now_ns(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        bench_clock::now().time_since_epoch()).count();
+}
+
+/* Largest message the suite sends. */
+static const size_t max_message_size = 65536;
+
+/* Message sizes drawn per message: fixed, uniform or exponential. */
+class size_distribution {
+public:
+    enum kind { fixed, uniform, exponential };
+
+    size_distribution() : _kind(fixed), _a(64), _b(64){}
+
+    /* The message size if it is fixed, otherwise 0. */
+    size_t fixed_size() const { return _kind == fixed ? _a : 0; }
+
+    /* Parses N, fixed:N, uniform:A-B or exp:MEAN */
+    bool parse(const char* spec){
+        auto kv = hy::string(spec).split_kv(':');
+        hy::string name = kv.first, args = kv.second;
+        if (args.empty()){
+            name = "fixed";
+            args = kv.first;
+        }
+
+        if (name == "fixed"){
+            _kind = fixed;
+            _a = _b = args.to_int();
+        }
+        else if (name == "uniform"){
+            auto r = args.split_n<2>('-');
+            _kind = uniform;
+            _a = r[0].to_int();
+            _b = r[1].to_int();
+        }
+        else if (name == "exp"){
+            _kind = exponential;
+            _a = args.to_int();
+            _b = max_message_size;
+        }
+        else {
+            return false;
+        }
+        return _a > 0 && _b >= _a && _b <= max_message_size;
+    }
+
+    size_t next(std::mt19937_64& rng) const {
+        switch (_kind){
+        case uniform:
+            return std::uniform_int_distribution<size_t>(_a, _b)(rng);
+        case exponential: {
+            size_t s = (size_t)std::exponential_distribution<double>(1.0 / _a)(rng);
+            return s < 1 ? 1 : (s > _b ? _b : s);
+        }
+        default:
+            return _a;
+        }
+    }
+
+    std::string describe() const {
+        switch (_kind){
+        case uniform: return "uniform:" + std::to_string(_a) + "-" + std::to_string(_b);
+        case exponential: return "exp:" + std::to_string(_a);
+        default: return "fixed:" + std::to_string(_a);
+        }
+    }
+
+private:
+    kind   _kind;
+    size_t _a;
+    size_t _b;
+};
+
+/* How EchoServer assigns accepted connections to its workers. */
+enum steering_mode {
+    /* one accept thread, round robin */
+    steer_none,
+    /* one accept thread, each connection goes to the worker pinned to the
+     * CPU that received it (SO_INCOMING_CPU) */
+    steer_handoff,
+    /* one reuseport listener per worker; a BPF program makes the kernel pick
+     * the listener of the receiving CPU */
+    steer_reuseport
+};
+
+static const char* steering_name(steering_mode m){
+    static const char* names[] = { "none", "handoff", "reuseport" };
+    return names[m];
+}
+
+static const char* wait_name(reactor::wait_mode m){
+    static const char* names[] = { "block", "spin", "adaptive" };
+    return names[m];
+}
+
+struct bench_options {
+    bench_options()
+        : open_loop(false), churn(false), post(false), nothrow(false), connections(1),
+          threads(0), server_threads(0), rate(0), window(max_message_size),
+          reset_rate(0.1), steer(steer_none), use_relay(false),
+          relay_mode(relay::copy), low_latency(false), fast_open(false), use_reactor(false), wait(reactor::block),
+          spin_us(reactor::default_spin_us), busy_poll(0), duration(5), warmup(1), port(7070),
+          verify(false), check(false){}
+
+    const char* mode() const {
+        if (post){
+            return "post";
+        }
+        return churn ? "churn" : (open_loop ? "open" : "closed");
+    }
+
+    bool   open_loop;
+    bool   churn;
+    bool   post;
+    bool   nothrow;
+    int    connections;
+    int    threads;
+    int    server_threads;
+    double rate;
+    size_distribution size;
+    size_t window;
+    double reset_rate;
+    steering_mode steer;
+    bool   use_relay;
+    relay::mode relay_mode;
+    bool   low_latency;
+    bool   fast_open;
+    bool   use_reactor;
+    reactor::wait_mode wait;
+    int    spin_us;
+    int    busy_poll;
+    double duration;
+    double warmup;
+    int    port;
+    bool   verify;
+    bool   check;
+    std::string json;
+
+    /* socket profiles of the clients and of the echo server's listeners */
+    socket_options client_socket() const {
+        socket_options o = low_latency ? socket_options::low_latency() : socket_options();
+        o.fast_open = fast_open ? 1 : 0;
+        return o;
+    }
+
+    socket_options server_socket() const {
+        socket_options o = low_latency ? socket_options::low_latency() : socket_options();
+        /* successive runs reuse the port while old connections are in TIME_WAIT */
+        o.reuse_address = true;
+        o.fast_open = fast_open ? 4096 : 0;
+        return o;
+    }
+};
+
+/* Payload source. Message number `seq` starts at offset seq % 26, which lets
+ * the receiver validate echoed bytes without keeping a copy of each message.
+ */
+static char payload[max_message_size + 26];
+
+static const char* message_data(uint64_t seq){
+    return payload + seq % 26;
+}
+
+/* Connects a stream_socket to ep. */
+static stream_socket connect_to(const endpoint& ep, const socket_options& opts){
+    tcp_socket s = tcp_socket::new_socket(opts);
+    auto addr = ep.getaddr();
+    if (::connect(s.native_handle(), (sockaddr*)&addr, sizeof(addr))){
+        throw io_exception("socket connect error");
+    }
+    return stream_socket(std::move(s), stream_socket::readable | stream_socket::writable);
+}
+
+/* Aborts the connection with a RST instead of the orderly FIN handshake.
+ * The descriptor is closed directly: close() would shut it down first.
+ */
+static void abort_connection(stream_socket& s){
+    linger l;
+    l.l_onoff = 1;
+    l.l_linger = 0;
+    setsockopt(s.native_handle(), SOL_SOCKET, SO_LINGER, (const char*)&l, sizeof(l));
+    ::closesocket(s.release());
+}
+
+/* Pins the calling thread to `cpu`. */
+static bool pin_thread(int cpu){
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+/* EchoServer accepts connections and spreads them over a set of worker
+ * threads, each of which polls its connections and echoes whatever it reads.
+ *
+ * With steering, worker i is pinned to CPU i and gets the connections whose
+ * packets CPU i processes, so the softirq work and the echo run on the same
+ * core. Each worker allocates its buffer after pinning itself; with
+ * first-touch placement the buffer then lives on the worker's NUMA node.
+ *
+ * For the churn benchmark the server closes a connection once it has echoed
+ * `close_after` bytes, and resets a `reset_rate` fraction of connections
+ * instead of answering them.
+ */
 class EchoServer {
 public:
-    class EchoServerClient {
-    public:
-        EchoServerClient(stream_socket&& s)
-            : _client(std::move(s)){
+    EchoServer(endpoint ep, int threads, steering_mode steer = steer_none,
+               size_t close_after = 0, double reset_rate = 0,
+               const socket_options& opts = socket_options())
+        : _name(ep), _workers(threads), _handoff(threads), _steer(steer), _close_after(close_after),
+          _reset_rate(reset_rate), _options(opts), _accepted(0), _local(0), _stopped(false){}
+
+    ~EchoServer(){ stop(); }
+
+    void start(){
+        if (_steer == steer_reuseport){
+            /* the BPF program indexes the group in bind order */
+            for (auto& w : _workers){
+                listen(w.acceptor, true);
+            }
+            auto r = _workers[0].acceptor.try_attach_cpu_steering((int)_workers.size());
+            if (!r){
+                std::cerr << "EchoServer: no CPU steering, the kernel hashes connections instead: "
+                          << socket_error::message(r.error()) << '\n';
+            }
+        }
+        else {
+            listen(_acceptor, false);
+            _accept_thread = std::thread([this]{ accept(); });
+        }
+        for (size_t i = 0; i < _workers.size(); ++i){
+            worker* w = &_workers[i];
+            w->thread = std::thread([this, w, i]{ serve(*w, (int)i); });
+        }
+    }
+
+    void stop(){
+        _stopped = true;
+        if (_accept_thread.joinable()){
+            _accept_thread.join();
+        }
+        for (auto& w : _workers){
+            if (w.thread.joinable()){
+                w.thread.join();
+            }
         }
+    }
 
-        void operator()(){ run(); }
+    /* Fraction of accepted connections served on the CPU that received them. */
+    double locality() const {
+        return _accepted ? (double)_local / _accepted : 0.0;
+    }
 
-        void run() try {
-            char buf[4096];
-            while (true) {
-                auto size = _client.read_some(buf, sizeof(buf));
-                if (!size){
-                    std::cout << "EchoServerClient exit...\n";
-                    break;
+private:
+    struct worker {
+        std::thread thread;
+        /* steer_reuseport only */
+        socket_acceptor acceptor;
+    };
+
+    void listen(socket_acceptor& a, bool reuse_port){
+        a.open(_options);
+        if (reuse_port){
+            a.set_reuse_port();
+        }
+        a.listen(_name, SOMAXCONN);
+        a.set_nonblocking();
+    }
+
+    int cpu_of(int worker) const {
+        static const int cores = std::max(1, (int)std::thread::hardware_concurrency());
+        return worker % cores;
+    }
+
+    /* Accepts every pending connection of `a`, returns false on errors. */
+    template<typename Sink>
+    bool accept_all(socket_acceptor& a, Sink sink){
+        for (;;){
+            auto s = a.try_accept();
+            if (!s){
+                if (!socket_error::transient(s.error())
+                    && s.error() != socket_error::connection_aborted){
+                    std::cerr << "EchoServer accept error: "
+                              << socket_error::message(s.error()) << '\n';
+                    return false;
                 }
-                _client.write(buf, size);
+                return true;
+            }
+            ++_accepted;
+            sink(std::move(s.value()));
+        }
+    }
+
+    void accept(){
+        pollfd fd;
+        fd.fd = _acceptor.native_handle();
+        fd.events = POLLIN;
+        size_t next = 0;
+        const size_t n = _workers.size();
+        while (!_stopped){
+            if (poll(&fd, 1, 20) <= 0){
+                continue;
             }
+            accept_all(_acceptor, [&](stream_socket&& s){
+                if (_steer == steer_handoff){
+                    _handoff.dispatch(std::move(s));
+                }
+                else {
+                    _handoff.dispatch((int)(next++ % n), std::move(s));
+                }
+            });
         }
-        catch (hy::io_exception e){
-            std::cerr << "EchoServerClient exception out: " << e.what() << '\n';
+    }
+
+    void serve(worker& w, int index){
+        const int cpu = cpu_of(index);
+        if (_steer != steer_none){
+            socket_handoff::pin_worker(index);
         }
 
-    private:
-        socket_stream _client;
+        /* touched after pinning, so the pages are local to this worker */
+        buffer_pool buffers(max_message_size, 1);
+        char* buf = buffers.get();
+        std::vector<stream_socket> conns;
+        std::vector<pollfd> fds;
+        std::mt19937_64 rng(index + 1);
+        std::uniform_real_distribution<double> chance(0, 1);
+        const bool listening = _steer == steer_reuseport;
+
+        while (!_stopped){
+            if (!listening){
+                size_t first = conns.size();
+                _handoff.take(index, conns);
+                for (size_t i = first; _steer == steer_handoff && i < conns.size(); ++i){
+                    auto in = conns[i].incoming_cpu();
+                    if (in && in.value() == cpu){
+                        ++_local;
+                    }
+                }
+            }
+
+            /* the listener, if any, is polled last */
+            fds.resize(conns.size() + listening);
+            for (size_t i = 0; i < conns.size(); ++i){
+                fds[i].fd = conns[i].native_handle();
+                fds[i].events = POLLIN;
+                fds[i].revents = 0;
+            }
+            if (listening){
+                fds.back().fd = w.acceptor.native_handle();
+                fds.back().events = POLLIN;
+                fds.back().revents = 0;
+            }
+            if (fds.empty()){
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+                continue;
+            }
+            if (poll(fds.data(), fds.size(), 20) <= 0){
+                continue;
+            }
+
+            if (listening && fds.back().revents){
+                accept_all(w.acceptor, [&](stream_socket&& s){
+                    auto in = s.incoming_cpu();
+                    if (in && in.value() == cpu){
+                        ++_local;
+                    }
+                    conns.push_back(std::move(s));
+                });
+            }
+
+            for (size_t i = fds.size() - listening; i-- > 0;){
+                if (!fds[i].revents){
+                    continue;
+                }
+                stream_socket& c = conns[i];
+                auto rd = c.try_read_some(buf, buffers.buffer_size());
+                bool alive = rd && rd.value() != 0;
+                if (alive && c.bytes_out() == 0 && _reset_rate > 0
+                    && chance(rng) < _reset_rate){
+                    abort_connection(c);
+                    alive = false;
+                }
+                else if (alive){
+                    alive = c.try_write(buf, rd.value()).ok()
+                        && (_close_after == 0 || c.bytes_out() < _close_after);
+                }
+                if (!alive){
+                    c.swap(conns.back());
+                    conns.pop_back();
+                }
+            }
+        }
+    }
+
+    endpoint _name;
+    socket_acceptor _acceptor;
+    std::vector<worker> _workers;
+    socket_handoff _handoff;
+    steering_mode _steer;
+    size_t _close_after;
+    double _reset_rate;
+    socket_options _options;
+    std::thread _accept_thread;
+    std::atomic<uint64_t> _accepted;
+    std::atomic<uint64_t> _local;
+    std::atomic<bool> _stopped;
+};
+
+/* Reads the CPU time used by the calling thread, in seconds. */
+static double thread_cpu_seconds(){
+#if defined(__linux__)
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#elif defined(WIN32)
+    FILETIME created, exited, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user);
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime; u.HighPart = user.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) / 1e7;
+#else
+    return 0;
+#endif
+}
+
+/* RelayServer sits between the clients and the echo server. It accepts each
+ * client, connects it to the echo server and forwards both ways with a
+ * hy::relay, relaying every pair on one reactor thread.
+ */
+class RelayServer {
+public:
+    RelayServer(const endpoint& ep, const endpoint& upstream, relay::mode m)
+        : _name(ep), _upstream(upstream), _mode(m), _bytes(0), _cpu(0),
+          _stopped(false){}
+
+    ~RelayServer(){ stop(); }
+
+    void start(){
+        _acceptor.open();
+        _acceptor.set_reuse_address();
+        _acceptor.listen(_name, SOMAXCONN);
+        _thread = std::thread([this]{ run(); });
+    }
+
+    void stop(){
+        _stopped = true;
+        if (_thread.joinable()){
+            _thread.join();
+        }
+    }
+
+    /* Bytes forwarded in both directions. */
+    uint64_t bytes() const { return _bytes; }
+
+    /* CPU time of the relay thread, in seconds. */
+    double cpu_seconds() const { return _cpu; }
+
+private:
+    struct pair {
+        stream_socket front;
+        stream_socket back;
+        std::unique_ptr<relay> proxy;
     };
 
-    EchoServer(endpoint ep): _name(ep){}
+    void run(){
+        double cpu = thread_cpu_seconds();
+        accept();
+        while (!_stopped){
+            _reactor.run_one(20);
+        }
+        _cpu = thread_cpu_seconds() - cpu;
+        for (auto p : _pairs){
+            drop(p);
+        }
+    }
+
+    void accept(){
+        _acceptor.async_accept(_reactor, [this](io_result<stream_socket> s){
+            if (!s){
+                std::cerr << "RelayServer accept error: " << socket_error::message(s.error()) << '\n';
+                return;
+            }
+            pair* p = new pair;
+            p->front = std::move(s.value());
+            _pairs.insert(p);
+            p->back.async_connect(_reactor, _upstream, [this, p](io_result<void> c){
+                if (!c){
+                    _pairs.erase(p);
+                    drop(p);
+                    return;
+                }
+                p->proxy.reset(new relay(_reactor, p->front, p->back, _mode));
+                p->proxy->start([this, p](io_result<void>){
+                    _pairs.erase(p);
+                    drop(p);
+                });
+            });
+            accept();
+        });
+    }
 
-    void operator()(){ run(); }
+    void drop(pair* p){
+        if (p->proxy){
+            _bytes += p->proxy->a_to_b() + p->proxy->b_to_a();
+        }
+        _reactor.remove(p->front.native_handle());
+        _reactor.remove(p->back.native_handle());
+        delete p;
+    }
 
-    void run() try {
-        socket_acceptor acceptor;
-        acceptor.listen(_name);
+    endpoint _name;
+    endpoint _upstream;
+    relay::mode _mode;
+    reactor _reactor;
+    socket_acceptor _acceptor;
+    std::set<pair*> _pairs;
+    std::thread _thread;
+    std::atomic<uint64_t> _bytes;
+    double _cpu;
+    std::atomic<bool> _stopped;
+};
 
-        while (true){
-            EchoServerClient c(acceptor.accept());
-            c.run();
+/* ReactorEchoServer echoes on a single hy::reactor thread, with async reads
+ * and writes, so that the reactor's wait modes can be compared. The thread
+ * is pinned to the last CPU, away from the first client threads.
+ */
+class ReactorEchoServer {
+public:
+    ReactorEchoServer(const endpoint& ep, reactor::wait_mode m, int spin_us, int busy_poll)
+        : _name(ep), _cpu(0), _stopped(false){
+        _reactor.set_wait_mode(m, spin_us);
+        if (busy_poll > 0 && !_reactor.set_busy_poll(busy_poll)){
+            std::cerr << "ReactorEchoServer: no busy polling on this platform\n";
         }
     }
-    catch (hy::io_exception e) {
-        std::cerr << "EchoServer exception: " << e.what() << '\n';
+
+    ~ReactorEchoServer(){ stop(); }
+
+    void start(){
+        _acceptor.open();
+        _acceptor.set_reuse_address();
+        _acceptor.listen(_name, SOMAXCONN);
+        _thread = std::thread([this]{ run(); });
     }
-    catch (...){
-        std::cerr << "unknown exception captured.\n";
+
+    void stop(){
+        _stopped = true;
+        if (_thread.joinable()){
+            _thread.join();
+        }
     }
 
+    /* CPU time of the reactor thread, in seconds. */
+    double cpu_seconds() const { return _cpu; }
+
+    /* Read after stop(). */
+    const reactor::wait_stats& wait_stats() const { return _stats; }
+
 private:
+    struct session {
+        stream_socket socket;
+        char buf[16384];
+    };
+
+    void run(){
+        int cores = std::max(1, (int)std::thread::hardware_concurrency());
+        pin_thread(cores - 1);
+        double cpu = thread_cpu_seconds();
+        accept();
+        while (!_stopped){
+            _reactor.run_one(20);
+        }
+        _cpu = thread_cpu_seconds() - cpu;
+        _stats = _reactor.get_wait_stats();
+        for (auto s : _sessions){
+            drop(s);
+        }
+    }
+
+    void accept(){
+        _acceptor.async_accept(_reactor, [this](io_result<stream_socket> s){
+            if (!s){
+                std::cerr << "ReactorEchoServer accept error: " << socket_error::message(s.error()) << '\n';
+                return;
+            }
+            session* c = new session;
+            c->socket = std::move(s.value());
+            _sessions.insert(c);
+            read(c);
+            accept();
+        });
+    }
+
+    void read(session* c){
+        c->socket.async_read_some(_reactor, c->buf, sizeof(c->buf), [this, c](io_result<size_t> n){
+            if (!n || n.value() == 0){
+                _sessions.erase(c);
+                drop(c);
+                return;
+            }
+            c->socket.async_write(_reactor, c->buf, n.value(), [this, c](io_result<size_t> w){
+                if (!w){
+                    _sessions.erase(c);
+                    drop(c);
+                    return;
+                }
+                read(c);
+            });
+        });
+    }
+
+    void drop(session* c){
+        _reactor.remove(c->socket.native_handle());
+        delete c;
+    }
+
     endpoint _name;
+    reactor _reactor;
+    socket_acceptor _acceptor;
+    std::set<session*> _sessions;
+    std::thread _thread;
+    double _cpu;
+    reactor::wait_stats _stats;
+    std::atomic<bool> _stopped;
+};
+
+/* Results of one client thread; merged after the run. */
+struct client_stats {
+    client_stats() : messages(0), bytes(0), errors(0), backlogged(0), resets(0){}
+
+    void merge(const client_stats& s){
+        raw.merge(s.raw);
+        corrected.merge(s.corrected);
+        messages += s.messages;
+        bytes += s.bytes;
+        errors += s.errors;
+        backlogged += s.backlogged;
+        resets += s.resets;
+    }
+
+    /* latency measured from the actual send time */
+    latency_histogram raw;
+    /* latency corrected for coordinated omission */
+    latency_histogram corrected;
+    uint64_t messages;
+    uint64_t bytes;
+    uint64_t errors;
+    /* open loop: messages sent later than scheduled because the window was full */
+    uint64_t backlogged;
+    /* churn: connections reset by the server */
+    uint64_t resets;
+};
+
+/* LoadClient drives a share of the connections from one thread. */
+class LoadClient {
+public:
+    LoadClient(const bench_options& opt, int connections, uint64_t seed)
+        : _opt(opt), _count(connections), _rng(seed), _seq(seed << 32){}
+
+    void connect(const endpoint& ep){
+        for (int i = 0; i < _count; ++i){
+            _conns.push_back(connection(connect_to(ep, _opt.client_socket())));
+        }
+    }
+
+    void run(uint64_t start, uint64_t measure_from, uint64_t stop){
+        const size_t n = _conns.size();
+        std::vector<pollfd> fds(n);
+        std::vector<char> buf(max_message_size);
+        for (size_t i = 0; i < n; ++i){
+            fds[i].fd = _conns[i].sock.native_handle();
+            fds[i].events = POLLIN;
+        }
+
+        _measure_from = measure_from;
+        if (_opt.open_loop){
+            /* spread the first sends of each connection over one interval */
+            _interval = (uint64_t)(1e9 * _opt.connections / _opt.rate);
+            for (size_t i = 0; i < n; ++i){
+                uint64_t phase = std::uniform_int_distribution<uint64_t>(0, _interval)(_rng);
+                _schedule.push(std::make_pair(start + phase, i));
+            }
+        }
+        else {
+            _interval = _opt.rate > 0 ? (uint64_t)(1e9 * _opt.connections / _opt.rate) : 0;
+            for (size_t i = 0; i < n; ++i){
+                try {
+                    send(i, now_ns());
+                }
+                catch (const io_exception&){
+                    fail(i, fds[i]);
+                }
+            }
+        }
+
+        uint64_t now = now_ns();
+        while (now < stop){
+            int timeout = 10;
+            if (_opt.open_loop && !_schedule.empty()){
+                uint64_t due = _schedule.top().first;
+                timeout = due <= now + 1000000 ? 0 : (int)((due - now) / 1000000);
+            }
+
+            int ready = poll(fds.data(), n, timeout);
+            now = now_ns();
+            for (size_t i = 0; ready > 0 && i < n; ++i){
+                if (!fds[i].revents){
+                    continue;
+                }
+                --ready;
+                try {
+                    size_t rd = _conns[i].sock.read_some(buf.data(), buf.size());
+                    if (rd == 0){
+                        throw io_exception("connection closed by server");
+                    }
+                    receive(i, buf.data(), rd, now);
+                }
+                catch (const io_exception&){
+                    fail(i, fds[i]);
+                }
+            }
+
+            if (_opt.open_loop){
+                while (!_schedule.empty() && _schedule.top().first <= now){
+                    auto due = _schedule.top();
+                    _schedule.pop();
+                    if (_conns[due.second].dead){
+                        continue;
+                    }
+                    try {
+                        _conns[due.second].backlog.push_back(due.first);
+                        flush(due.second);
+                        _schedule.push(std::make_pair(due.first + _interval, due.second));
+                    }
+                    catch (const io_exception&){
+                        fail(due.second, fds[due.second]);
+                    }
+                }
+                if (_schedule.empty()){
+                    break;
+                }
+            }
+        }
+    }
+
+    const client_stats& stats() const { return _stats; }
+
+private:
+    struct message {
+        uint64_t seq;
+        uint64_t intended;
+        uint64_t sent;
+        size_t   size;
+    };
+
+    struct connection {
+        explicit connection(stream_socket&& s)
+            : sock(std::move(s)), inflight_bytes(0), received(0), dead(false){}
+        connection(connection&& c)
+            : sock(std::move(c.sock)), inflight(std::move(c.inflight)),
+              backlog(std::move(c.backlog)), inflight_bytes(c.inflight_bytes),
+              received(c.received), dead(c.dead){}
+
+        stream_socket sock;
+        std::deque<message> inflight;
+        /* open loop: scheduled send times still waiting for window space */
+        std::deque<uint64_t> backlog;
+        size_t inflight_bytes;
+        /* bytes of inflight.front() received so far */
+        size_t received;
+        bool dead;
+    };
+
+    void fail(size_t i, pollfd& fd){
+        ++_stats.errors;
+        _conns[i].dead = true;
+        _conns[i].sock.close();
+        fd.fd = -1;
+    }
+
+    void send(size_t i, uint64_t intended){
+        connection& c = _conns[i];
+        message m;
+        m.seq = _seq++;
+        m.size = _opt.size.next(_rng);
+        m.intended = intended;
+        m.sent = now_ns();
+        c.sock.write(message_data(m.seq), m.size);
+        c.inflight.push_back(m);
+        c.inflight_bytes += m.size;
+    }
+
+    /* open loop: send backlogged messages while the window allows */
+    void flush(size_t i){
+        connection& c = _conns[i];
+        while (!c.backlog.empty() && c.inflight_bytes < _opt.window){
+            uint64_t intended = c.backlog.front();
+            c.backlog.pop_front();
+            if (now_ns() - intended > _interval){
+                ++_stats.backlogged;
+            }
+            send(i, intended);
+        }
+    }
+
+    void receive(size_t i, const char* data, size_t len, uint64_t now){
+        connection& c = _conns[i];
+        while (len){
+            message& m = c.inflight.front();
+            size_t take = m.size - c.received;
+            if (take > len){
+                take = len;
+            }
+            if (_opt.verify
+                && memcmp(data, message_data(m.seq) + c.received, take)){
+                throw io_exception("echoed payload mismatch");
+            }
+            c.received += take;
+            data += take;
+            len -= take;
+
+            if (c.received == m.size){
+                complete(m, now);
+                c.inflight_bytes -= m.size;
+                c.received = 0;
+                c.inflight.pop_front();
+
+                if (_opt.open_loop){
+                    flush(i);
+                }
+                else {
+                    send(i, now);
+                }
+            }
+        }
+    }
+
+    void complete(const message& m, uint64_t now){
+        if (m.intended < _measure_from){
+            return;
+        }
+        ++_stats.messages;
+        _stats.bytes += m.size;
+        _stats.raw.record(now - m.sent);
+        if (_opt.open_loop){
+            /* measuring from the intended send time accounts for any stall */
+            _stats.corrected.record(now - m.intended);
+        }
+        else if (_interval){
+            _stats.corrected.record_corrected(now - m.sent, _interval);
+        }
+        /* closed loop without --rate: run_load() corrects after the run */
+    }
+
+    typedef std::pair<uint64_t, size_t> due_time;
+
+    const bench_options& _opt;
+    int _count;
+    std::mt19937_64 _rng;
+    uint64_t _seq;
+    uint64_t _interval;
+    uint64_t _measure_from;
+    std::vector<connection> _conns;
+    std::priority_queue<due_time, std::vector<due_time>, std::greater<due_time> > _schedule;
+    client_stats _stats;
+};
+
+/* ChurnClient opens a connection per message: connect, send, receive the
+ * echo, close. A share of the connections is reset by the server, so this
+ * compares the cost of failures reported by io_exception with failures
+ * reported by io_result from the try_xxx() methods.
+ */
+class ChurnClient {
+public:
+    ChurnClient(const bench_options& opt, const endpoint& ep)
+        : _opt(opt), _name(ep), _socket(opt.client_socket()), _buf(max_message_size){}
+
+    void run(uint64_t measure_from, uint64_t stop){
+        const size_t size = _opt.size.fixed_size();
+        for (uint64_t seq = 0, now = now_ns(); now < stop; ++seq){
+            bool reset = false, failed = false;
+            if (_opt.nothrow){
+                session_nothrow(message_data(seq), size, reset, failed);
+            }
+            else {
+                session_throw(message_data(seq), size, reset, failed);
+            }
+
+            uint64_t end = now_ns();
+            if (now >= measure_from){
+                if (reset){
+                    ++_stats.resets;
+                }
+                else if (failed){
+                    ++_stats.errors;
+                }
+                else {
+                    ++_stats.messages;
+                    _stats.bytes += size;
+                    _stats.raw.record(end - now);
+                    _stats.corrected.record(end - now);
+                }
+            }
+            now = end;
+        }
+    }
+
+    const client_stats& stats() const { return _stats; }
+
+private:
+    void session_throw(const char* data, size_t size, bool& reset, bool& failed){
+        try {
+            /* the request goes out with the connect, in the SYN with --fast-open */
+            socket_stream s;
+            s.open(_name, _socket, data, size);
+            s.read(_buf.data(), size);
+        }
+        catch (const io_exception& e){
+            reset = e.error() == socket_error::connection_reset;
+            failed = true;
+        }
+    }
+
+    void session_nothrow(const char* data, size_t size, bool& reset, bool& failed){
+        socket_stream s;
+        io_result<void> o = s.try_open(_name, _socket, data, size);
+        if (!o){
+            reset = o.error() == socket_error::connection_reset;
+            failed = true;
+            return;
+        }
+        io_result<size_t> r = s.try_read(_buf.data(), size);
+        if (!r || r.value() != size){
+            reset = r.error() == socket_error::connection_reset;
+            failed = true;
+        }
+    }
+
+    const bench_options& _opt;
+    endpoint _name;
+    socket_options _socket;
+    std::vector<char> _buf;
+    client_stats _stats;
 };
 
 class PingpongTest {
@@ -70,9 +1048,9 @@ public:
         char wbuf[4096];
         char rbuf[sizeof(wbuf)];
 
-        int size = 16;
-        auto t1 = std::chrono::high_resolution_clock::now();
-        for (int i = 0; i < 10000; ++i) {
+        size_t size = 16;
+        bool passed = true;
+        for (int i = 0; i < 10000 && passed; ++i) {
             memset(wbuf, 0x61616161, size);
             wbuf[0] = '(';
             wbuf[size - 1] = ')';
@@ -81,7 +1059,7 @@ public:
 
             if (memcmp(wbuf, rbuf, size)){
                 std::cout << "PingpongTest failed at the " << i + 1 << "th loop.\n";
-                break;
+                passed = false;
             }
 
             size *= 2;
@@ -89,14 +1067,16 @@ public:
                 size = sizeof(wbuf);
             }
         }
-        auto tm = std::chrono::high_resolution_clock::now() - t1;
-        std::cout << "IO time: " << tm.count() << '\n';
-        std::cout << "PingpongTest send: " << stream.tellg() << ", recv: " << stream.tellp() << '\n';
+        validate(passed, "PingpongTest");
     }
-    catch (hy::io_exception e){
+    catch (const hy::io_exception& e){
         std::cerr << "PingpongTest exception out, " << e.what() << '\n';
     }
 
+    void validate(bool r, const char* test){
+        std::cout << test << ": " << (r ? "PASSED\n" : "FAILED\n");
+    }
+
 private:
     endpoint _name;
 };
@@ -145,7 +1125,7 @@ public:
         s.getline(buf, 5004);
         validate(l5000 == buf, "LineByLineTest #5");
     }
-    catch (hy::io_exception e){
+    catch (const hy::io_exception& e){
         std::cerr << "LineByLineTest exception out, " << e.what() << '\n';
     }
 
@@ -156,26 +1136,421 @@ private:
     endpoint _name;
 };
 
+/* Runs the closed or open loop benchmark, returns the merged statistics. */
+static client_stats run_load(const bench_options& opt, const endpoint& ep){
+    std::vector<std::unique_ptr<LoadClient> > clients;
+    for (int t = 0; t < opt.threads; ++t){
+        int share = opt.connections / opt.threads + (t < opt.connections % opt.threads);
+        clients.emplace_back(new LoadClient(opt, share, t + 1));
+        clients.back()->connect(ep);
+    }
+
+    uint64_t start = now_ns();
+    uint64_t measure_from = start + (uint64_t)(opt.warmup * 1e9);
+    uint64_t stop = measure_from + (uint64_t)(opt.duration * 1e9);
+
+    std::vector<std::thread> threads;
+    for (auto& c : clients){
+        LoadClient* client = c.get();
+        threads.emplace_back([=]{ client->run(start, measure_from, stop); });
+    }
+    for (auto& t : threads){
+        t.join();
+    }
 
-int main(){
-    endpoint ep = endpoint::localhost(7070);
+    client_stats total;
+    for (auto& c : clients){
+        total.merge(c->stats());
+    }
+    if (!opt.open_loop && opt.rate <= 0){
+        /* each connection sends again as soon as it has its answer, so the
+         * mean service time is the interval it would keep without stalls
+         */
+        total.corrected = total.raw.corrected_copy((uint64_t)total.raw.mean());
+    }
+    return total;
+}
+
+/* Runs the churn benchmark with one ChurnClient per connection. */
+static client_stats run_churn(const bench_options& opt, const endpoint& ep){
+    uint64_t measure_from = now_ns() + (uint64_t)(opt.warmup * 1e9);
+    uint64_t stop = measure_from + (uint64_t)(opt.duration * 1e9);
+
+    std::vector<std::unique_ptr<ChurnClient> > clients;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < opt.connections; ++t){
+        clients.emplace_back(new ChurnClient(opt, ep));
+        ChurnClient* client = clients.back().get();
+        threads.emplace_back([=]{ client->run(measure_from, stop); });
+    }
+    for (auto& t : threads){
+        t.join();
+    }
 
-    std::thread th2([&ep]()->void {
-        EchoServer server(ep);
-        server.run();
+    client_stats total;
+    for (auto& c : clients){
+        total.merge(c->stats());
+    }
+    return total;
+}
+
+/* Runs the handoff benchmark: each of opt.connections producer threads posts
+ * timestamped tasks to one reactor thread, with at most `window` of its tasks
+ * queued at a time. The reactor waits with opt.wait like --wait does; an
+ * acceptor one port above the relay's keeps it waiting for IO when idle, as
+ * the IO thread of a server would.
+ */
+static client_stats run_post(const bench_options& opt){
+    static const uint64_t window = 1024;
+    struct producer {
+        producer() : posted(0), done(0){}
+
+        uint64_t posted;
+        std::atomic<uint64_t> done;
+    };
+
+    reactor r;
+    r.set_wait_mode(opt.wait, opt.spin_us);
+    socket_acceptor keepalive;
+    keepalive.open(opt.server_socket());
+    keepalive.listen(endpoint::localhost(opt.port + 2));
+    keepalive.async_accept(r, [](io_result<stream_socket>){});
+
+    uint64_t measure_from = now_ns() + (uint64_t)(opt.warmup * 1e9);
+    uint64_t stop = measure_from + (uint64_t)(opt.duration * 1e9);
+
+    /* only the reactor thread records */
+    client_stats stats;
+    std::atomic<bool> stopping(false);
+    std::thread loop([&]{
+        int cores = std::max(1, (int)std::thread::hardware_concurrency());
+        pin_thread(cores - 1);
+        while (!stopping){
+            r.run_one(20);
+        }
+        /* run what is still queued, without waiting for IO */
+        while (r.poll()){
+        }
     });
 
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    std::vector<std::unique_ptr<producer> > producers;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < opt.connections; ++t){
+        producers.emplace_back(new producer);
+        producer* p = producers.back().get();
+        threads.emplace_back([&, p]{
+            while (now_ns() < stop){
+                if (p->posted - p->done.load(std::memory_order_acquire) >= window){
+                    std::this_thread::yield();
+                    continue;
+                }
+                ++p->posted;
+                uint64_t posted = now_ns();
+                r.post([&stats, p, posted, measure_from]{
+                    if (posted >= measure_from){
+                        uint64_t latency = now_ns() - posted;
+                        ++stats.messages;
+                        stats.raw.record(latency);
+                        stats.corrected.record(latency);
+                    }
+                    p->done.fetch_add(1, std::memory_order_release);
+                });
+            }
+        });
+    }
+    for (auto& t : threads){
+        t.join();
+    }
+    stopping = true;
+    loop.join();
+    r.remove(keepalive.native_handle());
+    return stats;
+}
+
+static bool parse_options(int argc, char* argv[], bench_options& opt){
+    for (int i = 1; i < argc; ++i){
+        auto kv = hy::string(argv[i]).split_kv('=');
+        hy::string key = kv.first;
+        hy::string val = kv.second;
+        if (!key.starts_with("--")){
+            return false;
+        }
+        key.pop_front(2);
+
+        bool flag = key == "verify" || key == "check" || key == "low-latency"
+            || key == "fast-open";
+        if (!flag && val.empty()){
+            if (i + 1 >= argc){
+                return false;
+            }
+            val = argv[++i];
+        }
+
+        if (key == "mode"){
+            if (val != "open" && val != "closed" && val != "churn" && val != "post"){
+                return false;
+            }
+            opt.open_loop = val == "open";
+            opt.churn = val == "churn";
+            opt.post = val == "post";
+        }
+        else if (key == "api"){
+            if (val != "throw" && val != "nothrow"){
+                return false;
+            }
+            opt.nothrow = val == "nothrow";
+        }
+        else if (key == "reset-rate"){ opt.reset_rate = val.to_double(); }
+        else if (key == "relay"){
+            if (val != "copy" && val != "splice"){
+                return false;
+            }
+            opt.use_relay = true;
+            opt.relay_mode = val == "splice" ? relay::splice : relay::copy;
+        }
+        else if (key == "wait"){
+            if (val == "block"){ opt.wait = reactor::block; }
+            else if (val == "spin"){ opt.wait = reactor::spin; }
+            else if (val == "adaptive"){ opt.wait = reactor::adaptive; }
+            else { return false; }
+            opt.use_reactor = true;
+        }
+        else if (key == "spin-us"){ opt.spin_us = val.to_int(); }
+        else if (key == "busy-poll"){ opt.busy_poll = val.to_int(); }
+        else if (key == "steer"){
+            if (val == "none"){ opt.steer = steer_none; }
+            else if (val == "handoff"){ opt.steer = steer_handoff; }
+            else if (val == "reuseport"){ opt.steer = steer_reuseport; }
+            else { return false; }
+        }
+        else if (key == "connections"){ opt.connections = val.to_int(); }
+        else if (key == "threads"){ opt.threads = val.to_int(); }
+        else if (key == "server-threads"){ opt.server_threads = val.to_int(); }
+        else if (key == "rate"){ opt.rate = val.to_double(); }
+        else if (key == "window"){ opt.window = val.to_int(); }
+        else if (key == "duration"){ opt.duration = val.to_double(); }
+        else if (key == "warmup"){ opt.warmup = val.to_double(); }
+        else if (key == "port"){ opt.port = val.to_int(); }
+        else if (key == "json"){ opt.json = val.std_string(); }
+        else if (key == "low-latency"){ opt.low_latency = true; }
+        else if (key == "fast-open"){ opt.fast_open = true; }
+        else if (key == "verify"){ opt.verify = true; }
+        else if (key == "check"){ opt.check = true; }
+        else if (key == "size"){
+            if (!opt.size.parse(val.std_string().c_str())){
+                return false;
+            }
+        }
+        else {
+            return false;
+        }
+    }
+
+    if (opt.connections < 1 || opt.connections > 10000
+        || (opt.open_loop && opt.rate <= 0) || opt.duration <= 0){
+        return false;
+    }
+    /* the reactor server neither steers nor closes connections by itself */
+    if (opt.use_reactor && (opt.churn || opt.steer != steer_none || opt.spin_us < 0)){
+        return false;
+    }
+    /* the churn server closes after one message, so it must know the size */
+    if (opt.churn && (opt.size.fixed_size() == 0 || opt.reset_rate < 0 || opt.reset_rate > 1)){
+        return false;
+    }
+
+    int cores = (int)std::thread::hardware_concurrency();
+    cores = cores > 0 ? cores : 1;
+    if (opt.threads <= 0){
+        opt.threads = std::min(opt.connections, cores);
+    }
+    if (opt.server_threads <= 0){
+        opt.server_threads = std::min(opt.connections, cores);
+    }
+    opt.threads = std::min(opt.threads, opt.connections);
+    return true;
+}
+
+/* 10k connections need two descriptors each; raise the soft limit. */
+static void raise_fd_limit(){
+#ifndef WIN32
+    rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max){
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+#endif
+}
+
+static void print_latency(const char* name, const latency_histogram& h){
+    printf("  %-10s p50 %8.1fus  p99 %8.1fus  p999 %8.1fus  max %8.1fus\n", name,
+           h.percentile(50) / 1e3, h.percentile(99) / 1e3,
+           h.percentile(99.9) / 1e3, h.max() / 1e3);
+}
+
+/* Server side results that go into the report. */
+struct server_stats {
+    server_stats() : locality(0), relay_bytes(0), relay_cpu(0), reactor_cpu(0){}
+
+    double locality;
+    uint64_t relay_bytes;
+    double relay_cpu;
+    double reactor_cpu;
+    reactor::wait_stats waits;
+};
+
+static void write_json(FILE* out, const bench_options& opt, const client_stats& s,
+                       const server_stats& srv){
+    json_writer json(out);
+    json.begin_object();
+    json.begin_object("config")
+        .value("mode", opt.mode())
+        .value("connections", opt.connections)
+        .value("threads", opt.threads)
+        .value("server_threads", opt.server_threads)
+        .value("steering", steering_name(opt.steer))
+        .value("relay", opt.use_relay ? (opt.relay_mode == relay::splice ? "splice" : "copy") : "none")
+        .value("rate", opt.rate)
+        .value("size", opt.size.describe())
+        .value("window", (unsigned long long)opt.window)
+        .value("reset_rate", opt.churn ? opt.reset_rate : 0.0)
+        .value("api", opt.nothrow ? "nothrow" : "throw")
+        .value("low_latency", opt.low_latency)
+        .value("fast_open", opt.fast_open)
+        .value("server", opt.use_reactor ? "reactor" : "poll")
+        .value("wait", opt.use_reactor ? wait_name(opt.wait) : "none")
+        .value("spin_us", opt.use_reactor && opt.wait != reactor::block ? opt.spin_us : 0)
+        .value("busy_poll_us", opt.use_reactor ? opt.busy_poll : 0)
+        .value("duration", opt.duration)
+        .value("warmup", opt.warmup)
+        .end();
+    json.begin_object("throughput")
+        .value("messages", (unsigned long long)s.messages)
+        .value("bytes", (unsigned long long)s.bytes)
+        .value("messages_per_sec", s.messages / opt.duration)
+        .value("mbytes_per_sec", s.bytes / opt.duration / 1e6)
+        .value("errors", (unsigned long long)s.errors)
+        .value("backlogged", (unsigned long long)s.backlogged)
+        .value("resets", (unsigned long long)s.resets)
+        .end();
+    json.begin_object("server")
+        .value("locality", srv.locality)
+        .value("relay_bytes", (unsigned long long)srv.relay_bytes)
+        .value("relay_cpu_seconds", srv.relay_cpu)
+        .value("reactor_cpu_seconds", srv.reactor_cpu)
+        .value("spin_hits", (unsigned long long)srv.waits.spin_hits)
+        .value("spin_misses", (unsigned long long)srv.waits.spin_misses)
+        .value("sleeps", (unsigned long long)srv.waits.sleeps)
+        .end();
+    json.begin_object("latency_ns")
+        .value("raw", s.raw)
+        .value("corrected", s.corrected)
+        .end();
+    json.end();
+}
+
+int main(int argc, char* argv[]){
+    bench_options opt;
+    if (!parse_options(argc, argv, opt)){
+        std::cerr << "usage: pingpong [--mode closed|open|churn|post] [--connections N] [--threads N]\n"
+                     "                [--server-threads N] [--steer none|handoff|reuseport]\n"
+                     "                [--relay copy|splice] [--wait block|spin|adaptive] [--spin-us US]\n"
+                     "                [--busy-poll US] [--rate R] [--size SPEC] [--window BYTES]\n"
+                     "                [--reset-rate P] [--api throw|nothrow] [--low-latency]\n"
+                     "                [--fast-open] [--duration SEC]\n"
+                     "                [--warmup SEC] [--port PORT] [--verify] [--check] [--json FILE]\n";
+        return 1;
+    }
+
+    raise_fd_limit();
+    for (size_t i = 0; i < sizeof(payload); ++i){
+        payload[i] = (char)('a' + i % 26);
+    }
 
-    std::thread th1([&ep]()->void {
-        PingpongTest pptest(ep);
+    endpoint ep = endpoint::localhost(opt.port);
+    EchoServer server(ep, opt.server_threads, opt.steer,
+                      opt.churn ? opt.size.fixed_size() : 0,
+                      opt.churn ? opt.reset_rate : 0, opt.server_socket());
+    /* with a relay, clients talk to the relay one port up */
+    endpoint client_ep = opt.use_relay ? endpoint::localhost(opt.port + 1) : ep;
+    RelayServer relay_server(client_ep, ep, opt.relay_mode);
+    ReactorEchoServer reactor_server(ep, opt.wait, opt.spin_us, opt.busy_poll);
+    try {
+        if (opt.use_reactor){
+            reactor_server.start();
+        }
+        else {
+            server.start();
+        }
+        if (opt.use_relay){
+            relay_server.start();
+        }
+    }
+    catch (const io_exception& e){
+        std::cerr << "failed to start the echo server: " << e.what() << '\n';
+        return 1;
+    }
+
+    if (opt.check){
+        PingpongTest pptest(client_ep);
         pptest.run();
 
-        LineByLineTest lbltest(ep);
+        LineByLineTest lbltest(client_ep);
         lbltest.run();
-    });
-    
-    th1.join();
-    th2.join();
+    }
+
+    client_stats total = opt.post ? run_post(opt)
+        : (opt.churn ? run_churn(opt, client_ep) : run_load(opt, client_ep));
+    relay_server.stop();
+    reactor_server.stop();
+    server.stop();
+
+    server_stats srv;
+    srv.locality = server.locality();
+    srv.relay_bytes = relay_server.bytes();
+    srv.relay_cpu = relay_server.cpu_seconds();
+    srv.reactor_cpu = reactor_server.cpu_seconds();
+    srv.waits = reactor_server.wait_stats();
+
+    printf("%s, %d connections, api %s, size %s: %.0f msg/s, %.2f MB/s, %llu errors, %llu resets\n",
+           opt.mode(), opt.connections, opt.nothrow ? "nothrow" : "throw",
+           opt.size.describe().c_str(), total.messages / opt.duration,
+           total.bytes / opt.duration / 1e6, (unsigned long long)total.errors,
+           (unsigned long long)total.resets);
+    print_latency("raw", total.raw);
+    print_latency("corrected", total.corrected);
+    if (opt.steer != steer_none){
+        printf("  steering %s: %.1f%% of connections served on the CPU that received them\n",
+               steering_name(opt.steer), server.locality() * 100);
+    }
+    if (opt.use_reactor && !opt.post){
+        /* the server runs for the warmup too */
+        double seconds = opt.warmup + opt.duration;
+        printf("  reactor wait %s: server CPU %.0f%%, %llu spin hits, %llu spin misses, %llu sleeps\n",
+               wait_name(opt.wait), srv.reactor_cpu / seconds * 100,
+               (unsigned long long)srv.waits.spin_hits,
+               (unsigned long long)srv.waits.spin_misses,
+               (unsigned long long)srv.waits.sleeps);
+    }
+    if (opt.use_relay){
+        /* the relay runs for the warmup too */
+        double seconds = opt.warmup + opt.duration;
+        printf("  relay %s: %.2f GB/s, relay thread CPU %.0f%%, %.2f GB per CPU second\n",
+               opt.relay_mode == relay::splice ? "splice" : "copy",
+               srv.relay_bytes / seconds / 1e9, srv.relay_cpu / seconds * 100,
+               srv.relay_cpu > 0 ? srv.relay_bytes / srv.relay_cpu / 1e9 : 0.0);
+    }
+
+    if (!opt.json.empty()){
+        FILE* out = opt.json == "-" ? stdout : fopen(opt.json.c_str(), "w");
+        if (!out){
+            std::cerr << "failed to open " << opt.json << '\n';
+            return 1;
+        }
+        write_json(out, opt, total, srv);
+        if (out != stdout){
+            fclose(out);
+        }
+    }
     return 0;
 }
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "histogram.h"
+
+/* json_writer is a minimal streaming JSON emitter for benchmark reports.
+ * It only knows about the handful of value types the reports need and takes
+ * care of commas and indentation.
+ */
+class json_writer {
+public:
+    explicit json_writer(FILE* out) : _out(out), _first(true){}
+
+    json_writer& begin_object(const char* key = nullptr){
+        _key(key);
+        fputc('{', _out);
+        _levels.push_back('}');
+        _first = true;
+        return *this;
+    }
+
+    json_writer& begin_array(const char* key = nullptr){
+        _key(key);
+        fputc('[', _out);
+        _levels.push_back(']');
+        _first = true;
+        return *this;
+    }
+
+    json_writer& end(){
+        char close = _levels.back();
+        _levels.pop_back();
+        _newline();
+        fputc(close, _out);
+        _first = false;
+        if (_levels.empty()){
+            fputc('\n', _out);
+        }
+        return *this;
+    }
+
+    json_writer& value(const char* key, const char* s){
+        _key(key);
+        _string(s);
+        return *this;
+    }
+
+    json_writer& value(const char* key, const std::string& s){
+        return value(key, s.c_str());
+    }
+
+    json_writer& value(const char* key, bool b){
+        _key(key);
+        fputs(b ? "true" : "false", _out);
+        return *this;
+    }
+
+    json_writer& value(const char* key, int v){
+        return value(key, (long long)v);
+    }
+
+    json_writer& value(const char* key, unsigned long long v){
+        _key(key);
+        fprintf(_out, "%llu", v);
+        return *this;
+    }
+
+    json_writer& value(const char* key, long long v){
+        _key(key);
+        fprintf(_out, "%lld", v);
+        return *this;
+    }
+
+    json_writer& value(const char* key, double v){
+        _key(key);
+        fprintf(_out, "%.6g", v);
+        return *this;
+    }
+
+    /* Writes the summary of a latency histogram as an object. Units are ns. */
+    json_writer& value(const char* key, const latency_histogram& h){
+        begin_object(key);
+        value("count", (unsigned long long)h.count());
+        value("min", (unsigned long long)h.min());
+        value("mean", h.mean());
+        value("p50", (unsigned long long)h.percentile(50));
+        value("p90", (unsigned long long)h.percentile(90));
+        value("p99", (unsigned long long)h.percentile(99));
+        value("p999", (unsigned long long)h.percentile(99.9));
+        value("max", (unsigned long long)h.max());
+        return end();
+    }
+
+private:
+    void _key(const char* key){
+        if (!_first){
+            fputc(',', _out);
+        }
+        _first = false;
+        if (!_levels.empty()){
+            _newline();
+        }
+        if (key){
+            _string(key);
+            fputs(": ", _out);
+        }
+    }
+
+    void _newline(){
+        fputc('\n', _out);
+        for (size_t i = 0; i < _levels.size(); ++i){
+            fputs("  ", _out);
+        }
+    }
+
+    void _string(const char* s){
+        fputc('"', _out);
+        for (; *s; ++s){
+            if (*s == '"' || *s == '\\'){
+                fputc('\\', _out);
+            }
+            fputc(*s, _out);
+        }
+        fputc('"', _out);
+    }
+
+    FILE* _out;
+    bool  _first;
+    std::vector<char> _levels;
+};